@@ -7,12 +7,15 @@
  *		picohrdl driver API functions for the PicoLog ADC-20 and ADC-24 
  *		High Resolution Data Loggers.
  *
- *  There are five examples:
+ *  There are eight examples:
  *		Collect a block of samples immediately
  *		Collect a block of samples when a trigger event occurs
  *		Use windowing to collect a sequence of overlapped blocks
+ *		Keep sliding-window statistics from only the newly arrived samples
  *		Write a continuous stream of data to a disk file
  *		Take individual readings
+ *		Stream from every connected unit on one time base
+ *		Log through the multi-rate logger scheduler
  *
  *	To build this application:-
  *
@@ -46,10 +49,13 @@
  ******************************************************************************/
 #include <stdio.h>
 #include <math.h>
+#include <time.h>
 
 #ifdef WIN32
 #include <conio.h>
 #include <windows.h>
+#include <stdlib.h>
+#include <string.h>
 #include "HRDL.h"
 
 #else
@@ -121,6 +127,12 @@ return (fp>0)?0:-1;
 #define min(a,b) ((a) < (b) ? a : b)
 #endif
 
+#include "../../shared/PicoLoggerRing.h"
+#include "../../shared/PicoTimeSeries.h"
+#include "../../shared/PicoLoggerScheduler.h"
+#include "../../shared/PicoSlidingWindow.h"
+#include "../shared/LibAdapterpicohrdl.h"
+
 struct structChannelSettings 
 {
 	int16_t enabled;
@@ -136,11 +148,31 @@ int32_t		g_values[BUFFER_SIZE];
 int32_t		g_scaleTo_mv;
 int16_t		g_device;
 int16_t		g_doSet;
+int16_t		g_mains;
 int16_t		g_maxNoOfChannels;
 
 
 double inputRangeDivider [] = {1, 2, 4, 8, 16, 32, 64}; // Used for different voltage scales
 
+#define MULTI_CONVERSION		HRDL_100MS	// Conversion time used for multi-unit streaming
+#define MULTI_CONVERSION_MS		101			// Time per channel to allow for each conversion
+#define MULTI_RING_ROWS			1024		// Time slots kept while aligning the units
+#define MULTI_SETTLE_ROWS		2			// Newest slots left for units that report late
+#define SCHED_POLL_MS			1000		// Time between polls when hosted by the logger scheduler
+
+/* One unit in multi-unit streaming */
+typedef struct tHrdlUnit
+{
+	int16_t		handle;
+	int8_t		serial[20];
+	int16_t		digital;								/* The digital inputs come first in each sample */
+	int16_t		nChannels;								/* Enabled analog channels */
+	int16_t		channels[HRDL_MAX_ANALOG_CHANNELS];
+	float		scale[HRDL_MAX_ANALOG_CHANNELS];		/* mV (or 1 for ADC counts) per count of each channel */
+	uint32_t	firstColumn;							/* Column of the unit's first channel in the ring and store */
+	int64_t		startMs;								/* logger_time_ms when the unit was set running */
+}HRDL_UNIT;
+
 /****************************************************************************
 *
 * ResetChannels
@@ -413,6 +445,8 @@ void CollectBlockImmediate (void)
 *
 ****************************************************************************/
 #define WINDOWEDBLOCK 16
+void CollectWindowedIncremental(void);
+
 void CollectWindowedBlocks(void)
 {
 	int32_t		i;
@@ -424,6 +458,15 @@ void CollectWindowedBlocks(void)
 	int16_t		status = 1;
 
 	printf("\nCollect windowed block...\n");
+	printf("Read only the new readings each second and keep %d second\n", WINDOWEDBLOCK);
+	printf("sliding-window statistics instead (Y/N)?\n");
+
+	if (toupper(_getch()) == 'Y')
+	{
+		CollectWindowedIncremental();
+		return;
+	}
+
 	printf("First block appears after 16 seconds,\n");
 	printf("Subsequent blocks every second...\n");
 	printf("Press a key to start\n");
@@ -538,6 +581,132 @@ void CollectWindowedBlocks(void)
 	_getch();
 }
 
+/****************************************************************************
+*
+* CollectWindowedIncremental
+*	This function gives the figures of a WINDOWEDBLOCK second window
+*	each second without reading the window again. The unit streams, each
+*	call to HRDLGetValues returns only the readings since the last call,
+*	and these are printed and pushed into a sliding window per channel
+*	that keeps the mean, minimum, maximum and RMS of the last
+*	WINDOWEDBLOCK readings.
+*
+****************************************************************************/
+void CollectWindowedIncremental(void)
+{
+	SLIDING_WINDOW	windows[HRDL_MAX_ANALOG_CHANNELS + 1];
+	int16_t			initialised[HRDL_MAX_ANALOG_CHANNELS + 1] = {0};
+	int32_t			i;
+	int16_t			channel;
+	int32_t			noOfReadings;
+	int16_t			noOfActiveChannels;
+	int8_t			strError[80];
+	int16_t			status = 1;
+	float			value;
+
+	for (i = HRDL_ANALOG_IN_CHANNEL_1; i <= g_maxNoOfChannels && status; i++)
+	{
+		status = HRDLSetAnalogInChannel(g_device,
+										(int16_t)i,
+										g_channelSettings[i].enabled, 
+										(int16_t) g_channelSettings[i].range,
+										g_channelSettings[i].singleEnded);
+
+		if (status && g_channelSettings[i].enabled)
+		{
+			status = initialised[i] = window_init(&windows[i], WINDOWEDBLOCK);
+		}
+	}
+
+	if (status)
+	{
+		//
+		// Collect data at 1 second intervals, with maximum resolution
+		//
+		HRDLSetInterval(g_device, 1000, HRDL_660MS);
+		status = HRDLRun(g_device, BUFFER_SIZE, (int16_t) HRDL_BM_STREAM);
+	}
+
+	if (status == 0)
+	{
+		HRDLGetUnitInfo(g_device, strError, (int16_t) 80, HRDL_SETTINGS);
+		printf("Error occurred: %s\n\n", strError);
+	}
+	else
+	{
+		while (!HRDLReady(g_device))
+		{
+			Sleep (100);
+		}
+
+		HRDLGetNumberOfEnabledChannels(g_device, &noOfActiveChannels);
+		noOfActiveChannels = noOfActiveChannels + (int16_t)(g_channelSettings[HRDL_DIGITAL_CHANNELS].enabled);
+
+		printf("Press any key to stop\n\n");
+
+		while (!_kbhit ())
+		{
+			noOfReadings = HRDLGetValues(g_device, g_values, NULL, BUFFER_SIZE / noOfActiveChannels);
+
+			//
+			// Print only the new readings
+			//
+			for (i = 0; i < noOfReadings * noOfActiveChannels;)
+			{
+				for (channel = HRDL_DIGITAL_CHANNELS; channel <= HRDL_MAX_ANALOG_CHANNELS; channel++)
+				{
+					if (!g_channelSettings[channel].enabled)
+					{
+						continue;
+					}
+
+					if (channel == HRDL_DIGITAL_CHANNELS)
+					{
+						printf("%d%d%d%d\t",  0x01 & (g_values [i]), 0x01 & (g_values [i] >> 0x1), 0x01 & (g_values [i] >> 0x2), 0x01 & (g_values [i] >> 0x3));
+					}
+					else
+					{
+						value = AdcToMv ((HRDL_INPUTS) channel, g_values [i]);
+						window_push(&windows[channel], value);
+						printf ("Ch%d %f\t", channel, value);
+					}
+
+					i++;
+				}
+
+				printf("\n");
+			}
+
+			for (channel = HRDL_ANALOG_IN_CHANNEL_1; channel <= HRDL_MAX_ANALOG_CHANNELS; channel++)
+			{
+				if (initialised[channel])
+				{
+					printf("Ch%d over the last %u: mean %f, min %f, max %f, RMS %f\n", channel, window_length(&windows[channel]),
+						window_mean(&windows[channel]), window_min(&windows[channel]), window_max(&windows[channel]), window_rms(&windows[channel]));
+				}
+			}
+
+			printf ("Press any key to stop\n\n");
+
+			//
+			// Wait a second before asking again
+			//
+			Sleep (1000);
+		}
+
+		HRDLStop(g_device);
+		_getch();
+	}
+
+	for (channel = HRDL_ANALOG_IN_CHANNEL_1; channel <= HRDL_MAX_ANALOG_CHANNELS; channel++)
+	{
+		if (initialised[channel])
+		{
+			window_free(&windows[channel]);
+		}
+	}
+}
+
 /****************************************************************************
 *
 * CollectStreaming
@@ -1142,6 +1311,414 @@ int16_t SelectUnit(void)
 
 } 
 
+/****************************************************************************
+*
+* CollectMultiUnitStreaming
+*	This function demonstrates streaming from every connected unit at
+*	once, with the unit already opened as the first.
+*
+* All units run at the same interval and are drained from one loop.
+* Each reading is converted with a scale factor worked out once per
+* channel and put in a time-aligned ring against one monotonic clock, so
+* readings from different units taken at the same time share a row. Rows
+* are appended to the time-series store hrdl_multi without formatting,
+* and hrdl_multi.txt lists which unit and channel each column is.
+*
+****************************************************************************/
+void CollectMultiUnitStreaming (void)
+{
+	HRDL_UNIT *	units;
+	HRDL_UNIT *	unit;
+	LOGGER_RING	ring;
+	TS_STORE	store;
+	FILE *		fp;
+	int8_t		line[80];
+	int32_t		times[BUFFER_SIZE];
+	int32_t *	values;
+	float *		rowValues;
+	uint8_t *	rowFlags;
+	int16_t		overflow;
+	int16_t		nUnits = 0;
+	int16_t		maxChannels;
+	int16_t		handle;
+	int16_t		channel;
+	int16_t		status = 1;
+	int16_t		u;
+	int32_t		minAdc = 0;
+	int32_t		maxAdc = 0;
+	int32_t		intervalMs = 1000;
+	int32_t		nValues;
+	int32_t		valuesPerSample;
+	int32_t		raw;
+	int32_t		i;
+	int32_t		c;
+	uint32_t	nColumns = 0;
+	uint64_t	rows = 0;
+	int64_t		timeMs;
+	int64_t		firstRowMs = -1;
+	int64_t		wallStartMs;
+	int16_t		stop = FALSE;
+
+	units = (HRDL_UNIT *) calloc(HRDL_MAX_UNITS, sizeof(HRDL_UNIT));
+	values = (int32_t *) calloc(BUFFER_SIZE * (HRDL_MAX_ANALOG_CHANNELS + 1), sizeof(int32_t));
+
+	if (units == NULL || values == NULL)
+	{
+		free(units);
+		free(values);
+		return;
+	}
+
+	//
+	// The unit already open keeps its settings, the others are opened now
+	//
+	units[nUnits].handle = g_device;
+	units[nUnits++].digital = g_channelSettings[HRDL_DIGITAL_CHANNELS].enabled;
+
+	printf("Looking for more units");
+
+	while (nUnits < HRDL_MAX_UNITS && (handle = OpenDevice(TRUE)) > 0)
+	{
+		units[nUnits++].handle = handle;
+		HRDLSetMains(handle, g_mains);
+	}
+
+	printf("\n%d unit(s):\n", nUnits);
+
+	for (u = 0; u < nUnits && status; u++)
+	{
+		unit = &units[u];
+		HRDLGetUnitInfo(unit->handle, unit->serial, sizeof (unit->serial), HRDL_BATCH_AND_SERIAL);
+		HRDLGetUnitInfo(unit->handle, line, sizeof (line), HRDL_VARIANT_INFO);
+		maxChannels = atoi((char *) line) == 24 ? 16 : 8;
+
+		//
+		// Use the channels set up for the first unit, as far as each unit has them
+		//
+		unit->firstColumn = nColumns;
+
+		for (channel = HRDL_ANALOG_IN_CHANNEL_1; channel <= maxChannels && status; channel++)
+		{
+			status = HRDLSetAnalogInChannel(unit->handle, channel, g_channelSettings[channel].enabled,
+											(int16_t) g_channelSettings[channel].range, g_channelSettings[channel].singleEnded);
+
+			if (status && g_channelSettings[channel].enabled)
+			{
+				HRDLGetMinMaxAdcCounts(unit->handle, &minAdc, &maxAdc, channel);
+				unit->channels[unit->nChannels] = channel;
+				unit->scale[unit->nChannels] = g_scaleTo_mv ?
+					(float) ((2500.0 / pow(2.0, (double) g_channelSettings[channel].range)) / (double) maxAdc) : 1.0f;
+				unit->nChannels++;
+			}
+		}
+
+		if (!status)
+		{
+			HRDLGetUnitInfo(unit->handle, line, (int16_t) 80, HRDL_SETTINGS);
+			printf("Error occurred on unit %s: %s\n\n", unit->serial, line);
+			break;
+		}
+
+		nColumns += unit->nChannels;
+		intervalMs = max(intervalMs, ((unit->nChannels * MULTI_CONVERSION_MS + 999) / 1000) * 1000);
+		printf("%d: %s, %d channel(s)\n", u + 1, unit->serial, unit->nChannels);
+	}
+
+	if (status && nColumns == 0)
+	{
+		printf("No analog channels are enabled.\n");
+		status = 0;
+	}
+
+	//
+	// All units sample at the same interval, so their readings fall in the same time slots
+	//
+	for (u = 0; u < nUnits && status; u++)
+	{
+		status = HRDLSetInterval(units[u].handle, intervalMs, MULTI_CONVERSION);
+	}
+
+	if (status)
+	{
+		rowValues = (float *) calloc(nColumns, sizeof(float));
+		rowFlags = (uint8_t *) calloc(nColumns, sizeof(uint8_t));
+
+		if (!logger_ring_init(&ring, nColumns, MULTI_RING_ROWS, intervalMs) || rowValues == NULL || rowFlags == NULL)
+		{
+			printf("Error setting up multi-unit streaming.\n");
+		}
+		else if (!ts_store_open(&store, "hrdl_multi", nColumns))
+		{
+			printf("Cannot open the time-series store hrdl_multi, the channels may have changed since it was created.\n");
+		}
+		else
+		{
+			fopen_s(&fp, "hrdl_multi.txt", "w");
+
+			if (fp != NULL)
+			{
+				fprintf(fp, "Store: hrdl_multi (.tsr, .tsm, .tsh, .tsd)\n");
+				fprintf(fp, "Interval: %d ms\n", intervalMs);
+				fprintf(fp, "Units: %s\n\n", g_scaleTo_mv ? "mV" : "ADC counts");
+
+				for (u = 0; u < nUnits; u++)
+				{
+					for (c = 0; c < units[u].nChannels; c++)
+					{
+						fprintf(fp, "Column %u: %s channel %d\n", units[u].firstColumn + c, units[u].serial, units[u].channels[c]);
+					}
+				}
+				fclose(fp);
+			}
+
+			wallStartMs = (int64_t) time(NULL) * 1000;
+
+			if (store.lastMs >= wallStartMs)
+			{
+				wallStartMs = store.lastMs + 1;
+			}
+
+			printf("\nSampling every %d ms. Data is written to the store hrdl_multi, see hrdl_multi.txt\n", intervalMs);
+
+			for (u = 0; u < nUnits && status; u++)
+			{
+				status = HRDLRun(units[u].handle, BUFFER_SIZE, (int16_t) HRDL_BM_STREAM);
+				units[u].startMs = logger_time_ms();
+			}
+
+			if (!status)
+			{
+				//
+				// u is one past the unit that failed, stop the units started before it
+				//
+				unit = &units[u - 1];
+				HRDLGetUnitInfo(unit->handle, line, (int16_t) 80, HRDL_SETTINGS);
+				printf("Error occurred on unit %s: %s\n\n", unit->serial, line);
+
+				while (--u > 0)
+				{
+					HRDLStop(units[u - 1].handle);
+				}
+
+				stop = TRUE;
+			}
+
+			for (u = 0; u < nUnits && status; u++)
+			{
+				while (!HRDLReady(units[u].handle))
+				{
+					Sleep (100);
+				}
+			}
+
+			if (status)
+			{
+				printf("Press any key to stop\n\n");
+			}
+
+			//
+			// One loop drains every unit, twice an interval
+			//
+			while (!stop)
+			{
+				stop = (int16_t) _kbhit();
+
+				for (u = 0; u < nUnits; u++)
+				{
+					unit = &units[u];
+					valuesPerSample = unit->nChannels + unit->digital;
+
+					nValues = HRDLGetTimesAndValues(unit->handle, times, values, &overflow, BUFFER_SIZE);
+
+					for (i = 0; i < nValues; i++)
+					{
+						for (c = 0; c < unit->nChannels; c++)
+						{
+							//
+							// The driver returns -1 for a reading it could not make, keep it as AdcToMv does and flag it
+							//
+							raw = values[i * valuesPerSample + unit->digital + c];
+
+							logger_ring_put(&ring, unit->startMs + times[i], unit->firstColumn + c,
+								(raw == -1) ? -1.0f : (float) raw * unit->scale[c],
+								(raw == -1 || (overflow & (1 << unit->channels[c]))) ? LOGGER_FLAG_OVERFLOW : 0);
+						}
+					}
+				}
+
+				while (logger_ring_read(&ring, &timeMs, rowValues, rowFlags, stop ? 0 : MULTI_SETTLE_ROWS))
+				{
+					if (firstRowMs < 0)
+					{
+						firstRowMs = timeMs;
+					}
+
+					ts_store_append(&store, wallStartMs + timeMs - firstRowMs, rowValues);
+					rows++;
+				}
+
+				printf("\r%llu rows of %u channels stored   ", (unsigned long long) rows, nColumns);
+
+				if (!stop)
+				{
+					Sleep (max(intervalMs / 2, 100));
+				}
+			}
+
+			for (u = 0; u < nUnits && status; u++)
+			{
+				HRDLStop(units[u].handle);
+			}
+
+			ts_store_flush(&store);
+			printf("\n\n%llu rows stored in %llu bytes, %llu rows lost, %llu late readings\n",
+				(unsigned long long) rows, (unsigned long long) store.bytesWritten,
+				(unsigned long long) ring.rowsLost, (unsigned long long) ring.lateValues);
+			ts_store_close(&store);
+		}
+
+		logger_ring_free(&ring);
+		free(rowValues);
+		free(rowFlags);
+	}
+
+	//
+	// Keep the first unit open for the rest of the example
+	//
+	for (u = 1; u < nUnits; u++)
+	{
+		HRDLCloseUnit(units[u].handle);
+	}
+
+	free(units);
+	free(values);
+	_getch();
+}
+
+/****************************************************************************
+*
+* ScheduledLogging
+*
+* Logs the enabled analog channels through the logger scheduler, which
+* can host units of the other logger families alongside it in the same
+* loop. Rows are written to hrdl_scheduled.csv.
+*
+****************************************************************************/
+void ScheduledLogging (void)
+{
+	LOGGER_SCHEDULER *	sched;
+	LOGGER_ADAPTER		adapter;
+	HRDL_ADAPTER		unit;
+	FILE *				fp = NULL;
+	int8_t				strError[80];
+	int16_t				channel;
+	int16_t				status = 1;
+	int32_t				minAdc = 0;
+	int32_t				maxAdc = 0;
+	int32_t				intervalMs;
+	int16_t				c;
+
+	memset(&unit, 0, sizeof(HRDL_ADAPTER));
+	unit.handle = g_device;
+	unit.digital = g_channelSettings[HRDL_DIGITAL_CHANNELS].enabled;
+
+	for (channel = HRDL_ANALOG_IN_CHANNEL_1; channel <= g_maxNoOfChannels && status; channel++)
+	{
+		status = HRDLSetAnalogInChannel(g_device, channel, g_channelSettings[channel].enabled,
+										(int16_t) g_channelSettings[channel].range, g_channelSettings[channel].singleEnded);
+
+		if (status && g_channelSettings[channel].enabled)
+		{
+			HRDLGetMinMaxAdcCounts(g_device, &minAdc, &maxAdc, channel);
+			unit.channels[unit.nChannels] = channel;
+			unit.scale[unit.nChannels] = g_scaleTo_mv ?
+				(float) ((2500.0 / pow(2.0, (double) g_channelSettings[channel].range)) / (double) maxAdc) : 1.0f;
+			unit.nChannels++;
+		}
+	}
+
+	if (status && unit.nChannels == 0)
+	{
+		printf("No analog channels are enabled.\n");
+		return;
+	}
+
+	//
+	// Sample as fast as the channels can all be converted, to the nearest 100 ms
+	//
+	intervalMs = ((unit.nChannels * MULTI_CONVERSION_MS + 99) / 100) * 100;
+
+	if (status)
+	{
+		status = HRDLSetInterval(g_device, intervalMs, MULTI_CONVERSION);
+	}
+
+	if (!status)
+	{
+		HRDLGetUnitInfo(g_device, strError, (int16_t) 80, HRDL_SETTINGS);
+		printf("Error occurred: %s\n\n", strError);
+		return;
+	}
+
+	memset(&adapter, 0, sizeof(LOGGER_ADAPTER));
+	strcpy(adapter.name, "HRDL");
+	adapter.context = &unit;
+	adapter.nColumns = unit.nChannels;
+	adapter.periodMs = intervalMs;
+	adapter.pollMs = SCHED_POLL_MS;
+	adapter.maxRows = HRDL_ADAPTER_VALUES / (unit.nChannels + unit.digital);
+	adapter.start = hrdlAdapterStart;
+	adapter.poll = hrdlAdapterPoll;
+	adapter.stop = hrdlAdapterStop;
+
+	sched = (LOGGER_SCHEDULER *) calloc(1, sizeof(LOGGER_SCHEDULER));
+	fopen_s(&fp, "hrdl_scheduled.csv", "w");
+
+	if (sched == NULL || fp == NULL)
+	{
+		printf("Unable to set up scheduled logging.\n");
+	}
+	else
+	{
+		fprintf(fp, "Time (s), Unit");
+
+		for (c = 0; c < unit.nChannels; c++)
+		{
+			fprintf(fp, ", Channel %d (%s)", unit.channels[c], g_scaleTo_mv ? "mV" : "ADC");
+		}
+
+		fprintf(fp, "\n");
+
+		logger_sched_init(sched, logger_sched_csv_sink, fp);
+		logger_sched_add(sched, &adapter);
+
+		if (!logger_sched_start(sched))
+		{
+			HRDLGetUnitInfo(g_device, strError, (int16_t) 80, HRDL_SETTINGS);
+			printf("Error occurred: %s\n\n", strError);
+		}
+		else
+		{
+			printf("Sampling every %d ms. Data is written to hrdl_scheduled.csv\n", intervalMs);
+			printf("Press any key to stop\n");
+			logger_sched_run(sched, _kbhit);
+			_getch();
+			logger_sched_stop(sched);
+			printf("\n");
+			logger_sched_print_stats(sched);
+		}
+
+		logger_sched_free(sched);
+	}
+
+	if (fp != NULL)
+	{
+		fclose(fp);
+	}
+
+	free(sched);
+}
+
 /****************************************************************************
 *
 *
@@ -1230,10 +1807,12 @@ void main (void)
 		
 		if (toupper (_getch ()) == 'Y')
 		{
+			g_mains = 1;
 			HRDLSetMains(g_device, 1);
 		}
 		else
 		{ 
+			g_mains = 0;
 			HRDLSetMains(g_device, 0);
 		}
 
@@ -1248,6 +1827,8 @@ void main (void)
 		printf("B - Immediate block\n");
 		printf("W - Windowed block\n");
 		printf("S - Streaming\n");
+		printf("M - Streaming from all connected units\n");
+		printf("L - Scheduled logging\n");
 		printf("U - Single readings\n");
     printf("R - Single readings (blocking call)\n");
 		printf("A - Set analog channels \n");
@@ -1271,6 +1852,14 @@ void main (void)
 			CollectStreaming();
 			break;  
 
+			case 'M':
+			CollectMultiUnitStreaming();
+			break;
+
+			case 'L':
+			ScheduledLogging();
+			break;
+
 			case 'R':
 			CollectSingleBlocked();
 			break;
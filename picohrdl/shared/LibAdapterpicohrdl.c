@@ -0,0 +1,79 @@
+/****************************************************************************
+ *
+ * Filename:    LibAdapterpicohrdl.c
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This file defines the logger scheduler adapter of the PicoLog
+ * ADC-20/24 (see LibAdapterpicohrdl.h).
+ *
+ ****************************************************************************/
+#include "./LibAdapterpicohrdl.h"
+
+#ifndef WIN32
+#include <unistd.h>
+
+#define Sleep(a) usleep(1000*a)
+#endif
+
+/****************************************************************************
+* hrdlAdapterStart
+*
+* Sets the unit streaming and waits until it is ready
+****************************************************************************/
+int16_t hrdlAdapterStart(void* context)
+{
+	HRDL_ADAPTER* adapter = (HRDL_ADAPTER*) context;
+
+	if (!HRDLRun(adapter->handle, HRDL_ADAPTER_VALUES, (int16_t) HRDL_BM_STREAM))
+	{
+		return 0;
+	}
+
+	while (!HRDLReady(adapter->handle))
+	{
+		Sleep (100);
+	}
+
+	return 1;
+}
+
+/****************************************************************************
+* hrdlAdapterPoll
+*
+* Reads the samples buffered since the last poll as rows of the enabled
+* analog channels. A reading the driver could not make (-1) stays -1, as
+* in the console example's AdcToMv.
+****************************************************************************/
+int32_t hrdlAdapterPoll(void* context, float* values, uint32_t maxRows)
+{
+	HRDL_ADAPTER* adapter = (HRDL_ADAPTER*) context;
+	int32_t valuesPerSample = adapter->nChannels + adapter->digital;
+	int32_t maxSamples = HRDL_ADAPTER_VALUES / valuesPerSample;
+	int32_t nValues;
+	int32_t raw;
+	int32_t i;
+	int32_t c;
+	int16_t overflow;
+
+	nValues = HRDLGetValues(adapter->handle, adapter->values, &overflow, (int32_t) maxRows < maxSamples ? (int32_t) maxRows : maxSamples);
+
+	for (i = 0; i < nValues; i++)
+	{
+		for (c = 0; c < adapter->nChannels; c++)
+		{
+			raw = adapter->values[i * valuesPerSample + adapter->digital + c];
+			values[i * adapter->nChannels + c] = (raw == -1) ? -1.0f : (float) raw * adapter->scale[c];
+		}
+	}
+
+	return nValues;
+}
+
+/****************************************************************************
+* hrdlAdapterStop
+****************************************************************************/
+void hrdlAdapterStop(void* context)
+{
+	HRDLStop(((HRDL_ADAPTER*) context)->handle);
+}
@@ -0,0 +1,46 @@
+/****************************************************************************
+ *
+ * Filename:    LibAdapterpicohrdl.h
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This header defines the logger scheduler adapter (see
+ * PicoLoggerScheduler.h) of the PicoLog ADC-20/24. The unit streams its
+ * enabled analog channels and each poll reads the samples buffered by the
+ * driver.
+ *
+ * The names are prefixed with the family, so one program can register
+ * adapters of several logger families with the same scheduler.
+ *
+ ****************************************************************************/
+#ifndef __LIBADAPTERPICOHRDL_H__
+#define __LIBADAPTERPICOHRDL_H__
+
+#include <stdint.h>
+
+#ifdef WIN32
+#include <windows.h>
+#include "HRDL.h"
+#else
+#include "libpicohrdl/HRDL.h"
+#endif
+
+#define HRDL_ADAPTER_VALUES		1000	// Driver buffer size, and most values read in one poll
+
+/* A unit hosted by the logger scheduler, its channels and interval already set */
+typedef struct tHrdlAdapter
+{
+	int16_t		handle;
+	int16_t		digital;								// The digital inputs come first in each sample
+	int16_t		nChannels;								// Enabled analog channels
+	int16_t		channels[HRDL_MAX_ANALOG_CHANNELS];
+	float		scale[HRDL_MAX_ANALOG_CHANNELS];		// mV (or 1 for ADC counts) per count of each channel
+	int32_t		values[HRDL_ADAPTER_VALUES];
+}HRDL_ADAPTER;
+
+// Function prototypes
+int16_t hrdlAdapterStart(void* context);
+int32_t hrdlAdapterPoll(void* context, float* values, uint32_t maxRows);
+void hrdlAdapterStop(void* context);
+
+#endif
@@ -15,8 +15,11 @@
  *    Collect a block of samples immediately
  *    Collect a block of samples when a trigger event occurs
  *    Use windowing to collect a sequence of overlapped blocks
+ *    Keep sliding-window statistics from only the newly arrived samples
  *    Write a continuous stream of data to a disk file
+ *    Log a continuous stream at full rate to a binary file
  *    Take individual readings
+ *    Log through the multi-rate logger scheduler
  *	  Set PWM
  *	  Set digital outputs
  *
@@ -53,12 +56,14 @@
  *******************************************************************************/
 
 #include <stdio.h>
+#include <time.h>
 #ifdef WIN32
 /* Headers for Windows */
 #include <conio.h>
 #include "pl1000Api.h"
 #include <windows.h>
 #include <stdlib.h>
+#include <string.h>
 #else
 #include <sys/types.h>
 #include <string.h>
@@ -139,10 +144,22 @@ return (fp>0)?0:-1;
 #define TRUE		1
 #define FALSE		0
 
+#include "../../shared/PicoTimeSeries.h"
+#include "../../shared/PicoChunkRing.h"
+#include "../../shared/PicoLoggerScheduler.h"
+#include "../../shared/PicoSlidingWindow.h"
+#include "../shared/LibAdapterpl1000.h"
+
 #define MAX_BLOCK_SIZE 8192
 #define PL1000_12_CHANNEL 12
 #define PL1000_16_CHANNEL 16
 
+#define FAST_STREAMING_BUFFERS	10	// Driver buffer size in blocks of MAX_BLOCK_SIZE samples per channel
+#define FAST_STREAMING_POLLS	4	// Polls in the time the driver buffer takes to fill
+
+#define SCHED_INTERVAL_MS	10		// Time between samples of all channels when hosted by the logger scheduler
+#define SCHED_POLL_MS		100
+
 int32_t		scale_to_mv = TRUE;
 uint16_t	max_adc_value;
 int16_t		g_handle;
@@ -394,6 +411,8 @@ void collect_block_triggered (void)
  *  This function demonstrates how to use windowed blocks.
  *
  ****************************************************************************/
+void collect_windowed_incremental (void);
+
 void collect_windowed_blocks (void)
 {
   uint32_t	i = 0;;
@@ -412,6 +431,16 @@ void collect_windowed_blocks (void)
 	FILE *		fp;
 
 	printf ("Collect windowed block...\n");
+	printf ("Read only the new samples each second and keep 10 second\n");
+	printf ("sliding-window statistics instead (Y/N)?\n");
+
+	if (toupper(_getch()) == 'Y')
+	{
+		free(samples);
+		collect_windowed_incremental();
+		return;
+	}
+
 	printf ("First block appears after 10 seconds,\n");
 	printf ("then 10 second blocks are collected every second\n");
 	printf ("Press a key to start\n");
@@ -481,6 +510,126 @@ void collect_windowed_blocks (void)
 	_getch();
 }
 
+/****************************************************************************
+ *
+ * collect_windowed_incremental()
+ *
+ *  This function gives the figures of a 10 second window each second
+ *  without reading the window again. The unit streams, each read
+ *  returns only the samples since the last one, and these are written
+ *  to the file and pushed into a sliding window that keeps the mean,
+ *  minimum, maximum and RMS of the last 10 seconds.
+ *
+ ****************************************************************************/
+void collect_windowed_incremental (void)
+{
+	uint32_t		i = 0;
+	uint32_t		j = 0;
+	int16_t			channels [] = {(int16_t) PL1000_CHANNEL_1};
+	int16_t			nChannels = 1;
+	uint32_t		nSamplesPerChannel = 1000;	// Samples per channel in the window
+	uint32_t		nSamplesCollected;
+	uint16_t *		samples = (uint16_t *) calloc(nSamplesPerChannel * nChannels, sizeof(uint16_t));
+	uint32_t		usForBlock = 10000000;	// 10 seconds
+	uint16_t		overflow = 0;
+	uint32_t		triggerIndex = 0;
+	int16_t			nLines = 0;
+	float			value;
+	SLIDING_WINDOW	windows[1];
+	int16_t			nWindows = 0;
+	FILE *			fp = NULL;
+
+	for (nWindows = 0; nWindows < nChannels && window_init(&windows[nWindows], nSamplesPerChannel); nWindows++);
+
+	if (samples == NULL || nWindows < nChannels)
+	{
+		printf ("Unable to allocate the sliding windows\n");
+	}
+	else
+	{
+		// Set the trigger (disabled)
+		status = pl1000SetTrigger(g_handle, FALSE, 0, 0, 0, 0, 0, 0, 0);
+
+		// Sample at the same rate as a 10 second window of nSamplesPerChannel
+		status = pl1000SetInterval(g_handle, &usForBlock, nSamplesPerChannel, channels, nChannels);
+
+		printf("\n");
+		printf("Sampling interval: %d us\n", usForBlock / (nSamplesPerChannel * nChannels));
+		printf("\n");
+
+		// The driver keeps a whole window, so a late read loses nothing
+		status = pl1000Run(g_handle, nSamplesPerChannel, BM_STREAM);
+
+		isReady = 0;
+
+		while (isReady == 0)
+		{
+			status = pl1000Ready(g_handle, &isReady);
+		}
+
+		printf("Press any key to stop\n");
+		fopen_s(&fp, "pl1000_windowed_blocks.txt", "w");
+
+		if (fp == NULL)
+		{
+			printf("Unable to open pl1000_windowed_blocks.txt\n");
+			status = pl1000Stop(g_handle);
+		}
+	}
+
+	while (fp != NULL && !_kbhit())
+	{
+		nSamplesCollected = nSamplesPerChannel;
+
+		status = pl1000GetValues(g_handle, samples, &nSamplesCollected, &overflow, &triggerIndex);
+
+		for (i = 0; i < nSamplesCollected; i++)
+		{
+			for (j = 0; j < (uint32_t) nChannels; j++)
+			{
+				value = (float) adc_to_mv(samples[(i * nChannels) + j]);
+				window_push(&windows[j], value);
+				fprintf(fp, "%d\t", (int32_t) value);
+			}
+
+			fprintf(fp, "\n");
+		}
+
+		for (j = 0; j < (uint32_t) nChannels; j++)
+		{
+			printf("%4d new values, ch%02d over the last %u: mean %.1f, min %.0f, max %.0f, RMS %.1f\n",
+				nSamplesCollected, channels[j], window_length(&windows[j]), window_mean(&windows[j]),
+				window_min(&windows[j]), window_max(&windows[j]), window_rms(&windows[j]));
+		}
+
+		if (nLines == 20)
+		{
+			printf("Press any key to stop\n");
+			nLines = 0;
+		}
+		else
+		{
+			nLines++;
+		}
+
+		Sleep(1000);		// Wait 1 second before collecting the next samples
+	}
+
+	if (fp != NULL)
+	{
+		fclose(fp);
+		status = pl1000Stop(g_handle);
+		_getch();
+	}
+
+	while (nWindows > 0)
+	{
+		window_free(&windows[--nWindows]);
+	}
+
+	free(samples);
+}
+
 /****************************************************************************
  *
  * collect_streaming()
@@ -507,9 +656,17 @@ void collect_streaming (void)
 	uint32_t	totalSamplesCollected = 0;
 	uint32_t	samplingIntervalUs = 0;
 	FILE *		fp;
+	TS_STORE	store;
+	int16_t		storeOpen = FALSE;
+	int64_t		startMs = 0;
+	uint64_t	sampleIndex = 0;
+	float		values[PL1000_16_CHANNEL];
+	TS_POINT	points[10];
+	int32_t		nPoints;
 	
 	printf ("Collect streaming...\n");
 	printf ("Data is written to disk file (pl1000_streaming.txt)\n");
+	printf ("and appended to the time-series store pl1000_streaming (.tsr, .tsm, .tsh, .tsd)\n");
 	printf ("Press a key to start\n");
 	_getch();
 		
@@ -538,6 +695,19 @@ void collect_streaming (void)
 
 	printf("Press any key to stop\n");
 	fopen_s(&fp, "pl1000_streaming.txt", "w");
+
+	// Rows are stored against wall-clock time so the minute, hour and day rollups line up across runs
+	storeOpen = ts_store_open(&store, "pl1000_streaming", nChannels);
+	startMs = (int64_t)time(NULL) * 1000;
+
+	if (!storeOpen)
+	{
+		printf("Cannot open the time-series store, data is only written to pl1000_streaming.txt\n");
+	}
+	else if (store.lastMs >= startMs)
+	{
+		startMs = store.lastMs + 1;	// Clock set back since the last run
+	}
   
 	while (!_kbhit())
 	{
@@ -562,10 +732,18 @@ void collect_streaming (void)
 		{
       for (j = 0; j < (uint32_t) nChannels; j++)
       {
-        fprintf(fp, "%d\t", adc_to_mv(samples[(i * nChannels) + j]));
+        values[j] = (float) adc_to_mv(samples[(i * nChannels) + j]);
+        fprintf(fp, "%d\t", (int32_t) values[j]);
       }
 
       fprintf(fp, "\n");
+
+      if (storeOpen)
+      {
+        ts_store_append(&store, startMs + (int64_t) (sampleIndex * samplingIntervalUs / 1000), values);
+      }
+
+      sampleIndex++;
 		}
 
 		Sleep(100);
@@ -574,6 +752,195 @@ void collect_streaming (void)
 	fclose(fp);
 	status = pl1000Stop(g_handle);
 
+	if (storeOpen)
+	{
+		// A dashboard reads the rollups rather than the raw rows
+		nPoints = ts_store_query(&store, TS_LEVEL_MINUTE, 0, store.lastMs - 9 * ts_level_period_ms(TS_LEVEL_MINUTE), store.lastMs, points, 10);
+
+		printf("\nMinute rollups of channel %d (%s):\n", channels[0], scale_to_mv ? "mV" : "ADC counts");
+
+		for (i = 0; nPoints > 0 && i < (uint32_t) nPoints; i++)
+		{
+			printf("%lld: min %.0f, max %.0f, mean %.1f (%u readings)\n", (long long) points[i].timeMs / 1000, points[i].min, points[i].max, points[i].mean, points[i].count);
+		}
+
+		ts_store_flush(&store);
+		printf("%llu rows stored in %llu bytes\n", (unsigned long long) store.rowsAppended, (unsigned long long) store.bytesWritten);
+		ts_store_close(&store);
+	}
+
+	_getch();
+}
+
+/****************************************************************************
+ *
+ * collect_streaming_fast()
+ *
+ *  This function demonstrates streaming at full rate. The main thread
+ *  reads raw blocks from the driver, polling often enough that its
+ *  buffer cannot fill between reads, and a writer thread saves them to
+ *  pl1000_streaming.bin unconverted. Nothing is formatted while streaming,
+ *  so the read loop keeps up at the fastest sampling intervals.
+ *
+ ****************************************************************************/
+void collect_streaming_fast (void)
+{
+	int16_t		channels [PL1000_16_CHANNEL];
+	int16_t		nChannels = 0;
+	uint32_t	nSamplesPerChannel = MAX_BLOCK_SIZE;
+	uint32_t	nSamplesPerChannelForBuffer = FAST_STREAMING_BUFFERS * nSamplesPerChannel;
+	uint32_t	nSamplesCollected = 0;
+	uint16_t *	samples = NULL;
+	int16_t *	block[1];
+	uint32_t	usForBlock = 0;
+	uint32_t	samplingIntervalUs = 0;
+	uint32_t	pollMs = 0;
+	uint16_t	overflow = 0;
+	uint32_t	triggerIndex = 0;
+	uint64_t	totalSamplesCollected = 0;
+	uint64_t	samplesWritten = 0;
+	uint64_t	nQueued = 0;
+	uint64_t	nChunks = 0;
+	uint32_t	nFullReads = 0;
+	uint32_t	nPolls = 0;
+	int16_t		i;
+	CHUNK_RING	ring;
+	FILE *		fp;
+
+	do
+	{
+		printf("Enter the number of channels (1 to %d):", numDeviceChannels);
+		scanf_s("%hd", &nChannels);
+		fflush(stdin);
+	} while (nChannels < 1 || nChannels > (int16_t) numDeviceChannels);
+
+	do
+	{
+		printf("Enter the sampling interval between conversions (1 to 10000 microseconds):");
+		scanf_s("%u", &samplingIntervalUs);
+		fflush(stdin);
+	} while (samplingIntervalUs < 1 || samplingIntervalUs > 10000);
+
+	for (i = 0; i < nChannels; i++)
+	{
+		channels[i] = PL1000_CHANNEL_1 + i;
+	}
+
+	// Set the trigger (disabled)
+	status = pl1000SetTrigger(g_handle, FALSE, 0, 0, 0, 0, 0, 0, 0);
+
+	// Set sampling rate and channels, the driver rounds the interval to one it can use
+	usForBlock = samplingIntervalUs * nSamplesPerChannel * nChannels;
+	status = pl1000SetInterval(g_handle, &usForBlock, nSamplesPerChannel, channels, nChannels);
+
+	if (status != PICO_OK)
+	{
+		printf("\nUnable to set the sampling interval - status code 0x%08lx\n", (unsigned long) status);
+		return;
+	}
+
+	samplingIntervalUs = (usForBlock / (nSamplesPerChannel * nChannels));
+
+	// Poll several times in the time the driver buffer takes to fill
+	pollMs = (uint32_t) (((uint64_t) nSamplesPerChannelForBuffer * nChannels * samplingIntervalUs) / (1000 * FAST_STREAMING_POLLS));
+	pollMs = max(pollMs, 1);
+
+	samples = (uint16_t *) calloc((size_t) nSamplesPerChannelForBuffer * nChannels, sizeof(uint16_t));
+
+	// The blocks are interleaved already, so the writer saves them as one stream
+	if (samples == NULL || !chunk_ring_open(&ring, "pl1000_streaming.bin", 1, 0))
+	{
+		printf("\nUnable to set up the binary writer\n");
+		free(samples);
+		return;
+	}
+
+	printf("\n");
+	printf("Sampling interval: %d us (%d us per channel)\n", samplingIntervalUs, samplingIntervalUs * nChannels);
+	printf("Reading every %d ms\n", pollMs);
+	printf("Data is written to disk file (pl1000_streaming.bin)\n");
+	printf("Press any key to stop\n\n");
+
+	// Start streaming
+	status = pl1000Run(g_handle, nSamplesPerChannelForBuffer, BM_STREAM);
+
+	// Wait until unit is ready
+	isReady = 0;
+
+	while (isReady == 0)
+	{
+		status = pl1000Ready(g_handle, &isReady);
+	}
+
+	while (!_kbhit())
+	{
+		// Take everything the driver holds
+		nSamplesCollected = nSamplesPerChannelForBuffer;
+
+		status = pl1000GetValues(g_handle, samples, &nSamplesCollected, &overflow, &triggerIndex);
+
+		if (status != PICO_OK)
+		{
+			printf("\nUnable to get values - status code 0x%08lx\n", (unsigned long) status);
+			break;
+		}
+
+		// A full buffer may have wrapped before it was read
+		if (nSamplesCollected == nSamplesPerChannelForBuffer)
+		{
+			nFullReads++;
+		}
+
+		if (nSamplesCollected > 0)
+		{
+			block[0] = (int16_t *) samples;
+			chunk_ring_append(&ring, block, nSamplesCollected * nChannels);
+			totalSamplesCollected += nSamplesCollected;
+		}
+
+		if (++nPolls % (1000 / pollMs + 1) == 0)
+		{
+			chunk_ring_status(&ring, &samplesWritten, &nQueued, &nChunks);
+			printf("\rCollected %llu values per channel, %llu written, %llu chunks queued   ",
+				(unsigned long long) totalSamplesCollected, (unsigned long long) samplesWritten / nChannels, (unsigned long long) nQueued);
+		}
+
+		Sleep(pollMs);
+	}
+
+	status = pl1000Stop(g_handle);
+
+	chunk_ring_close(&ring);
+	free(samples);
+
+	printf("\n\n%llu values per channel written to pl1000_streaming.bin\n", (unsigned long long) ring.samplesWritten / nChannels);
+
+	if (nFullReads > 0)
+	{
+		printf("The driver buffer was full on %d reads, so some samples may have been lost\n", nFullReads);
+	}
+
+	// Describe the file, so it can be read without this program
+	fopen_s(&fp, "pl1000_streaming_bin.txt", "w");
+
+	if (fp != NULL)
+	{
+		fprintf(fp, "Data file: pl1000_streaming.bin\n");
+		fprintf(fp, "Format: uint16_t ADC counts, interleaved\n");
+		fprintf(fp, "Channels:");
+
+		for (i = 0; i < nChannels; i++)
+		{
+			fprintf(fp, " %d", channels[i]);
+		}
+
+		fprintf(fp, "\nSampling interval per channel: %d us\n", samplingIntervalUs * nChannels);
+		fprintf(fp, "Maximum ADC count: %d (2500 mV)\n", max_adc_value);
+		fprintf(fp, "Values per channel: %llu\n", (unsigned long long) ring.samplesWritten / nChannels);
+		fprintf(fp, "Reads with a full driver buffer: %d\n", nFullReads);
+		fclose(fp);
+	}
+
 	_getch();
 }
 
@@ -628,6 +995,113 @@ void collect_individual (void)
 	_getch ();
 }
 
+/****************************************************************************
+ *
+ * scheduled_logging()
+ *
+ *  This function logs every channel through the logger scheduler, which
+ *  can host units of the other logger families alongside it in the same
+ *  loop. Rows are written to pl1000_scheduled.csv.
+ *
+ ****************************************************************************/
+void scheduled_logging (void)
+{
+	LOGGER_SCHEDULER *	sched;
+	LOGGER_ADAPTER		adapter;
+	PL1000_ADAPTER *	context;
+	int16_t				channels[PL1000_16_CHANNEL];
+	uint32_t			usForBlock = PL1000_ADAPTER_BLOCK_SIZE * SCHED_INTERVAL_MS * 1000;
+	FILE *				fp = NULL;
+	int16_t				c;
+
+	printf ("Scheduled logging...\n");
+	printf ("Data is written to disk file (pl1000_scheduled.csv)\n");
+	printf ("Press a key to start\n");
+	_getch();
+
+	for (c = 0; c < numDeviceChannels; c++)
+	{
+		channels[c] = (int16_t) PL1000_CHANNEL_1 + c;
+	}
+
+	// Set the trigger (disabled)
+	status = pl1000SetTrigger(g_handle, FALSE, 0, 0, 0, 0, 0, 0, 0);
+
+	if (status == PICO_OK)
+	{
+		status = pl1000SetInterval(g_handle, &usForBlock, PL1000_ADAPTER_BLOCK_SIZE, channels, numDeviceChannels);
+	}
+
+	if (status != PICO_OK)
+	{
+		printf ("pl1000SetInterval: Status = 0x%X\n", status);
+		return;
+	}
+
+	memset(&adapter, 0, sizeof(LOGGER_ADAPTER));
+	strcpy(adapter.name, "PL1000");
+	adapter.nColumns = numDeviceChannels;
+	adapter.periodMs = max(usForBlock / (PL1000_ADAPTER_BLOCK_SIZE * 1000), 1);	// The driver may have changed the interval
+	adapter.pollMs = SCHED_POLL_MS;
+	adapter.maxRows = PL1000_ADAPTER_BLOCK_SIZE;
+	adapter.start = pl1000AdapterStart;
+	adapter.poll = pl1000AdapterPoll;
+	adapter.stop = pl1000AdapterStop;
+
+	sched = (LOGGER_SCHEDULER *) calloc(1, sizeof(LOGGER_SCHEDULER));
+	context = (PL1000_ADAPTER *) calloc(1, sizeof(PL1000_ADAPTER));
+	adapter.context = context;
+	fopen_s(&fp, "pl1000_scheduled.csv", "w");
+
+	if (sched == NULL || context == NULL || fp == NULL)
+	{
+		printf ("Unable to set up scheduled logging\n");
+	}
+	else
+	{
+		context->handle = g_handle;
+		context->nChannels = (int16_t) numDeviceChannels;
+		context->scaleToMv = (int16_t) scale_to_mv;
+		context->maxAdc = max_adc_value;
+
+		fprintf(fp, "Time (s), Unit");
+
+		for (c = 0; c < numDeviceChannels; c++)
+		{
+			fprintf(fp, ", ch%02d (%s)", channels[c], scale_to_mv ? "mV" : "ADC");
+		}
+
+		fprintf(fp, "\n");
+
+		logger_sched_init(sched, logger_sched_csv_sink, fp);
+		logger_sched_add(sched, &adapter);
+
+		if (!logger_sched_start(sched))
+		{
+			printf ("pl1000Run: Status = 0x%X\n", context->status);
+		}
+		else
+		{
+			printf ("Sampling every %u ms. Press any key to stop\n", adapter.periodMs);
+			logger_sched_run(sched, _kbhit);
+			_getch();
+			logger_sched_stop(sched);
+			printf ("\n");
+			logger_sched_print_stats(sched);
+		}
+
+		logger_sched_free(sched);
+	}
+
+	if (fp != NULL)
+	{
+		fclose(fp);
+	}
+
+	free(context);
+	free(sched);
+}
+
 /****************************************************************************
  *
  * outputToggle()
@@ -838,6 +1312,8 @@ void main (void)
 			printf ("T - Triggered block\t\tP - Set PWM\n");
 			printf ("W - Windowed block\t\tD - Display digital output states\n");
 			printf ("S - Streaming\t\t\t0,1,2,3 - Toggle digital output\n");
+			printf ("F - Fast binary streaming\n");
+			printf ("L - Scheduled logging\n");
 			printf ("I - Individual reading\t\tX - exit\n");
 			ch = toupper (_getch());
 			printf ("\n");
@@ -860,9 +1336,17 @@ void main (void)
 					collect_streaming ();
 					break;
 
+				case 'F':
+					collect_streaming_fast ();
+					break;
+
 				case 'I':
 					collect_individual ();
 					break;
+
+				case 'L':
+					scheduled_logging ();
+					break;
 				
 				case 'P':
 					pwm();
@@ -0,0 +1,68 @@
+/****************************************************************************
+ *
+ * Filename:    LibAdapterpl1000.c
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This file defines the logger scheduler adapter of the PicoLog 1000
+ * Series (see LibAdapterpl1000.h).
+ *
+ ****************************************************************************/
+#include "./LibAdapterpl1000.h"
+
+/****************************************************************************
+* pl1000AdapterStart
+*
+* Sets the unit streaming, with room in the driver for ten blocks
+****************************************************************************/
+int16_t pl1000AdapterStart(void* context)
+{
+	PL1000_ADAPTER* adapter = (PL1000_ADAPTER*) context;
+	int16_t isReady = 0;
+
+	adapter->status = pl1000Run(adapter->handle, PL1000_ADAPTER_BLOCK_SIZE * 10, BM_STREAM);
+
+	while (adapter->status == PICO_OK && isReady == 0)
+	{
+		adapter->status = pl1000Ready(adapter->handle, &isReady);
+	}
+
+	return adapter->status == PICO_OK;
+}
+
+/****************************************************************************
+* pl1000AdapterPoll
+*
+* Reads the samples buffered since the last poll as rows of every channel,
+* in mV if scaleToMv is set
+****************************************************************************/
+int32_t pl1000AdapterPoll(void* context, float* values, uint32_t maxRows)
+{
+	PL1000_ADAPTER* adapter = (PL1000_ADAPTER*) context;
+	uint32_t nSamples = maxRows < PL1000_ADAPTER_BLOCK_SIZE ? maxRows : PL1000_ADAPTER_BLOCK_SIZE;
+	uint16_t overflow = 0;
+	uint32_t triggerIndex = 0;
+	uint32_t i;
+
+	adapter->status = pl1000GetValues(adapter->handle, adapter->samples, &nSamples, &overflow, &triggerIndex);
+
+	if (adapter->status != PICO_OK)
+	{
+		return -1;
+	}
+
+	for (i = 0; i < nSamples * adapter->nChannels; i++)
+	{
+		values[i] = (float) (adapter->scaleToMv ? adapter->samples[i] * 2500 / adapter->maxAdc : adapter->samples[i]);
+	}
+
+	return (int32_t) nSamples;
+}
+
+/****************************************************************************
+* pl1000AdapterStop
+****************************************************************************/
+void pl1000AdapterStop(void* context)
+{
+	pl1000Stop(((PL1000_ADAPTER*) context)->handle);
+}
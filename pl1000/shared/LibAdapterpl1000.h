@@ -0,0 +1,49 @@
+/****************************************************************************
+ *
+ * Filename:    LibAdapterpl1000.h
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This header defines the logger scheduler adapter (see
+ * PicoLoggerScheduler.h) of the PicoLog 1000 Series. The unit streams
+ * its channels and each poll reads the samples buffered by the driver.
+ *
+ * The names are prefixed with the family, so one program can register
+ * adapters of several logger families with the same scheduler.
+ *
+ ****************************************************************************/
+#ifndef __LIBADAPTERPL1000_H__
+#define __LIBADAPTERPL1000_H__
+
+#include <stdint.h>
+
+#ifdef WIN32
+#include <windows.h>
+#include "pl1000Api.h"
+#else
+#include <libpl1000/pl1000Api.h>
+#ifndef PICO_STATUS
+#include <libpl1000/PicoStatus.h>
+#endif
+#endif
+
+#define PL1000_ADAPTER_BLOCK_SIZE		100		// Samples per channel in each block, and most read in one poll
+#define PL1000_ADAPTER_MAX_CHANNELS		16
+
+/* A unit hosted by the logger scheduler, its channels set with pl1000SetInterval */
+typedef struct tPl1000Adapter
+{
+	int16_t		handle;
+	int16_t		nChannels;
+	int16_t		scaleToMv;
+	uint16_t	maxAdc;
+	uint16_t	samples[PL1000_ADAPTER_BLOCK_SIZE * PL1000_ADAPTER_MAX_CHANNELS];
+	PICO_STATUS	status;			// Status of the last driver call
+}PL1000_ADAPTER;
+
+// Function prototypes
+int16_t pl1000AdapterStart(void* context);
+int32_t pl1000AdapterPoll(void* context, float* values, uint32_t maxRows);
+void pl1000AdapterStop(void* context);
+
+#endif
@@ -10,6 +10,7 @@
 *    How to set up the channels
 *    How to collect data via both USB and ethernet connections
 *    How to enable ethernet and set the unit's IP address
+*    How to poll a fleet of ethernet units from one loop
 *
 *	To build this application:-
 *
@@ -32,6 +33,8 @@
 *************************************************************************/
 
 #include <stdio.h>
+#include <math.h>
+#include <time.h>
 #ifdef WIN32
 #include <conio.h>
 #include <windows.h>
@@ -106,7 +109,12 @@ return (fp>0)?0:-1;
 #define min(a,b) ((a) < (b) ? a : b)
 #endif
 
+#include "../../shared/PicoFleetPoller.h"
+#include "../../shared/PicoLoggerRing.h"
+#include "../../shared/PicoTimeSeries.h"
+
 #define NUM_CHANNELS 3
+#define CONVERSION_MS 1000	// Time for the unit to convert one channel
 
 typedef struct 
 {
@@ -170,11 +178,10 @@ int8_t* MeasurementTypeToString(PLCM3_DATA_TYPES measurementType)
 	}
 }
 	
-// Convert values depending upon measurement type
+// Scale factor per count depending upon measurement type
 // values are returned as uV, so /1000 to give mV reading
-double ApplyScaling(int32_t  value, int16_t channel, int8_t *units)
+double ScalingFactor(int16_t channel, char *units)
 {
-
 	switch(channelSettings[channel].measurementType)
 	{
 		case PLCM3_OFF:
@@ -183,28 +190,37 @@ double ApplyScaling(int32_t  value, int16_t channel, int8_t *units)
 
 		case PLCM3_1_MILLIVOLT:
 			strcpy(units, "A");
-			return value / 1000;
+			return 1 / 1000.0;
 
 		case PLCM3_10_MILLIVOLTS:
 			strcpy(units, "A");
-			return value / 1000.0;
+			return 1 / 1000.0;
 
 		case PLCM3_100_MILLIVOLTS:
 			strcpy(units, "mA");
-			return value;
+			return 1;
 
 		case PLCM3_VOLTAGE:
 			strcpy(units, "mV");
-			return value / 1000.0;
+			return 1 / 1000.0;
 
 		default:
+			strcpy(units, "");
 			return -1;
 	}
 }
 
+// Convert values depending upon measurement type
+double ApplyScaling(int32_t  value, int16_t channel, char *units)
+{
+	double factor = ScalingFactor(channel, units);
+
+	return factor < 0 ? -1 : value * factor;
+}
+
 void CollectData()
 {
-	int8_t	units[NUM_CHANNELS][10];
+	char	units[NUM_CHANNELS][10];
 	int16_t channel;
 	int32_t values[NUM_CHANNELS];
 	double	scaledValues[NUM_CHANNELS];
@@ -281,6 +297,252 @@ void CollectData()
 	_getch();
 }
 
+// Reads the latest value of a channel for the fleet poller
+PICO_STATUS FleetRead(int16_t handle, int16_t channel, int32_t * value)
+{
+	return PLCM3GetValue(handle, (PLCM3_CHANNELS) channel, value);
+}
+
+// Polls every unit listed in plcm3_fleet.txt from one loop and logs the
+// readings to plcm3_fleet.csv
+void FleetPolling()
+{
+	FLEET * fleet;
+	FILE * fp = NULL;
+	int8_t line[40];
+	char units[NUM_CHANNELS][10];
+	int16_t channels[NUM_CHANNELS];
+	double scale[NUM_CHANNELS];
+	int16_t nChannels = 0;
+	int16_t channel;
+	int16_t handle;
+	int16_t u;
+	int16_t c;
+	int64_t reportMs;
+	uint64_t reads;
+	uint64_t lastReads = 0;
+	int32_t nPoints;
+	int64_t wallStartMs;
+	float * row = NULL;
+	int16_t storeOpen = FALSE;
+	TS_STORE store;
+	TS_POINT points[10];
+	FLEET_UNIT * unit;
+
+	fleet = (FLEET *) calloc(1, sizeof(FLEET));
+
+	if (fleet == NULL)
+	{
+		return;
+	}
+
+	printf("\nChannels: ");
+
+	for (channel = 0; channel < NUM_CHANNELS; channel++)
+	{
+		printf("%s%s", channel ? ", " : "", MeasurementTypeToString(channelSettings[channel].measurementType));
+	}
+
+	printf("\nChange channel settings? (Y/N)\n");
+
+	if (toupper(_getch()) == 'Y')
+	{
+		ChannelSetUp();
+	}
+
+	// Every unit uses the same channels, and converts them in turn
+	for (channel = 0; channel < NUM_CHANNELS; channel++)
+	{
+		if (channelSettings[channel].measurementType != PLCM3_OFF)
+		{
+			channels[nChannels] = channel + 1;
+			scale[nChannels] = ScalingFactor(channel, units[nChannels]);
+			nChannels++;
+		}
+	}
+
+	if (nChannels == 0)
+	{
+		printf("No channels are enabled.\n");
+		free(fleet);
+		return;
+	}
+
+	fleet_init(fleet, FleetRead);
+
+	// One IP address a line
+	fopen_s(&fp, "plcm3_fleet.txt", "r");
+
+	if (fp == NULL)
+	{
+		printf("Unable to open plcm3_fleet.txt\n");
+	}
+
+	while (fp != NULL && fleet->nUnits < FLEET_MAX_UNITS && fscanf(fp, "%39s", line) == 1)
+	{
+		printf("Opening %s... ", line);
+		handle = 0;
+		g_status = PLCM3OpenUnitViaIp(&handle, NULL, line);
+
+		for (channel = 0; channel < NUM_CHANNELS && g_status == PICO_OK; channel++)
+		{
+			g_status = PLCM3SetChannel(handle, (PLCM3_CHANNELS) (channel + 1), channelSettings[channel].measurementType);
+		}
+
+		if (g_status == PICO_OK)
+		{
+			g_status = fleet_add_unit(fleet, (char *) line, handle, nChannels, channels, scale, CONVERSION_MS * NUM_CHANNELS);
+		}
+
+		if (g_status == PICO_OK)
+		{
+			printf("OK\n");
+		}
+		else
+		{
+			printf("Status code: 0x%X\n", g_status);
+
+			if (handle > 0)
+			{
+				PLCM3CloseUnit(handle);
+			}
+		}
+	}
+
+	if (fp != NULL)
+	{
+		fclose(fp);
+	}
+
+	fp = NULL;
+
+	if (fleet->nUnits > 0)
+	{
+		fopen_s(&fp, "plcm3_fleet.csv", "w");
+	}
+
+	if (fp != NULL)
+	{
+		fprintf(fp, "Time (s), Unit");
+
+		for (c = 0; c < nChannels; c++)
+		{
+			fprintf(fp, ", Ch %d (%s)", channels[c], units[c]);
+		}
+
+		fprintf(fp, "\n");
+
+		/* One column per channel of each unit, so a store is only reused with the same units */
+		row = (float *) malloc(fleet->nUnits * nChannels * sizeof(float));
+		storeOpen = (row != NULL && ts_store_open(&store, "plcm3_fleet", fleet->nUnits * nChannels));
+		wallStartMs = (int64_t) time(NULL) * 1000;
+
+		if (!storeOpen)
+		{
+			printf("Cannot open the time-series store plcm3_fleet, readings are only written to plcm3_fleet.csv\n");
+		}
+		else if (store.lastMs >= wallStartMs)
+		{
+			wallStartMs = store.lastMs + 1;
+		}
+
+		printf("\nPolling %d unit(s), readings are written to plcm3_fleet.csv. Press any key to stop.\n\n", fleet->nUnits);
+		reportMs = logger_time_ms() + 1000;
+
+		while (!_kbhit())
+		{
+			if (fleet_poll(fleet, 100) > 0)
+			{
+				for (u = 0; u < fleet->nUnits; u++)
+				{
+					unit = &fleet->units[u];
+
+					if (unit->updated && unit->freshMask)
+					{
+						fprintf(fp, "%.3f, %s", (logger_time_ms() - fleet->startMs) / 1000.0, unit->name);
+
+						for (c = 0; c < unit->nChannels; c++)
+						{
+							// Channels not converted since the last read are left empty
+							if (unit->freshMask & (1 << (unit->channels[c] - 1)))
+							{
+								fprintf(fp, ", %.3f", unit->values[c]);
+							}
+							else
+							{
+								fprintf(fp, ",");
+							}
+						}
+
+						fprintf(fp, "\n");
+					}
+				}
+
+				if (storeOpen)
+				{
+					/* Channels not converted since the last read are missing (NaN) in the store */
+					for (u = 0; u < fleet->nUnits; u++)
+					{
+						unit = &fleet->units[u];
+
+						for (c = 0; c < nChannels; c++)
+						{
+							row[u * nChannels + c] = (unit->updated && (unit->freshMask & (1 << (unit->channels[c] - 1)))) ? (float) unit->values[c] : NAN;
+						}
+					}
+
+					ts_store_append(&store, wallStartMs + logger_time_ms() - fleet->startMs, row);
+				}
+			}
+
+			if (logger_time_ms() >= reportMs)
+			{
+				for (u = 0, reads = 0; u < fleet->nUnits; u++)
+				{
+					reads += fleet->units[u].reads;
+				}
+
+				printf("\r%llu reads, %llu per second   ", (unsigned long long) reads, (unsigned long long) (reads - lastReads));
+				lastReads = reads;
+				reportMs += 1000;
+			}
+		}
+
+		_getch();
+		fclose(fp);
+		printf("\n");
+
+		if (storeOpen)
+		{
+			if (store.rowsAppended > 0)
+			{
+				/* Summaries come from the rollups, without reading the rows back */
+				nPoints = ts_store_query(&store, TS_LEVEL_MINUTE, 0, store.lastMs - 9 * ts_level_period_ms(TS_LEVEL_MINUTE), store.lastMs, points, 10);
+
+				printf("\nMinute rollups of %s Ch %d:\n", fleet->units[0].name, channels[0]);
+
+				for (u = 0; u < nPoints; u++)
+				{
+					printf("%lld: min %.3f, max %.3f, mean %.3f (%u readings)\n", (long long) points[u].timeMs / 1000,
+						points[u].min, points[u].max, points[u].mean, points[u].count);
+				}
+			}
+
+			ts_store_close(&store);
+		}
+
+		free(row);
+	}
+
+	for (u = 0; u < fleet->nUnits; u++)
+	{
+		PLCM3CloseUnit(fleet->units[u].handle);
+	}
+
+	fleet_close(fleet);
+	free(fleet);
+}
+
 void EthernetSettings()
 {
 	int32_t		tmp;
@@ -389,6 +651,12 @@ void main()
 
 	printf("Picolog CM3 (plcm3) Driver Example Program\n\n");
 
+	// Set default channel settings
+	for(channel = 0; channel < NUM_CHANNELS; channel++)
+	{
+		channelSettings[channel].measurementType = PLCM3_1_MILLIVOLT;
+	}
+
 	printf("Enumerating devices...\n\n");
 
 	// Enumerate all USB and Ethernet devices
@@ -409,7 +677,8 @@ void main()
 		printf("\n\n");
 		printf("Select connection:\n");
 		printf("U:\tUSB\n");
-		printf("E:\tEthernet\n\n");
+		printf("E:\tEthernet\n");
+		printf("F:\tFleet of ethernet units\n\n");
 
 		ch = toupper(_getch());
 
@@ -425,6 +694,10 @@ void main()
 				validSelection = 1;
 				break;
 
+			case 'F':
+				FleetPolling();
+				return;
+
 			default:
 				printf("Invalid input.\n");
 		}
@@ -456,12 +729,6 @@ void main()
 		printf("PLCM3 Opened.\n");
 	}
 
-	// Set default channel settings
-	for(channel = 0; channel < NUM_CHANNELS; channel++)
-	{
-		channelSettings[channel].measurementType = PLCM3_1_MILLIVOLT;
-	}
-
 	// Get unit serial number
 	get_info(g_handle);
 	
@@ -27,6 +27,7 @@
  *	  Collect a stream of data using an advanced trigger copying
  *	  the data from the callback
  *			- PicoScope 2202, 2204, 2204A, 2205 and 2205A only
+ *	  Collect a continuous stream of data to disk through a host ring
  *    Set the signal generator with the built in signals 
  *			- PicoScope 2203, 2204, 2204A, 2205 and 2205A only
  *	  Set the signal generator with the arbitrary signal 
@@ -143,6 +144,8 @@ int32_t fopen_s(FILE ** a, const char * b, const char * c)
 #define min(a,b) ((a) < (b) ? a : b)
 #endif
 
+#include "../../shared/PicoChunkRing.h"
+
 #define BUFFER_SIZE 	1024
 #define BUFFER_SIZE_STREAMING 50000		// Overview buffer size
 #define NUM_STREAMING_SAMPLES 10000000	// Number of streaming samples to collect
@@ -184,6 +187,7 @@ uint32_t	g_nValues;
 uint32_t	g_startIndex;			// Start index in application buffer where data should be written to in streaming mode collection
 uint32_t	g_prevStartIndex;		// Keep track of previous index into application buffer in streaming mode collection
 int16_t		g_appBufferFull = 0;	// Use this in the callback to indicate if it is going to copy past the end of the buffer
+CHUNK_RING	g_ring;					// Host ring drained to disk in continuous fast streaming
 
 typedef enum {
 	MODEL_NONE = 0,
@@ -381,6 +385,44 @@ void  PREF4 ps2000FastStreamingReady2( int16_t **overviewBuffers,
 	}
 }
 
+/****************************************************************************
+ *
+ * Streaming callback
+ *
+ * This demonstrates continuous streaming: the data in the overview buffers
+ * is appended to a host ring which a writer thread saves to disk, so the
+ * capture length is not limited by the application buffers
+ *
+ ****************************************************************************/
+void  PREF4 ps2000FastStreamingRing( int16_t **overviewBuffers,
+											int16_t overflow,
+											uint32_t triggeredAt,
+											int16_t triggered,
+											int16_t auto_stop,
+											uint32_t nValues)
+{
+	int16_t *	maxBuffers[DUAL_SCOPE] = {NULL, NULL};
+	int16_t		channel;
+
+	unitOpened.trigger.advanced.totalSamples += nValues;
+	unitOpened.trigger.advanced.autoStop = auto_stop;
+
+	g_overflow = overflow;
+
+	if (nValues > 0)
+	{
+		// Only the max buffers are used as there is no aggregation
+		for (channel = (int16_t) PS2000_CHANNEL_A; channel < g_ring.nChannels; channel++)
+		{
+			if (unitOpened.channelSettings[channel].enabled)
+			{
+				maxBuffers[channel] = overviewBuffers[channel * 2];
+			}
+		}
+
+		chunk_ring_append(&g_ring, maxBuffers, nValues);
+	}
+}
 
 /****************************************************************************
  *
@@ -1239,6 +1281,90 @@ void collect_fast_streaming (void)
 	_getch ();
 }
 
+/****************************************************************************
+ *
+ * collect_fast_streaming_ring
+ *
+ * Demonstrates continuous fast streaming with no fixed capture length.
+ * The callback appends the data to a host ring of chunks and a writer
+ * thread saves them to disk while the device is streaming. The ring only
+ * allocates more chunks while the disk falls behind.
+ *
+ ****************************************************************************/
+void collect_fast_streaming_ring (void)
+{
+	int32_t		ok;
+	int16_t		ch;
+	uint64_t	samplesWritten = 0;
+	uint64_t	nPreviousWritten = 0;
+	uint64_t	nQueued = 0;
+	uint64_t	nChunks = 0;
+
+	printf ( "Collect continuous streaming...\n" );
+	printf ( "Data is written to disk file (fast_stream_ring.bin)\n" );
+	printf ( "Press a key to start, then press a key to stop\n" );
+	_getch ();
+
+	set_defaults ();
+
+	// Continuous streaming cannot use a trigger
+	ps2000_set_trigger ( unitOpened.handle, PS2000_NONE, 0, 0, 0, 0 );
+
+	unitOpened.trigger.advanced.autoStop = 0;
+	unitOpened.trigger.advanced.totalSamples = 0;
+	unitOpened.trigger.advanced.triggered = 0;
+
+	// No memory limit (0), the ring grows while the disk falls behind
+	if (!chunk_ring_open (&g_ring, "fast_stream_ring.bin", unitOpened.noOfChannels, 0))
+	{
+		printf ( "Unable to create the host ring\n" );
+		return;
+	}
+
+	/* Collect data at 1us intervals with no aggregation and no auto stop
+	* NOTE: The actual sampling interval used by the driver might not be that which is specified below. Use the sampling intervals
+	* returned by the ps2000_get_timebase() function to work out the most appropriate sampling interval to use.
+	*/
+	ok = ps2000_run_streaming_ns ( unitOpened.handle, 1, PS2000_US, NUM_STREAMING_SAMPLES, 0, 1, BUFFER_SIZE_STREAMING );
+
+	printf ( "OK: %d\n", ok );
+
+	while (ok && !_kbhit())
+	{
+		ps2000_get_streaming_last_values (unitOpened.handle, ps2000FastStreamingRing);
+
+		chunk_ring_status (&g_ring, &samplesWritten, &nQueued, &nChunks);
+
+		// Report once per chunk written, printing to console can take up resources
+		if (samplesWritten != nPreviousWritten)
+		{
+			printf ("Collected: %llu, written: %llu, queued chunks: %llu, allocated chunks: %llu\n",
+				(unsigned long long) g_ring.samplesAppended, (unsigned long long) samplesWritten,
+				(unsigned long long) nQueued, (unsigned long long) nChunks);
+			nPreviousWritten = samplesWritten;
+		}
+		Sleep (0);
+	}
+
+	ps2000_stop (unitOpened.handle);
+
+	chunk_ring_close (&g_ring);
+
+	printf ( "\nCollected %llu samples, wrote %llu samples, dropped %llu samples\n",
+		(unsigned long long) g_ring.samplesAppended, (unsigned long long) g_ring.samplesWritten,
+		(unsigned long long) g_ring.samplesDropped );
+	printf ( "Peak memory: %llu chunks of %d samples\n", (unsigned long long) g_ring.nChunks, CHUNK_RING_SAMPLES );
+	printf ( "File format: int16_t ADC counts, one value per channel per sample (" );
+
+	for (ch = 0; ch < g_ring.nChannels; ch++)
+	{
+		printf ( "%c%s", 'A' + ch, unitOpened.channelSettings[ch].enabled ? "" : " off" );
+		printf ( ch < g_ring.nChannels - 1 ? ", " : ")\n" );
+	}
+
+	_getch ();
+}
+
 /****************************************************************************
  *
  * collect_fast_streaming_triggered
@@ -1986,6 +2112,7 @@ void main (void)
 			printf ( "F - Fast streaming\n");
 			printf ( "D - Fast streaming triggered\n");
 			printf ( "C - Fast streaming triggered 2\n");
+			printf ( "R - Fast streaming to disk (continuous)\n");
 			printf ( "G - Signal generator\n");
 			printf ( "H - Arbitrary signal generator\n");
 			printf ( "X - Exit\n" );
@@ -2052,6 +2179,17 @@ void main (void)
 				}
 				break;
 
+			case 'R':
+				if (unitOpened.hasFastStreaming)
+				{
+					collect_fast_streaming_ring ();
+				}
+				else
+				{
+					printf ("Not supported by this model\n\n");
+				}
+				break;
+
 			case 'E':
 				if (unitOpened.hasEts)
 				{
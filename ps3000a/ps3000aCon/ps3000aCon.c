@@ -77,6 +77,7 @@
  ******************************************************************************/
 
 #include <stdio.h>
+#include <time.h>
 
 /* Headers for Windows */
 #ifdef _WIN32
@@ -154,6 +155,10 @@ int32_t fopen_s(FILE ** a, const char * b, const char * c)
 #define min(a,b) ((a) < (b) ? a : b)
 #endif
 
+#include "../../shared/PicoDigital.h"
+#include "../../shared/PicoSerialDecode.h"
+#include "../../shared/PicoStatistics.h"
+
 #define PREF4 __stdcall
 
 int32_t cycles = 0;
@@ -245,6 +250,18 @@ uint32_t	g_trigAt = 0;
 char BlockFile[20]		= "block.txt";
 char DigiBlockFile[20]	= "digiBlock.txt";
 char StreamFile[20]		= "stream.txt";
+char DigiDecodeFile[20]	= "digiDecode.txt";
+
+// Serial bus decoding of the digital lines (see setSerialDecoders)
+#define MAX_SERIAL_DECODERS	3
+
+BOOL			decodeUart = FALSE;
+BOOL			decodeSpi = FALSE;
+BOOL			decodeI2c = FALSE;
+uint32_t		uartBaudRate = 9600;
+UART_SETTINGS	uartSettings = { 0, 0.0, 8, SERIAL_PARITY_NONE, 1, FALSE };
+SPI_SETTINGS	spiSettings = { 8, 9, 10, 11, 0, 0, 8, FALSE };
+I2C_SETTINGS	i2cSettings = { 12, 13 };
 
 typedef struct tBufferInfo
 {
@@ -585,6 +602,97 @@ PICO_STATUS clearDataBuffers(UNIT * unit)
 	return status;
 }
 
+/****************************************************************************
+* startSerialDecoders
+*
+* Sets up the enabled serial bus decoders for a capture
+* Inputs:
+* - decoders : array of MAX_SERIAL_DECODERS decoders
+* - timeInterval : sample interval in seconds
+*
+* Returns the number of decoders started
+****************************************************************************/
+int16_t startSerialDecoders(SERIAL_DECODER * decoders, double timeInterval)
+{
+	int16_t nDecoders = 0;
+	PICO_STATUS status;
+
+	if (decodeUart)
+	{
+		uartSettings.samplesPerBit = 1.0 / (uartBaudRate * timeInterval);
+
+		if ((status = serial_decoder_init_uart(&decoders[nDecoders], &uartSettings)) == PICO_OK)
+		{
+			nDecoders++;
+		}
+		else
+		{
+			printf("UART decoding needs at least 2 samples per bit at %lu baud.\n", uartBaudRate);
+		}
+	}
+
+	if (decodeSpi)
+	{
+		if ((status = serial_decoder_init_spi(&decoders[nDecoders], &spiSettings)) == PICO_OK)
+		{
+			nDecoders++;
+		}
+		else
+		{
+			printf("startSerialDecoders:serial_decoder_init_spi ------ 0x%08lx \n", status);
+		}
+	}
+
+	if (decodeI2c)
+	{
+		if ((status = serial_decoder_init_i2c(&decoders[nDecoders], &i2cSettings)) == PICO_OK)
+		{
+			nDecoders++;
+		}
+		else
+		{
+			printf("startSerialDecoders:serial_decoder_init_i2c ------ 0x%08lx \n", status);
+		}
+	}
+
+	return nDecoders;
+}
+
+/****************************************************************************
+* runSerialDecoders
+*
+* Decodes the samples added to the digital store since the last call and
+* writes the decoded frames to a file
+****************************************************************************/
+void runSerialDecoders(SERIAL_DECODER * decoders, int16_t nDecoders, DIGITAL_STORE * store, FILE * fp, double timeInterval)
+{
+	int16_t i;
+	PICO_STATUS status;
+
+	for (i = 0; i < nDecoders; i++)
+	{
+		if ((status = serial_decode(&decoders[i], store)) != PICO_OK)
+		{
+			printf("runSerialDecoders:serial_decode ------ 0x%08lx \n", status);
+		}
+
+		serial_write_frames(&decoders[i], fp, timeInterval);
+	}
+}
+
+/****************************************************************************
+* stopSerialDecoders
+****************************************************************************/
+void stopSerialDecoders(SERIAL_DECODER * decoders, int16_t nDecoders)
+{
+	int16_t i;
+
+	for (i = 0; i < nDecoders; i++)
+	{
+		serial_decoder_free(&decoders[i]);
+	}
+}
+
 /****************************************************************************
 * blockDataHandler
 * - Used by all block data routines
@@ -614,6 +722,11 @@ void blockDataHandler(UNIT * unit, char * text, int32_t offset, MODE mode)
 
 	FILE * fp = NULL;
 	FILE * digiFp = NULL;
+	FILE * decodeFp = NULL;
+
+	DIGITAL_STORE digitalStore;
+	SERIAL_DECODER decoders[MAX_SERIAL_DECODERS];
+	int16_t nDecoders;
 	
 	PICO_STATUS status;
 	PS3000A_RATIO_MODE ratioMode = PS3000A_RATIO_MODE_NONE;
@@ -845,6 +958,38 @@ void blockDataHandler(UNIT * unit, char * text, int32_t offset, MODE mode)
 
 					}
 				}
+
+				// Decode the serial buses from the packed digital data
+				if ((nDecoders = startSerialDecoders(decoders, timeInterval * 1e-9)) > 0)
+				{
+					if ((status = digital_store_init(&digitalStore, unit->digitalPorts, sampleCount)) == PICO_OK)
+					{
+						status = digital_store_append(&digitalStore, digiBuffer, sampleCount);
+					}
+
+					if (status != PICO_OK)
+					{
+						printf("BlockDataHandler:digital_store_append ------ 0x%08lx \n", status);
+					}
+					else
+					{
+						fopen_s(&decodeFp, DigiDecodeFile, "w");
+
+						if (decodeFp != NULL)
+						{
+							runSerialDecoders(decoders, nDecoders, &digitalStore, decodeFp, timeInterval * 1e-9);
+							fclose(decodeFp);
+							printf("Decoded serial frames written to %s\n", DigiDecodeFile);
+						}
+						else
+						{
+							printf("Cannot open the file %s for writing.\n", DigiDecodeFile);
+						}
+					}
+
+					digital_store_free(&digitalStore);
+					stopSerialDecoders(decoders, nDecoders);
+				}
 			}
 
 		} 
@@ -925,6 +1070,7 @@ void streamDataHandler(UNIT * unit, uint32_t preTrigger, MODE mode)
 	int16_t * appBuffers[PS3000A_MAX_CHANNEL_BUFFERS];
 	int16_t * digiBuffers[PS3000A_MAX_DIGITAL_PORTS];
 	int16_t * appDigiBuffers[PS3000A_MAX_DIGITAL_PORTS];
+	int16_t * newDigiSamples[PS3000A_MAX_DIGITAL_PORTS];
 	
 	PICO_STATUS status;
 
@@ -934,6 +1080,15 @@ void streamDataHandler(UNIT * unit, uint32_t preTrigger, MODE mode)
 	BUFFER_INFO bufferInfo;
 	FILE * fp = NULL;
 
+	DIGITAL_STORE digitalStore;
+	DIGITAL_TIMING timing;
+	SERIAL_DECODER decoders[MAX_SERIAL_DECODERS];
+	int16_t nDecoders = 0;
+	FILE * decodeFp = NULL;
+	double timeUnitSeconds[] = { 1e-15, 1e-12, 1e-9, 1e-6, 1e-3, 1.0 };	// PS3000A_TIME_UNITS
+	CHANNEL_STATISTICS channelStats[PS3000A_MAX_CHANNELS];
+	time_t statsPrinted = time(NULL);
+
 
 	if (mode == ANALOGUE)		// Analogue - collect raw data
 	{
@@ -949,6 +1104,8 @@ void streamDataHandler(UNIT * unit, uint32_t preTrigger, MODE mode)
 				appBuffers[i * 2] = (int16_t*) calloc(sampleCount, sizeof(int16_t));
 				appBuffers[i * 2 + 1] = (int16_t*) calloc(sampleCount, sizeof(int16_t));
 
+				stats_init(&channelStats[i], (int16_t)i, unit->maxValue);
+
 				printf(status ? "StreamDataHandler:ps3000aSetDataBuffers(channel %ld) ------ 0x%08lx \n":"", i, status);
 			}
 		}
@@ -1003,6 +1160,12 @@ void streamDataHandler(UNIT * unit, uint32_t preTrigger, MODE mode)
 			printf(status?"StreamDataHandler:ps3000aSetDataBuffer(channel %ld) ------ 0x%08lx \n":"", i, status);
 		}
 
+		// Packed copy of the stream (8 lines per byte) with a transition index per line
+		if ((status = digital_store_init(&digitalStore, unit->digitalPorts, sampleCount)) != PICO_OK)
+		{
+			printf("StreamDataHandler:digital_store_init ------ 0x%08lx \n", status);
+		}
+
 		downsampleRatio = 1;
 		timeUnits = PS3000A_MS;
 		sampleInterval = 10;
@@ -1056,6 +1219,22 @@ void streamDataHandler(UNIT * unit, uint32_t preTrigger, MODE mode)
 
 	printf("Streaming data...Press a key to stop\n");
 
+	// Serial frames are decoded as each block of digital data arrives
+	if (mode == DIGITAL && digitalStore.nPorts > 0)
+	{
+		if ((nDecoders = startSerialDecoders(decoders, sampleInterval * timeUnitSeconds[timeUnits])) > 0)
+		{
+			fopen_s(&decodeFp, DigiDecodeFile, "w");
+
+			if (decodeFp == NULL)
+			{
+				printf("Cannot open the file %s for writing.\n", DigiDecodeFile);
+				stopSerialDecoders(decoders, nDecoders);
+				nDecoders = 0;
+			}
+		}
+	}
+
 	if (mode == ANALOGUE)
 	{
 		fopen_s(&fp, StreamFile, "w");
@@ -1114,6 +1293,48 @@ void streamDataHandler(UNIT * unit, uint32_t preTrigger, MODE mode)
 				printf("Trig. at index %lu", triggeredAt);	// show where trigger occurred
 			}
 
+			if (mode == ANALOGUE)
+			{
+				// Update the running statistics of each channel with the new samples
+				for (j = 0; j < unit->channelCount; j++)
+				{
+					if (unit->channelSettings[j].enabled)
+					{
+						stats_update(&channelStats[j], &appBuffers[j * 2][g_startIndex], g_sampleCount);
+					}
+				}
+
+				// Print the statistics of the samples since the last print at most once a second
+				if (time(NULL) != statsPrinted)
+				{
+					statsPrinted = time(NULL);
+					for (j = 0; j < unit->channelCount; j++)
+					{
+						if (unit->channelSettings[j].enabled)
+						{
+							printf("\n");
+							stats_print(stdout, &channelStats[j], &channelStats[j].window, "Window statistics");
+							stats_reset_window(&channelStats[j]);
+						}
+					}
+				}
+			}
+
+			if (mode == DIGITAL && digitalStore.nPorts > 0)
+			{
+				for (i = 0; i < unit->digitalPorts; i++)
+				{
+					newDigiSamples[i] = appDigiBuffers[i] + g_startIndex;
+				}
+
+				digital_store_append(&digitalStore, newDigiSamples, g_sampleCount);
+
+				if (nDecoders > 0)
+				{
+					runSerialDecoders(decoders, nDecoders, &digitalStore, decodeFp, sampleInterval * timeUnitSeconds[timeUnits]);
+				}
+			}
+
 			for (i = g_startIndex; i < (int32_t)(g_startIndex + g_sampleCount); i++) 
 			{
 				if (mode == ANALOGUE)
@@ -1188,6 +1409,24 @@ void streamDataHandler(UNIT * unit, uint32_t preTrigger, MODE mode)
 		fclose(fp);	
 	}
 
+	if (mode == ANALOGUE)
+	{
+		for (i = 0; i < unit->channelCount; i++)
+		{
+			if (unit->channelSettings[i].enabled)
+			{
+				stats_print(stdout, &channelStats[i], &channelStats[i].lifetime, "Streaming statistics");
+			}
+		}
+	}
+
+	if (decodeFp != NULL)
+	{
+		fclose(decodeFp);
+		stopSerialDecoders(decoders, nDecoders);
+		printf("\nDecoded serial frames written to %s\n", DigiDecodeFile);
+	}
+
 	if (mode == ANALOGUE)		// Only if we allocated these buffers
 	{
 		for (i = 0; i < unit->channelCount; i++) 
@@ -1211,6 +1450,26 @@ void streamDataHandler(UNIT * unit, uint32_t preTrigger, MODE mode)
 			free(appDigiBuffers[i]);
 		}
 
+		// Edges and pulse widths of each line, measured over the transition index
+		if (digitalStore.nPorts > 0)
+		{
+			printf("\nDigital line timing over %llu samples (in samples):\n", (unsigned long long) digitalStore.nSamples);
+
+			for (bit = digitalStore.nPorts * DIGITAL_LINES_PER_PORT - 1; bit >= 0; bit--)
+			{
+				digital_line_timing(&digitalStore, (int16_t) bit, &timing);
+
+				if (timing.risingEdges + timing.fallingEdges > 0)
+				{
+					printf("D%-2ld rising: %llu falling: %llu high: %llu - %llu low: %llu - %llu\n", bit,
+						(unsigned long long) timing.risingEdges, (unsigned long long) timing.fallingEdges,
+						(unsigned long long) timing.minHigh, (unsigned long long) timing.maxHigh,
+						(unsigned long long) timing.minLow, (unsigned long long) timing.maxLow);
+				}
+			}
+		}
+
+		digital_store_free(&digitalStore);
 	}
 
 	if (mode == AGGREGATED) 		// Only if we allocated these buffers
@@ -2627,6 +2886,77 @@ void digitalStreamingImmediate(UNIT * unit)
 }
 
 
+/****************************************************************************
+* setSerialDecoders
+* Selects the serial buses to decode from the digital lines (D0 - D15)
+* in digital block and streaming captures
+***************************************************************************/
+void setSerialDecoders(UNIT *unit)
+{
+	int16_t nLines = unit->digitalPorts * 8;	// D0 to D15
+
+	printf("Serial decoding - frames are written to %s\n\n", DigiDecodeFile);
+
+	printf("Decode UART (Y/N)? ");
+	decodeUart = (toupper(_getch()) == 'Y');
+
+	if (decodeUart)
+	{
+		printf("\nUART line: ");
+		decodeUart = (scanf_s("%hd", &uartSettings.line) == 1);
+		printf("Baud rate: ");
+		decodeUart &= (scanf_s("%lu", &uartBaudRate) == 1);
+
+		if (!decodeUart || uartSettings.line < 0 || uartSettings.line >= nLines || uartBaudRate == 0)
+		{
+			printf("Invalid UART settings - UART decoding disabled\n");
+			decodeUart = FALSE;
+		}
+	}
+
+	printf("\nDecode SPI (Y/N)? ");
+	decodeSpi = (toupper(_getch()) == 'Y');
+
+	if (decodeSpi)
+	{
+		printf("\nSPI clock, MOSI, MISO and chip select lines (-1 if not used): ");
+		decodeSpi = (scanf_s("%hd %hd %hd %hd", &spiSettings.clockLine, &spiSettings.mosiLine, &spiSettings.misoLine, &spiSettings.csLine) == 4);
+		printf("SPI mode (0 - 3): ");
+		decodeSpi &= (scanf_s("%hd", &spiSettings.cpha) == 1);
+
+		if (!decodeSpi || spiSettings.clockLine < 0 || spiSettings.clockLine >= nLines ||
+			spiSettings.mosiLine < 0 || spiSettings.mosiLine >= nLines ||
+			spiSettings.misoLine < -1 || spiSettings.misoLine >= nLines ||
+			spiSettings.csLine < -1 || spiSettings.csLine >= nLines ||
+			spiSettings.cpha < 0 || spiSettings.cpha > 3)
+		{
+			printf("Invalid SPI settings - SPI decoding disabled\n");
+			decodeSpi = FALSE;
+		}
+
+		spiSettings.cpol = (spiSettings.cpha >> 1) & 1;
+		spiSettings.cpha &= 1;
+	}
+
+	printf("\nDecode I2C (Y/N)? ");
+	decodeI2c = (toupper(_getch()) == 'Y');
+
+	if (decodeI2c)
+	{
+		printf("\nI2C SCL and SDA lines: ");
+		decodeI2c = (scanf_s("%hd %hd", &i2cSettings.sclLine, &i2cSettings.sdaLine) == 2);
+
+		if (!decodeI2c || i2cSettings.sclLine < 0 || i2cSettings.sclLine >= nLines ||
+			i2cSettings.sdaLine < 0 || i2cSettings.sdaLine >= nLines)
+		{
+			printf("Invalid I2C settings - I2C decoding disabled\n");
+			decodeI2c = FALSE;
+		}
+	}
+
+	printf("\n");
+}
+
 /****************************************************************************
 * digitalMenu 
 * Displays digital examples available
@@ -2655,6 +2985,7 @@ void digitalMenu(UNIT *unit)
 		printf("O - Analogue 'OR'  Digital Triggered Block\n");
 		printf("S - Digital Streaming Mode\n");
 		printf("V - Digital Streaming Aggregated\n");
+		printf("D - Serial Decode Settings\n");
 		printf("X - Return to previous menu\n\n");
 		printf("Operation:");
 
@@ -2686,6 +3017,10 @@ void digitalMenu(UNIT *unit)
 			case 'V':
 				digitalStreamingAggregated(unit);
 				break;
+
+			case 'D':
+				setSerialDecoders(unit);
+				break;
 		}
 	}
 
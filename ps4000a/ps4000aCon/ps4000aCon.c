@@ -56,6 +56,7 @@
  ******************************************************************************/
 
 #include <stdio.h>
+#include <time.h>
 
 /* Headers for Windows */
 #ifdef _WIN32
@@ -134,6 +135,9 @@ return (fp>0)?0:-1;
 #define min(a,b) ((a) < (b) ? a : b)
 #endif
 
+#include "../../shared/PicoStatistics.h"
+#include "../../shared/PicoSoftTrigger.h"
+
 int32_t cycles = 0;
 
 #define BUFFER_SIZE 	1024
@@ -237,6 +241,8 @@ uint32_t		g_startIndex;
 int16_t			g_trig = 0;
 uint32_t		g_trigAt = 0;
 int16_t			g_probeStateChanged = 0;
+SOFT_TRIGGER *	g_softTrigger = NULL;		// Set by CollectStreamingSoftTriggered
+FILE *			g_softTriggerFp = NULL;
 
 USER_PROBE_INFO userProbeInfo;
 
@@ -710,6 +716,10 @@ void StreamDataHandler(UNIT * unit, uint32_t preTrigger)
 	PS4000A_RATIO_MODE ratioMode;
 
 	BUFFER_INFO bufferInfo;
+	CHANNEL_STATISTICS channelStats[PS4000A_MAX_CHANNELS];
+	time_t statsPrinted = time(NULL);
+	int16_t * triggerBuffers[PS4000A_MAX_CHANNELS];
+	int16_t nTriggerBuffers;
 
 	for (i = 0; i < unit->channelCount; i++)
 	{
@@ -722,6 +732,8 @@ void StreamDataHandler(UNIT * unit, uint32_t preTrigger)
 			appBuffers[i * 2] = (int16_t*) calloc(sampleCount, sizeof(int16_t));
 			appBuffers[i * 2 + 1] = (int16_t*) calloc(sampleCount, sizeof(int16_t));
 
+			stats_init(&channelStats[i], (int16_t)i, unit->maxADCValue);
+
 			printf(status?"StreamDataHandler:ps4000aSetDataBuffers(channel %d) ------ 0x%08x \n":"", i, status);
 		}
 	}
@@ -818,6 +830,44 @@ void StreamDataHandler(UNIT * unit, uint32_t preTrigger)
 				printf("Trig. at index %u", triggeredAt);	// show where trigger occurred
 			}
 
+			// Update the running statistics of each channel with the new samples
+			for (j = 0; j < unit->channelCount; j++)
+			{
+				if (unit->channelSettings[j].enabled)
+				{
+					stats_update(&channelStats[j], &appBuffers[j * 2][g_startIndex], g_sampleCount);
+				}
+			}
+
+			// Print the statistics of the samples since the last print at most once a second
+			if (time(NULL) != statsPrinted)
+			{
+				statsPrinted = time(NULL);
+				for (j = 0; j < unit->channelCount; j++)
+				{
+					if (unit->channelSettings[j].enabled)
+					{
+						printf("\n");
+						stats_print(stdout, &channelStats[j], &channelStats[j].window, "Window statistics");
+						stats_reset_window(&channelStats[j]);
+					}
+				}
+			}
+
+			if (g_softTrigger != NULL)
+			{
+				nTriggerBuffers = 0;
+
+				for (j = 0; j < unit->channelCount; j++)
+				{
+					if (unit->channelSettings[j].enabled)
+					{
+						triggerBuffers[nTriggerBuffers++] = &appBuffers[j * 2][g_startIndex];
+					}
+				}
+				soft_trigger_process(g_softTrigger, triggerBuffers, g_sampleCount);
+			}
+
 			for (i = g_startIndex; i < (int32_t)(g_startIndex + g_sampleCount); i++)
 			{
 
@@ -850,6 +900,11 @@ void StreamDataHandler(UNIT * unit, uint32_t preTrigger)
 
 	ps4000aStop(unit->handle);
 
+	if (g_softTrigger != NULL)
+	{
+		soft_trigger_flush(g_softTrigger);
+	}
+
 	if (!g_autoStopped)
 	{
 		printf("\nData collection aborted.\n");
@@ -865,6 +920,14 @@ void StreamDataHandler(UNIT * unit, uint32_t preTrigger)
 		fclose(fp);
 	}
 
+	for (i = 0; i < unit->channelCount; i++)
+	{
+		if (unit->channelSettings[i].enabled)
+		{
+			stats_print(stdout, &channelStats[i], &channelStats[i].lifetime, "Streaming statistics");
+		}
+	}
+
 	for (i = 0; i < unit->channelCount; i++)
 	{
 		if (unit->channelSettings[i].enabled)
@@ -1859,6 +1922,122 @@ void CollectStreamingTriggered(UNIT * unit)
 }
 
 
+/****************************************************************************
+* SoftTriggerEvent
+* Writes each software trigger event to the file softTrigger.txt
+***************************************************************************/
+void SoftTriggerEvent(SOFT_TRIGGER_EVENT * event, void * parameter)
+{
+	uint32_t i;
+	int16_t ch;
+
+	printf("\nSoftware trigger %u at sample %llu, high pulse %llu samples", event->eventNumber,
+		(unsigned long long) event->triggerSample, (unsigned long long) event->pulseWidth);
+
+	if (g_softTriggerFp == NULL)
+	{
+		return;
+	}
+
+	fprintf(g_softTriggerFp, "Event %u: trigger at sample %llu, pulse width %llu samples, %u pre-trigger samples\n",
+		event->eventNumber, (unsigned long long) event->triggerSample, (unsigned long long) event->pulseWidth, event->preSamples);
+
+	for (i = 0; i < event->nSamples; i++)
+	{
+		fprintf(g_softTriggerFp, "%6d", (int32_t) i - (int32_t) event->preSamples);
+
+		for (ch = 0; ch < event->nChannels; ch++)
+		{
+			fprintf(g_softTriggerFp, ", %6d", event->data[ch][i]);
+		}
+		fprintf(g_softTriggerFp, "\n");
+	}
+	fprintf(g_softTriggerFp, "\n");
+}
+
+/****************************************************************************
+* CollectStreamingSoftTriggered
+*  this function demonstrates a software trigger on a stream of data.
+*  Unlike the hardware trigger it re-arms after every event: each falling
+*  edge through 1000 mV on the first enabled channel that ends a high
+*  pulse longer than 100 samples gives an event.
+***************************************************************************/
+void CollectStreamingSoftTriggered(UNIT * unit)
+{
+	struct tPwq pulseWidth;
+	struct tPS4000ADirection directions;
+	SOFT_TRIGGER trigger;
+	SOFT_TRIGGER_SETTINGS settings;
+	PICO_STATUS status;
+	int16_t source = -1;
+	int16_t nChannels = 0;
+	int32_t ch;
+
+	for (ch = 0; ch < unit->channelCount; ch++)
+	{
+		if (unit->channelSettings[ch].enabled)
+		{
+			if (source < 0)
+			{
+				source = (int16_t) ch;
+			}
+			nChannels++;
+		}
+	}
+
+	if (source < 0)
+	{
+		printf("CollectStreamingSoftTriggered: No channels enabled\n");
+		return;
+	}
+
+	memset(&settings, 0, sizeof(SOFT_TRIGGER_SETTINGS));
+	settings.source = 0;	// First enabled channel
+	settings.type = SOFT_TRIGGER_FALLING;
+	settings.thresholdUpper = mv_to_adc(1000, unit->channelSettings[source].range, unit);
+	settings.hysteresis = 256 * 10;
+	settings.pwqType = SOFT_PWQ_GREATER_THAN;
+	settings.pwqLower = 100;
+	settings.preTrigger = 200;
+	settings.postTrigger = 800;
+
+	if ((status = soft_trigger_init(&trigger, &settings, nChannels, 200000, SoftTriggerEvent, NULL)) != PICO_OK)
+	{
+		printf("CollectStreamingSoftTriggered:soft_trigger_init ------ 0x%08lx \n", (unsigned long)status);
+		return;
+	}
+
+	memset(&pulseWidth, 0, sizeof(struct tPwq));
+	memset(&directions, 0, sizeof(struct tPS4000ADirection));
+
+	SetDefaults(unit);
+
+	printf("Collect streaming with a software trigger on channel %c...\n", 'A' + source);
+	printf("Data is written to disk file (stream.txt), events to softTrigger.txt\n");
+	printf("Press a key to start\n");
+	_getch();
+
+	/* Hardware trigger disabled */
+	SetTrigger(unit, NULL, 0, NULL, 0, &directions, 1, &pulseWidth, 0, 0, 0);
+
+	fopen_s(&g_softTriggerFp, "softTrigger.txt", "w");
+	g_softTrigger = &trigger;
+
+	StreamDataHandler(unit, 0);
+
+	g_softTrigger = NULL;
+
+	if (g_softTriggerFp != NULL)
+	{
+		fclose(g_softTriggerFp);
+		g_softTriggerFp = NULL;
+	}
+
+	printf("%u software trigger events\n", trigger.nEvents);
+	soft_trigger_free(&trigger);
+}
+
+
 /****************************************************************************
 * DisplaySettings 
 * Displays information about the user configurable settings in this example
@@ -2071,6 +2250,7 @@ void MainMenu(UNIT *unit)
 		printf("R - Collect set of rapid captures\n");
 		printf("S - Immediate streaming\n");
 		printf("W - Triggered streaming\n");
+		printf("U - Software triggered streaming\n");
 		
 		if (unit->sigGen != SIGGEN_NONE)
 		{
@@ -2111,6 +2291,10 @@ void MainMenu(UNIT *unit)
 				CollectStreamingTriggered(unit);
 				break;
 
+			case 'U':
+				CollectStreamingSoftTriggered(unit);
+				break;
+
 			case 'E':
 				if (unit->hasETS == FALSE)
 				{
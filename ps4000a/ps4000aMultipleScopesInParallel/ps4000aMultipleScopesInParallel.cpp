@@ -2,6 +2,10 @@
 #include "ps4000aApi.h"
 #include "iostream"
 #include "fstream"
+#include "chrono"
+#include "cmath"
+#include "thread"
+#include "vector"
 
 #include "windows.h"
 
@@ -24,12 +28,213 @@ struct ParallelDevice {
 
   int32_t AdcTrigger = 500;
   int32_t AutoTrigger = 30000;
+  int32_t preTriggerSamples = 100;
 
   int16_t isReady;
 
   int32_t* timeIndisposed;
 };
 
+enum class encPrintStyle {
+  TriggerChannelOnly = 1,
+  EveryChannel = 2
+};
+
+// Merge writer
+//
+// Writes the blocks of all the devices to one file, a row per sample time.
+// The devices are lined up on their trigger points (the pre-trigger
+// samples plus the trigger time offset), and only the rows every device
+// has data for are written.
+//
+// Every row has the same length, so each device is formatted by its own
+// thread straight into its columns of a chunk of rows, and the chunk is
+// written with one call while the next chunk is being formatted.
+enum class encMergeFormat {
+  Binary = 1,   // MergeFileHeader, then int16_t values, device by device and channel by channel in each row
+  Csv = 2       // Fixed-width text
+};
+
+constexpr int32_t MERGE_CHUNK_ROWS = 1 << 16;
+constexpr int32_t CSV_SAMPLE_WIDTH = 12;  // Sample number from the trigger
+constexpr int32_t CSV_VALUE_WIDTH = 7;    // ',' then -32768
+
+struct MergeFileHeader {
+  char magic[8] = { 'P', 'S', 'M', 'E', 'R', 'G', 'E', '1' };
+  int32_t numberOfDevices;
+  int32_t channelsPerDevice;
+  int64_t numberOfRows;
+  int64_t firstSample;                    // Sample number of the first row from the trigger
+  double timeIntervalNs;
+};
+
+struct MergeLayout {
+  int32_t channels;                       // Channels written per device, from channel A
+  int64_t firstSample;                    // Sample number of the first row from the trigger
+  int64_t numberOfRows;
+  std::vector<int64_t> bufferIndex;       // Buffer index of the first row, per device
+  std::vector<double> residualNs;         // Trigger offset left after rounding to a sample, per device
+  size_t rowBytes;
+};
+
+// Formats a value right-aligned in width characters
+static inline void formatFixed(char* out, int64_t value, int32_t width) {
+  uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+  char* p = out + width;
+
+  do {
+    *--p = static_cast<char>('0' + magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude && p > out);
+
+  if (value < 0 && p > out)
+    *--p = '-';
+  while (p > out)
+    *--p = ' ';
+}
+
+// Works out which sample of each device goes in each row
+static bool alignDevices(ParallelDevice* devices, int32_t numberOfDevices, int32_t channels, encMergeFormat format, MergeLayout& layout) {
+  static const double NS_PER_UNIT[] = { 1e-6, 1e-3, 1.0, 1e3, 1e6, 1e9 };  // PS4000A_FS to PS4000A_S
+  const double timeIntervalNs = devices[0].timeInterval;
+  int64_t lastSample = INT64_MAX;
+  std::vector<int64_t> triggerIndex(numberOfDevices);
+
+  layout.channels = channels;
+  layout.firstSample = INT64_MIN;
+  layout.bufferIndex.assign(numberOfDevices, 0);
+  layout.residualNs.assign(numberOfDevices, 0);
+
+  for (int32_t deviceNumber = 0; deviceNumber < numberOfDevices; ++deviceNumber) {
+    ParallelDevice& dev = devices[deviceNumber];
+    int64_t offset = 0;
+    PS4000A_TIME_UNITS timeUnits = PS4000A_NS;
+
+    if (dev.timeInterval != timeIntervalNs) {
+      std::cout << "PS" << deviceNumber << " samples every " << dev.timeInterval << " ns, not " << timeIntervalNs << " ns" << std::endl;
+      return false;
+    }
+
+    auto status = ps4000aGetTriggerTimeOffset64(dev.handle, &offset, &timeUnits, 0);
+    if (PICO_OK != status) {
+      std::cout << "PS" << deviceNumber << " Get Trigger Time Offset : " << status << std::endl;
+      return false;
+    }
+
+    // The trigger is offsetNs after the pre-trigger samples
+    const double offsetNs = offset * NS_PER_UNIT[timeUnits];
+    const int64_t offsetSamples = llround(offsetNs / timeIntervalNs);
+    triggerIndex[deviceNumber] = dev.preTriggerSamples + offsetSamples;
+    layout.residualNs[deviceNumber] = offsetNs - offsetSamples * timeIntervalNs;
+
+    layout.firstSample = max(layout.firstSample, -triggerIndex[deviceNumber]);
+    lastSample = min(lastSample, dev.noSamples - triggerIndex[deviceNumber]);
+  }
+
+  layout.numberOfRows = max(lastSample - layout.firstSample, static_cast<int64_t>(0));
+  for (int32_t deviceNumber = 0; deviceNumber < numberOfDevices; ++deviceNumber)
+    layout.bufferIndex[deviceNumber] = triggerIndex[deviceNumber] + layout.firstSample;
+
+  if (encMergeFormat::Binary == format)
+    layout.rowBytes = numberOfDevices * channels * sizeof(int16_t);
+  else
+    layout.rowBytes = CSV_SAMPLE_WIDTH + numberOfDevices * channels * CSV_VALUE_WIDTH + 1;
+  return true;
+}
+
+// Fills one device's columns of a chunk of rows
+static void formatDevice(const ParallelDevice& dev, const MergeLayout& layout, int32_t deviceNumber, encMergeFormat format,
+  int64_t firstRow, int64_t rows, char* chunk) {
+  const int16_t* const* buffer = dev.buffer;
+  const int64_t index = layout.bufferIndex[deviceNumber] + firstRow;
+
+  if (encMergeFormat::Binary == format) {
+    char* out = chunk + deviceNumber * layout.channels * sizeof(int16_t);
+    for (int64_t row = 0; row < rows; ++row, out += layout.rowBytes)
+      for (int32_t ch = 0; ch < layout.channels; ++ch)
+        memcpy(out + ch * sizeof(int16_t), &buffer[ch][index + row], sizeof(int16_t));
+  }
+  else {
+    char* out = chunk + CSV_SAMPLE_WIDTH + deviceNumber * layout.channels * CSV_VALUE_WIDTH;
+    for (int64_t row = 0; row < rows; ++row, out += layout.rowBytes)
+      for (int32_t ch = 0; ch < layout.channels; ++ch) {
+        out[ch * CSV_VALUE_WIDTH] = ',';
+        formatFixed(out + ch * CSV_VALUE_WIDTH + 1, buffer[ch][index + row], CSV_VALUE_WIDTH - 1);
+      }
+  }
+}
+
+static bool writeMerged(ParallelDevice* devices, int32_t numberOfDevices, const MergeLayout& layout, encMergeFormat format, const char* fileName) {
+  std::ofstream outputFile(fileName, std::ios::binary);
+  std::vector<char> chunks[2];
+  std::thread writer;
+
+  if (!outputFile) {
+    std::cout << "Cannot open " << fileName << std::endl;
+    return false;
+  }
+
+  if (encMergeFormat::Binary == format) {
+    MergeFileHeader header;
+    header.numberOfDevices = numberOfDevices;
+    header.channelsPerDevice = layout.channels;
+    header.numberOfRows = layout.numberOfRows;
+    header.firstSample = layout.firstSample;
+    header.timeIntervalNs = devices[0].timeInterval;
+    outputFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  }
+  else {
+    outputFile << "# " << devices[0].timeInterval << " ns per sample";
+    for (int32_t deviceNumber = 0; deviceNumber < numberOfDevices; ++deviceNumber)
+      outputFile << ", PS" << deviceNumber << " triggered " << layout.residualNs[deviceNumber] << " ns after sample 0";
+    outputFile << "\n" << "Sample";
+    for (int32_t deviceNumber = 0; deviceNumber < numberOfDevices; ++deviceNumber)
+      for (int32_t ch = 0; ch < layout.channels; ++ch)
+        outputFile << ",PS" << deviceNumber << " " << static_cast<char>('A' + ch);
+    outputFile << "\n";
+  }
+
+  for (auto& chunk : chunks)
+    chunk.resize(MERGE_CHUNK_ROWS * layout.rowBytes);
+
+  for (int64_t firstRow = 0, chunkNumber = 0; firstRow < layout.numberOfRows; firstRow += MERGE_CHUNK_ROWS, ++chunkNumber) {
+    const int64_t rows = min(static_cast<int64_t>(MERGE_CHUNK_ROWS), layout.numberOfRows - firstRow);
+    char* chunk = chunks[chunkNumber & 1].data();
+    std::vector<std::thread> formatters;
+
+    for (int32_t deviceNumber = 0; deviceNumber < numberOfDevices; ++deviceNumber)
+      formatters.emplace_back(formatDevice, std::cref(devices[deviceNumber]), std::cref(layout), deviceNumber, format, firstRow, rows, chunk);
+
+    if (encMergeFormat::Csv == format) {
+      char* out = chunk;
+      for (int64_t row = 0; row < rows; ++row, out += layout.rowBytes) {
+        formatFixed(out, layout.firstSample + firstRow + row, CSV_SAMPLE_WIDTH);
+        out[layout.rowBytes - 1] = '\n';
+      }
+    }
+
+    for (auto& formatter : formatters)
+      formatter.join();
+
+    // Write this chunk while the next one is formatted into the other buffer
+    if (writer.joinable())
+      writer.join();
+    writer = std::thread([&outputFile, chunk, bytes = rows * layout.rowBytes] {
+      outputFile.write(chunk, bytes);
+    });
+  }
+
+  if (writer.joinable())
+    writer.join();
+  outputFile.close();
+
+  if (!outputFile) {
+    std::cout << "Error writing " << fileName << std::endl;
+    return false;
+  }
+  return true;
+}
+
 int main() {
   constexpr int32_t numberOfDevices = 1;
   ParallelDevice parallelDevice[numberOfDevices];
@@ -90,7 +295,6 @@ int main() {
   // Get Timebase
   std::cout << "Get Timebase" << std::endl;
   const auto TEN_MEGA_SAMPLES = pow(10, 7);
-  auto numOfSamples = TEN_MEGA_SAMPLES;
   // 12.5 ns  (n+1)
   // Sampling Frequency = 80MHz / ( n + 1 )
 
@@ -160,7 +364,7 @@ int main() {
     for (int32_t deviceNumber = 0; deviceNumber < numberOfDevices; ++deviceNumber) {
       ParallelDevice& dev = parallelDevice[deviceNumber];
       dev.timeIndisposed = new int32_t(NUMBER_OF_CHANNELS);
-      status2 = ps4000aRunBlock(dev.handle, 100, TEN_MEGA_SAMPLES - 100, dev.timebase, dev.timeIndisposed, 0, nullptr, nullptr);
+      status2 = ps4000aRunBlock(dev.handle, dev.preTriggerSamples, dev.noSamples - dev.preTriggerSamples, dev.timebase, dev.timeIndisposed, 0, nullptr, nullptr);
       if (PICO_OK != status2) {
         std::cout << "PS" << deviceNumber << " Run Block : " << status2 << std::endl;
         return -1;
@@ -201,104 +405,25 @@ int main() {
     }
   }
 
-  // Printing Values
-  std::cout << "Printing Values" << std::endl;
-  std::ofstream outputFile;
-  outputFile.open("outputFile.txt");
-  enum class encIncrementStep {
-    OneUnitIncrementStep = 1,
-    TenThousandIncrementStep = 10000
-  };
-  constexpr auto incrementStep = encIncrementStep::TenThousandIncrementStep;
-  enum class encPrintStyle {
-    TriggerChannelOnly = 1,
-    EveryChannel = 2
-  };
-  constexpr auto channelPrintStyle = encPrintStyle::EveryChannel;
-
-  constexpr auto PRINT_ONLY_EVERY_10000_SAMPLES = 10000;
-  for (auto s = 0; s < 1000; s++) {
-    switch (channelPrintStyle) {
-    case encPrintStyle::EveryChannel: {
-      for (int32_t deviceNumber = 0; deviceNumber < numberOfDevices; ++deviceNumber) {
-        ParallelDevice& dev = parallelDevice[deviceNumber];
-        if (0 == deviceNumber) {
-          outputFile << s << " ; " << dev.buffer[0][s];
-          for (auto ch = 1; ch < NUMBER_OF_CHANNELS; ++ch)
-            outputFile << " ; " << dev.buffer[ch][s];
-        }
-        else if (numberOfDevices - 1 == deviceNumber) {
-          outputFile << "\t || \t" << dev.buffer[0][s];
-          for (auto ch = 1; ch < NUMBER_OF_CHANNELS; ++ch)
-            outputFile << " ; " << dev.buffer[ch][s];
-          outputFile << std::endl;
-        }
-        else {
-          outputFile << "\t || \t" << dev.buffer[0][s];
-          for (auto ch = 1; ch < NUMBER_OF_CHANNELS; ++ch)
-            outputFile << " ; " << dev.buffer[ch][s];
-        }
-      }
-      break;
-    }
-    case encPrintStyle::TriggerChannelOnly: {
-      constexpr int CHANNEL_A = 0;
-      for (int32_t deviceNumber = 0; deviceNumber < numberOfDevices; ++deviceNumber) {
-        ParallelDevice& dev = parallelDevice[deviceNumber];
-        if (0 == deviceNumber)
-          outputFile << s << " ; " << dev.buffer[CHANNEL_A][s];
-        else if (numberOfDevices - 1 == deviceNumber)
-          outputFile << "\t || \t" << dev.buffer[CHANNEL_A][s] <<
-          std::endl;
-        else
-          outputFile << "\t || \t" << dev.buffer[CHANNEL_A][s];
-      }
-      break;
-    }
-    }
-  }
-  for (auto s = 0; s < numOfSamples; s += static_cast<int>(incrementStep)) {
-    if (0 == (s % PRINT_ONLY_EVERY_10000_SAMPLES))
-      std::cout << s << std::endl;
-
-    switch (channelPrintStyle) {
-    case encPrintStyle::EveryChannel: {
-      for (int32_t deviceNumber = 0; deviceNumber < numberOfDevices; ++deviceNumber) {
-        ParallelDevice& dev = parallelDevice[deviceNumber];
-        if (0 == deviceNumber) {
-          outputFile << s << " ; " << dev.buffer[0][s];
-          for (auto ch = 1; ch < NUMBER_OF_CHANNELS; ++ch)
-            outputFile << " ; " << dev.buffer[ch][s];
-        }
-        else if (numberOfDevices - 1 == deviceNumber) {
-          outputFile << "\t || \t" << dev.buffer[0][s];
-          for (auto ch = 1; ch < NUMBER_OF_CHANNELS; ++ch)
-            outputFile << " ; " << dev.buffer[ch][s];
-          outputFile << std::endl;
-        }
-        else {
-          outputFile << "\t || \t" << dev.buffer[0][s];
-          for (auto ch = 1; ch < NUMBER_OF_CHANNELS; ++ch)
-            outputFile << " ; " << dev.buffer[ch][s];
-        }
-      }
-      break;
-    }
-    case encPrintStyle::TriggerChannelOnly: {
-      constexpr int CHANNEL_A = 0;
-      for (int32_t deviceNumber = 0; deviceNumber < numberOfDevices; ++deviceNumber) {
-        ParallelDevice& dev = parallelDevice[deviceNumber];
-        if (0 == deviceNumber)
-          outputFile << s << " ; " << dev.buffer[CHANNEL_A][s];
-        else if (numberOfDevices - 1 == deviceNumber)
-          outputFile << "\t || \t" << dev.buffer[CHANNEL_A][s] <<
-          std::endl;
-        else
-          outputFile << "\t || \t" << dev.buffer[CHANNEL_A][s];
-      }
-      break;
-    }
-    }
+  // Merging Values
+  std::cout << "Merging Values" << std::endl;
+  {
+    constexpr auto channelPrintStyle = encPrintStyle::EveryChannel;
+    constexpr auto mergeFormat = encMergeFormat::Csv;
+    const char* fileName = encMergeFormat::Csv == mergeFormat ? "outputFile.txt" : "outputFile.bin";
+    MergeLayout layout;
+
+    if (!alignDevices(parallelDevice, numberOfDevices,
+      encPrintStyle::EveryChannel == channelPrintStyle ? NUMBER_OF_CHANNELS : 1, mergeFormat, layout))
+      return -1;
+
+    const auto start = std::chrono::steady_clock::now();
+    if (!writeMerged(parallelDevice, numberOfDevices, layout, mergeFormat, fileName))
+      return -1;
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << layout.numberOfRows << " rows from sample " << layout.firstSample << " written to " << fileName
+      << " in " << elapsed.count() << " s" << std::endl;
   }
 
   // Free Buffers
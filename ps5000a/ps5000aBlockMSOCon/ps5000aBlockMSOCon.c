@@ -129,6 +129,9 @@ int32_t fopen_s(FILE ** a, const int8_t * b, const int8_t * c)
 #define min(a,b) ((a) < (b) ? a : b)
 #endif
 
+#include "../../shared/PicoDigital.h"
+#include "../../shared/PicoSerialDecode.h"
+
 int32_t cycles = 0;
 
 #define QUAD_SCOPE		4
@@ -136,6 +139,16 @@ int32_t cycles = 0;
 
 #define MAX_DIGITAL_PORTS 2
 
+// Serial bus decoding of the digital lines
+#define UART_LINE			0	// D0
+#define UART_BAUD_RATE		9600
+#define SPI_CLOCK_LINE		8	// D8 - D11, mode 0, chip select active low
+#define SPI_MOSI_LINE		9
+#define SPI_MISO_LINE		10
+#define SPI_CS_LINE			11
+#define I2C_SCL_LINE		12	// D12 & D13
+#define I2C_SDA_LINE		13
+
 #define MAX_PICO_DEVICES 64
 #define TIMED_LOOP_STEP 500
 
@@ -168,6 +181,7 @@ int16_t			g_overflow = 0;
 
 int8_t blockFile[20] = "block.txt";
 int8_t digiBlockFile[20] = "digiBlock.txt";
+int8_t digiDecodeFile[20] = "digiDecode.txt";
 
 /****************************************************************************
 * Callback
@@ -496,6 +510,24 @@ int32_t main(void)
 
     printf("Data collection complete - collected %d samples per channel.\n", totalSamples);
 
+    // Pack the digital ports (8 lines per byte) and index the transitions of each line
+    DIGITAL_STORE digitalStore;
+    DIGITAL_TIMING timing;
+    int16_t digiLine;
+
+    status = digital_store_init(&digitalStore, MAX_DIGITAL_PORTS, totalSamples);
+
+    if (status == PICO_OK)
+    {
+      status = digital_store_append(&digitalStore, digiBuffers, totalSamples);
+    }
+
+    if (status != PICO_OK)
+    {
+      fprintf(stderr, "digital_store_append ------ 0x%08lx \n", status);
+      return -1;
+    }
+
     // Output data to file
 
     FILE * fp;
@@ -547,9 +579,7 @@ int32_t main(void)
 
       for (i = 0; i < totalSamples; i++)
       {
-        digiValue = 0x00ff & digiBuffers[1][i];	// Mask Port 1 values to get lower 8 bits
-        digiValue <<= 8;												// Shift by 8 bits to place in upper 8 bits of 16-bit word
-        digiValue |= digiBuffers[0][i];					// Mask Port 0 values to get lower 8 bits and apply bitwise inclusive OR to combine with Port 1 values
+        digiValue = (uint16_t)digital_store_value(&digitalStore, i);	// Port 1 in the upper 8 bits, Port 0 in the lower 8 bits
 
         // Output data in binary form
         for (bit = 0; bit < 16; bit++)
@@ -570,6 +600,76 @@ int32_t main(void)
     {
       printf("Cannot open file %s for writing.\n", digiBlockFile);
     }
+
+    // Edge counts and pulse widths are measured over the transitions, not the samples
+    printf("\nDigital line timing (samples, interval %.1f ns):\n", timeInterval);
+
+    for (digiLine = 15; digiLine >= 0; digiLine--)
+    {
+      digital_line_timing(&digitalStore, digiLine, &timing);
+
+      if (timing.risingEdges + timing.fallingEdges == 0)
+      {
+        continue;
+      }
+
+      printf("D%-2d rising: %llu falling: %llu high: %llu - %llu low: %llu - %llu duty: %.1f%%\n", digiLine,
+        (unsigned long long)timing.risingEdges, (unsigned long long)timing.fallingEdges,
+        (unsigned long long)timing.minHigh, (unsigned long long)timing.maxHigh,
+        (unsigned long long)timing.minLow, (unsigned long long)timing.maxLow,
+        100.0 * timing.highSamples / digitalStore.nSamples);
+    }
+
+    // Decode the serial buses on the digital lines
+    SERIAL_DECODER decoders[3];
+    PICO_STATUS decoderStatus[3];
+    char * decoderNames[3] = { "UART", "SPI", "I2C" };
+    UART_SETTINGS uartSettings = { UART_LINE, 1.0 / (UART_BAUD_RATE * timeInterval * 1e-9), 8, SERIAL_PARITY_NONE, 1, FALSE };
+    SPI_SETTINGS spiSettings = { SPI_CLOCK_LINE, SPI_MOSI_LINE, SPI_MISO_LINE, SPI_CS_LINE, 0, 0, 8, FALSE };
+    I2C_SETTINGS i2cSettings = { I2C_SCL_LINE, I2C_SDA_LINE };
+    FILE * decodeFp;
+    int16_t d;
+
+    decoderStatus[0] = serial_decoder_init_uart(&decoders[0], &uartSettings);
+    decoderStatus[1] = serial_decoder_init_spi(&decoders[1], &spiSettings);
+    decoderStatus[2] = serial_decoder_init_i2c(&decoders[2], &i2cSettings);
+
+    if (decoderStatus[0] != PICO_OK)
+    {
+      printf("UART decoding needs at least 2 samples per bit at %d baud.\n", UART_BAUD_RATE);
+    }
+
+    fopen_s(&decodeFp, digiDecodeFile, "w");
+
+    if (decodeFp != NULL)
+    {
+      fprintf(decodeFp, "Serial Decode log\n");
+      fprintf(decodeFp, "UART D%d %d baud, SPI D%d - D%d, I2C D%d & D%d\n\n", UART_LINE, UART_BAUD_RATE,
+        SPI_CLOCK_LINE, SPI_CS_LINE, I2C_SCL_LINE, I2C_SDA_LINE);
+
+      for (d = 0; d < 3; d++)
+      {
+        if (decoderStatus[d] == PICO_OK)
+        {
+          serial_decode(&decoders[d], &digitalStore);
+          printf("%s: %llu frames\n", decoderNames[d], (unsigned long long)decoders[d].nFrames);
+          serial_write_frames(&decoders[d], decodeFp, timeInterval * 1e-9);
+        }
+      }
+
+      fclose(decodeFp);
+    }
+    else
+    {
+      printf("Cannot open file %s for writing.\n", digiDecodeFile);
+    }
+
+    for (d = 0; d < 3; d++)
+    {
+      serial_decoder_free(&decoders[d]);
+    }
+
+    digital_store_free(&digitalStore);
   }
   else
   {
@@ -18,6 +18,7 @@
  *   Collect a block of samples when a trigger event occurs
  *	 Collect a block of samples using Equivalent Time Sampling (ETS)
  *   Collect samples using a rapid block capture with trigger
+ *   Match the rapid block captures of several units by trigger time stamp
  *   Collect a stream of data immediately
  *   Collect a stream of data when a trigger event occurs
  *   Set Signal Generator, using standard or custom signals
@@ -58,6 +59,8 @@
  ******************************************************************************/
 
 #include <stdio.h>
+#include <time.h>
+#include <math.h>
 
 /* Headers for Windows */
 #ifdef _WIN32
@@ -135,9 +138,15 @@ return (fp>0)?0:-1;
 #define min(a,b) ((a) < (b) ? a : b)
 #endif
 
+#include "../../shared/PicoTimebase.h"
+#include "../../shared/PicoEts.h"
+#include "../../shared/PicoStatistics.h"
+#include "../../shared/PicoTriggerCorrelator.h"
+
 int32_t cycles = 0;
 
 #define BUFFER_SIZE 	1024
+#define ETS_CYCLES		10	// ETS block captures merged into one waveform
 
 #define QUAD_SCOPE		4
 #define DUAL_SCOPE		2
@@ -145,6 +154,10 @@ int32_t cycles = 0;
 #define MAX_PICO_DEVICES 64
 #define TIMED_LOOP_STEP 500
 
+#define CORRELATED_RUNS			5		// Rapid block runs of all units in collectRapidBlockCorrelated
+#define CORRELATED_CAPTURES		32		// Captures per run
+#define CORRELATED_TOLERANCE	20		// Sample intervals between time stamps of one trigger on different units
+
 typedef struct
 {
 	int16_t DCcoupled;
@@ -210,6 +223,8 @@ typedef struct
 }UNIT;
 
 uint32_t	timebase = 8;
+TIMEBASE_SOLVER timebaseSolver;
+ETS_RECONSTRUCTOR etsReconstructor;
 BOOL			scaleVoltages = TRUE;
 
 uint16_t inputRanges [PS5000A_MAX_RANGES] = {
@@ -238,6 +253,7 @@ int16_t			g_overflow = 0;
 
 int8_t blockFile[20]  = "block.txt";
 int8_t streamFile[20] = "stream.txt";
+int8_t etsFile[20] = "etsWaveform.txt";
 
 typedef struct tBufferInfo
 {
@@ -698,6 +714,26 @@ void blockDataHandler(UNIT * unit, int8_t * text, int32_t offset, int16_t etsMod
 
 			sampleCount = min(sampleCount, BUFFER_SIZE);
 
+			// Merge this capture into the ETS waveform (see collectBlockEts)
+			if (etsModeSet && etsReconstructor.capacity != 0)
+			{
+				int16_t * etsBuffers[ETS_MAX_CHANNELS] = { NULL };
+
+				for (j = 0; j < unit->channelCount; j++)
+				{
+					if (unit->channelSettings[j].enabled)
+					{
+						etsBuffers[j] = buffers[j * 2];
+					}
+				}
+
+				if ((status = ets_add_block(&etsReconstructor, etsTime, etsBuffers, sampleCount)) != PICO_OK)
+				{
+					printf("blockDataHandler:ets_add_block ------ 0x%08lx \n", status);
+					ets_free(&etsReconstructor);	// collectBlockEts stops and skips the reconstruction
+				}
+			}
+
 			fopen_s(&fp, blockFile, "w");
 
 			if (fp != NULL)
@@ -830,6 +866,8 @@ void streamDataHandler(UNIT * unit, uint32_t preTrigger)
 	int16_t retry = 0;
 	int16_t powerChange = 0;
 	uint32_t numStreamingValues = 0;
+	CHANNEL_STATISTICS channelStats[PS5000A_MAX_CHANNELS];
+	time_t statsPrinted = time(NULL);
 
 	BUFFER_INFO bufferInfo;
 
@@ -853,6 +891,8 @@ void streamDataHandler(UNIT * unit, uint32_t preTrigger)
 				appBuffers[i * 2] = (int16_t*) calloc(sampleCount, sizeof(int16_t));
 				appBuffers[i * 2 + 1] = (int16_t*) calloc(sampleCount, sizeof(int16_t));
 
+				stats_init(&channelStats[i], (int16_t)i, unit->maxADCValue);
+
 				printf(status?"StreamDataHandler:ps5000aSetDataBuffers(channel %ld) ------ 0x%08lx \n":"", i, status);
 			}
 		}
@@ -979,6 +1019,30 @@ void streamDataHandler(UNIT * unit, uint32_t preTrigger)
 				printf("Trig. at index %lu total %lu", g_trigAt, triggeredAt + 1);	// show where trigger occurred
 				
 			}
+
+			// Update the running statistics of each channel with the new samples
+			for (j = 0; j < unit->channelCount; j++)
+			{
+				if (unit->channelSettings[j].enabled)
+				{
+					stats_update(&channelStats[j], &appBuffers[j * 2][g_startIndex], g_sampleCount);
+				}
+			}
+
+			// Print the statistics of the samples since the last print at most once a second
+			if (time(NULL) != statsPrinted)
+			{
+				statsPrinted = time(NULL);
+				for (j = 0; j < unit->channelCount; j++)
+				{
+					if (unit->channelSettings[j].enabled)
+					{
+						printf("\n");
+						stats_print(stdout, &channelStats[j], &channelStats[j].window, "Window statistics");
+						stats_reset_window(&channelStats[j]);
+					}
+				}
+			}
 			
 			for (i = g_startIndex; i < (int32_t)(g_startIndex + g_sampleCount); i++) 
 			{
@@ -1020,6 +1084,14 @@ void streamDataHandler(UNIT * unit, uint32_t preTrigger)
 		fclose (fp);
 	}
 
+	for (i = 0; i < unit->channelCount; i++)
+	{
+		if (unit->channelSettings[i].enabled)
+		{
+			stats_print(stdout, &channelStats[i], &channelStats[i].lifetime, "Streaming statistics");
+		}
+	}
+
 	if (!g_autoStopped && !powerChange)  
 	{
 		printf("\nData collection aborted\n");
@@ -1168,6 +1240,99 @@ void collectBlockImmediate(UNIT * unit)
 	blockDataHandler(unit, (int8_t *) "First 10 readings\n", 0, FALSE);
 }
 
+/****************************************************************************
+* writeEtsWaveform
+*  Reconstructs the merged ETS captures as one uniformly sampled waveform
+*  and writes it to etsWaveform.txt
+****************************************************************************/
+void writeEtsWaveform(UNIT * unit)
+{
+	PICO_STATUS status = PICO_OK;
+	int16_t * outputs[ETS_MAX_CHANNELS] = { NULL };
+	int64_t startTime = 0;
+	uint64_t nOutput = ets_output_size(&etsReconstructor);
+	uint64_t i;
+	int16_t j;
+
+	FILE * fp = NULL;
+
+	if (nOutput == 0)
+	{
+		printf("writeEtsWaveform: no ETS data\n");
+		return;
+	}
+
+	for (j = 0; j < unit->channelCount; j++)
+	{
+		if (unit->channelSettings[j].enabled)
+		{
+			outputs[j] = (int16_t*) calloc((size_t) nOutput, sizeof(int16_t));
+
+			if (outputs[j] == NULL)
+			{
+				status = PICO_MEMORY;
+			}
+		}
+	}
+
+	if (status != PICO_OK)
+	{
+		printf("writeEtsWaveform:calloc ------ 0x%08lx \n", status);
+	}
+	else if ((status = ets_reconstruct(&etsReconstructor, &startTime, nOutput, outputs)) != PICO_OK)
+	{
+		printf("writeEtsWaveform:ets_reconstruct ------ 0x%08lx \n", status);
+	}
+	else
+	{
+		printf("ETS waveform: %llu samples at %lld fs from %llu captured samples\n",
+			nOutput, etsReconstructor.interval, etsReconstructor.count);
+
+		fopen_s(&fp, etsFile, "w");
+
+		if (fp != NULL)
+		{
+			fprintf(fp, "ETS Reconstructed Waveform\n\n");
+			fprintf(fp, "Time (fs) ");
+
+			for (j = 0; j < unit->channelCount; j++)
+			{
+				if (unit->channelSettings[j].enabled)
+				{
+					fprintf(fp, " Ch    ADC       mV   ");
+				}
+			}
+			fprintf(fp, "\n");
+
+			for (i = 0; i < nOutput; i++)
+			{
+				fprintf(fp, "%I64d ", startTime + (int64_t) i * etsReconstructor.interval);
+
+				for (j = 0; j < unit->channelCount; j++)
+				{
+					if (outputs[j] != NULL)
+					{
+						fprintf(fp, "Ch%C  %6d = %+6dmV   ", 'A' + j, outputs[j][i],
+							adc_to_mv(outputs[j][i], unit->channelSettings[PS5000A_CHANNEL_A + j].range, unit));
+					}
+				}
+				fprintf(fp, "\n");
+			}
+			fclose(fp);
+		}
+		else
+		{
+			printf(	"Cannot open the file %s for writing.\n"
+				"Please ensure that you have permission to access the file.\n", etsFile);
+		}
+	}
+
+	for (j = 0; j < unit->channelCount; j++)
+	{
+		free(outputs[j]);
+	}
+}
+
 /****************************************************************************
 * collectBlockEts
 *  this function demonstrates how to collect a block of
@@ -1180,6 +1345,7 @@ void collectBlockEts(UNIT * unit)
 	int16_t triggerVoltage = 1000; // millivolts
 	uint32_t delay = 0;
 	int16_t etsModeSet = FALSE;
+	int16_t cycle;
 
 	PS5000A_CHANNEL triggerChannel = PS5000A_CHANNEL_A;
 	int16_t voltageRange = inputRanges[unit->channelSettings[triggerChannel].range];
@@ -1255,7 +1421,27 @@ void collectBlockEts(UNIT * unit)
 
 	printf("ETS Sample Time is %ld picoseconds\n", ets_sampletime);
 
-	blockDataHandler(unit, (int8_t *) "Ten readings after trigger\n", BUFFER_SIZE / 10 - 5, etsModeSet); // 10% of data is pre-trigger
+	// etsTime values are in femtoseconds
+	if (etsModeSet && (status = ets_init(&etsReconstructor, unit->channelCount, ETS_CYCLES * BUFFER_SIZE, (int64_t) ets_sampletime * 1000)) != PICO_OK)
+	{
+		printf("collectBlockEts:ets_init ------ 0x%08lx \n", status);
+	}
+
+	for (cycle = 0; cycle < ETS_CYCLES; cycle++)
+	{
+		blockDataHandler(unit, (int8_t *) "Ten readings after trigger\n", BUFFER_SIZE / 10 - 5, etsModeSet); // 10% of data is pre-trigger
+
+		if (!etsModeSet || etsReconstructor.capacity == 0)
+		{
+			break;
+		}
+	}
+
+	if (etsReconstructor.capacity != 0)
+	{
+		writeEtsWaveform(unit);
+		ets_free(&etsReconstructor);
+	}
 
 	status = ps5000aSetEts(unit->handle, PS5000A_ETS_OFF, 0, 0, &ets_sampletime);
 
@@ -1340,39 +1526,16 @@ void collectBlockTriggered(UNIT * unit)
 }
 
 /****************************************************************************
-* collectRapidBlock
-*  this function demonstrates how to collect a set of captures using
-*  rapid block mode.
+* setRapidBlockTrigger
+*  sets the rising edge trigger on channel A used for rapid block captures
 ****************************************************************************/
-void collectRapidBlock(UNIT * unit)
+PICO_STATUS setRapidBlockTrigger(UNIT * unit)
 {
-	uint32_t	nCaptures;
-	uint32_t	nSegments;
-	int32_t		nMaxSamples;
-	uint32_t	nSamples = 1000;
-	int32_t		timeIndisposed;
-	uint32_t	capture;
-	int16_t		channel;
-	int16_t***	rapidBuffers;
-	int16_t*	overflow;
-	PICO_STATUS status;
-	int16_t		i;
-	uint32_t	nCompletedCaptures;
-	int16_t		retry;
-
 	int16_t		triggerVoltage = 1000; // mV
 	PS5000A_CHANNEL triggerChannel = PS5000A_CHANNEL_A;
 	int16_t		voltageRange = inputRanges[unit->channelSettings[triggerChannel].range];
 	int16_t		triggerThreshold = 0;
 
-	int32_t		timeIntervalNs = 0;
-	int32_t		maxSamples = 0;
-	uint32_t	maxSegments = 0;
-
-	uint64_t timeStampCounterDiff = 0;
-
-	PS5000A_TRIGGER_INFO * triggerInfo; // Struct to store trigger timestamping information
-
 	// Structures for setting up trigger - declare each as an array of multiple structures if using multiple channels
 	struct tPS5000ATriggerChannelPropertiesV2 triggerProperties;
 	struct tPS5000ACondition conditions;
@@ -1390,7 +1553,7 @@ void collectRapidBlock(UNIT * unit)
 	if (unit->channelSettings[triggerChannel].enabled == 0)
 	{
 		printf("collectBlockTriggered: Channel not enabled.");
-		return;
+		return PICO_INVALID_CHANNEL;
 	}
 
 	// If the trigger voltage level is greater than the range selected, set the threshold to half
@@ -1418,18 +1581,55 @@ void collectRapidBlock(UNIT * unit)
 	directions.direction = PS5000A_RISING;
 	directions.mode = PS5000A_LEVEL;
 
-	printf("Collect rapid block triggered...\n");
 	printf("Collects when value rises past %d ", scaleVoltages ?
 		adc_to_mv(triggerProperties.thresholdUpper, unit->channelSettings[PS5000A_CHANNEL_A].range, unit)	// If scaleVoltages, print mV value
 		: triggerProperties.thresholdUpper);																// else print ADC Count
 
 	printf(scaleVoltages ? "mV\n" : "ADC Counts\n");
-	printf("Press any key to abort\n");
 
 	setDefaults(unit);
 
 	// Trigger enabled
-	status = setTrigger(unit, &triggerProperties, 1, &conditions, 1, &directions, 1, &pulseWidth, 0, 0);
+	return setTrigger(unit, &triggerProperties, 1, &conditions, 1, &directions, 1, &pulseWidth, 0, 0);
+}
+
+/****************************************************************************
+* collectRapidBlock
+*  this function demonstrates how to collect a set of captures using
+*  rapid block mode.
+****************************************************************************/
+void collectRapidBlock(UNIT * unit)
+{
+	uint32_t	nCaptures;
+	uint32_t	nSegments;
+	int32_t		nMaxSamples;
+	uint32_t	nSamples = 1000;
+	int32_t		timeIndisposed;
+	uint32_t	capture;
+	int16_t		channel;
+	int16_t***	rapidBuffers;
+	int16_t*	overflow;
+	PICO_STATUS status;
+	int16_t		i;
+	uint32_t	nCompletedCaptures;
+	int16_t		retry;
+
+	int32_t		timeIntervalNs = 0;
+	int32_t		maxSamples = 0;
+	uint32_t	maxSegments = 0;
+
+	uint64_t timeStampCounterDiff = 0;
+
+	PS5000A_TRIGGER_INFO * triggerInfo; // Struct to store trigger timestamping information
+
+	printf("Collect rapid block triggered...\n");
+
+	if (setRapidBlockTrigger(unit) == PICO_INVALID_CHANNEL)
+	{
+		return;
+	}
+
+	printf("Press any key to abort\n");
 
 	// Find the maximum number of segments
 	status = ps5000aGetMaxSegments(unit->handle, &maxSegments);
@@ -1651,6 +1851,269 @@ void collectRapidBlock(UNIT * unit)
 	free(triggerInfo);
 }
 
+/****************************************************************************
+* collectRapidBlockCorrelated
+*  this function runs rapid block captures on several units at once and
+*  matches the captures of each trigger across the units from the trigger
+*  time stamps, so the captures can be joined without comparing the data.
+*  The same trigger signal should be connected to channel A of every unit.
+*  The first unit is the reference for the clocks of the others.
+****************************************************************************/
+void collectRapidBlockCorrelated(UNIT ** units, int16_t nUnits)
+{
+	TRIGGER_CORRELATOR		correlator;
+	const CORRELATED_EVENT *	events;
+	uint32_t	nEvents;
+	uint32_t	nSegments;
+	uint32_t	maxSegments = 0;
+	int32_t		nMaxSamples;
+	uint32_t	nSamples = 1000;
+	uint32_t	nSamplesRead;
+	int32_t		timeIndisposed;
+	uint32_t	capture;
+	uint32_t	event;
+	uint32_t	run;
+	int16_t		channel;
+	int16_t		u;
+	int16_t		nReady;
+	int16_t		aborted = FALSE;
+	PICO_STATUS	status = PICO_OK;
+
+	uint32_t	unitTimebase[TRIGGER_CORRELATOR_MAX_DEVICES];
+	int32_t		timeIntervalNs[TRIGGER_CORRELATOR_MAX_DEVICES];
+	int32_t		maxTimeIntervalNs = 0;
+	int32_t		maxSamples = 0;
+	int16_t		ready[TRIGGER_CORRELATOR_MAX_DEVICES];
+	int16_t *	buffers[TRIGGER_CORRELATOR_MAX_DEVICES];	// [channel][capture][sample] for each unit
+	int16_t *	overflow[TRIGGER_CORRELATOR_MAX_DEVICES];
+	PS5000A_TRIGGER_INFO	triggerInfo[CORRELATED_CAPTURES];
+	uint64_t	timeStampCounters[CORRELATED_CAPTURES];
+	PICO_STATUS	triggerStatuses[CORRELATED_CAPTURES];
+
+	if (nUnits > TRIGGER_CORRELATOR_MAX_DEVICES)
+	{
+		printf("Using the first %d units\n", TRIGGER_CORRELATOR_MAX_DEVICES);
+		nUnits = TRIGGER_CORRELATOR_MAX_DEVICES;
+	}
+
+	printf("Collect rapid block triggered on %d units...\n", nUnits);
+
+	memset(&correlator, 0, sizeof(TRIGGER_CORRELATOR));
+	memset(buffers, 0, sizeof(buffers));
+	memset(overflow, 0, sizeof(overflow));
+
+	for (u = 0; u < nUnits && status == PICO_OK; u++)
+	{
+		printf("Unit %d (%s S/N %s): ", u, units[u]->modelString, units[u]->serial);
+		status = setRapidBlockTrigger(units[u]);
+
+		if (status == PICO_OK)
+		{
+			status = ps5000aGetMaxSegments(units[u]->handle, &maxSegments);
+		}
+
+		nSegments = maxSegments < 64 ? maxSegments : 64;
+
+		if (status == PICO_OK && nSegments < CORRELATED_CAPTURES)
+		{
+			printf("collectRapidBlockCorrelated: unit %d has only %u segments\n", u, nSegments);
+			status = PICO_TOO_MANY_SEGMENTS;
+		}
+
+		if (status == PICO_OK)
+		{
+			status = ps5000aMemorySegments(units[u]->handle, nSegments, &nMaxSamples);
+		}
+
+		if (status == PICO_OK)
+		{
+			status = ps5000aSetNoOfCaptures(units[u]->handle, CORRELATED_CAPTURES);
+		}
+
+		// Same timebase as collectRapidBlock, or the next valid one
+		unitTimebase[u] = 127;
+
+		while (status == PICO_OK || status == PICO_INVALID_TIMEBASE)
+		{
+			status = ps5000aGetTimebase(units[u]->handle, unitTimebase[u], nSamples, &timeIntervalNs[u], &maxSamples, 0);
+
+			if (status != PICO_INVALID_TIMEBASE)
+			{
+				break;
+			}
+
+			unitTimebase[u]++;
+		}
+
+		if (status == PICO_OK)
+		{
+			maxTimeIntervalNs = max(maxTimeIntervalNs, timeIntervalNs[u]);
+		}
+
+		buffers[u] = (int16_t *)calloc((size_t) units[u]->channelCount * CORRELATED_CAPTURES * nSamples, sizeof(int16_t));
+		overflow[u] = (int16_t *)calloc((size_t) units[u]->channelCount * CORRELATED_CAPTURES, sizeof(int16_t));
+
+		if (status == PICO_OK && (buffers[u] == NULL || overflow[u] == NULL))
+		{
+			status = PICO_MEMORY;
+		}
+
+		for (channel = 0; channel < units[u]->channelCount && status == PICO_OK; channel++)
+		{
+			if (units[u]->channelSettings[channel].enabled)
+			{
+				for (capture = 0; capture < CORRELATED_CAPTURES && status == PICO_OK; capture++)
+				{
+					status = ps5000aSetDataBuffer(units[u]->handle, (PS5000A_CHANNEL)channel,
+						buffers[u] + ((size_t) channel * CORRELATED_CAPTURES + capture) * nSamples, nSamples, capture, PS5000A_RATIO_MODE_NONE);
+				}
+			}
+		}
+
+		if (status != PICO_OK)
+		{
+			printf("collectRapidBlockCorrelated: unit %d ------ 0x%08lx \n", u, status);
+		}
+	}
+
+	if (status == PICO_OK)
+	{
+		status = trigger_correlator_init(&correlator, nUnits, (double) CORRELATED_TOLERANCE * maxTimeIntervalNs);
+	}
+
+	if (status == PICO_OK)
+	{
+		printf("Press any key to abort\n");
+	}
+
+	for (run = 0; run < CORRELATED_RUNS && status == PICO_OK && !aborted; run++)
+	{
+		// Arm every unit, then wait for all of them
+		for (u = 0; u < nUnits && status == PICO_OK; u++)
+		{
+			ready[u] = 0;
+			status = ps5000aRunBlock(units[u]->handle, 0, nSamples, unitTimebase[u], &timeIndisposed, 0, NULL, NULL);
+
+			if (status != PICO_OK)
+			{
+				printf("collectRapidBlockCorrelated:ps5000aRunBlock unit %d ------ 0x%08lx \n", u, status);
+			}
+		}
+
+		nReady = 0;
+
+		while (status == PICO_OK && nReady < nUnits && !_kbhit())
+		{
+			for (u = 0, nReady = 0; u < nUnits && status == PICO_OK; u++)
+			{
+				if (!ready[u])
+				{
+					status = ps5000aIsReady(units[u]->handle, &ready[u]);
+				}
+
+				nReady += ready[u] ? 1 : 0;
+			}
+
+			Sleep(1);
+		}
+
+		if (status != PICO_OK || nReady < nUnits)
+		{
+			if (status == PICO_OK)
+			{
+				_getch();
+				printf("Rapid capture aborted\n");
+			}
+
+			aborted = TRUE;
+			break;
+		}
+
+		for (u = 0; u < nUnits && status == PICO_OK; u++)
+		{
+			nSamplesRead = nSamples;
+			status = ps5000aGetValuesBulk(units[u]->handle, &nSamplesRead, 0, CORRELATED_CAPTURES - 1, 1, PS5000A_RATIO_MODE_NONE, overflow[u]);
+
+			if (status == PICO_OK)
+			{
+				status = ps5000aGetTriggerInfoBulk(units[u]->handle, triggerInfo, 0, CORRELATED_CAPTURES - 1);
+			}
+
+			if (status != PICO_OK)
+			{
+				printf("collectRapidBlockCorrelated: unit %d ------ 0x%08lx \n", u, status);
+				break;
+			}
+
+			for (capture = 0; capture < CORRELATED_CAPTURES; capture++)
+			{
+				timeStampCounters[capture] = triggerInfo[capture].timeStampCounter;
+				triggerStatuses[capture] = triggerInfo[capture].status;
+			}
+
+			status = trigger_correlator_add(&correlator, u, timeIntervalNs[u], timeStampCounters, triggerStatuses, CORRELATED_CAPTURES);
+		}
+
+		if (status == PICO_OK)
+		{
+			status = trigger_correlator_correlate(&correlator, &events, &nEvents);
+		}
+
+		if (status != PICO_OK)
+		{
+			break;
+		}
+
+		// Join the captures of each trigger, showing the first sample on channel A of each unit
+		printf("\nRun %u: %u trigger events\n\n", run, nEvents);
+		printf("Event     Time (us)");
+
+		for (u = 0; u < nUnits; u++)
+		{
+			printf("   Unit %d: seg   A", u);
+		}
+
+		printf("\n");
+
+		for (event = 0; event < nEvents; event++)
+		{
+			printf("%5llu  %12.3f", (unsigned long long) events[event].globalIndex, events[event].timeNs / 1000.0);
+
+			for (u = 0; u < nUnits; u++)
+			{
+				if (events[event].segment[u] < 0)
+				{
+					printf("          --      --");
+				}
+				else
+				{
+					printf("          %2d  %6d", events[event].segment[u], scaleVoltages ?
+						adc_to_mv(buffers[u][(size_t) events[event].segment[u] * nSamples], units[u]->channelSettings[PS5000A_CHANNEL_A].range, units[u])	// If scaleVoltages, print mV value
+						: buffers[u][(size_t) events[event].segment[u] * nSamples]);																		// else print ADC Count
+				}
+			}
+
+			printf("\n");
+		}
+
+		printf("\n");
+		trigger_correlator_print(stdout, &correlator);
+	}
+
+	// Stop
+	for (u = 0; u < nUnits; u++)
+	{
+		ps5000aStop(units[u]->handle);
+		free(buffers[u]);
+		free(overflow[u]);
+	}
+
+	trigger_correlator_free(&correlator);
+
+	printf("\nPress any key...\n\n");
+	_getch();
+}
+
 /****************************************************************************
 * Initialise unit' structure with Variant specific defaults
 ****************************************************************************/
@@ -1901,7 +2364,14 @@ void setTimebase(UNIT * unit)
 	}
 	
 	// Find the shortest possible timebase and inform the user.
-	status = ps5000aGetMinimumTimebaseStateless(unit->handle, enabledChannelOrPortFlags, &shortestTimebase, &timeIntervalSeconds, unit->resolution);
+	if (timebaseSolver.calibrated)
+	{
+		status = timebase_solver_fastest(&timebaseSolver, unit->resolution, enabledChannelOrPortFlags, 0, &shortestTimebase, &timeIntervalSeconds);
+	}
+	else
+	{
+		status = ps5000aGetMinimumTimebaseStateless(unit->handle, enabledChannelOrPortFlags, &shortestTimebase, &timeIntervalSeconds, unit->resolution);
+	}
 
 	if (status != PICO_OK)
 	{
@@ -1915,6 +2385,19 @@ void setTimebase(UNIT * unit)
 	fflush(stdin);
 	scanf_s("%lud", &timebase);
 
+	// Answer from the solver if calibrated, otherwise probe the driver
+	if (timebase_solver_ready(&timebaseSolver, unit->resolution))
+	{
+		if (timebase < shortestTimebase)
+		{
+			timebase = shortestTimebase;
+		}
+
+		timeInterval = (int32_t)llround(timebase_to_interval(&timebaseSolver.model[unit->resolution], timebase) * 1e9);
+		printf("Timebase used %lu = %ld ns sample interval\n", timebase, timeInterval);
+		return;
+	}
+
 	do 
 	{
 		status = ps5000aGetTimebase(unit->handle, timebase, BUFFER_SIZE, &timeInterval, &maxSamples, 0);
@@ -1939,6 +2422,71 @@ void setTimebase(UNIT * unit)
 	printf("Timebase used %lu = %ld ns sample interval\n", timebase, timeInterval);
 }
 
+/****************************************************************************
+* calibrateTimebaseSolver
+* Fills the timebase solver for all resolutions and channel combinations,
+* so later timebase selection needs no driver calls.
+* The timebase formula is checked against the driver for each resolution.
+*
+****************************************************************************/
+PICO_STATUS calibrateTimebaseSolver(UNIT * unit)
+{
+	PICO_STATUS status;
+	int32_t maxSamples;
+	uint32_t channelFlags;
+	uint32_t minTimebase;
+	double minInterval;
+	int16_t validated;
+	int32_t r;
+
+	// Timebase formulas per resolution (8, 12, 14, 15 and 16 bit)
+	//  8, 14, 15 bit: n < 3 : 2^n / 1 GHz, n >= 3 : (n - 2) / 125 MHz
+	// 12, 16 bit    : n < 4 : 2^n / 1 GHz, n >= 4 : (n - 3) / 62.5 MHz
+	TIMEBASE_MODEL models[] = {	{ TRUE, 3, 1e-9, 2, 8e-9 },		// PS5000A_DR_8BIT
+								{ TRUE, 4, 1e-9, 3, 16e-9 },	// PS5000A_DR_12BIT
+								{ TRUE, 3, 1e-9, 2, 8e-9 },		// PS5000A_DR_14BIT
+								{ TRUE, 3, 1e-9, 2, 8e-9 },		// PS5000A_DR_15BIT
+								{ TRUE, 4, 1e-9, 3, 16e-9 } };	// PS5000A_DR_16BIT
+
+	// Free the solver of a previous unit or call, as handleDevice runs once per unit opened
+	timebase_solver_free(&timebaseSolver);
+
+	if ((status = timebase_solver_init(&timebaseSolver, unit->channelCount)) != PICO_OK)
+	{
+		printf("calibrateTimebaseSolver:timebase_solver_init ------ 0x%08lx \n", status);
+		return status;
+	}
+
+	printf("Calibrating timebase solver...\n");
+
+	for (r = PS5000A_DR_8BIT; r <= PS5000A_DR_16BIT; r++)
+	{
+		timebase_solver_set_model(&timebaseSolver, r, models[r]);
+		validated = FALSE;
+
+		for (channelFlags = 1; channelFlags < (1u << unit->channelCount); channelFlags++)
+		{
+			status = ps5000aGetMinimumTimebaseStateless(unit->handle, (PS5000A_CHANNEL_FLAGS)channelFlags, &minTimebase, &minInterval, (PS5000A_DEVICE_RESOLUTION)r);
+			timebase_solver_set_entry(&timebaseSolver, r, channelFlags, status, minTimebase, minInterval);
+
+			if (status == PICO_OK && !validated)
+			{
+				validated = TRUE;
+				timebase_solver_validate(&timebaseSolver, r, minTimebase, minInterval);
+			}
+		}
+	}
+
+	// Memory is only known for the current resolution - see setResolution
+	if (ps5000aMemorySegments(unit->handle, 1, &maxSamples) == PICO_OK)
+	{
+		timebase_solver_set_memory(&timebaseSolver, unit->resolution, (uint64_t)maxSamples);
+	}
+
+	timebaseSolver.calibrated = TRUE;
+	return PICO_OK;
+}
+
 /****************************************************************************
 * printResolution
 *
@@ -1993,6 +2541,7 @@ void setResolution(UNIT * unit)
 	int16_t numEnabledChannels = 0;
 	int16_t retry;
 	int32_t resolutionInput;
+	int32_t maxSamples;
 
 	PICO_STATUS status;
 	PS5000A_DEVICE_RESOLUTION resolution;
@@ -2096,6 +2645,11 @@ void setResolution(UNIT * unit)
 
 		printf("Resolution selected: ");
 		printResolution(&newResolution);
+
+		if (ps5000aMemorySegments(unit->handle, 1, &maxSamples) == PICO_OK)
+		{
+			timebase_solver_set_memory(&timebaseSolver, unit->resolution, (uint64_t)maxSamples);
+		}
 		
 		// The maximum ADC value will change if transitioning from 8 bit to >= 12 bit or vice-versa
 		ps5000aMaximumValue(unit->handle, &value);
@@ -2527,6 +3081,8 @@ PICO_STATUS handleDevice(UNIT * unit)
 	
 	timebase = 1;
 
+	calibrateTimebaseSolver(unit);
+
 	ps5000aMaximumValue(unit->handle, &value);
 	unit->maxADCValue = value;
 
@@ -2565,6 +3121,7 @@ PICO_STATUS handleDevice(UNIT * unit)
 void closeDevice(UNIT *unit)
 {
 	ps5000aCloseUnit(unit->handle);
+	timebase_solver_free(&timebaseSolver);
 }
 
 /****************************************************************************
@@ -2682,6 +3239,8 @@ int32_t main(void)
 			"1234567890ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz#";
 	PICO_STATUS status = PICO_OK;
 	UNIT allUnits[MAX_PICO_DEVICES];
+	UNIT * correlatedUnits[MAX_PICO_DEVICES];
+	int16_t nCorrelated;
 
 	printf("PicoScope 5000 Series (ps5000a) Driver Example Program\n");
 	printf("\nEnumerating Units...\n");
@@ -2788,6 +3347,7 @@ int32_t main(void)
 				allUnits[listIter].modelString, allUnits[listIter].serial);
 	}
 
+	printf("*) Rapid block on all units, captures matched by trigger time stamp\n");
 	printf("ESC) Cancel\n");
 
 	ch = '.';
@@ -2830,9 +3390,38 @@ int32_t main(void)
 							allUnits[listIter].serial);
 				}
 				
+				printf("*) Rapid block on all units, captures matched by trigger time stamp\n");
 				printf("ESC) Cancel\n");
 			}
 		}
+
+		if (ch == '*')
+		{
+			nCorrelated = 0;
+
+			for (listIter = 0; listIter < devCount; listIter++)
+			{
+				if ((allUnits[listIter].openStatus == PICO_OK || allUnits[listIter].openStatus == PICO_POWER_SUPPLY_NOT_CONNECTED)
+					&& handleDevice(&allUnits[listIter]) == PICO_OK)
+				{
+					correlatedUnits[nCorrelated++] = &allUnits[listIter];
+				}
+			}
+
+			collectRapidBlockCorrelated(correlatedUnits, nCorrelated);
+
+			printf("Found %d devices, pick one to open from the list:\n", devCount);
+
+			for (listIter = 0; listIter < devCount; listIter++)
+			{
+				printf("%c) Picoscope %7s S/N: %s\n", devChars[listIter],
+						allUnits[listIter].modelString,
+						allUnits[listIter].serial);
+			}
+
+			printf("*) Rapid block on all units, captures matched by trigger time stamp\n");
+			printf("ESC) Cancel\n");
+		}
 	}
 
 	for (listIter = 0; listIter < devCount; listIter++)
@@ -129,6 +129,12 @@ return (fp>0)?0:-1;
 ***************************************************************************/
 
 extern BOOL		scaleVoltages; //defined and used in Libps6000a.c
+extern BOOL		captureToFile; //defined in Libps6000a.c
+extern double	preTriggerHistory; //defined in Libps6000a.c
+extern double	postTriggerTime; //defined in Libps6000a.c
+extern uint32_t	dualRateShift; //defined in Libps6000a.c
+extern PICO_RATIO_MODE backpressureMode; //defined in Libps6000a.c
+extern uint32_t	firDecimation; //defined in Libps6000a.c
 /***************************************************************************/
 
 /****************************************************************************
@@ -142,6 +148,7 @@ extern BOOL		scaleVoltages; //defined and used in Libps6000a.c
 static void mainMenu(GENERICUNIT*unit)
 {
 	int8_t ch = '.';
+	int8_t fallback;
 	while (ch != 'X')
 	{
 		displaySettings(unit);
@@ -152,9 +159,11 @@ static void mainMenu(GENERICUNIT*unit)
 
 		printf("S - Immediate Streaming                       V - Set Voltages\n");
 		printf("T - Triggered Streaming                       I - SetTimebase\n");
-		printf("                                              A - ADC counts/mV\n");	
-		printf("                                              D - Set Resolution\n");
-		printf("                                              X - Exit\n");
+		printf("P - Plan Streaming Settings                   A - ADC counts/mV\n");	
+		printf("F - Toggle Capture File                       D - Set Resolution\n");
+		printf("H - Pre-trigger History (Triggered)           W - Software Triggered Streaming\n");
+		printf("R - Dual-rate Streaming (Raw + Min/Max)       B - Backpressure Fallback (Immediate)\n");
+		printf("L - FIR Decimated Copy (Low-rate Channels)    X - Exit\n");
 		printf("Operation:");
 
 		ch = toupper(_getch());
@@ -171,6 +180,50 @@ static void mainMenu(GENERICUNIT*unit)
 				collectStreamingTriggered(unit);
 				break;
 
+			case 'W':
+				collectStreamingSoftTriggered(unit);
+				break;
+
+			case 'H':
+				printf("Seconds of pre-trigger history to keep on the host (0 for none): ");
+				scanf_s("%lf", &preTriggerHistory);
+				if (preTriggerHistory > 0.0)
+				{
+					printf("Seconds to keep after the trigger: ");
+					scanf_s("%lf", &postTriggerTime);
+				}
+				break;
+
+			case 'R':
+				printf("Min/max stream ratio 2^n, enter n from 1 to %d (0 for raw only): ", DUAL_RATE_MAX_SHIFT);
+				scanf_s("%u", &dualRateShift);
+				if (dualRateShift > DUAL_RATE_MAX_SHIFT)
+				{
+					dualRateShift = DUAL_RATE_MAX_SHIFT;
+				}
+				break;
+
+			case 'B':
+				printf("Fallback when the disk falls behind - A: Aggregate, D: Decimate, N: None\n");
+				fallback = toupper(_getch());
+				backpressureMode = (fallback == 'A') ? PICO_RATIO_MODE_AGGREGATE : (fallback == 'D') ? PICO_RATIO_MODE_DECIMATE : PICO_RATIO_MODE_RAW;
+				printf((backpressureMode == PICO_RATIO_MODE_RAW) ? "No backpressure fallback\n" :
+					(backpressureMode == PICO_RATIO_MODE_AGGREGATE) ? "Falling back to aggregation\n" : "Falling back to decimation\n");
+				break;
+
+			case 'L':
+				printf("Decimation factor of the filtered copy in StreamingFiltered.bin (1 for none): ");
+				scanf_s("%u", &firDecimation);
+				if (firDecimation == 0)
+				{
+					firDecimation = 1;
+				}
+				break;
+
+			case 'P':
+				planStreaming(unit);
+				break;
+
 			case 'V':
 				setVoltages(unit);
 				break;
@@ -183,6 +236,11 @@ static void mainMenu(GENERICUNIT*unit)
 				scaleVoltages = !scaleVoltages;
 				break;
 
+			case 'F':
+				captureToFile = !captureToFile;
+				printf(captureToFile ? "Capturing to a memory-mapped file\n" : "Capturing to text files\n");
+				break;
+
 			case 'D':
 				setResolution(unit);
 				break;
@@ -16,6 +16,7 @@
 #include "../../shared/PicoScaling.h"
 #include "../../shared/PicoBuffers.h"
 #include "../../shared/PicoFileFunctions.h"
+#include "../../shared/PicoCaptureFile.h"
 
 #include "./Libps60000a.h"
 
@@ -107,6 +108,7 @@ FILE* fp = NULL;
 extern BOOL		scaleVoltages;
 extern uint32_t	timebase;
 extern const uint64_t constBufferSize;
+extern BOOL		captureToFile;
 /***************************************************************************/
 
 /****************************************************************************
@@ -157,6 +159,7 @@ void rapidblockDataHandler(GENERICUNIT* unit, int8_t* text, int32_t offset)
 	bufferSettings.downSampleRatioMode = PICO_RATIO_MODE_AGGREGATE; //PICO_RATIO_MODE_RAW; // 
 	bufferSettings.downSampleRatio = 16;
 	bufferSettings.nSamples = constBufferSize;
+	bufferSettings.dataType = pico_sample_data_type(unit->resolution);
 
 	//printf(scaleVoltages ? "Volts\n" : "ADC Counts\n");
 	printf("Press any key to abort\n");
@@ -171,7 +174,22 @@ void rapidblockDataHandler(GENERICUNIT* unit, int8_t* text, int32_t offset)
 
 	//Create Buffers - Min and Max (3D buffers - Captures, Channels, Samples)
 	struct tmultiBufferSizes multiBufferSizes;;// to store buffer sizes
-	pico_create_multibuffers(unit, bufferSettings, (int32_t)nCaptures, &minBuffers, &maxBuffers, &multiBufferSizes);
+	CAPTURE_FILE captureFile;
+	if (captureToFile)
+	{
+		// Buffers are carved from the memory-mapped capture file
+		status = capture_file_create(&captureFile, "RapidBlockCapture.pcf", unit, bufferSettings, nCaptures, 0, &minBuffers, &maxBuffers, &multiBufferSizes);
+		if (status != PICO_OK)
+		{
+			printf("RapidBlockDataHandler:capture_file_create ------ 0x%08x \n", status);
+			return;
+		}
+		captureFile.header->timeInterval = unit->timeInterval * bufferSettings.downSampleRatio;
+	}
+	else
+	{
+		pico_create_multibuffers(unit, bufferSettings, (int32_t)nCaptures, &minBuffers, &maxBuffers, &multiBufferSizes);
+	}
 
 	// Create Overflow Array Buffers
 	int16_t* overflowArray;
@@ -226,6 +244,10 @@ void rapidblockDataHandler(GENERICUNIT* unit, int8_t* text, int32_t offset)
 
 		if (nCompletedCaptures == 0)
 		{
+			if (captureToFile)
+			{
+				capture_file_close(&captureFile, minBuffers, maxBuffers);
+			}
 			return;
 		}
 
@@ -245,7 +267,7 @@ void rapidblockDataHandler(GENERICUNIT* unit, int8_t* text, int32_t offset)
 					maxBuffers[capture][channel],
 					minBuffers[capture][channel],
 					(int32_t)nSamples,
-					PICO_INT16_T, //PICO_DATA_TYPE
+					bufferSettings.dataType, //PICO_DATA_TYPE
 					capture,
 					bufferSettings.downSampleRatioMode,
 					action_flag);
@@ -293,10 +315,10 @@ void rapidblockDataHandler(GENERICUNIT* unit, int8_t* text, int32_t offset)
 						if (maxBuffers[capture][channel])//Check buffer is not NULL
 						{//3.3e //6d
 							printf("%3.3e\t", scaleVoltages ?
-								adc_to_mv(maxBuffers[capture][channel][i],
+								adc_to_mv(pico_buffer_value(maxBuffers[capture][channel], bufferSettings.dataType, i),
 									unit->channelSettings[PICO_CHANNEL_A + channel].range,
 									unit->maxADCValue)														// If scaleVoltages, print mV value
-								: maxBuffers[capture][channel][i]);
+								: pico_buffer_value(maxBuffers[capture][channel], bufferSettings.dataType, i));
 						}// else print ADC Count
 					}
 					else
@@ -329,17 +351,29 @@ void rapidblockDataHandler(GENERICUNIT* unit, int8_t* text, int32_t offset)
 			}
 		}
 
-		// Print each segment capture to a file
-		printf("\nWriting each of: %lld channel buffer sets to a file.\n", multiBufferSizes.numberOfBuffers);
-		WriteArrayToFilesGeneric(
-			unit,
-			minBuffers,
-			maxBuffers,
-			multiBufferSizes,
-			enabledChannelsScaling,
-			"RapidBlockCaptureNo_",
-			0,						// Triggersample
-			overflowArray);	
+		if (captureToFile)
+		{
+			// GetValuesBulk has written the samples straight into the file mapping
+			for (capture = 0; capture < nCaptures; capture++)
+			{
+				capture_file_set_samples(&captureFile, capture, nSamples);
+			}
+			printf("\n%llu captures written to RapidBlockCapture.pcf\n", nCaptures);
+		}
+		else
+		{
+			// Print each segment capture to a file
+			printf("\nWriting each of: %lld channel buffer sets to a file.\n", multiBufferSizes.numberOfBuffers);
+			WriteArrayToFilesGeneric(
+				unit,
+				minBuffers,
+				maxBuffers,
+				multiBufferSizes,
+				enabledChannelsScaling,
+				"RapidBlockCaptureNo_",
+				0,						// Triggersample
+				overflowArray);	
+		}
 	}
 
 	// Stop device
@@ -349,25 +383,32 @@ void rapidblockDataHandler(GENERICUNIT* unit, int8_t* text, int32_t offset)
 	clearDataBuffers(unit);
 	free(overflowArray);
 
-	for (channel = 0; channel < unit->channelCount; channel++)
+	if (captureToFile)
 	{
-		if (unit->channelSettings[channel].enabled)
+		capture_file_close(&captureFile, minBuffers, maxBuffers);
+	}
+	else
+	{
+		for (channel = 0; channel < unit->channelCount; channel++)
 		{
-			for (capture = 0; capture < nCaptures; capture++)
+			if (unit->channelSettings[channel].enabled)
 			{
-				free(maxBuffers[capture][channel]);
-				free(minBuffers[capture][channel]);
+				for (capture = 0; capture < nCaptures; capture++)
+				{
+					free(maxBuffers[capture][channel]);
+					free(minBuffers[capture][channel]);
+				}
 			}
 		}
-	}
 
-	for (capture = 0; capture < nCaptures; capture++)
-	{
-		free(maxBuffers[capture]);
-		free(minBuffers[capture]);
+		for (capture = 0; capture < nCaptures; capture++)
+		{
+			free(maxBuffers[capture]);
+			free(minBuffers[capture]);
+		}
+		free(maxBuffers);
+		free(minBuffers);
 	}
-	free(maxBuffers);
-	free(minBuffers);
 }
 
 /****************************************************************************
@@ -19,6 +19,7 @@
 
 #include <conio.h>
 #include "ps6000aApi.h"
+#include "../../shared/PicoStreamingPlan.h"
 #else
 #include <sys/types.h>
 #include <string.h>
@@ -93,11 +94,28 @@ int32_t fopen_s(FILE** a, const char* b, const char* c)
 
 //#define BUFFER_SIZE 	1024
 
+// Sustained USB 3.0 bandwidth (bytes per second) assumed by planStreaming
+#define STREAMING_USB_BANDWIDTH	300e6
+
+// Backpressure fallback of streamBackpressureHandler (see PicoBackpressure.h).
+// Queue depths are in PicoChunkRing chunks, the ratio goes up 4 times per level.
+#define BACKPRESSURE_HIGH_WATERMARK		8
+#define BACKPRESSURE_LOW_WATERMARK		1
+#define BACKPRESSURE_MAX_LEVEL			4
+#define BACKPRESSURE_SHIFT_PER_LEVEL	2
+#define BACKPRESSURE_HOLD_SETS			8
+
 
 // Function prototypes
 
 void streamDataHandler(GENERICUNIT* unit, uint64_t noOfPreTriggerSamples);
 void collectStreamingImmediate(GENERICUNIT* unit);
 void collectStreamingTriggered(GENERICUNIT* unit);
+void collectStreamingSoftTriggered(GENERICUNIT* unit);
+void streamHistoryHandler(GENERICUNIT* unit);
+void streamBackpressureHandler(GENERICUNIT* unit);
+
+void planStreaming(GENERICUNIT* unit);
+PICO_STATUS applyStreamingPlan(GENERICUNIT* unit, STREAMING_PLAN* plan, uint32_t channelFlags);
 
 #endif
\ No newline at end of file
@@ -102,6 +102,13 @@ USER_PROBE_INFO userProbeInfo;
 BOOL		scaleVoltages = TRUE;
 uint32_t	timebase = 0;
 const uint64_t constBufferSize = 12040;
+TIMEBASE_SOLVER timebaseSolver;
+BOOL		captureToFile = FALSE;	// Capture into a memory-mapped file (see PicoCaptureFile.h)
+double		preTriggerHistory = 0.0;	// Seconds of host-side pre-trigger history in triggered streaming (see PicoTriggerHistory.h)
+double		postTriggerTime = 0.01;		// Seconds kept after the trigger with preTriggerHistory
+uint32_t	dualRateShift = 0;		// Raw streaming also returns a min/max stream at 1:2^dualRateShift, 0 for raw only
+PICO_RATIO_MODE backpressureMode = PICO_RATIO_MODE_RAW;	// Fallback when the disk falls behind in immediate streaming, RAW for none
+uint32_t	firDecimation = 1;		// Host FIR decimated copy of the raw stream in StreamingFiltered.bin (see PicoFirDecimator.h), 1 for none
 /***************************************************************************/
 
 /****************************************************************************
@@ -501,7 +508,14 @@ void setTimebase(GENERICUNIT* unit)
 	}
 
 	// Find the shortest possible timebase and inform the user.
-	status = ps6000aGetMinimumTimebaseStateless(unit->handle, enabledChannelOrPortFlags, &shortestTimebase, &timeIntervalSeconds, unit->resolution);
+	if (timebaseSolver.calibrated)
+	{
+		status = timebase_solver_fastest(&timebaseSolver, unit->resolution, enabledChannelOrPortFlags, 0, &shortestTimebase, &timeIntervalSeconds);
+	}
+	else
+	{
+		status = ps6000aGetMinimumTimebaseStateless(unit->handle, enabledChannelOrPortFlags, &shortestTimebase, &timeIntervalSeconds, unit->resolution);
+	}
 
 	if (status != PICO_OK)
 	{
@@ -518,13 +532,21 @@ void setTimebase(GENERICUNIT* unit)
 	double timeIntervalRequested = 0;
 	scanf_s("%le", &timeIntervalRequested);
 
-	status = ps6000aNearestSampleIntervalStateless(unit->handle,
-		enabledChannelOrPortFlags,	//enabledChannelFlags,
-		timeIntervalRequested,		//timeIntervalRequested,
-		unit->resolution,			//resolution,
-		&timebase,					//*timebase,
-		&timeInterval				//*timeIntervalAvailable
-		);
+	if (timebase_solver_ready(&timebaseSolver, unit->resolution))
+	{
+		status = timebase_solver_nearest(&timebaseSolver, unit->resolution, enabledChannelOrPortFlags,
+			timeIntervalRequested, 1, &timebase, &timeInterval);
+	}
+	else
+	{
+		status = ps6000aNearestSampleIntervalStateless(unit->handle,
+			enabledChannelOrPortFlags,	//enabledChannelFlags,
+			timeIntervalRequested,		//timeIntervalRequested,
+			unit->resolution,			//resolution,
+			&timebase,					//*timebase,
+			&timeInterval				//*timeIntervalAvailable
+			);
+	}
 
 		if (status != PICO_OK)//(status == PICO_INVALID_NUMBER_CHANNELS_FOR_RESOLUTION)
 		{
@@ -540,6 +562,74 @@ void setTimebase(GENERICUNIT* unit)
 	unit->timeInterval = timeInterval;
 }
 
+/****************************************************************************
+* calibrateTimebaseSolver
+* Fills the timebase solver for all resolutions and channel combinations,
+* so later timebase selection needs no driver calls.
+* The timebase formula is checked against the driver for each resolution.
+*
+****************************************************************************/
+PICO_STATUS calibrateTimebaseSolver(GENERICUNIT* unit)
+{
+	PICO_STATUS status;
+	PICO_DEVICE_RESOLUTION resolutions[] = { PICO_DR_8BIT, PICO_DR_10BIT, PICO_DR_12BIT };
+	// 6000E timebases: n < 5 : 2^n / 5 GHz, n >= 5 : (n - 4) / 156.25 MHz
+	TIMEBASE_MODEL model = { TRUE, 5, 2e-10, 4, 6.4e-9 };
+	uint32_t channelFlags;
+	uint32_t minTimebase;
+	uint32_t timebaseDriver;
+	double minInterval;
+	double intervalDriver;
+	uint64_t maxSamples;
+	size_t r;
+	int16_t validated;
+
+	// Free the solver of a previous unit or call, as handleDevice runs once per unit opened
+	timebase_solver_free(&timebaseSolver);
+
+	if ((status = timebase_solver_init(&timebaseSolver, unit->channelCount)) != PICO_OK)
+	{
+		printf("calibrateTimebaseSolver:timebase_solver_init ------ 0x%08lx \n", status);
+		return status;
+	}
+
+	printf("Calibrating timebase solver...\n");
+
+	for (r = 0; r < sizeof(resolutions) / sizeof(resolutions[0]); r++)
+	{
+		timebase_solver_set_model(&timebaseSolver, resolutions[r], model);
+
+		if (ps6000aGetMaximumAvailableMemory(unit->handle, &maxSamples, resolutions[r]) == PICO_OK)
+		{
+			timebase_solver_set_memory(&timebaseSolver, resolutions[r], maxSamples);
+		}
+
+		validated = FALSE;
+
+		for (channelFlags = 1; channelFlags < (1u << unit->channelCount); channelFlags++)
+		{
+			status = ps6000aGetMinimumTimebaseStateless(unit->handle, (PICO_CHANNEL_FLAGS)channelFlags, &minTimebase, &minInterval, resolutions[r]);
+			timebase_solver_set_entry(&timebaseSolver, resolutions[r], channelFlags, status, minTimebase, minInterval);
+
+			// Check the formula once per resolution - at the shortest timebase and one in the linear range
+			if (status == PICO_OK && !validated)
+			{
+				validated = TRUE;
+				timebase_solver_validate(&timebaseSolver, resolutions[r], minTimebase, minInterval);
+
+				status = ps6000aNearestSampleIntervalStateless(unit->handle, (PICO_CHANNEL_FLAGS)channelFlags, minInterval * 300, resolutions[r], &timebaseDriver, &intervalDriver);
+				if (status == PICO_OK)
+				{
+					timebase_solver_validate(&timebaseSolver, resolutions[r], timebaseDriver, intervalDriver);
+				}
+			}
+		}
+	}
+
+	timebaseSolver.calibrated = TRUE;
+	return PICO_OK;
+}
+
 /****************************************************************************
 * printResolution
 *
@@ -587,6 +677,42 @@ void printResolution(PICO_DEVICE_RESOLUTION* resolution)
 	printf("\n");
 }
 
+/****************************************************************************
+* applyResolution
+* Sets the device resolution and updates the maximum ADC value
+* Parameters
+* - unit        pointer to the UNIT structure
+* - newResolution
+*
+* Returns
+* - PICO_STATUS to indicate success, or if an error occurred
+****************************************************************************/
+PICO_STATUS applyResolution(GENERICUNIT* unit, PICO_DEVICE_RESOLUTION newResolution)
+{
+	int16_t value = 0;
+	PICO_STATUS status;
+
+	status = ps6000aSetDeviceResolution(unit->handle, (PICO_DEVICE_RESOLUTION)newResolution);
+
+	if (status == PICO_OK)
+	{
+		unit->resolution = newResolution;
+
+		printf("Resolution selected: ");
+		printResolution(&newResolution);
+
+		// The maximum ADC value will change if transitioning from 8 bit to >= 12 bit or vice-versa
+		status = ps6000aGetAdcLimits(unit->handle, newResolution, NULL, &value);
+		unit->maxADCValue = value;
+	}
+	else
+	{
+		printf("applyResolution:ps6000aSetDeviceResolution ------ 0x%08lx \n", status);
+	}
+
+	return status;
+}
+
 /****************************************************************************
 * setResolution
 * Set resolution for the device
@@ -594,7 +720,6 @@ void printResolution(PICO_DEVICE_RESOLUTION* resolution)
 ****************************************************************************/
 void setResolution(GENERICUNIT* unit)
 {
-	int16_t value = 0;
 	int16_t i;
 	int16_t numEnabledChannels = 0;
 	int16_t retry;
@@ -680,23 +805,7 @@ void setResolution(GENERICUNIT* unit)
 
 	printf("\n");
 
-	status = ps6000aSetDeviceResolution(unit->handle, (PICO_DEVICE_RESOLUTION)newResolution);
-
-	if (status == PICO_OK)
-	{
-		unit->resolution = newResolution;
-
-		printf("Resolution selected: ");
-		printResolution(&newResolution);
-
-		// The maximum ADC value will change if transitioning from 8 bit to >= 12 bit or vice-versa
-		status = ps6000aGetAdcLimits(unit->handle, newResolution, NULL, &value);
-		unit->maxADCValue = value;
-	}
-	else
-	{
-		printf("setResolution:ps6000aSetDeviceResolution ------ 0x%08lx \n", status);
-	}
+	applyResolution(unit, newResolution);
 
 }
 
@@ -856,6 +965,8 @@ PICO_STATUS handleDevice(GENERICUNIT* unit)
 
 	unit->timeInterval = temp_timeIntervalns * 1e-9;
 
+	calibrateTimebaseSolver(unit);
+
 	status = ps6000aGetAdcLimits(unit->handle, PICO_DR_8BIT, NULL, &value);
 	unit->maxADCValue = value;
 
@@ -898,4 +1009,5 @@ PICO_STATUS handleDevice(GENERICUNIT* unit)
 void closeDevice(GENERICUNIT* unit)
 {
 	ps6000aCloseUnit(unit->handle);
+	timebase_solver_free(&timebaseSolver);
 }
\ No newline at end of file
@@ -128,6 +128,7 @@ return (fp>0)?0:-1;
 * Refernce Global Variables
 ***************************************************************************/
 extern BOOL		scaleVoltages;
+extern BOOL		captureToFile; //defined in Libpsospa.c
 extern uint32_t	timebase; //extern uint32_t	timebase = 8;
 /***************************************************************************/
 
@@ -153,7 +154,7 @@ static void mainMenu(GENERICUNIT *unit)
 		printf("R - Immediate RapidBlock                      V - Set Voltages\n");
 		printf("T - Triggered RapidBlock                      I - SetTimebase\n");
 		printf("                                              A - ADC counts/mV\n");	
-		printf("                                              D - Set Resolution\n");
+		printf("F - Toggle Capture File                       D - Set Resolution\n");
 		printf("                                              X - Exit\n");
 		printf("Operation:");
 
@@ -183,6 +184,11 @@ static void mainMenu(GENERICUNIT *unit)
 				scaleVoltages = !scaleVoltages;
 				break;
 
+			case 'F':
+				captureToFile = !captureToFile;
+				printf(captureToFile ? "Capturing to a memory-mapped file\n" : "Capturing to text files\n");
+				break;
+
 			case 'D':
 				setResolution(unit);
 				break;
@@ -154,6 +154,7 @@ void blockDataHandler(GENERICUNIT* unit, int8_t* text, int32_t offset)
 	bufferSettings.downSampleRatioMode = ratioMode;
 	bufferSettings.downSampleRatio = downSampleRatio;
 	bufferSettings.nSamples = constBufferSize;
+	bufferSettings.dataType = pico_sample_data_type(unit->resolution);
 
 	//Create Buffers - Min and Max (3D buffer - 1 Segment, Channels, Samples)
 	struct tmultiBufferSizes multiBufferSizes;// to store buffer sizes
@@ -172,7 +173,7 @@ void blockDataHandler(GENERICUNIT* unit, int8_t* text, int32_t offset)
 				maxBuffers[0][i], // 1 waveform buffer only
 				minBuffers[0][i], // 1 waveform buffer only
 				(int32_t)bufferSettings.nSamples,
-				PICO_INT16_T,
+				bufferSettings.dataType,
 				0,			//waveform number
 				bufferSettings.downSampleRatioMode,
 				action_flag);
@@ -289,10 +290,10 @@ void blockDataHandler(GENERICUNIT* unit, int8_t* text, int32_t offset)
 						if (maxBuffers[0][channel])//Check buffer is not NULL
 						{//3.3e //6d
 							printf("%+3.3e\t", scaleVoltages ?
-								adc_to_mv(maxBuffers[0][channel][i],
+								adc_to_mv(pico_buffer_value(maxBuffers[0][channel], bufferSettings.dataType, i),
 									unit->channelSettings[PICO_CHANNEL_A + channel].range,
 									unit->maxADCValue)			// If scaleVoltages, print mV value
-								: maxBuffers[0][channel][i]);
+								: pico_buffer_value(maxBuffers[0][channel], bufferSettings.dataType, i));
 						}// else print ADC Count
 					}
 					else
@@ -13,10 +13,21 @@
 
 #include <stdio.h>
 #include <stdbool.h>
+#include <time.h>
+#include <ctype.h>
 #include "math.h"
 #include "../../shared/PicoScaling.h"
 #include "../../shared/PicoBuffers.h"
 #include "../../shared/PicoFileFunctions.h"
+#include "../../shared/PicoStreamingPlan.h"
+#include "../../shared/PicoCaptureFile.h"
+#include "../../shared/PicoPyramid.h"
+#include "../../shared/PicoStatistics.h"
+#include "../../shared/PicoSoftTrigger.h"
+#include "../../shared/PicoTriggerHistory.h"
+#include "../../shared/PicoChunkRing.h"
+#include "../../shared/PicoBackpressure.h"
+#include "../../shared/PicoFirDecimator.h"
 
 #include "./Libpsospa.h"
 
@@ -107,8 +118,490 @@ FILE* fp = NULL;
 extern BOOL		scaleVoltages;
 extern uint32_t	timebase; //extern uint32_t	timebase = 8;
 extern const uint64_t constBufferSize;
+extern TIMEBASE_SOLVER timebaseSolver;
+extern BOOL		captureToFile;
+extern double	preTriggerHistory;
+extern double	postTriggerTime;
+extern uint32_t	dualRateShift;
+extern PICO_RATIO_MODE backpressureMode;
+extern uint32_t	firDecimation;
 /***************************************************************************/
 
+STREAMING_PLAN streamingPlan;
+
+SOFT_TRIGGER* softTrigger = NULL;	// Set by collectStreamingSoftTriggered, fed by streamDataHandler
+FILE* softTriggerFp = NULL;
+
+//Set the number buffers needed (2 or greater) for this code.
+#define STREAMINGBUFFERS 3
+
+/****************************************************************************
+* STREAM_BUFFER_SETS
+* - The buffer sets streamDataHandler passes to the driver in turn, and
+*   what the host builds from each set once the driver has filled it
+****************************************************************************/
+typedef struct tStreamBufferSets
+{
+	struct tbuffer_settings		bufferSettings;
+	struct tmultiBufferSizes	multiBufferSizes;
+	int16_t***					minBuffers;
+	int16_t***					maxBuffers;
+	uint64_t					nBufferSets;
+	BOOL						captureToFile;
+	CAPTURE_FILE				captureFile;
+	PICO_PYRAMID				pyramids[PSOSPA_MAX_CHANNELS];		// Overview of each enabled channel, built as the capture file is written
+	int16_t						nPyramids;
+	// Dual-rate streaming: min/max aggregated stream of the same channels
+	BOOL						dualRate;
+	struct tmultiBufferSizes	aggregateBufferSizes;
+	int16_t***					aggregateMinBuffers;
+	int16_t***					aggregateMaxBuffers;
+	int16_t						envelopeMin[PSOSPA_MAX_CHANNELS];	// Envelope of the aggregated values since the last print
+	int16_t						envelopeMax[PSOSPA_MAX_CHANNELS];
+	uint64_t					nEnvelopeValues;
+	CHANNEL_STATISTICS			channelStats[PSOSPA_MAX_CHANNELS];	// Running statistics of each enabled channel
+	int16_t						nStats;
+	time_t						statsPrinted;
+	FIR_CASCADE					firCascades[PSOSPA_MAX_CHANNELS];	// Anti-aliased low-rate copy of each enabled channel
+	int16_t*					firBuffers[PSOSPA_MAX_CHANNELS];
+	int16_t						nFirChannels;
+	CHUNK_RING					firRing;
+	PICO_PROBE_SCALING			enabledChannelsScaling[PSOSPA_MAX_CHANNELS];
+}STREAM_BUFFER_SETS;
+
+/****************************************************************************
+* aggregateEnvelope
+* - Widens a min and max envelope with the aggregated (dual-rate) values of
+*   one buffer set
+****************************************************************************/
+static void aggregateEnvelope(const int16_t* minBuffer, const int16_t* maxBuffer, PICO_DATA_TYPE dataType, uint64_t nValues,
+	int16_t* envelopeMin, int16_t* envelopeMax)
+{
+	int16_t value;
+	uint64_t i;
+
+	for (i = 0; i < nValues; i++)
+	{
+		value = pico_buffer_value(minBuffer, dataType, i);
+		*envelopeMin = value < *envelopeMin ? value : *envelopeMin;
+		value = pico_buffer_value(maxBuffer, dataType, i);
+		*envelopeMax = value > *envelopeMax ? value : *envelopeMax;
+	}
+}
+
+/****************************************************************************
+* resetEnvelope
+* - Empties the envelope of each enabled channel
+****************************************************************************/
+static void resetEnvelope(STREAM_BUFFER_SETS* sets)
+{
+	int16_t j;
+
+	for (j = 0; j < PSOSPA_MAX_CHANNELS; j++)
+	{
+		sets->envelopeMin[j] = INT16_MAX;
+		sets->envelopeMax[j] = INT16_MIN;
+	}
+	sets->nEnvelopeValues = 0;
+}
+
+/****************************************************************************
+* createBufferSets
+* - Creates the buffer sets (carved from the capture file if captureToFile
+*   is set), the dual-rate buffer sets, and the statistics, pyramids and
+*   FIR cascades of the enabled channels
+****************************************************************************/
+static PICO_STATUS createBufferSets(GENERICUNIT* unit, STREAM_BUFFER_SETS* sets, uint64_t nCaptures, BOOL dualRate, uint64_t aggregateRatio)
+{
+	PICO_STATUS status;
+	struct tbuffer_settings aggregateSettings = sets->bufferSettings;
+	int16_t channel;
+
+	sets->nBufferSets = STREAMINGBUFFERS;
+	sets->captureToFile = captureToFile;
+	sets->nPyramids = 0;
+	sets->dualRate = dualRate;
+	sets->aggregateMinBuffers = NULL;
+	sets->aggregateMaxBuffers = NULL;
+	resetEnvelope(sets);
+	sets->nStats = 0;
+	sets->statsPrinted = time(NULL);
+	sets->nFirChannels = 0;
+
+	if (sets->captureToFile)
+	{
+		// One buffer set per capture, carved from the memory-mapped capture file. Only a window
+		// of nBufferSets sets is mapped at a time, moved along as each set is handed to the driver.
+		status = capture_file_create(&sets->captureFile, "StreamingCapture.pcf", unit, sets->bufferSettings, nCaptures, sets->nBufferSets,
+			&sets->minBuffers, &sets->maxBuffers, &sets->multiBufferSizes);
+		if (status != PICO_OK)
+		{
+			printf("streamDataHandler:capture_file_create ------ 0x%08lx \n", status);
+			return status;
+		}
+
+		for (channel = 0; channel < unit->channelCount; channel++)
+		{
+			if (unit->channelSettings[channel].enabled)
+			{
+				if (dualRate)
+				{
+					pyramid_init_aggregated(&sets->pyramids[sets->nPyramids++], channel, dualRateShift);
+				}
+				else
+				{
+					pyramid_init(&sets->pyramids[sets->nPyramids++], channel);
+				}
+			}
+		}
+	}
+	else
+	{
+		pico_create_multibuffers(unit, sets->bufferSettings, sets->nBufferSets, &sets->minBuffers, &sets->maxBuffers, &sets->multiBufferSizes);
+	}
+
+	if (dualRate)
+	{
+		aggregateSettings.downSampleRatioMode = PICO_RATIO_MODE_AGGREGATE;
+		aggregateSettings.downSampleRatio = aggregateRatio;
+		pico_create_multibuffers(unit, aggregateSettings, sets->nBufferSets, &sets->aggregateMinBuffers, &sets->aggregateMaxBuffers, &sets->aggregateBufferSizes);
+	}
+
+	for (channel = 0; channel < unit->channelCount; channel++)
+	{
+		if (unit->channelSettings[channel].enabled)
+		{
+			stats_init(&sets->channelStats[sets->nStats++], channel, unit->maxADCValue);
+		}
+	}
+
+	if (firDecimation > 1 && sets->bufferSettings.downSampleRatioMode == PICO_RATIO_MODE_RAW)
+	{
+		for (sets->nFirChannels = 0; sets->nFirChannels < sets->nStats; sets->nFirChannels++)
+		{
+			sets->firBuffers[sets->nFirChannels] = (int16_t*)malloc((size_t)(sets->multiBufferSizes.maxBufferSize / firDecimation + 1) * sizeof(int16_t));
+			status = fir_cascade_init(&sets->firCascades[sets->nFirChannels], firDecimation, (uint32_t)sets->multiBufferSizes.maxBufferSize);
+
+			if (status != PICO_OK || sets->firBuffers[sets->nFirChannels] == NULL)
+			{
+				printf("streamDataHandler:fir_cascade_init ------ 0x%08lx \n", (status != PICO_OK) ? status : PICO_MEMORY);
+				fir_cascade_free(&sets->firCascades[sets->nFirChannels]);
+				free(sets->firBuffers[sets->nFirChannels]);
+				break;
+			}
+		}
+
+		if (sets->nFirChannels < sets->nStats || !chunk_ring_open(&sets->firRing, "StreamingFiltered.bin", sets->nFirChannels, 0))
+		{
+			while (sets->nFirChannels > 0)
+			{
+				sets->nFirChannels--;
+				fir_cascade_free(&sets->firCascades[sets->nFirChannels]);
+				free(sets->firBuffers[sets->nFirChannels]);
+			}
+		}
+		else
+		{
+			printf("FIR decimated channels (1:%u, %d stages) are written to StreamingFiltered.bin\n", firDecimation, sets->firCascades[0].nStages);
+		}
+	}
+
+	return PICO_OK;
+}
+
+/****************************************************************************
+* setBufferSet
+* - Passes the buffers of one buffer set of each enabled channel to the
+*   driver, mapping the set into the capture file window first
+****************************************************************************/
+static PICO_STATUS setBufferSet(GENERICUNIT* unit, STREAM_BUFFER_SETS* sets, uint64_t set, PICO_ACTION action)
+{
+	PICO_STATUS status = PICO_OK;
+	uint64_t slot = set % sets->nBufferSets;
+	int16_t channel;
+
+	if (sets->captureToFile && (status = capture_file_map_buffer(&sets->captureFile, set, sets->minBuffers, sets->maxBuffers)) != PICO_OK)
+	{
+		printf("\nError from function capture_file_map_buffer with status: ------ 0x%08lx", status);
+		return status;
+	}
+
+	for (channel = 0; channel < unit->channelCount; channel++)
+	{
+		if (unit->channelSettings[channel].enabled)
+		{
+			status = psospaSetDataBuffers(unit->handle,
+				(PICO_CHANNEL)channel,
+				sets->maxBuffers[slot][channel],
+				sets->minBuffers[slot][channel],
+				(int32_t)sets->multiBufferSizes.maxBufferSize,
+				sets->bufferSettings.dataType, //PICO_DATA_TYPE
+				0,
+				sets->bufferSettings.downSampleRatioMode,
+				action);
+
+			action = PICO_ADD;//all subsequent calls use ADD!
+
+			if (sets->dualRate && status == PICO_OK)
+			{
+				status = psospaSetDataBuffers(unit->handle,
+					(PICO_CHANNEL)channel,
+					sets->aggregateMaxBuffers[slot][channel],
+					sets->aggregateMinBuffers[slot][channel],
+					(int32_t)sets->aggregateBufferSizes.maxBufferSize,
+					sets->bufferSettings.dataType,
+					0,
+					PICO_RATIO_MODE_AGGREGATE,
+					PICO_ADD);
+			}
+
+			printf("%c,", 'A' + channel);
+			if (status != PICO_OK)
+			{
+				printf("\nError from function SetDataBuffers with status: ------ 0x%08lx", status);
+				break;
+			}
+		}
+	}
+
+	return status;
+}
+
+/****************************************************************************
+* processBufferSet
+* - Host processing of a buffer set the driver has filled: statistics,
+*   software trigger, FIR cascades, dual-rate envelope and the capture
+*   file and pyramids, or the text file of the set
+* Input :
+* - nValues : values the driver has written to each buffer of the set.
+* - nAggregateValues : aggregated values in the set (dual-rate streaming).
+* - triggerAt : trigger sample reported for the set.
+****************************************************************************/
+static void processBufferSet(GENERICUNIT* unit, STREAM_BUFFER_SETS* sets, uint64_t set, uint64_t nValues, uint64_t nAggregateValues,
+	uint64_t triggerAt, int16_t* fileOverflow)
+{
+	uint64_t slot = set % sets->nBufferSets;
+	int16_t* triggerBuffers[PSOSPA_MAX_CHANNELS];		// Enabled channels of the buffer set, for the software trigger
+	int16_t j;
+
+	// Update the statistics once per completed buffer set, while the data is still in cache
+	for (j = 0; j < sets->nStats; j++)
+	{
+		if (sets->multiBufferSizes.dataType == PICO_INT8_T)
+		{
+			stats_update_int8(&sets->channelStats[j], (int8_t*)sets->maxBuffers[slot][sets->channelStats[j].channel], nValues);
+		}
+		else
+		{
+			stats_update(&sets->channelStats[j], sets->maxBuffers[slot][sets->channelStats[j].channel], nValues);
+		}
+		triggerBuffers[j] = sets->maxBuffers[slot][sets->channelStats[j].channel];
+	}
+
+	if (sets->dualRate && nAggregateValues > 0)
+	{
+		// Live min/max envelope from the aggregated stream, no host decimation of the raw data
+		for (j = 0; j < sets->nStats; j++)
+		{
+			aggregateEnvelope(sets->aggregateMinBuffers[slot][sets->channelStats[j].channel],
+				sets->aggregateMaxBuffers[slot][sets->channelStats[j].channel],
+				sets->aggregateBufferSizes.dataType, nAggregateValues, &sets->envelopeMin[j], &sets->envelopeMax[j]);
+		}
+		sets->nEnvelopeValues += nAggregateValues;
+	}
+
+	// Print the statistics and envelope of the buffer sets since the last print at most once a second
+	if (time(NULL) != sets->statsPrinted)
+	{
+		sets->statsPrinted = time(NULL);
+		for (j = 0; j < sets->nStats; j++)
+		{
+			printf("\n");
+			stats_print(stdout, &sets->channelStats[j], &sets->channelStats[j].window, "Window statistics");
+			stats_reset_window(&sets->channelStats[j]);
+		}
+
+		if (sets->nEnvelopeValues > 0)
+		{
+			printf("\nEnvelope -");
+			for (j = 0; j < sets->nStats; j++)
+			{
+				printf(" Ch%c: %d to %d", 'A' + sets->channelStats[j].channel, sets->envelopeMin[j], sets->envelopeMax[j]);
+			}
+			resetEnvelope(sets);
+		}
+	}
+
+	if (softTrigger != NULL)
+	{
+		if (sets->multiBufferSizes.dataType == PICO_INT8_T)
+		{
+			soft_trigger_process_int8(softTrigger, (int8_t**)triggerBuffers, (uint32_t)nValues);
+		}
+		else
+		{
+			soft_trigger_process(softTrigger, triggerBuffers, (uint32_t)nValues);
+		}
+	}
+
+	if (sets->nFirChannels > 0)
+	{
+		uint32_t nFiltered = 0;
+
+		for (j = 0; j < sets->nFirChannels; j++)
+		{
+			if (sets->multiBufferSizes.dataType == PICO_INT8_T)
+			{
+				nFiltered = fir_cascade_process_int8(&sets->firCascades[j], (int8_t*)sets->maxBuffers[slot][sets->channelStats[j].channel], (uint32_t)nValues, sets->firBuffers[j]);
+			}
+			else
+			{
+				nFiltered = fir_cascade_process(&sets->firCascades[j], sets->maxBuffers[slot][sets->channelStats[j].channel], (uint32_t)nValues, sets->firBuffers[j]);
+			}
+		}
+		chunk_ring_append(&sets->firRing, sets->firBuffers, nFiltered);
+	}
+
+	if (sets->captureToFile)
+	{
+		// The driver has written this buffer set straight into the file mapping
+		capture_file_set_samples(&sets->captureFile, set, nValues);
+		capture_file_flush(&sets->captureFile, set);
+
+		for (j = 0; j < sets->nPyramids; j++)
+		{
+			if (sets->dualRate)
+			{
+				pyramid_append(&sets->pyramids[j],
+					sets->aggregateMaxBuffers[slot][sets->pyramids[j].channel],
+					sets->aggregateMinBuffers[slot][sets->pyramids[j].channel],
+					sets->aggregateBufferSizes.dataType,
+					nAggregateValues);
+			}
+			else
+			{
+				pyramid_append(&sets->pyramids[j],
+					sets->maxBuffers[slot][sets->pyramids[j].channel],
+					(sets->multiBufferSizes.minBufferSize != 0) ? sets->minBuffers[slot][sets->pyramids[j].channel] : NULL,
+					sets->multiBufferSizes.dataType,
+					nValues);
+			}
+		}
+	}
+	else
+	{
+		//OFFLOAD DATA HERE FOR PROCESSING - "maxBuffers[i] and minBuffers[i]"
+		//WRITING TO TEXT FOR DEMO ONLY!, FOR HIGH SPEED SAMPLING WRITE TO BINARY FILE OR COPY TO ANOTHER BUFFER
+
+		//Write one segment to a file as captured
+		printf("\nWriting Buffer Set %lld of channels to a file.\n", set);
+
+		//Create file name string
+		char buf[58 + (3 * sizeof(int))];
+		size_t buf_size = sizeof(buf) / sizeof(buf[0]);
+		snprintf(buf, buf_size, "%s%d.txt", startOfFileName, (int)set);
+
+
+		WriteArrayToFileGeneric(
+			unit,
+			sets->minBuffers[slot],
+			sets->maxBuffers[slot],
+			sets->multiBufferSizes,
+			sets->enabledChannelsScaling,
+			buf,
+			triggerAt, // Triggersample
+			fileOverflow);
+		printf(" ");
+	}
+}
+
+/****************************************************************************
+* freeBufferSets
+* - Prints the capture statistics, finishes the FIR, capture and pyramid
+*   files and frees the buffer sets
+****************************************************************************/
+static void freeBufferSets(GENERICUNIT* unit, STREAM_BUFFER_SETS* sets)
+{
+	PICO_STATUS status;
+	uint64_t capture;
+	int16_t channel;
+	int16_t j;
+
+	for (j = 0; j < sets->nStats; j++)
+	{
+		stats_print(stdout, &sets->channelStats[j], &sets->channelStats[j].lifetime, "Capture statistics");
+	}
+
+	if (sets->nFirChannels > 0)
+	{
+		chunk_ring_close(&sets->firRing);
+		printf("%lld filtered values per channel written to StreamingFiltered.bin\n", sets->firRing.samplesWritten);
+
+		for (j = 0; j < sets->nFirChannels; j++)
+		{
+			fir_cascade_free(&sets->firCascades[j]);
+			free(sets->firBuffers[j]);
+		}
+	}
+
+	if (sets->captureToFile)
+	{
+		capture_file_close(&sets->captureFile, sets->minBuffers, sets->maxBuffers);
+		printf("Capture file written: StreamingCapture.pcf\n");
+
+		for (j = 0; j < sets->nPyramids; j++)
+		{
+			pyramid_finish(&sets->pyramids[j]);
+		}
+		if ((status = pyramid_write_file("StreamingCapture.pyr", sets->pyramids, sets->nPyramids)) != PICO_OK)
+		{
+			printf("streamDataHandler:pyramid_write_file ------ 0x%08lx \n", status);
+		}
+		for (j = 0; j < sets->nPyramids; j++)
+		{
+			pyramid_free(&sets->pyramids[j]);
+		}
+	}
+	else
+	{
+		for (channel = 0; channel < unit->channelCount; channel++)
+		{
+			if (unit->channelSettings[channel].enabled)
+			{
+				for (capture = 0; capture < sets->nBufferSets; capture++)
+				{
+					free(sets->maxBuffers[capture][channel]);
+					free(sets->minBuffers[capture][channel]);
+				}
+			}
+		}
+
+		for (capture = 0; capture < sets->nBufferSets; capture++)
+		{
+			free(sets->maxBuffers[capture]);
+			free(sets->minBuffers[capture]);
+		}
+		free(sets->maxBuffers);
+		free(sets->minBuffers);
+	}
+
+	if (sets->dualRate)
+	{
+		for (capture = 0; capture < sets->nBufferSets; capture++)
+		{
+			for (channel = 0; channel < unit->channelCount; channel++)
+			{
+				free(sets->aggregateMaxBuffers[capture][channel]);
+				free(sets->aggregateMinBuffers[capture][channel]);
+			}
+			free(sets->aggregateMaxBuffers[capture]);
+			free(sets->aggregateMinBuffers[capture]);
+		}
+		free(sets->aggregateMaxBuffers);
+		free(sets->aggregateMinBuffers);
+	}
+}
+
 /****************************************************************************
 * streamDataHandler
 * - Used by all streaming data routines
@@ -123,13 +616,10 @@ void streamDataHandler(GENERICUNIT* unit, uint64_t noOfPreTriggerSamples, int16_
 	int32_t index = 0;
 	uint32_t triggeredAt = 0;
 	int16_t channel;
-	uint64_t capture;
 	int16_t NoEnabledchannels = 0;
 	PICO_STATUS status;
 
-	//Set the number buffers needed (2 or greater) for this code.
-	#define STREAMINGBUFFERS 3
-	const uint64_t nCaptures = STREAMINGBUFFERS;
+	uint64_t nCaptures = STREAMINGBUFFERS;
 
 	//Define acquisition Settings
 	uint64_t nSamples = constBufferSize;	//Set the number of samples per capture
@@ -139,48 +629,49 @@ void streamDataHandler(GENERICUNIT* unit, uint64_t noOfPreTriggerSamples, int16_
 	PICO_ACTION action_flag = (PICO_CLEAR_ALL | PICO_ADD);//bitwise OR flags for first buffer that is set
 	uint64_t downSampleRatio = 1;
 
-	//Buffers settings (Set DownSampling mode and ratio)
-	//Use scope acquisition settings for first data download
-	struct tbuffer_settings bufferSettings;
-	bufferSettings.startIndex = 0;
-	bufferSettings.downSampleRatioMode = ratioMode;
-	bufferSettings.downSampleRatio = downSampleRatio;
-	bufferSettings.nSamples = nSamples;
+	// Use the streaming plan if one has been applied (see planStreaming).
+	// Buffer sets are reused in turn, so nCaptures can exceed STREAMINGBUFFERS.
+	if (streamingPlan.valid)
+	{
+		nCaptures = streamingPlan.numberOfBuffers;
+		nSamples = streamingPlan.samplesPerBuffer * streamingPlan.downSampleRatio;
+		idealTimeInterval = streamingPlan.sampleInterval * 1e12;
+		sampleIntervalTimeUnits = PICO_PS;
+		downSampleRatio = streamingPlan.downSampleRatio;
+		ratioMode = streamingPlan.aggregate ? PICO_RATIO_MODE_AGGREGATE : PICO_RATIO_MODE_RAW;
+	}
 
-	//Create Buffers - Min and Max (3D buffers - Captures, Channels, Samples)
-	struct tmultiBufferSizes multiBufferSizes;// to store buffer sizes
-	int16_t*** minBuffers;
-	int16_t*** maxBuffers;
-	pico_create_multibuffers(unit, bufferSettings, nCaptures, &minBuffers, &maxBuffers, &multiBufferSizes);
+	// Dual-rate streaming: the driver also returns a min/max aggregated stream of the same channels
+	// for live monitoring and the pyramid. A raw buffer size that is a multiple of the ratio means
+	// both streams fill their buffer sets together.
+	BOOL dualRate = (dualRateShift > 0 && ratioMode == PICO_RATIO_MODE_RAW);
+	uint64_t aggregateRatio = 1ull << dualRateShift;
 
-	// Pass first set of channel Buffers to the API
-	printf("Calling SetDataBuffers() for BufferSet #0 Channel(s) - ");
-	for (channel = 0; channel < unit->channelCount; channel++)
+	if (dualRate)
 	{
-		if (unit->channelSettings[channel].enabled)
-		{
-			NoEnabledchannels++;
-
-			status = psospaSetDataBuffers(unit->handle,
-				(PICO_CHANNEL)channel,
-				maxBuffers[0][channel],
-				minBuffers[0][channel],
-				(int32_t)nSamples,
-				PICO_INT16_T, //PICO_DATA_TYPE
-				0,
-				PICO_RATIO_MODE_RAW,
-				action_flag);
+		nSamples = (nSamples + aggregateRatio - 1) / aggregateRatio * aggregateRatio;
+	}
 
-			action_flag = PICO_ADD;//all subsequent calls use ADD!
+	//Create Buffers - Min and Max (3D buffers - Captures, Channels, Samples)
+	//Buffers settings (Set DownSampling mode and ratio)
+	//Use scope acquisition settings for first data download
+	STREAM_BUFFER_SETS sets;
+	sets.bufferSettings.startIndex = 0;
+	sets.bufferSettings.downSampleRatioMode = ratioMode;
+	sets.bufferSettings.downSampleRatio = downSampleRatio;
+	sets.bufferSettings.nSamples = nSamples;
+	sets.bufferSettings.dataType = pico_sample_data_type(unit->resolution);
 
-			printf("%c,", 'A' + channel);
-			if (status != PICO_OK)
-			{
-				printf("\nError from function SetDataBuffers with status: ------ 0x%08lx", status);
-				break;
-			}
-		}
+	if (createBufferSets(unit, &sets, nCaptures, dualRate, aggregateRatio) != PICO_OK)
+	{
+		return;
 	}
+	NoEnabledchannels = sets.nStats;
+
+	// Pass first set of channel Buffers to the API
+	printf("Calling SetDataBuffers() for BufferSet #0 Channel(s) - ");
+	status = setBufferSet(unit, &sets, 0, action_flag);
+	action_flag = PICO_ADD;//all subsequent calls use ADD!
 
 	// Start continuous streaming
 	printf("\nStarting Data Capture...");
@@ -192,8 +683,8 @@ void streamDataHandler(GENERICUNIT* unit, uint64_t noOfPreTriggerSamples, int16_
 		noOfPreTriggerSamples,
 		nSamples - noOfPreTriggerSamples,
 		autostop,
-		downSampleRatio,
-		ratioMode);
+		dualRate ? aggregateRatio : downSampleRatio,
+		dualRate ? (PICO_RATIO_MODE)(PICO_RATIO_MODE_RAW | PICO_RATIO_MODE_AGGREGATE) : ratioMode);
 	
 	if (status != PICO_OK)
 	{
@@ -202,30 +693,40 @@ void streamDataHandler(GENERICUNIT* unit, uint64_t noOfPreTriggerSamples, int16_
 	}
 
 	//Get scaling Info for each channel
-	PICO_PROBE_SCALING enabledChannelsScaling[PSOSPA_MAX_CHANNELS] = {0};
 	PICO_PROBE_SCALING channelRangeInfoTemp;
+	memset(sets.enabledChannelsScaling, 0, sizeof(sets.enabledChannelsScaling));
 	for (uint64_t i = 0; i < unit->channelCount; i++)
 	{
 		if (unit->channelSettings[i].enabled)
 		{
 			getRangeScaling(unit->channelSettings[PICO_CHANNEL_A + 0].range, &channelRangeInfoTemp);
-			enabledChannelsScaling[i] = channelRangeInfoTemp;
+			sets.enabledChannelsScaling[i] = channelRangeInfoTemp;
 		}
 	}
 
 	//Save and print Sample Internal set (in seconds)
 	unit->timeInterval = ( idealTimeInterval * (pow(10, 3 * sampleIntervalTimeUnits) / 1E+15) );
 	printf("\nRunStreaming sample Internal: %g seconds", unit->timeInterval);
+	unit->timeInterval *= downSampleRatio; // Interval between the values written to file
+	if (sets.captureToFile)
+	{
+		sets.captureFile.header->timeInterval = unit->timeInterval;
+	}
 	printf("\nTotal number of samples: %lld", nSamples);
 	printf("\nAutostop: %d", autostop);
+	if (dualRate)
+	{
+		printf("\nDual-rate: min/max aggregated stream at 1:%lld", aggregateRatio);
+	}
 	printf("\nPress a key to Abort\n");
 
 	//Create Arrays of Structs for GetStreamingLatestValues for each memory segment
-	PICO_STREAMING_DATA_TRIGGER_INFO streamingDataTriggerInfoArray[STREAMINGBUFFERS] = {0};
+	PICO_STREAMING_DATA_TRIGGER_INFO* streamingDataTriggerInfoArray;
 	PICO_STREAMING_DATA_TRIGGER_INFO streamingDataTriggerInfoTemp;
 	PICO_STREAMING_DATA_INFO** streamingDataInfoArray;
 
 	// Allocate memory
+	streamingDataTriggerInfoArray = (PICO_STREAMING_DATA_TRIGGER_INFO*)calloc(nCaptures, sizeof(PICO_STREAMING_DATA_TRIGGER_INFO));
 	streamingDataInfoArray = (PICO_STREAMING_DATA_INFO**)calloc(unit->channelCount, sizeof(PICO_STREAMING_DATA_INFO*));
 	for (channel = 0; channel < unit->channelCount; channel++)
 	{
@@ -244,11 +745,12 @@ void streamDataHandler(GENERICUNIT* unit, uint64_t noOfPreTriggerSamples, int16_
 		streamingDataTriggerInfoArray[j] = StreamingDataTriggerInfo0;
 	}
 	PICO_STREAMING_DATA_INFO* dataStreamInfo;
-	dataStreamInfo = (PICO_STREAMING_DATA_INFO*)calloc(NoEnabledchannels, sizeof(PICO_STREAMING_DATA_INFO));
+	int16_t nStreamInfos = dualRate ? 2 * NoEnabledchannels : NoEnabledchannels;	// Aggregated stream entries follow the raw ones
+	dataStreamInfo = (PICO_STREAMING_DATA_INFO*)calloc(nStreamInfos, sizeof(PICO_STREAMING_DATA_INFO));
 	//assert(dataStreamInfo == NULL);
 	int16_t FileOverflow = 0; //For file writing
 	
-	if (dataStreamInfo != NULL && streamingDataInfoArray != NULL) //Check for dereferencing null pointers
+	if (dataStreamInfo != NULL && streamingDataInfoArray != NULL && streamingDataTriggerInfoArray != NULL) //Check for dereferencing null pointers
 		//if (dataStreamInfo != NULL) //Check for dereferencing null pointers
 	{
 		int numEnableCh = 0;
@@ -262,7 +764,12 @@ void streamDataHandler(GENERICUNIT* unit, uint64_t noOfPreTriggerSamples, int16_
 					//dataStreamInfos
 					dataStreamInfo[numEnableCh].channel_ = (PICO_CHANNEL)channel;
 					dataStreamInfo[numEnableCh].mode_ = ratioMode; // PICO_RATIO_MODE_RAW; // ratioMode;
-					dataStreamInfo[numEnableCh].type_ = PICO_INT16_T;//
+					dataStreamInfo[numEnableCh].type_ = sets.bufferSettings.dataType;//
+					if (dualRate)
+					{
+						dataStreamInfo[NoEnabledchannels + numEnableCh] = dataStreamInfo[numEnableCh];
+						dataStreamInfo[NoEnabledchannels + numEnableCh].mode_ = PICO_RATIO_MODE_AGGREGATE;
+					}
 					numEnableCh++;
 				}
 			}
@@ -274,44 +781,17 @@ void streamDataHandler(GENERICUNIT* unit, uint64_t noOfPreTriggerSamples, int16_
 
 		if (status == PICO_OK)
 		{
-			bool SetDataBufferFlag = false;
 			uint64_t i = 0;
+			uint64_t nFilled = 0;	// Values the driver has written to the current buffer set
 
 			while (i < nCaptures) //loop for each buffer Set created
 			{	
-				if (SetDataBufferFlag)
-				{	// Pass next set of channel Buffers to the API	
-					printf("\nCalling SetDataBuffer() for BufferSet #%d Channel(s) - ", (int)i);
-					for (short channel = 0; channel < unit->channelCount; channel++)
-					{
-						if (unit->channelSettings[channel].enabled)
-						{
-							status = psospaSetDataBuffers(unit->handle,
-								(PICO_CHANNEL)channel,
-								maxBuffers[i][channel],
-								minBuffers[i][channel],
-								(int32_t)nSamples,
-								PICO_INT16_T,
-								0,
-								PICO_RATIO_MODE_RAW,
-								action_flag);
-							printf("%c,", 'A' + channel);
-							if (status != PICO_OK)
-							{
-								printf(" - Error from function SetDataBuffers with status: ------ 0x%08lx", status);
-								break;
-							}
-						}
-					}
-				}
-				SetDataBufferFlag = false;
-
 				Sleep((int)timedelay_ms);
 
 				//Call GetStreamingLatestValues() - passing buffer status data in and out
 				status = psospaGetStreamingLatestValues(unit->handle,
 					dataStreamInfo,					//pointer to dataStreamInfo,
-					(uint64_t)NoEnabledchannels,	//sizeof(dataStreamInfo)
+					(uint64_t)nStreamInfos,			//sizeof(dataStreamInfo)
 					&streamingDataTriggerInfoTemp); //pointer to streamingDataTriggerInfoTemp
 
 				///Copy returned Array and sturture to Arrays for each segement
@@ -327,6 +807,11 @@ void streamDataHandler(GENERICUNIT* unit, uint64_t noOfPreTriggerSamples, int16_
 				}
 				streamingDataTriggerInfoArray[i] = streamingDataTriggerInfoTemp;
 
+				if (dataStreamInfo[0].noOfSamples_ != 0)
+				{
+					nFilled = dataStreamInfo[0].startIndex_ + dataStreamInfo[0].noOfSamples_;
+				}
+
 				//printf("\nPolling Delay is: %6.3le ms", timedelay);
 				if(dataStreamInfo[0].noOfSamples_ != 0)
 				{
@@ -337,36 +822,34 @@ void streamDataHandler(GENERICUNIT* unit, uint64_t noOfPreTriggerSamples, int16_
 				// If buffers full move to next bufferSet, or continue if autoStop triggered
 				if (status == PICO_WAITING_FOR_DATA_BUFFERS | streamingDataTriggerInfoTemp.autoStop_ == 1)
 				{
-					//OFFLOAD DATA HERE FOR PROCESSING - "maxBuffers[i] and minBuffers[i]"
-					//WRITING TO TEXT FOR DEMO ONLY!, FOR HIGH SPEED SAMPLING WRITE TO BINARY FILE OR COPY TO ANOTHER BUFFER
-
-					//Write one segment to a file as captured
-					printf("\nWriting Buffer Set %lld of channels to a file.\n", i);
-
-					//Create file name string
-					char buf[58 + (3 * sizeof(int))];
-					size_t buf_size = sizeof(buf) / sizeof(buf[0]);
-					snprintf(buf, buf_size, "%s%d.txt", startOfFileName, (int)i);
-
-					WriteArrayToFileGeneric(
-						unit,
-						minBuffers[i],
-						maxBuffers[i],
-						multiBufferSizes,
-						enabledChannelsScaling,
-						buf,
-						streamingDataTriggerInfoArray[i].triggerAt_, // Triggersample
-						&FileOverflow);
-					printf(" ");
+					// The last buffer set is only partly filled on autoStop
+					uint64_t nValues = (status == PICO_WAITING_FOR_DATA_BUFFERS) ?
+						sets.multiBufferSizes.maxBufferSize : dataStreamInfo[0].startIndex_ + dataStreamInfo[0].noOfSamples_;
+					// Aggregated values in this buffer set (dual-rate streaming)
+					uint64_t nAggregateValues = !dualRate ? 0 : (status == PICO_WAITING_FOR_DATA_BUFFERS) ?
+						sets.aggregateBufferSizes.maxBufferSize : dataStreamInfo[NoEnabledchannels].startIndex_ + dataStreamInfo[NoEnabledchannels].noOfSamples_;
 
-					if(streamingDataTriggerInfoTemp.autoStop_ == 1)
+					// Pass the next set of channel Buffers to the API before this set is processed,
+					// so the driver is not kept waiting for buffers while the host works on it
+					status = PICO_OK;
+					if (streamingDataTriggerInfoTemp.autoStop_ != 1 && i + 1 < nCaptures)
 					{
-						printf("\nAutoStop Triggered!\n"); 
+						printf("\nCalling SetDataBuffer() for BufferSet #%d Channel(s) - ", (int)(i + 1));
+						status = setBufferSet(unit, &sets, i + 1, action_flag);
+					}
+
+					processBufferSet(unit, &sets, i, nValues, nAggregateValues, streamingDataTriggerInfoArray[i].triggerAt_, &FileOverflow);
+
+					if(streamingDataTriggerInfoTemp.autoStop_ == 1)
+					{
+						printf("\nAutoStop Triggered!\n"); 
 						break;	//exit loop on Autostop	
 					}
+					if (status != PICO_OK)
+						break;
 
-					i++;	//index next bufferSet and set flag
-					SetDataBufferFlag = true;
+					i++;	//index next bufferSet
+					nFilled = 0;
 				}
 				else
 				{
@@ -377,6 +860,14 @@ void streamDataHandler(GENERICUNIT* unit, uint64_t noOfPreTriggerSamples, int16_
 					}
 				}
 			}
+
+			// Record the buffer set the driver was filling when the loop ended, the
+			// capture file would otherwise show it as empty
+			if (sets.captureToFile && i < nCaptures && nFilled > 0)
+			{
+				capture_file_set_samples(&sets.captureFile, i, nFilled);
+				capture_file_flush(&sets.captureFile, i);
+			}
  			printf("\n");
 			//OR WAIT UNTIL ALL BUFFER SEGMENTS ARE CAPTURED AND PROCESS DATA IN - "maxBuffers and minBuffers"
 		}
@@ -395,28 +886,17 @@ void streamDataHandler(GENERICUNIT* unit, uint64_t noOfPreTriggerSamples, int16_
 	// Release Buffer memory from API
 	clearDataBuffers(unit);
 
-	// Free memory
-	for (channel = 0; channel < unit->channelCount; channel++)
+	if (softTrigger != NULL)
 	{
-		if (unit->channelSettings[channel].enabled)
-		{
-			for (capture = 0; capture < nCaptures; capture++)
-			{
-				free(maxBuffers[capture][channel]);
-				free(minBuffers[capture][channel]);
-			}
-		}
+		// Events still waiting for post-trigger samples are written short
+		soft_trigger_flush(softTrigger);
 	}
 
-	for (capture = 0; capture < nCaptures; capture++)
-	{
-		free(maxBuffers[capture]);
-		free(minBuffers[capture]);
-	}
-	free(maxBuffers);
-	free(minBuffers);
+	// Free memory
+	freeBufferSets(unit, &sets);
 
 	free(streamingDataInfoArray);
+	free(streamingDataTriggerInfoArray);
 	free(dataStreamInfo);
 
 }
@@ -475,8 +955,527 @@ void collectStreamingTriggered(GENERICUNIT* unit)
 		&pulseWidth,		//PWQ
 		0, 0);				//TrigDelay //AutoTrigger_us
 
-	streamDataHandler(unit, 0, 1);
+	if (preTriggerHistory > 0.0)
+	{
+		streamHistoryHandler(unit);
+	}
+	else
+	{
+		streamDataHandler(unit, 0, 1);
+	}
+}
+
+/****************************************************************************
+*  streamHistoryHandler
+*  Streams with the hardware trigger set, keeping preTriggerHistory
+*  seconds of data on the host until the trigger arrives. The history
+*  and postTriggerTime seconds after the trigger are written to
+*  StreamingTriggerHistory.txt as one record.
+***************************************************************************/
+void streamHistoryHandler(GENERICUNIT* unit)
+{
+	PICO_STATUS status;
+	TRIGGER_HISTORY history;
+	PICO_STREAMING_DATA_INFO dataStreamInfo[PSOSPA_MAX_CHANNELS];
+	PICO_STREAMING_DATA_TRIGGER_INFO triggerInfo = { 0, 0, 0 };
+	PICO_DATA_TYPE dataType = pico_sample_data_type(unit->resolution);
+	PICO_ACTION action_flag = (PICO_CLEAR_ALL | PICO_ADD);
+	double idealTimeInterval = 1;
+	uint32_t sampleIntervalTimeUnits = PICO_US;
+	uint64_t bufferSize = constBufferSize;
+	double sampleInterval;
+	int16_t channels[PSOSPA_MAX_CHANNELS];
+	int16_t nChannels = 0;
+	int16_t triggered = 0;
+	uint64_t triggerAt = 0;
+	int16_t complete = 0;
+	uint64_t triggerIndex = 0;
+	uint64_t nSamples = 0;
+	uint64_t i;
+	int16_t ch;
+	FILE* fpHistory = NULL;
+
+	if (streamingPlan.valid)
+	{
+		idealTimeInterval = streamingPlan.sampleInterval * 1e12;
+		sampleIntervalTimeUnits = PICO_PS;
+	}
+	sampleInterval = idealTimeInterval * (pow(10, 3 * sampleIntervalTimeUnits) / 1E+15);
+
+	for (ch = 0; ch < unit->channelCount; ch++)
+	{
+		if (unit->channelSettings[ch].enabled)
+		{
+			channels[nChannels] = ch;
+			dataStreamInfo[nChannels].channel_ = (PICO_CHANNEL)ch;
+			dataStreamInfo[nChannels].mode_ = PICO_RATIO_MODE_RAW;
+			dataStreamInfo[nChannels].type_ = dataType;
+			nChannels++;
+		}
+	}
+
+	status = trigger_history_init(&history, nChannels, (uint32_t)pico_sample_size(dataType), bufferSize,
+		(uint64_t)(preTriggerHistory / sampleInterval), (uint64_t)(postTriggerTime / sampleInterval));
+
+	if (status != PICO_OK)
+	{
+		printf("streamHistoryHandler:trigger_history_init ------ 0x%08lx \n", status);
+		return;
+	}
+
+	printf("Keeping %llu pre-trigger samples (%g s) in %llu buffers\n",
+		(unsigned long long)history.historySamples, preTriggerHistory, (unsigned long long)history.nSlots);
+
+	for (ch = 0; ch < nChannels; ch++)
+	{
+		status = psospaSetDataBuffers(unit->handle, (PICO_CHANNEL)channels[ch],
+			(int16_t*)trigger_history_buffer(&history, ch), NULL, (int32_t)bufferSize, dataType, 0, PICO_RATIO_MODE_RAW, action_flag);
+		action_flag = PICO_ADD;
+
+		if (status != PICO_OK)
+		{
+			printf("streamHistoryHandler:psospaSetDataBuffers ------ 0x%08lx \n", status);
+			trigger_history_free(&history);
+			return;
+		}
+	}
+
+	status = psospaRunStreaming(unit->handle, &idealTimeInterval, sampleIntervalTimeUnits, 0, history.postSamples, 0, 1, PICO_RATIO_MODE_RAW);
+
+	if (status != PICO_OK)
+	{
+		printf("streamHistoryHandler:psospaRunStreaming ------ 0x%08lx \n", status);
+		trigger_history_free(&history);
+		return;
+	}
+
+	printf("Waiting for trigger...Press a key to abort\n");
+
+	while (!complete && !_kbhit())
+	{
+		// Poll at about a third of the time to fill a buffer
+		Sleep((int)(sampleInterval * bufferSize * 0.3 * 1000));
+
+		status = psospaGetStreamingLatestValues(unit->handle, dataStreamInfo, (uint64_t)nChannels, &triggerInfo);
+
+		if (triggerInfo.triggered_ && !triggered)
+		{
+			triggered = 1;
+			triggerAt = triggerInfo.triggerAt_;
+			printf("Triggered\n");
+		}
+
+		if (status == PICO_WAITING_FOR_DATA_BUFFERS)
+		{
+			// The next buffers are history slots until the trigger, then the post-trigger part of the record
+			complete = trigger_history_buffer_full(&history, triggered, triggerAt);
+
+			for (ch = 0; ch < nChannels && !complete; ch++)
+			{
+				status = psospaSetDataBuffers(unit->handle, (PICO_CHANNEL)channels[ch],
+					(int16_t*)trigger_history_buffer(&history, ch), NULL, (int32_t)bufferSize, dataType, 0, PICO_RATIO_MODE_RAW, PICO_ADD);
+
+				if (status != PICO_OK)
+				{
+					printf("streamHistoryHandler:psospaSetDataBuffers ------ 0x%08lx \n", status);
+					break;
+				}
+			}
+		}
+		else if (status != PICO_OK)
+		{
+			printf("streamHistoryHandler:psospaGetStreamingLatestValues ------ 0x%08lx \n", status);
+			break;
+		}
+	}
+
+	psospaStop(unit->handle);
+	clearDataBuffers(unit);
+
+	nSamples = trigger_history_record(&history, &triggerIndex);
+
+	if (nSamples == 0)
+	{
+		printf("No trigger\n");
+	}
+	else if (fopen_s(&fpHistory, "StreamingTriggerHistory.txt", "w") == 0 && fpHistory != NULL)
+	{
+		fprintf(fpHistory, "Triggered streaming with %llu pre-trigger samples, %g s per sample\n", (unsigned long long)triggerIndex, sampleInterval);
+		fprintf(fpHistory, scaleVoltages ? "Sample, Time (s), Channel values (mV)\n" : "Sample, Time (s), Channel values (ADC counts)\n");
+
+		for (i = 0; i < nSamples; i++)
+		{
+			fprintf(fpHistory, "%lld, %g", (int64_t)i - (int64_t)triggerIndex, ((int64_t)i - (int64_t)triggerIndex) * sampleInterval);
+
+			for (ch = 0; ch < nChannels; ch++)
+			{
+				int16_t value = trigger_history_value(&history, ch, i);
+
+				if (scaleVoltages)
+					fprintf(fpHistory, ", %g", adc_to_mv(value, unit->channelSettings[channels[ch]].range, unit->maxADCValue));
+				else
+					fprintf(fpHistory, ", %d", value);
+			}
+			fprintf(fpHistory, "\n");
+		}
+		fclose(fpHistory);
+		printf("%llu samples (%llu before the trigger) written to StreamingTriggerHistory.txt\n", (unsigned long long)nSamples, (unsigned long long)triggerIndex);
+	}
+
+	trigger_history_free(&history);
 }
+
+/****************************************************************************
+*  streamBackpressureHandler
+*  Streams to StreamingBackpressure.bin through a chunk ring with a writer
+*  thread. When the writer falls behind, streaming is restarted with
+*  backpressureMode at an increasing ratio, and returns to raw once the
+*  queue has drained, so the file covers the whole run without overruns.
+*  Aggregated data is written as min/max pairs. The mode of each part of
+*  the file is written to StreamingBackpressure.txt.
+***************************************************************************/
+void streamBackpressureHandler(GENERICUNIT* unit)
+{
+	PICO_STATUS status = PICO_OK;
+	BACKPRESSURE backpressure;
+	BACKPRESSURE_SETTINGS settings = { BACKPRESSURE_HIGH_WATERMARK, BACKPRESSURE_LOW_WATERMARK,
+		BACKPRESSURE_MAX_LEVEL, BACKPRESSURE_SHIFT_PER_LEVEL, BACKPRESSURE_HOLD_SETS };
+	CHUNK_RING ring;
+	PICO_STREAMING_DATA_INFO dataStreamInfo[PSOSPA_MAX_CHANNELS];
+	PICO_STREAMING_DATA_TRIGGER_INFO triggerInfo = { 0, 0, 0 };
+	PICO_RATIO_MODE mode = PICO_RATIO_MODE_RAW;
+	PICO_ACTION action_flag;
+	double idealTimeInterval = 1;
+	uint32_t sampleIntervalTimeUnits = PICO_US;
+	uint64_t bufferSize = constBufferSize;	// Values per channel in each buffer set, at every ratio
+	PICO_DATA_TYPE dataType = pico_sample_data_type(unit->resolution);
+	size_t sampleSize = pico_sample_size(dataType);
+	double sampleInterval = 0.0;
+	int16_t channels[PSOSPA_MAX_CHANNELS];
+	int16_t* maxBuffers[2][PSOSPA_MAX_CHANNELS] = { { NULL } };
+	int16_t* minBuffers[2][PSOSPA_MAX_CHANNELS] = { { NULL } };
+	int16_t* pairBuffers[PSOSPA_MAX_CHANNELS] = { NULL };
+	int16_t nChannels = 0;
+	int16_t set = 0;
+	int16_t done;
+	int16_t restart = TRUE;
+	uint64_t ratio = 1;
+	uint64_t valuesWritten = 0;
+	uint64_t samplesCovered = 0;
+	uint64_t samplesWritten = 0;
+	uint64_t queueDepth = 0;
+	uint64_t nChunks = 0;
+	uint64_t i;
+	int16_t ch;
+
+	if (streamingPlan.valid)
+	{
+		idealTimeInterval = streamingPlan.sampleInterval * 1e12;
+		sampleIntervalTimeUnits = PICO_PS;
+	}
+
+	for (ch = 0; ch < unit->channelCount; ch++)
+	{
+		if (unit->channelSettings[ch].enabled)
+		{
+			channels[nChannels] = ch;
+			dataStreamInfo[nChannels].channel_ = (PICO_CHANNEL)ch;
+			dataStreamInfo[nChannels].type_ = dataType;
+			maxBuffers[0][nChannels] = (int16_t*)calloc(bufferSize, sampleSize);
+			maxBuffers[1][nChannels] = (int16_t*)calloc(bufferSize, sampleSize);
+			minBuffers[0][nChannels] = (int16_t*)calloc(bufferSize, sampleSize);
+			minBuffers[1][nChannels] = (int16_t*)calloc(bufferSize, sampleSize);
+			pairBuffers[nChannels] = (int16_t*)calloc(2 * bufferSize, sizeof(int16_t));	// The chunk ring stores 16-bit values
+
+			if (maxBuffers[0][nChannels] == NULL || maxBuffers[1][nChannels] == NULL || minBuffers[0][nChannels] == NULL ||
+				minBuffers[1][nChannels] == NULL || pairBuffers[nChannels] == NULL)
+			{
+				status = PICO_MEMORY;
+			}
+			nChannels++;
+		}
+	}
+
+	if (status != PICO_OK || !chunk_ring_open(&ring, "StreamingBackpressure.bin", nChannels, 0))
+	{
+		printf("streamBackpressureHandler:chunk_ring_open ------ 0x%08lx \n", status);
+
+		for (ch = 0; ch < nChannels; ch++)
+		{
+			free(maxBuffers[0][ch]);
+			free(maxBuffers[1][ch]);
+			free(minBuffers[0][ch]);
+			free(minBuffers[1][ch]);
+			free(pairBuffers[ch]);
+		}
+		return;
+	}
+
+	backpressure_init(&backpressure, &settings);
+	printf("Streaming to StreamingBackpressure.bin...Press a key to stop\n");
+
+	while (!_kbhit())
+	{
+		if (restart)
+		{
+			// Start, or restart at the new level, with buffer set 0
+			restart = FALSE;
+			set = 0;
+			ratio = backpressure_ratio(&backpressure);
+			mode = (backpressure.level == 0) ? PICO_RATIO_MODE_RAW : backpressureMode;
+			action_flag = (PICO_CLEAR_ALL | PICO_ADD);
+
+			for (ch = 0; ch < nChannels; ch++)
+			{
+				dataStreamInfo[ch].mode_ = mode;
+				status = psospaSetDataBuffers(unit->handle, (PICO_CHANNEL)channels[ch], maxBuffers[0][ch],
+					(mode == PICO_RATIO_MODE_AGGREGATE) ? minBuffers[0][ch] : NULL, (int32_t)bufferSize, dataType, 0, mode, action_flag);
+				action_flag = PICO_ADD;
+
+				if (status != PICO_OK)
+				{
+					printf("streamBackpressureHandler:psospaSetDataBuffers ------ 0x%08lx \n", status);
+					break;
+				}
+			}
+
+			if (status == PICO_OK)
+			{
+				status = psospaRunStreaming(unit->handle, &idealTimeInterval, sampleIntervalTimeUnits, 0, bufferSize * ratio, 0, ratio, mode);
+
+				if (status != PICO_OK)
+				{
+					printf("streamBackpressureHandler:psospaRunStreaming ------ 0x%08lx \n", status);
+				}
+			}
+
+			if (status != PICO_OK)
+				break;
+
+			sampleInterval = idealTimeInterval * (pow(10, 3 * sampleIntervalTimeUnits) / 1E+15);
+			backpressure_add_segment(&backpressure, valuesWritten, samplesCovered, (int32_t)mode,
+				(mode == PICO_RATIO_MODE_AGGREGATE) ? 2 : 1, queueDepth);
+
+			printf("Streaming %s at 1:%lld (queue depth %lld chunks)\n", (mode == PICO_RATIO_MODE_RAW) ? "raw" :
+				(mode == PICO_RATIO_MODE_AGGREGATE) ? "aggregated" : "decimated", ratio, queueDepth);
+		}
+
+		// Poll at about a third of the time to fill a buffer set
+		Sleep((int)(sampleInterval * bufferSize * ratio * 0.3 * 1000));
+
+		status = psospaGetStreamingLatestValues(unit->handle, dataStreamInfo, (uint64_t)nChannels, &triggerInfo);
+
+		if (status == PICO_WAITING_FOR_DATA_BUFFERS)
+		{
+			// Give the driver the other set first, then queue the full one
+			done = set;
+			set ^= 1;
+
+			for (ch = 0; ch < nChannels; ch++)
+			{
+				status = psospaSetDataBuffers(unit->handle, (PICO_CHANNEL)channels[ch], maxBuffers[set][ch],
+					(mode == PICO_RATIO_MODE_AGGREGATE) ? minBuffers[set][ch] : NULL, (int32_t)bufferSize, dataType, 0, mode, PICO_ADD);
+
+				if (status != PICO_OK)
+				{
+					printf("streamBackpressureHandler:psospaSetDataBuffers ------ 0x%08lx \n", status);
+					break;
+				}
+			}
+
+			if (mode == PICO_RATIO_MODE_AGGREGATE)
+			{
+				// Min/max pairs keep one column per channel in the file
+				for (ch = 0; ch < nChannels; ch++)
+				{
+					for (i = 0; i < bufferSize; i++)
+					{
+						pairBuffers[ch][2 * i] = pico_buffer_value(minBuffers[done][ch], dataType, i);
+						pairBuffers[ch][2 * i + 1] = pico_buffer_value(maxBuffers[done][ch], dataType, i);
+					}
+				}
+				chunk_ring_append(&ring, pairBuffers, (uint32_t)(2 * bufferSize));
+				valuesWritten += 2 * bufferSize;
+			}
+			else if (dataType != PICO_INT16_T)
+			{
+				// 8-bit values are widened to 16-bit ADC counts for the file
+				for (ch = 0; ch < nChannels; ch++)
+				{
+					for (i = 0; i < bufferSize; i++)
+					{
+						pairBuffers[ch][i] = pico_buffer_value(maxBuffers[done][ch], dataType, i);
+					}
+				}
+				chunk_ring_append(&ring, pairBuffers, (uint32_t)bufferSize);
+				valuesWritten += bufferSize;
+			}
+			else
+			{
+				chunk_ring_append(&ring, maxBuffers[done], (uint32_t)bufferSize);
+				valuesWritten += bufferSize;
+			}
+			samplesCovered += bufferSize * ratio;
+
+			chunk_ring_status(&ring, &samplesWritten, &queueDepth, &nChunks);
+
+			if (status != PICO_OK)
+				break;
+
+			if (backpressure_update(&backpressure, queueDepth))
+			{
+				psospaStop(unit->handle);
+				restart = TRUE;
+			}
+		}
+		else if (status != PICO_OK)
+		{
+			printf("streamBackpressureHandler:psospaGetStreamingLatestValues ------ 0x%08lx \n", status);
+			break;
+		}
+	}
+
+	psospaStop(unit->handle);
+	clearDataBuffers(unit);
+	chunk_ring_close(&ring);
+
+	printf("%lld values per channel written, covering %lld samples (%g s), peak queue depth %lld chunks, %u segments\n",
+		ring.samplesWritten, samplesCovered, samplesCovered * sampleInterval, backpressure.peakDepth, backpressure.nSegments);
+
+	if ((status = backpressure_write_metadata(&backpressure, "StreamingBackpressure.txt", "StreamingBackpressure.bin",
+		nChannels, sampleInterval)) != PICO_OK)
+	{
+		printf("streamBackpressureHandler:backpressure_write_metadata ------ 0x%08lx \n", status);
+	}
+
+	backpressure_free(&backpressure);
+
+	for (ch = 0; ch < nChannels; ch++)
+	{
+		free(maxBuffers[0][ch]);
+		free(maxBuffers[1][ch]);
+		free(minBuffers[0][ch]);
+		free(minBuffers[1][ch]);
+		free(pairBuffers[ch]);
+	}
+}
+
+/****************************************************************************
+*  softTriggerEvent
+*  Writes each software trigger event to SoftTriggerEvents.txt
+***************************************************************************/
+static void softTriggerEvent(SOFT_TRIGGER_EVENT* event, void* parameter)
+{
+	GENERICUNIT* unit = (GENERICUNIT*)parameter;
+	uint32_t i;
+	int16_t ch;
+
+	printf("\nSoftware trigger %u at sample %llu", event->eventNumber, (unsigned long long)event->triggerSample);
+
+	if (softTriggerFp == NULL)
+		return;
+
+	fprintf(softTriggerFp, "Event %u: trigger at sample %llu (%g s), %s, pulse width %llu samples, %u pre-trigger samples\n",
+		event->eventNumber, (unsigned long long)event->triggerSample, event->triggerSample * unit->timeInterval,
+		event->rising ? "rising" : "falling", (unsigned long long)event->pulseWidth, event->preSamples);
+
+	for (i = 0; i < event->nSamples; i++)
+	{
+		fprintf(softTriggerFp, "%6d", (int32_t)i - (int32_t)event->preSamples);
+
+		for (ch = 0; ch < event->nChannels; ch++)
+		{
+			fprintf(softTriggerFp, ", %6d", event->data[ch][i]);
+		}
+		fprintf(softTriggerFp, "\n");
+	}
+	fprintf(softTriggerFp, "\n");
+}
+
+/****************************************************************************
+*  collectStreamingSoftTriggered
+*  This function demonstrates a software trigger on a continuous stream.
+*  The hardware trigger is off; every rising edge through +50% of the
+*  first enabled channel's range gives an event with its own pre- and
+*  post-trigger data.
+***************************************************************************/
+void collectStreamingSoftTriggered(GENERICUNIT* unit)
+{
+	PICO_STATUS status;
+	SOFT_TRIGGER trigger;
+	SOFT_TRIGGER_SETTINGS settings;
+	int16_t source = -1;
+	int16_t nChannels = 0;
+	int16_t ch;
+
+	for (ch = 0; ch < unit->channelCount; ch++)
+	{
+		if (unit->channelSettings[ch].enabled)
+		{
+			if (source < 0)
+				source = ch;
+			nChannels++;
+		}
+	}
+
+	if (source < 0)
+	{
+		printf("collectStreamingSoftTriggered: No channels enabled\n");
+		return;
+	}
+
+	memset(&settings, 0, sizeof(SOFT_TRIGGER_SETTINGS));
+	settings.source = 0;	// The first enabled channel
+	settings.type = SOFT_TRIGGER_RISING;
+	settings.thresholdUpper = mv_to_adc((double)inputRanges[unit->channelSettings[source].range] / 2,
+		unit->channelSettings[source].range,
+		unit->maxADCValue);
+	settings.hysteresis = 256 * 10;
+	settings.pwqType = SOFT_PWQ_NONE;
+	settings.preTrigger = 500;
+	settings.postTrigger = 1500;
+
+	if ((status = soft_trigger_init(&trigger, &settings, nChannels, (uint32_t)constBufferSize, softTriggerEvent, unit)) != PICO_OK)
+	{
+		printf("collectStreamingSoftTriggered:soft_trigger_init ------ 0x%08lx \n", status);
+		return;
+	}
+
+	printf("Collect streaming with a software trigger...\n");
+	printf("Trigger Channel is %c\n", 'A' + source);
+	printf("Triggers each time the value rises past %d", scaleVoltages ?
+		(int16_t)adc_to_mv(settings.thresholdUpper, unit->channelSettings[source].range, unit->maxADCValue)	// If scaleVoltages, print mV value
+		: settings.thresholdUpper);																	// else print ADC Count
+	printf(scaleVoltages ? " mV\n" : " ADC Counts\n");
+	printf("Events are written to SoftTriggerEvents.txt\n");
+	printf("Press a key to start...\n");
+	_getch();
+
+	setDefaults(unit);
+
+	/* Hardware trigger disabled */
+	status = psospaSetSimpleTrigger(unit->handle, 0, PICO_CHANNEL_A, 0, PICO_RISING, 0, 0);
+
+	fopen_s(&softTriggerFp, "SoftTriggerEvents.txt", "w");
+	softTrigger = &trigger;
+
+	streamDataHandler(unit, 0, 0);
+
+	softTrigger = NULL;
+	if (softTriggerFp != NULL)
+	{
+		fclose(softTriggerFp);
+		softTriggerFp = NULL;
+	}
+
+	printf("%u software trigger events", trigger.nEvents);
+	if (trigger.nMissed)
+		printf(", %u missed (too many pending)", trigger.nMissed);
+	printf("\n");
+
+	soft_trigger_free(&trigger);
+}
+
 /****************************************************************************
 *  collectStreamingImmediate
 *  This function demonstrates how to collect a stream of data
@@ -493,5 +1492,104 @@ void collectStreamingImmediate(GENERICUNIT* unit)
 	printf("Press a key to start\n");
 	_getch();
 
-	streamDataHandler(unit, 0, 0);
-}
\ No newline at end of file
+	if (backpressureMode != PICO_RATIO_MODE_RAW)
+	{
+		streamBackpressureHandler(unit);
+	}
+	else
+	{
+		streamDataHandler(unit, 0, 0);
+	}
+}
+
+/****************************************************************************
+*  applyStreamingPlan
+*  Applies the channels, resolution and timebase of a streaming plan
+*  through the same paths as setVoltages and setResolution
+***************************************************************************/
+PICO_STATUS applyStreamingPlan(GENERICUNIT* unit, STREAMING_PLAN* plan, uint32_t channelFlags)
+{
+	PICO_STATUS status;
+	int16_t ch;
+
+	// Switch off unused channels first, the resolution may not allow them
+	for (ch = 0; ch < unit->channelCount; ch++)
+	{
+		if (!((channelFlags >> ch) & 1))
+		{
+			unit->channelSettings[ch].enabled = FALSE;
+		}
+	}
+	setDefaults(unit);
+
+	if ((status = applyResolution(unit, (PICO_DEVICE_RESOLUTION)plan->resolution)) != PICO_OK)
+	{
+		plan->valid = FALSE;
+		return status;
+	}
+
+	for (ch = 0; ch < unit->channelCount; ch++)
+	{
+		unit->channelSettings[ch].enabled = (channelFlags >> ch) & 1;
+	}
+	setDefaults(unit);
+
+	timebase = plan->timebase;
+	unit->timeInterval = plan->sampleInterval;
+	return PICO_OK;
+}
+
+/****************************************************************************
+*  planStreaming
+*  Asks for the required channels, minimum resolution and duration, then
+*  picks and applies the settings with the highest sustained streaming rate
+***************************************************************************/
+void planStreaming(GENERICUNIT* unit)
+{
+	PICO_STATUS status;
+	PLAN_RESOLUTION resolutions[] = { { PICO_DR_8BIT, 8, 1 }, { PICO_DR_10BIT, 10, 2 } };
+	STREAMING_PLAN_REQUEST request = { 0, 8, 10.0, STREAMING_USB_BANDWIDTH, FALSE };
+	char channels[PSOSPA_MAX_CHANNELS + 1] = { '\0' };
+	int32_t input = 0;
+	int16_t i;
+
+	printf("Enter the channels to stream (example ABD): ");
+	fflush(stdin);
+	scanf_s("%8s", channels, (unsigned)sizeof(channels));
+
+	for (i = 0; channels[i] != '\0'; i++)
+	{
+		if (toupper(channels[i]) - 'A' >= 0 && toupper(channels[i]) - 'A' < unit->channelCount)
+		{
+			request.channelFlags |= 1u << (toupper(channels[i]) - 'A');
+		}
+	}
+
+	printf("Minimum resolution in bits: ");
+	scanf_s("%d", &input);
+	request.minBits = (int16_t)input;
+
+	printf("Target duration in seconds: ");
+	scanf_s("%le", &request.duration);
+
+	printf("Aggregate in the driver when USB bandwidth limited (1 = yes, 0 = no): ");
+	scanf_s("%d", &input);
+	request.allowAggregation = (int16_t)input;
+
+	status = streaming_plan_create(&timebaseSolver, resolutions, sizeof(resolutions) / sizeof(resolutions[0]), &request, &streamingPlan);
+
+	if (status != PICO_OK)
+	{
+		printf("planStreaming:streaming_plan_create ------ 0x%08lx \n", status);
+		if (status == PICO_INVALID_NUMBER_CHANNELS_FOR_RESOLUTION)
+			printf("The channel combination is not valid for the minimum resolution\n");
+		return;
+	}
+
+	streaming_plan_print(&streamingPlan);
+
+	if ((status = applyStreamingPlan(unit, &streamingPlan, request.channelFlags)) != PICO_OK)
+	{
+		printf("planStreaming:applyStreamingPlan ------ 0x%08lx \n", status);
+	}
+}
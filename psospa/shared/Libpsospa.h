@@ -18,6 +18,7 @@
 #include <conio.h>
 #include "psospaApi.h"
 #include "../../shared/PicoUnit.h"
+#include "../../shared/PicoTimebase.h"
 #else
 #include <sys/types.h>
 #include <string.h>
@@ -101,6 +102,8 @@ int32_t fopen_s(FILE** a, const char* b, const char* c)
 #define PSOSPA_MAX_CHANNELS 4 //analog chs only
 #define MSO_MAX_CHANNELS 2 //digital chs only
 
+#define DUAL_RATE_MAX_SHIFT 10 //Largest min/max stream ratio (1:1024) for dual-rate streaming
+
 //Default Enabled Channel defines-
 #define ENABLED_CHS_LIMIT 2 //Set to limit the max number channels to enable (for example if set to 2 then ChA and CnB will be turned on)
 #define TURN_ON_EVERY_N_CH 1 //Set this either 2 or 4 (2 = Every odd Ch is enabled, 4 = Every 4th Ch enabled) Or set to 1 to disable.
@@ -143,8 +146,10 @@ PICO_STATUS handleDevice(GENERICUNIT* unit);
 
 void setVoltages(GENERICUNIT* unit);
 void setTimebase(GENERICUNIT* unit);
+PICO_STATUS calibrateTimebaseSolver(GENERICUNIT* unit);
 
 void setResolution(GENERICUNIT* unit);
+PICO_STATUS applyResolution(GENERICUNIT* unit, PICO_DEVICE_RESOLUTION newResolution);
 void printResolution(PICO_DEVICE_RESOLUTION* resolution);
 
 PICO_STATUS clearDataBuffers(GENERICUNIT* unit);
@@ -0,0 +1,178 @@
+/****************************************************************************
+ *
+ * Filename:    PicoBackpressure.c
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This file defines a backpressure controller for streaming
+ * (see PicoBackpressure.h).
+ *
+ ****************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include "./PicoBackpressure.h"
+
+/****************************************************************************
+* backpressure_init
+****************************************************************************/
+void backpressure_init(BACKPRESSURE* backpressure, const BACKPRESSURE_SETTINGS* settings)
+{
+	memset(backpressure, 0, sizeof(BACKPRESSURE));
+	backpressure->settings = *settings;
+
+	if (backpressure->settings.lowWatermark >= backpressure->settings.highWatermark)
+		backpressure->settings.lowWatermark = backpressure->settings.highWatermark / 2;
+
+	if (backpressure->settings.shiftPerLevel == 0)
+		backpressure->settings.shiftPerLevel = 1;
+}
+
+/****************************************************************************
+* backpressure_free
+****************************************************************************/
+void backpressure_free(BACKPRESSURE* backpressure)
+{
+	free(backpressure->segments);
+	backpressure->segments = NULL;
+	backpressure->nSegments = 0;
+	backpressure->maxSegments = 0;
+}
+
+/****************************************************************************
+* backpressure_update
+*
+* Call once per completed buffer set
+* Inputs:
+* - queueDepth: items waiting for the consumer
+* Returns:
+* - 1 if the level has changed and streaming must be restarted
+*   with backpressure_ratio, 0 otherwise
+****************************************************************************/
+int16_t backpressure_update(BACKPRESSURE* backpressure, uint64_t queueDepth)
+{
+	BACKPRESSURE_SETTINGS* settings = &backpressure->settings;
+
+	if (queueDepth > backpressure->peakDepth)
+		backpressure->peakDepth = queueDepth;
+
+	backpressure->setsAtLevel++;
+
+	// The queue takes time to drain after a step up, so only step up again
+	// straight away if it is still growing
+	if (queueDepth >= settings->highWatermark && backpressure->level < settings->maxLevel &&
+		(backpressure->setsAtLevel >= settings->holdSets || queueDepth > backpressure->switchDepth))
+	{
+		backpressure->level++;
+		backpressure->setsAtLevel = 0;
+		backpressure->switchDepth = queueDepth;
+		return 1;
+	}
+
+	// Only step down once the queue has drained and the level has had time to
+	// settle, so a consumer near its limit does not switch on every buffer set
+	if (queueDepth <= settings->lowWatermark && backpressure->level > 0 && backpressure->setsAtLevel >= settings->holdSets)
+	{
+		backpressure->level--;
+		backpressure->setsAtLevel = 0;
+		backpressure->switchDepth = queueDepth;
+		return 1;
+	}
+
+	return 0;
+}
+
+/****************************************************************************
+* backpressure_ratio
+*
+* Down-sampling ratio for the current level, 1 for raw
+****************************************************************************/
+uint64_t backpressure_ratio(const BACKPRESSURE* backpressure)
+{
+	return 1ull << (backpressure->level * backpressure->settings.shiftPerLevel);
+}
+
+/****************************************************************************
+* backpressure_add_segment
+*
+* Records the start of a segment at the current level. Call when
+* streaming starts and after every restart.
+* Inputs:
+* - firstValue: values per channel already in the data file
+* - firstSample: raw samples covered by those values
+* - ratioMode: PICO_RATIO_MODE the driver is running with
+* - valuesPerRatio: values written for each ratio samples
+* - queueDepth: queue depth that caused the switch
+****************************************************************************/
+PICO_STATUS backpressure_add_segment(BACKPRESSURE* backpressure, uint64_t firstValue, uint64_t firstSample,
+	int32_t ratioMode, uint32_t valuesPerRatio, uint64_t queueDepth)
+{
+	BACKPRESSURE_SEGMENT* segments;
+	BACKPRESSURE_SEGMENT* segment;
+
+	if (backpressure->nSegments == backpressure->maxSegments)
+	{
+		segments = (BACKPRESSURE_SEGMENT*)realloc(backpressure->segments,
+			(backpressure->maxSegments + 64) * sizeof(BACKPRESSURE_SEGMENT));
+
+		if (segments == NULL)
+			return PICO_MEMORY;
+
+		backpressure->segments = segments;
+		backpressure->maxSegments += 64;
+	}
+
+	segment = &backpressure->segments[backpressure->nSegments++];
+	segment->firstValue = firstValue;
+	segment->firstSample = firstSample;
+	segment->ratioMode = ratioMode;
+	segment->level = backpressure->level;
+	segment->ratio = backpressure_ratio(backpressure);
+	segment->valuesPerRatio = valuesPerRatio;
+	segment->queueDepth = queueDepth;
+	return PICO_OK;
+}
+
+/****************************************************************************
+* backpressure_write_metadata
+*
+* Writes the segment table as text, one line per segment
+* Inputs:
+* - dataFileName: the data file the segments refer to
+* - nChannels: values per sample in the data file
+* - sampleInterval: seconds between raw samples
+****************************************************************************/
+PICO_STATUS backpressure_write_metadata(const BACKPRESSURE* backpressure, const char* fileName,
+	const char* dataFileName, int16_t nChannels, double sampleInterval)
+{
+	const BACKPRESSURE_SEGMENT* segment;
+	FILE* fp = NULL;
+	uint32_t s;
+
+#ifdef _WIN32
+	fopen_s(&fp, fileName, "w");
+#else
+	fp = fopen(fileName, "w");
+#endif
+
+	if (fp == NULL)
+		return PICO_NOT_FOUND;
+
+	fprintf(fp, "Data file: %s\n", dataFileName);
+	fprintf(fp, "Channels: %d (interleaved int16_t)\n", nChannels);
+	fprintf(fp, "Raw sample interval: %g s\n", sampleInterval);
+	fprintf(fp, "Peak queue depth: %llu\n", (unsigned long long)backpressure->peakDepth);
+	fprintf(fp, "Segments: %u\n\n", backpressure->nSegments);
+	fprintf(fp, "Segment, FirstValue, FirstSample, RatioMode, Level, Ratio, ValuesPerRatio, QueueDepth\n");
+
+	for (s = 0; s < backpressure->nSegments; s++)
+	{
+		segment = &backpressure->segments[s];
+		fprintf(fp, "%u, %llu, %llu, 0x%08x, %u, %llu, %u, %llu\n", s,
+			(unsigned long long)segment->firstValue, (unsigned long long)segment->firstSample,
+			(uint32_t)segment->ratioMode, segment->level, (unsigned long long)segment->ratio,
+			segment->valuesPerRatio, (unsigned long long)segment->queueDepth);
+	}
+
+	fclose(fp);
+	return PICO_OK;
+}
@@ -0,0 +1,73 @@
+/****************************************************************************
+ *
+ * Filename:    PicoBackpressure.h
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This header defines a backpressure controller for streaming. The
+ * caller reports the depth of its consumer queue (e.g. chunks waiting in
+ * a PicoChunkRing) after each buffer set. Above the high watermark the
+ * controller steps up a level, and the caller restarts streaming with a
+ * larger down-sampling ratio. At or below the low watermark it steps back
+ * down, one level at a time, until the stream is raw again. Every level
+ * change is kept as a segment, and the segments are written as capture
+ * metadata so a reader knows the ratio of each part of the data file.
+ *
+ ****************************************************************************/
+#ifndef __PICOBACKPRESSURE_H__
+#define __PICOBACKPRESSURE_H__
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* PicoStatus.h of the driver being built, from its include directory (AM_CPPFLAGS on Linux) */
+#ifndef PICO_OK
+#include "PicoStatus.h"
+#endif
+
+typedef struct tBackpressureSettings
+{
+	uint64_t	highWatermark;	// Queue depth that steps up a level
+	uint64_t	lowWatermark;	// Queue depth that steps back down
+	uint32_t	maxLevel;		// Level 0 is raw
+	uint32_t	shiftPerLevel;	// The ratio at level n is 2^(n * shiftPerLevel)
+	uint32_t	holdSets;		// Buffer sets to stay at a level before stepping down
+}BACKPRESSURE_SETTINGS;
+
+typedef struct tBackpressureSegment
+{
+	uint64_t	firstValue;		// Per channel value index in the data file
+	uint64_t	firstSample;	// Raw samples covered before the segment (restart gaps not counted)
+	int32_t		ratioMode;		// PICO_RATIO_MODE the driver was restarted with
+	uint32_t	level;
+	uint64_t	ratio;
+	uint32_t	valuesPerRatio;	// Values written per ratio samples, 2 for min/max pairs
+	uint64_t	queueDepth;		// Queue depth that caused the switch
+}BACKPRESSURE_SEGMENT;
+
+typedef struct tBackpressure
+{
+	BACKPRESSURE_SETTINGS	settings;
+	uint32_t				level;
+	uint32_t				setsAtLevel;
+	uint64_t				switchDepth;	// Queue depth at the last level change
+	uint64_t				peakDepth;
+	BACKPRESSURE_SEGMENT*	segments;
+	uint32_t				nSegments;
+	uint32_t				maxSegments;	// Allocated, grows as needed
+}BACKPRESSURE;
+
+// Function prototypes
+void backpressure_init(BACKPRESSURE* backpressure, const BACKPRESSURE_SETTINGS* settings);
+void backpressure_free(BACKPRESSURE* backpressure);
+
+int16_t backpressure_update(BACKPRESSURE* backpressure, uint64_t queueDepth);
+uint64_t backpressure_ratio(const BACKPRESSURE* backpressure);
+
+PICO_STATUS backpressure_add_segment(BACKPRESSURE* backpressure, uint64_t firstValue, uint64_t firstSample,
+	int32_t ratioMode, uint32_t valuesPerRatio, uint64_t queueDepth);
+
+PICO_STATUS backpressure_write_metadata(const BACKPRESSURE* backpressure, const char* fileName,
+	const char* dataFileName, int16_t nChannels, double sampleInterval);
+
+#endif
@@ -154,7 +154,9 @@ void data_buffer_sizes(PICO_RATIO_MODE downSampleRatioMode, uint64_t downSampleR
 /****************************************************************************
 * pico_create_multibuffersBAD
 *
-* Creates buffers with the correct size for the given settings
+* Creates buffers with the correct size for the given settings.
+* PICO_INT8_T buffers hold 1 byte per sample, so read them with
+* pico_buffer_value rather than indexing the int16_t pointers directly.
 * Inputs:
 * - GENERICUNIT* unit
 * - BUFFER_SETTINGS bufferSettings
@@ -178,6 +180,8 @@ void pico_create_multibuffers(GENERICUNIT* unit, BUFFER_SETTINGS bufferSettings,
         &maxBufferSize,
         &minBufferSize);
 
+    size_t sampleSize = pico_sample_size(bufferSettings.dataType);
+
     // Create buffers 
     *minBuffers = (int16_t***)calloc(numberOfBuffers, sizeof(int16_t*));
     *maxBuffers = (int16_t***)calloc(numberOfBuffers, sizeof(int16_t*));
@@ -196,9 +200,9 @@ void pico_create_multibuffers(GENERICUNIT* unit, BUFFER_SETTINGS bufferSettings,
                 if (unit->channelSettings[channel].enabled)
                 {
                     if ((*minBuffers)[capture] != NULL)
-                        (*minBuffers)[capture][channel] = (int16_t*)calloc(minBufferSize, sizeof(int16_t));
+                        (*minBuffers)[capture][channel] = (int16_t*)calloc(minBufferSize, sampleSize);
                     if ((*maxBuffers)[capture] != NULL)
-                        (*maxBuffers)[capture][channel] = (int16_t*)calloc(maxBufferSize, sizeof(int16_t));
+                        (*maxBuffers)[capture][channel] = (int16_t*)calloc(maxBufferSize, sampleSize);
             
                 }
         
@@ -208,4 +212,41 @@ void pico_create_multibuffers(GENERICUNIT* unit, BUFFER_SETTINGS bufferSettings,
     multiBufferSizes->numberOfBuffers = numberOfBuffers;
     multiBufferSizes->maxBufferSize = maxBufferSize;
     multiBufferSizes->minBufferSize = minBufferSize;
+    multiBufferSizes->dataType = bufferSettings.dataType;
+}
+
+/****************************************************************************
+* pico_sample_data_type
+*
+* Returns the smallest data type that holds samples at a resolution.
+* 8-bit captures use PICO_INT8_T, halving host memory and copies.
+****************************************************************************/
+PICO_DATA_TYPE pico_sample_data_type(PICO_DEVICE_RESOLUTION resolution)
+{
+    return (resolution == PICO_DR_8BIT) ? PICO_INT8_T : PICO_INT16_T;
+}
+
+/****************************************************************************
+* pico_sample_size
+*
+* Returns the size in bytes of one sample of a data type
+****************************************************************************/
+size_t pico_sample_size(PICO_DATA_TYPE dataType)
+{
+    return (dataType == PICO_INT8_T) ? sizeof(int8_t) : sizeof(int16_t);
+}
+
+/****************************************************************************
+* pico_buffer_value
+*
+* Reads one sample from a PICO_INT8_T or PICO_INT16_T buffer.
+* 8-bit samples are shifted up to 16-bit ADC counts, so the maxADCValue
+* from GetAdcLimits and all the scaling functions can be used unchanged.
+****************************************************************************/
+int16_t pico_buffer_value(const int16_t* buffer, PICO_DATA_TYPE dataType, uint64_t index)
+{
+    if (dataType == PICO_INT8_T)
+        return (int16_t)(((const int8_t*)buffer)[index] * 256);
+
+    return buffer[index];
 }
\ No newline at end of file
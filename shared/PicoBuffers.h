@@ -94,6 +94,7 @@ typedef struct tbuffer_settings
 	uint64_t		nSamples;
 	PICO_RATIO_MODE	downSampleRatioMode;
 	uint64_t		downSampleRatio;
+	PICO_DATA_TYPE	dataType;		// PICO_INT8_T or PICO_INT16_T (see pico_sample_data_type)
 }BUFFER_SETTINGS;
 
 typedef struct tmultiBufferSizes
@@ -101,6 +102,7 @@ typedef struct tmultiBufferSizes
 	uint64_t numberOfBuffers;
 	uint64_t maxBufferSize;
 	uint64_t minBufferSize;
+	PICO_DATA_TYPE dataType;
 }MULTIBUFFERSIZES;
 
 // Function prototypes
@@ -108,4 +110,8 @@ void data_buffer_sizes(PICO_RATIO_MODE downSampleRatioMode, uint64_t downSampleR
 
 void pico_create_multibuffers(GENERICUNIT* unit, BUFFER_SETTINGS bufferSettings, uint64_t numberOfBuffers, int16_t**** minBuffers, int16_t**** maxBuffers, MULTIBUFFERSIZES* multiBufferSizes);
 
+PICO_DATA_TYPE pico_sample_data_type(PICO_DEVICE_RESOLUTION resolution);
+size_t pico_sample_size(PICO_DATA_TYPE dataType);
+int16_t pico_buffer_value(const int16_t* buffer, PICO_DATA_TYPE dataType, uint64_t index);
+
 #endif
\ No newline at end of file
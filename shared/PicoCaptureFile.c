@@ -0,0 +1,554 @@
+/****************************************************************************
+ *
+ * Filename:    PicoCaptureFile.c
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This file defines memory-mapped capture files for PicoScope data.
+ * The buffer pointers returned by capture_file_create have the same
+ * layout as pico_create_multibuffers, so the capture code is unchanged
+ * apart from how the buffers are created and released. For a windowed
+ * file the pointers of buffer set n are in slot n % windowSets and are
+ * valid once capture_file_map_buffer has been called for the set.
+ *
+ ****************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "./PicoCaptureFile.h"
+
+/* Headers for Windows */
+#ifdef _WIN32
+#include "windows.h"
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#endif
+
+/****************************************************************************
+* alignUp
+****************************************************************************/
+static uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+/****************************************************************************
+* mapFile
+*
+* Opens (or creates with the given size) the file and maps the first
+* mapSize bytes, or the whole file if mapSize is 0
+****************************************************************************/
+static PICO_STATUS mapFile(CAPTURE_FILE* captureFile, const char* fileName, uint64_t size, uint64_t mapSize, int16_t create)
+{
+#ifdef _WIN32
+	LARGE_INTEGER fileSize;
+
+	captureFile->file = CreateFileA(fileName,
+		captureFile->readOnly ? GENERIC_READ : (GENERIC_READ | GENERIC_WRITE),
+		FILE_SHARE_READ,
+		NULL,
+		create ? CREATE_ALWAYS : OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL,
+		NULL);
+
+	if (captureFile->file == INVALID_HANDLE_VALUE)
+		return PICO_NOT_FOUND;
+
+	if (!create)
+	{
+		GetFileSizeEx(captureFile->file, &fileSize);
+		size = (uint64_t)fileSize.QuadPart;
+	}
+
+	captureFile->mapping = CreateFileMappingA(captureFile->file,
+		NULL,
+		captureFile->readOnly ? PAGE_READONLY : PAGE_READWRITE,
+		(DWORD)(size >> 32),
+		(DWORD)(size & 0xFFFFFFFF),
+		NULL);
+
+	if (captureFile->mapping == NULL)
+	{
+		CloseHandle(captureFile->file);
+		return PICO_MEMORY;
+	}
+
+	if (mapSize == 0)
+		mapSize = size;
+
+	captureFile->view = (uint8_t*)MapViewOfFile(captureFile->mapping,
+		captureFile->readOnly ? FILE_MAP_READ : FILE_MAP_WRITE, 0, 0, (SIZE_T)mapSize);
+
+	if (captureFile->view == NULL)
+	{
+		CloseHandle(captureFile->mapping);
+		CloseHandle(captureFile->file);
+		return PICO_MEMORY;
+	}
+#else
+	struct stat fileStat;
+	void* view;
+
+	captureFile->fd = open(fileName, captureFile->readOnly ? O_RDONLY : (O_RDWR | (create ? (O_CREAT | O_TRUNC) : 0)), 0644);
+
+	if (captureFile->fd < 0)
+		return PICO_NOT_FOUND;
+
+	if (create)
+	{
+		if (ftruncate(captureFile->fd, (off_t)size) != 0)
+		{
+			close(captureFile->fd);
+			return PICO_MEMORY;
+		}
+	}
+	else
+	{
+		fstat(captureFile->fd, &fileStat);
+		size = (uint64_t)fileStat.st_size;
+	}
+
+	if (mapSize == 0)
+		mapSize = size;
+
+	view = mmap(NULL, (size_t)mapSize,
+		captureFile->readOnly ? PROT_READ : (PROT_READ | PROT_WRITE),
+		MAP_SHARED, captureFile->fd, 0);
+
+	if (view == MAP_FAILED)
+	{
+		close(captureFile->fd);
+		return PICO_MEMORY;
+	}
+	captureFile->view = (uint8_t*)view;
+#endif
+
+	captureFile->size = size;
+	captureFile->viewSize = mapSize;
+	return PICO_OK;
+}
+
+/****************************************************************************
+* unmapView
+****************************************************************************/
+static void unmapView(CAPTURE_FILE* captureFile, uint8_t* view, uint64_t size)
+{
+#ifdef _WIN32
+	if (!captureFile->readOnly)
+		FlushViewOfFile(view, 0);
+	UnmapViewOfFile(view);
+#else
+	if (!captureFile->readOnly)
+		msync(view, (size_t)size, MS_ASYNC);
+	munmap(view, (size_t)size);
+#endif
+}
+
+/****************************************************************************
+* mapSlot
+*
+* Maps a buffer set into a window slot in place of the set mapped before
+****************************************************************************/
+static PICO_STATUS mapSlot(CAPTURE_FILE* captureFile, uint64_t slot, uint64_t buffer)
+{
+	uint64_t offset = captureFile->header->dataOffset + buffer * captureFile->header->bufferSetSize;
+	uint64_t size = captureFile->header->bufferSetSize;
+	uint8_t* view;
+
+	if (captureFile->windowViews[slot] != NULL)
+	{
+		unmapView(captureFile, captureFile->windowViews[slot], size);
+		captureFile->windowViews[slot] = NULL;
+	}
+
+#ifdef _WIN32
+	view = (uint8_t*)MapViewOfFile(captureFile->mapping, FILE_MAP_WRITE,
+		(DWORD)(offset >> 32), (DWORD)(offset & 0xFFFFFFFF), (SIZE_T)size);
+
+	if (view == NULL)
+		return PICO_MEMORY;
+#else
+	void* mapped = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, captureFile->fd, (off_t)offset);
+
+	if (mapped == MAP_FAILED)
+		return PICO_MEMORY;
+	view = (uint8_t*)mapped;
+#endif
+
+	captureFile->windowViews[slot] = view;
+	captureFile->windowBuffers[slot] = buffer;
+	return PICO_OK;
+}
+
+/****************************************************************************
+* bufferSetAddress
+*
+* Returns the start of a buffer set, or NULL if it is not mapped
+****************************************************************************/
+static uint8_t* bufferSetAddress(CAPTURE_FILE* captureFile, uint64_t buffer)
+{
+	uint64_t slot;
+
+	if (buffer >= captureFile->header->numberOfBuffers)
+		return NULL;
+
+	if (captureFile->windowViews == NULL)
+		return captureFile->view + captureFile->header->dataOffset + buffer * captureFile->header->bufferSetSize;
+
+	slot = buffer % captureFile->windowSets;
+	return (captureFile->windowBuffers[slot] == buffer) ? captureFile->windowViews[slot] : NULL;
+}
+
+/****************************************************************************
+* setBufferPointers
+*
+* Points the channel buffers of one slot at a mapped buffer set
+****************************************************************************/
+static void setBufferPointers(CAPTURE_FILE* captureFile, uint8_t* bufferSet, int16_t** minBuffers, int16_t** maxBuffers)
+{
+	CAPTURE_FILE_HEADER* header = captureFile->header;
+	uint64_t maxBytes = alignUp(header->maxBufferSize * pico_sample_size((PICO_DATA_TYPE)header->dataType), CAPTURE_FILE_ALIGNMENT);
+	int16_t channel;
+
+	for (channel = 0; channel < header->channelCount; channel++)
+	{
+		if ((header->channelFlags >> channel) & 1)
+		{
+			maxBuffers[channel] = (int16_t*)bufferSet;
+			if (header->minBufferSize != 0)
+				minBuffers[channel] = (int16_t*)(bufferSet + maxBytes);
+
+			bufferSet += header->channelStride;
+		}
+	}
+}
+
+/****************************************************************************
+* capture_file_create
+*
+* Creates a capture file big enough for numberOfBuffers buffer sets and
+* returns buffer pointers into the mapping
+* Inputs:
+* - fileName
+* - GENERICUNIT* unit (enabled channels)
+* - BUFFER_SETTINGS bufferSettings (samples, downsampling and data type)
+* - numberOfBuffers
+* - windowSets: buffer sets mapped at once, 0 (or numberOfBuffers or more)
+*   to map the whole file. The first windowSets sets are mapped.
+* Outputs:
+* - captureFile
+* - Max Buffer, Min Buffer (3D pointer arrays as pico_create_multibuffers,
+*   one entry per window slot)
+* - MULTIBUFFERSIZES* multiBufferSizes
+* Returns:
+* - PICO_OK, PICO_NOT_FOUND if the file cannot be created, or PICO_MEMORY
+****************************************************************************/
+PICO_STATUS capture_file_create(CAPTURE_FILE* captureFile, const char* fileName, GENERICUNIT* unit,
+	BUFFER_SETTINGS bufferSettings, uint64_t numberOfBuffers, uint64_t windowSets,
+	int16_t**** minBuffers, int16_t**** maxBuffers, MULTIBUFFERSIZES* multiBufferSizes)
+{
+	PICO_STATUS status;
+	CAPTURE_FILE_HEADER header;
+	uint64_t maxBufferSize = 0;
+	uint64_t minBufferSize = 0;
+	uint64_t maxBytes;
+	uint64_t minBytes;
+	uint64_t capture;
+	int16_t nChannels = 0;
+	int16_t channel;
+	size_t sampleSize = pico_sample_size(bufferSettings.dataType);
+
+	memset(captureFile, 0, sizeof(CAPTURE_FILE));
+	memset(&header, 0, sizeof(CAPTURE_FILE_HEADER));
+
+	data_buffer_sizes(bufferSettings.downSampleRatioMode,
+		bufferSettings.downSampleRatio,
+		bufferSettings.nSamples,
+		&maxBufferSize,
+		&minBufferSize);
+
+	for (channel = 0; channel < unit->channelCount; channel++)
+	{
+		if (unit->channelSettings[channel].enabled)
+		{
+			header.channelFlags |= 1u << channel;
+			nChannels++;
+		}
+	}
+
+	maxBytes = alignUp(maxBufferSize * sampleSize, CAPTURE_FILE_ALIGNMENT);
+	minBytes = alignUp(minBufferSize * sampleSize, CAPTURE_FILE_ALIGNMENT);
+
+	header.magic = CAPTURE_FILE_MAGIC;
+	header.version = CAPTURE_FILE_VERSION;
+	header.headerSize = sizeof(CAPTURE_FILE_HEADER);
+	header.dataType = bufferSettings.dataType;
+	header.channelCount = unit->channelCount;
+	header.maxADCValue = unit->maxADCValue;
+	header.numberOfBuffers = numberOfBuffers;
+	header.maxBufferSize = maxBufferSize;
+	header.minBufferSize = minBufferSize;
+	header.channelStride = maxBytes + minBytes;
+	header.bufferSetSize = alignUp(header.channelStride * nChannels, CAPTURE_FILE_PAGE_SIZE);
+	header.dataOffset = alignUp(sizeof(CAPTURE_FILE_HEADER) + numberOfBuffers * sizeof(uint64_t), CAPTURE_FILE_PAGE_SIZE);
+	header.timeInterval = unit->timeInterval;
+
+	if (windowSets == 0 || windowSets > numberOfBuffers)
+		windowSets = numberOfBuffers;
+
+	// A windowed file only keeps the header mapped, the buffer sets are mapped below
+	if ((status = mapFile(captureFile, fileName, header.dataOffset + header.bufferSetSize * numberOfBuffers,
+		(windowSets < numberOfBuffers) ? header.dataOffset : 0, TRUE)) != PICO_OK)
+	{
+		printf("capture_file_create:mapFile ------ 0x%08lx \n", (unsigned long)status);
+		return status;
+	}
+
+	captureFile->header = (CAPTURE_FILE_HEADER*)captureFile->view;
+	captureFile->samplesInBuffer = (uint64_t*)(captureFile->view + sizeof(CAPTURE_FILE_HEADER));
+	captureFile->windowSets = windowSets;
+	*captureFile->header = header;
+
+	if (windowSets < numberOfBuffers)
+	{
+		captureFile->windowViews = (uint8_t**)calloc(windowSets, sizeof(uint8_t*));
+		captureFile->windowBuffers = (uint64_t*)calloc(windowSets, sizeof(uint64_t));
+
+		if (captureFile->windowViews == NULL || captureFile->windowBuffers == NULL)
+		{
+			printf("capture_file_create:calloc ------ 0x%08lx \n", (unsigned long)PICO_MEMORY);
+			capture_file_close(captureFile, NULL, NULL);
+			return PICO_MEMORY;
+		}
+	}
+
+	// Point the buffer arrays into the mapping
+	*minBuffers = (int16_t***)calloc(windowSets, sizeof(int16_t**));
+	*maxBuffers = (int16_t***)calloc(windowSets, sizeof(int16_t**));
+
+	if (*minBuffers == NULL || *maxBuffers == NULL)
+	{
+		printf("capture_file_create:calloc ------ 0x%08lx \n", (unsigned long)PICO_MEMORY);
+		free(*minBuffers);
+		free(*maxBuffers);
+		capture_file_close(captureFile, NULL, NULL);
+		return PICO_MEMORY;
+	}
+
+	for (capture = 0; capture < windowSets; capture++)
+	{
+		(*minBuffers)[capture] = (int16_t**)calloc(unit->channelCount, sizeof(int16_t*));
+		(*maxBuffers)[capture] = (int16_t**)calloc(unit->channelCount, sizeof(int16_t*));
+
+		if ((*minBuffers)[capture] == NULL || (*maxBuffers)[capture] == NULL)
+		{
+			printf("capture_file_create:calloc ------ 0x%08lx \n", (unsigned long)PICO_MEMORY);
+			capture_file_close(captureFile, *minBuffers, *maxBuffers);
+			return PICO_MEMORY;
+		}
+
+		if (captureFile->windowViews != NULL && (status = mapSlot(captureFile, capture, capture)) != PICO_OK)
+		{
+			printf("capture_file_create:mapSlot ------ 0x%08lx \n", (unsigned long)status);
+			capture_file_close(captureFile, *minBuffers, *maxBuffers);
+			return status;
+		}
+
+		setBufferPointers(captureFile, bufferSetAddress(captureFile, capture), (*minBuffers)[capture], (*maxBuffers)[capture]);
+	}
+
+	multiBufferSizes->numberOfBuffers = numberOfBuffers;
+	multiBufferSizes->maxBufferSize = maxBufferSize;
+	multiBufferSizes->minBufferSize = minBufferSize;
+	multiBufferSizes->dataType = bufferSettings.dataType;
+
+	return PICO_OK;
+}
+
+/****************************************************************************
+* capture_file_map_buffer
+*
+* Maps a buffer set of a windowed file into slot buffer % windowSets, in
+* place of the set mapped there before, and points the buffers of the slot
+* at it. Call it before passing the buffers of the set to SetDataBuffers,
+* once the driver and the host are both done with the set it replaces.
+* Nothing is remapped if the whole file is mapped.
+* Returns:
+* - PICO_OK, PICO_INVALID_PARAMETER or PICO_MEMORY
+****************************************************************************/
+PICO_STATUS capture_file_map_buffer(CAPTURE_FILE* captureFile, uint64_t buffer, int16_t*** minBuffers, int16_t*** maxBuffers)
+{
+	PICO_STATUS status;
+	uint64_t slot;
+
+	if (captureFile->readOnly || buffer >= captureFile->header->numberOfBuffers)
+		return PICO_INVALID_PARAMETER;
+
+	if (captureFile->windowViews == NULL)
+		return PICO_OK;
+
+	slot = buffer % captureFile->windowSets;
+	if (captureFile->windowViews[slot] != NULL && captureFile->windowBuffers[slot] == buffer)
+		return PICO_OK;
+
+	if ((status = mapSlot(captureFile, slot, buffer)) != PICO_OK)
+		return status;
+
+	setBufferPointers(captureFile, captureFile->windowViews[slot], minBuffers[slot], maxBuffers[slot]);
+	return PICO_OK;
+}
+
+/****************************************************************************
+* capture_file_open
+*
+* Maps an existing capture file read only
+* Returns:
+* - PICO_OK, PICO_NOT_FOUND, PICO_MEMORY or PICO_INVALID_PARAMETER
+*   if the file is not a capture file
+****************************************************************************/
+PICO_STATUS capture_file_open(CAPTURE_FILE* captureFile, const char* fileName)
+{
+	PICO_STATUS status;
+	CAPTURE_FILE_HEADER* header;
+
+	memset(captureFile, 0, sizeof(CAPTURE_FILE));
+	captureFile->readOnly = TRUE;
+
+	if ((status = mapFile(captureFile, fileName, 0, 0, FALSE)) != PICO_OK)
+		return status;
+
+	header = (CAPTURE_FILE_HEADER*)captureFile->view;
+
+	if (captureFile->size < sizeof(CAPTURE_FILE_HEADER) ||
+		header->magic != CAPTURE_FILE_MAGIC ||
+		header->version != CAPTURE_FILE_VERSION ||
+		header->dataOffset + header->bufferSetSize * header->numberOfBuffers > captureFile->size)
+	{
+		capture_file_close(captureFile, NULL, NULL);
+		return PICO_INVALID_PARAMETER;
+	}
+
+	captureFile->header = header;
+	captureFile->samplesInBuffer = (uint64_t*)(captureFile->view + sizeof(CAPTURE_FILE_HEADER));
+	captureFile->windowSets = header->numberOfBuffers;
+	return PICO_OK;
+}
+
+/****************************************************************************
+* capture_file_set_samples
+*
+* Records the number of valid samples in a buffer set
+****************************************************************************/
+void capture_file_set_samples(CAPTURE_FILE* captureFile, uint64_t buffer, uint64_t nSamples)
+{
+	if (captureFile->readOnly || buffer >= captureFile->header->numberOfBuffers)
+		return;
+
+	captureFile->samplesInBuffer[buffer] = nSamples;
+}
+
+/****************************************************************************
+* capture_file_flush
+*
+* Starts writing a completed buffer set to disk without waiting
+****************************************************************************/
+PICO_STATUS capture_file_flush(CAPTURE_FILE* captureFile, uint64_t buffer)
+{
+	uint8_t* start;
+
+	if (captureFile->readOnly || (start = bufferSetAddress(captureFile, buffer)) == NULL)
+		return PICO_INVALID_PARAMETER;
+
+#ifdef _WIN32
+	if (!FlushViewOfFile(start, (SIZE_T)captureFile->header->bufferSetSize))
+		return PICO_MEMORY;
+#else
+	if (msync(start, (size_t)captureFile->header->bufferSetSize, MS_ASYNC) != 0)
+		return PICO_MEMORY;
+#endif
+	return PICO_OK;
+}
+
+/****************************************************************************
+* capture_file_buffer
+*
+* Returns a channel buffer of a buffer set, or NULL if the channel was
+* not enabled. Read the samples with pico_buffer_value.
+* Inputs:
+* - minBuffer: 1 = min buffer, 0 = max buffer
+****************************************************************************/
+int16_t* capture_file_buffer(CAPTURE_FILE* captureFile, uint64_t buffer, int16_t channel, int16_t minBuffer)
+{
+	CAPTURE_FILE_HEADER* header = captureFile->header;
+	uint8_t* bufferSet;
+	int16_t ch;
+
+	if (channel < 0 || channel >= header->channelCount ||
+		!((header->channelFlags >> channel) & 1) || (minBuffer && header->minBufferSize == 0) ||
+		(bufferSet = bufferSetAddress(captureFile, buffer)) == NULL)
+	{
+		return NULL;
+	}
+
+	for (ch = 0; ch < channel; ch++)
+	{
+		if ((header->channelFlags >> ch) & 1)
+			bufferSet += header->channelStride;
+	}
+
+	if (minBuffer)
+		bufferSet += alignUp(header->maxBufferSize * pico_sample_size((PICO_DATA_TYPE)header->dataType), CAPTURE_FILE_ALIGNMENT);
+
+	return (int16_t*)bufferSet;
+}
+
+/****************************************************************************
+* capture_file_close
+*
+* Flushes and unmaps the file. Frees the buffer pointer arrays returned by
+* capture_file_create (pass NULL for files opened with capture_file_open).
+* Release the buffers from the driver before calling this.
+****************************************************************************/
+void capture_file_close(CAPTURE_FILE* captureFile, int16_t*** minBuffers, int16_t*** maxBuffers)
+{
+	uint64_t capture;
+
+	if (captureFile->view == NULL)
+		return;
+
+	if (minBuffers != NULL && maxBuffers != NULL)
+	{
+		for (capture = 0; capture < captureFile->windowSets; capture++)
+		{
+			free(maxBuffers[capture]);
+			free(minBuffers[capture]);
+		}
+		free(maxBuffers);
+		free(minBuffers);
+	}
+
+	if (captureFile->windowViews != NULL)
+	{
+		for (capture = 0; capture < captureFile->windowSets; capture++)
+		{
+			if (captureFile->windowViews[capture] != NULL)
+				unmapView(captureFile, captureFile->windowViews[capture], captureFile->header->bufferSetSize);
+		}
+		free(captureFile->windowViews);
+	}
+	free(captureFile->windowBuffers);
+
+	unmapView(captureFile, captureFile->view, captureFile->viewSize);
+#ifdef _WIN32
+	CloseHandle(captureFile->mapping);
+	CloseHandle(captureFile->file);
+#else
+	close(captureFile->fd);
+#endif
+
+	memset(captureFile, 0, sizeof(CAPTURE_FILE));
+}
@@ -0,0 +1,90 @@
+/****************************************************************************
+ *
+ * Filename:    PicoCaptureFile.h
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This header defines memory-mapped capture files for PicoScope data.
+ * Buffer sets are carved from a preallocated file mapping and passed
+ * straight to SetDataBuffers, so the driver writes samples into
+ * file-backed memory and the operating system flushes them to disk.
+ *
+ * A file can be mapped whole, or through a window of a few buffer sets
+ * that is moved along the file as the capture advances, so the address
+ * space used does not grow with the length of the capture.
+ *
+ ****************************************************************************/
+#ifndef __PICOCAPTUREFILE_H__
+#define __PICOCAPTUREFILE_H__
+
+#include "./PicoBuffers.h"
+
+#define CAPTURE_FILE_MAGIC		0x46435050	// "PPCF"
+#define CAPTURE_FILE_VERSION	1
+// Alignment of the data area and of each channel buffer in the file.
+// Buffer sets are mapped on their own, so this is the Windows allocation
+// granularity (which also covers the page size on Linux).
+#define CAPTURE_FILE_PAGE_SIZE	65536
+#define CAPTURE_FILE_ALIGNMENT	64
+
+// File layout:
+// CAPTURE_FILE_HEADER
+// uint64_t samplesInBuffer[numberOfBuffers]	(valid samples per buffer set)
+// Data area at dataOffset, one block of bufferSetSize bytes per buffer set.
+// Each block holds the max buffer then the min buffer (if minBufferSize != 0)
+// of every enabled channel, lowest channel first.
+typedef struct tCaptureFileHeader
+{
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	headerSize;
+	uint32_t	channelFlags;		// Enabled channels (bit 0 = channel A)
+	int32_t		dataType;			// PICO_DATA_TYPE of the samples
+	int16_t		channelCount;
+	int16_t		maxADCValue;
+	uint64_t	numberOfBuffers;
+	uint64_t	maxBufferSize;		// Samples per channel max buffer
+	uint64_t	minBufferSize;		// Samples per channel min buffer (0 if not used)
+	uint64_t	channelStride;		// Bytes from one channel's max buffer to the next
+	uint64_t	bufferSetSize;		// Bytes per buffer set
+	uint64_t	dataOffset;			// Bytes from the start of the file to buffer set 0
+	double		timeInterval;		// Seconds between the values in the buffers
+}CAPTURE_FILE_HEADER;
+
+typedef struct tCaptureFile
+{
+	CAPTURE_FILE_HEADER*	header;
+	uint64_t*				samplesInBuffer;
+	uint8_t*				view;		// Start of the mapping
+	uint64_t				size;		// Size of the file in bytes
+	uint64_t				viewSize;	// Size of the mapping at view in bytes
+	int16_t					readOnly;
+	// Windowed files map the header at view and each buffer set in its own slot
+	uint64_t				windowSets;		// Buffer sets mapped at once (numberOfBuffers if the whole file is mapped)
+	uint8_t**				windowViews;	// Mapping of each slot, NULL if the whole file is mapped
+	uint64_t*				windowBuffers;	// Buffer set mapped in each slot
+#ifdef _WIN32
+	HANDLE					file;
+	HANDLE					mapping;
+#else
+	int						fd;
+#endif
+}CAPTURE_FILE;
+
+// Function prototypes
+PICO_STATUS capture_file_create(CAPTURE_FILE* captureFile, const char* fileName, GENERICUNIT* unit,
+	BUFFER_SETTINGS bufferSettings, uint64_t numberOfBuffers, uint64_t windowSets,
+	int16_t**** minBuffers, int16_t**** maxBuffers, MULTIBUFFERSIZES* multiBufferSizes);
+
+PICO_STATUS capture_file_map_buffer(CAPTURE_FILE* captureFile, uint64_t buffer, int16_t*** minBuffers, int16_t*** maxBuffers);
+
+PICO_STATUS capture_file_open(CAPTURE_FILE* captureFile, const char* fileName);
+
+void capture_file_set_samples(CAPTURE_FILE* captureFile, uint64_t buffer, uint64_t nSamples);
+PICO_STATUS capture_file_flush(CAPTURE_FILE* captureFile, uint64_t buffer);
+
+int16_t* capture_file_buffer(CAPTURE_FILE* captureFile, uint64_t buffer, int16_t channel, int16_t minBuffer);
+
+void capture_file_close(CAPTURE_FILE* captureFile, int16_t*** minBuffers, int16_t*** maxBuffers);
+
+#endif
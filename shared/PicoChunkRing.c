@@ -0,0 +1,343 @@
+/****************************************************************************
+ *
+ * Filename:    PicoChunkRing.c
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This file defines a chunked host ring for continuous streaming.
+ * The producer (the streaming callback) only takes the lock when a
+ * chunk is full. The writer thread saves the interleaved 16-bit samples
+ * of each chunk to a binary file and returns the chunk to a free list.
+ *
+ ****************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include "./PicoChunkRing.h"
+
+/* Headers for Windows */
+#ifdef _WIN32
+#define ringLock(r)		EnterCriticalSection(&(r)->lock)
+#define ringUnlock(r)	LeaveCriticalSection(&(r)->lock)
+#define ringWait(r)		SleepConditionVariableCS(&(r)->ready, &(r)->lock, INFINITE)
+#define ringSignal(r)	WakeConditionVariable(&(r)->ready)
+#else
+#define ringLock(r)		pthread_mutex_lock(&(r)->lock)
+#define ringUnlock(r)	pthread_mutex_unlock(&(r)->lock)
+#define ringWait(r)		pthread_cond_wait(&(r)->ready, &(r)->lock)
+#define ringSignal(r)	pthread_cond_signal(&(r)->ready)
+#endif
+
+/****************************************************************************
+* getChunk
+*
+* Returns a free chunk, allocating a new one if none can be reused.
+* Must be called with the lock held.
+****************************************************************************/
+static RING_CHUNK* getChunk(CHUNK_RING* ring)
+{
+	RING_CHUNK* chunk = ring->freeList;
+
+	if (chunk != NULL)
+	{
+		ring->freeList = chunk->next;
+	}
+	else
+	{
+		if (ring->maxChunks != 0 && ring->nChunks >= ring->maxChunks)
+			return NULL;
+
+		chunk = (RING_CHUNK*)malloc(sizeof(RING_CHUNK) + (size_t)CHUNK_RING_SAMPLES * ring->nChannels * sizeof(int16_t));
+
+		if (chunk == NULL)
+			return NULL;
+
+		chunk->data = (int16_t*)(chunk + 1);
+		ring->nChunks++;
+	}
+
+	chunk->next = NULL;
+	chunk->nSamples = 0;
+	return chunk;
+}
+
+/****************************************************************************
+* queueChunk
+*
+* Adds a filled chunk to the write queue. Must be called with the lock held.
+****************************************************************************/
+static void queueChunk(CHUNK_RING* ring, RING_CHUNK* chunk)
+{
+	chunk->next = NULL;
+
+	if (ring->tail != NULL)
+		ring->tail->next = chunk;
+	else
+		ring->head = chunk;
+
+	ring->tail = chunk;
+	ring->nQueued++;
+
+	if (ring->nQueued > ring->peakQueued)
+		ring->peakQueued = ring->nQueued;
+
+	ringSignal(ring);
+}
+
+/****************************************************************************
+* writerThread
+*
+* Writes queued chunks to the file until the ring is closed and empty
+****************************************************************************/
+#ifdef _WIN32
+static DWORD WINAPI writerThread(LPVOID parameter)
+#else
+static void* writerThread(void* parameter)
+#endif
+{
+	CHUNK_RING* ring = (CHUNK_RING*)parameter;
+	RING_CHUNK* chunk;
+	size_t nValues;
+
+	ringLock(ring);
+
+	for (;;)
+	{
+		while (ring->head == NULL && !ring->stop)
+			ringWait(ring);
+
+		if (ring->head == NULL)
+			break;
+
+		chunk = ring->head;
+		ring->head = chunk->next;
+		if (ring->head == NULL)
+			ring->tail = NULL;
+
+		ringUnlock(ring);
+
+		nValues = (size_t)chunk->nSamples * ring->nChannels;
+
+		if (!ring->writeError && fwrite(chunk->data, sizeof(int16_t), nValues, ring->fp) != nValues)
+		{
+			printf("chunk_ring:fwrite ------ write error, later samples are discarded\n");
+			ring->writeError = 1;
+		}
+
+		ringLock(ring);
+
+		ring->nQueued--;
+		if (!ring->writeError)
+			ring->samplesWritten += chunk->nSamples;
+
+		chunk->next = ring->freeList;
+		ring->freeList = chunk;
+	}
+
+	ringUnlock(ring);
+	return 0;
+}
+
+/****************************************************************************
+* chunk_ring_open
+*
+* Creates the file and starts the writer thread
+* Inputs:
+* - fileName: binary file of interleaved int16_t samples
+* - nChannels: values per sample (max. CHUNK_RING_MAX_CHANNELS)
+* - maxChunks: memory limit in chunks, 0 for no limit. Samples are
+*   dropped (and counted) when the limit is reached.
+* Returns:
+* - 1 on success, 0 on failure
+****************************************************************************/
+int16_t chunk_ring_open(CHUNK_RING* ring, const char* fileName, int16_t nChannels, uint64_t maxChunks)
+{
+	memset(ring, 0, sizeof(CHUNK_RING));
+
+	if (nChannels <= 0 || nChannels > CHUNK_RING_MAX_CHANNELS)
+		return 0;
+
+	ring->nChannels = nChannels;
+	ring->maxChunks = maxChunks;
+
+#ifdef _WIN32
+	fopen_s(&ring->fp, fileName, "wb");
+#else
+	ring->fp = fopen(fileName, "wb");
+#endif
+
+	if (ring->fp == NULL)
+	{
+		printf("chunk_ring_open:fopen ------ cannot create %s\n", fileName);
+		return 0;
+	}
+
+	ring->filling = getChunk(ring);
+
+	if (ring->filling == NULL)
+	{
+		fclose(ring->fp);
+		return 0;
+	}
+
+#ifdef _WIN32
+	InitializeCriticalSection(&ring->lock);
+	InitializeConditionVariable(&ring->ready);
+	ring->thread = CreateThread(NULL, 0, writerThread, ring, 0, NULL);
+
+	if (ring->thread == NULL)
+	{
+		printf("chunk_ring_open:CreateThread ------ 0x%08lx \n", GetLastError());
+		DeleteCriticalSection(&ring->lock);
+		free(ring->filling);
+		fclose(ring->fp);
+		return 0;
+	}
+#else
+	pthread_mutex_init(&ring->lock, NULL);
+	pthread_cond_init(&ring->ready, NULL);
+
+	if (pthread_create(&ring->thread, NULL, writerThread, ring) != 0)
+	{
+		printf("chunk_ring_open:pthread_create ------ failed\n");
+		pthread_cond_destroy(&ring->ready);
+		pthread_mutex_destroy(&ring->lock);
+		free(ring->filling);
+		fclose(ring->fp);
+		return 0;
+	}
+#endif
+	return 1;
+}
+
+/****************************************************************************
+* chunk_ring_append
+*
+* Copies samples into the ring. Call from the streaming callback.
+* Inputs:
+* - channelBuffers: one buffer per channel, NULL writes zeros
+* - nSamples: samples per channel
+* Returns:
+* - 1 if all samples were stored, 0 if some were dropped
+****************************************************************************/
+int16_t chunk_ring_append(CHUNK_RING* ring, int16_t** channelBuffers, uint32_t nSamples)
+{
+	RING_CHUNK* chunk;
+	uint32_t done = 0;
+	uint32_t n;
+	uint32_t i;
+	int16_t* out;
+	int16_t ch;
+
+	while (done < nSamples)
+	{
+		if (ring->filling == NULL)
+		{
+			// The limit was reached earlier, see if the writer has freed a chunk
+			ringLock(ring);
+			ring->filling = getChunk(ring);
+			ringUnlock(ring);
+
+			if (ring->filling == NULL)
+			{
+				ring->samplesDropped += nSamples - done;
+				return 0;
+			}
+		}
+
+		chunk = ring->filling;
+		n = CHUNK_RING_SAMPLES - chunk->nSamples;
+		if (n > nSamples - done)
+			n = nSamples - done;
+
+		out = chunk->data + (size_t)chunk->nSamples * ring->nChannels;
+
+		for (i = 0; i < n; i++)
+		{
+			for (ch = 0; ch < ring->nChannels; ch++)
+			{
+				*out++ = channelBuffers[ch] ? channelBuffers[ch][done + i] : 0;
+			}
+		}
+
+		chunk->nSamples += n;
+		done += n;
+		ring->samplesAppended += n;
+
+		if (chunk->nSamples == CHUNK_RING_SAMPLES)
+		{
+			ringLock(ring);
+			queueChunk(ring, chunk);
+			ring->filling = getChunk(ring);
+			ringUnlock(ring);
+		}
+	}
+	return 1;
+}
+
+/****************************************************************************
+* chunk_ring_status
+*
+* Outputs:
+* - samplesWritten: samples per channel saved to the file
+* - nQueued: full chunks waiting for the writer
+* - nChunks: chunks allocated
+****************************************************************************/
+void chunk_ring_status(CHUNK_RING* ring, uint64_t* samplesWritten, uint64_t* nQueued, uint64_t* nChunks)
+{
+	ringLock(ring);
+	*samplesWritten = ring->samplesWritten;
+	*nQueued = ring->nQueued;
+	*nChunks = ring->nChunks;
+	ringUnlock(ring);
+}
+
+/****************************************************************************
+* chunk_ring_close
+*
+* Queues the partly filled chunk, waits for the writer to save everything
+* and frees the ring. The counters stay valid after the call.
+****************************************************************************/
+void chunk_ring_close(CHUNK_RING* ring)
+{
+	RING_CHUNK* chunk;
+
+	ringLock(ring);
+
+	if (ring->filling != NULL)
+	{
+		if (ring->filling->nSamples > 0)
+		{
+			queueChunk(ring, ring->filling);
+		}
+		else
+		{
+			ring->filling->next = ring->freeList;
+			ring->freeList = ring->filling;
+		}
+		ring->filling = NULL;
+	}
+
+	ring->stop = 1;
+	ringSignal(ring);
+	ringUnlock(ring);
+
+#ifdef _WIN32
+	WaitForSingleObject(ring->thread, INFINITE);
+	CloseHandle(ring->thread);
+	DeleteCriticalSection(&ring->lock);
+#else
+	pthread_join(ring->thread, NULL);
+	pthread_cond_destroy(&ring->ready);
+	pthread_mutex_destroy(&ring->lock);
+#endif
+
+	while (ring->freeList != NULL)
+	{
+		chunk = ring->freeList;
+		ring->freeList = chunk->next;
+		free(chunk);
+	}
+
+	fclose(ring->fp);
+	ring->fp = NULL;
+}
@@ -0,0 +1,74 @@
+/****************************************************************************
+ *
+ * Filename:    PicoChunkRing.h
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This header defines a chunked host ring for continuous streaming.
+ * The streaming callback appends samples to fixed size chunks, which are
+ * allocated on demand, and a writer thread drains completed chunks to
+ * disk. Written chunks are reused, so memory only grows while the disk
+ * is slower than the device.
+ *
+ * The functions return 1 on success and 0 on failure (like the ps2000
+ * driver) so the ring does not depend on PicoStatus.h.
+ *
+ ****************************************************************************/
+#ifndef __PICOCHUNKRING_H__
+#define __PICOCHUNKRING_H__
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* Headers for Windows */
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#define CHUNK_RING_SAMPLES		65536	// Samples per channel in each chunk
+#define CHUNK_RING_MAX_CHANNELS	8
+
+typedef struct tRingChunk
+{
+	struct tRingChunk*	next;
+	uint32_t			nSamples;	// Samples per channel in the chunk
+	int16_t*			data;		// Interleaved, nChannels values per sample
+}RING_CHUNK;
+
+typedef struct tChunkRing
+{
+	int16_t			nChannels;
+	uint64_t		maxChunks;		// 0 for no limit
+	FILE*			fp;
+	RING_CHUNK*		filling;		// Only used by the producer
+	RING_CHUNK*		head;			// Oldest chunk waiting to be written
+	RING_CHUNK*		tail;
+	RING_CHUNK*		freeList;
+	uint64_t		nChunks;		// Chunks allocated
+	uint64_t		nQueued;
+	uint64_t		peakQueued;
+	uint64_t		samplesAppended;
+	uint64_t		samplesWritten;
+	uint64_t		samplesDropped;
+	int16_t			stop;
+	int16_t			writeError;
+#ifdef _WIN32
+	CRITICAL_SECTION	lock;
+	CONDITION_VARIABLE	ready;
+	HANDLE				thread;
+#else
+	pthread_mutex_t		lock;
+	pthread_cond_t		ready;
+	pthread_t			thread;
+#endif
+}CHUNK_RING;
+
+// Function prototypes
+int16_t chunk_ring_open(CHUNK_RING* ring, const char* fileName, int16_t nChannels, uint64_t maxChunks);
+int16_t chunk_ring_append(CHUNK_RING* ring, int16_t** channelBuffers, uint32_t nSamples);
+void chunk_ring_status(CHUNK_RING* ring, uint64_t* samplesWritten, uint64_t* nQueued, uint64_t* nChunks);
+void chunk_ring_close(CHUNK_RING* ring);
+
+#endif
@@ -0,0 +1,382 @@
+/****************************************************************************
+ *
+ * Filename:    PicoDigital.c
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This file defines a packed store for MSO digital ports with a per-line
+ * transition index. The index is built as samples are appended: eight
+ * packed samples are compared at a time and only words that contain a
+ * change are examined bit by bit.
+ *
+ ****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "./PicoDigital.h"
+
+/****************************************************************************
+* levelAfter
+*
+* Level of a line from transition k up to the next transition
+****************************************************************************/
+static int16_t levelAfter(DIGITAL_TRANSITIONS* line, uint64_t k)
+{
+	return (int16_t)(line->initialLevel ^ ((k & 1) ? 0 : 1));
+}
+
+/****************************************************************************
+* addTransition
+****************************************************************************/
+static PICO_STATUS addTransition(DIGITAL_TRANSITIONS* line, uint64_t sample)
+{
+	uint64_t* transitions;
+	uint64_t capacity;
+
+	if (line->count == line->capacity)
+	{
+		capacity = line->capacity ? line->capacity * 2 : 256;
+		transitions = (uint64_t*)realloc(line->transitions, (size_t)capacity * sizeof(uint64_t));
+
+		if (transitions == NULL)
+			return PICO_MEMORY;
+
+		line->transitions = transitions;
+		line->capacity = capacity;
+	}
+
+	line->transitions[line->count++] = sample;
+	return PICO_OK;
+}
+
+/****************************************************************************
+* indexPort
+*
+* Adds the transitions of one port for samples [first, last)
+****************************************************************************/
+static PICO_STATUS indexPort(DIGITAL_STORE* store, int16_t port, uint64_t first, uint64_t last)
+{
+	PICO_STATUS status;
+	uint8_t* data = store->ports[port];
+	uint64_t current;
+	uint64_t previous;
+	uint64_t i = first;
+	uint64_t end;
+	uint8_t diff;
+	int16_t bit;
+
+	while (i < last)
+	{
+		// Skip runs of 8 samples with no change in any line of the port
+		if (i + 8 <= last)
+		{
+			memcpy(&current, data + i, sizeof(uint64_t));
+			memcpy(&previous, data + i - 1, sizeof(uint64_t));
+
+			if (current == previous)
+			{
+				i += 8;
+				continue;
+			}
+			end = i + 8;
+		}
+		else
+		{
+			end = last;
+		}
+
+		for (; i < end; i++)
+		{
+			diff = data[i] ^ data[i - 1];
+
+			for (bit = 0; diff != 0; bit++, diff >>= 1)
+			{
+				if (diff & 1)
+				{
+					if ((status = addTransition(&store->lines[port * DIGITAL_LINES_PER_PORT + bit], i)) != PICO_OK)
+						return status;
+				}
+			}
+		}
+	}
+	return PICO_OK;
+}
+
+/****************************************************************************
+* findTransition
+*
+* Returns the index of the first transition at or after sample
+****************************************************************************/
+static uint64_t findTransition(DIGITAL_TRANSITIONS* line, uint64_t sample)
+{
+	uint64_t low = 0;
+	uint64_t high = line->count;
+	uint64_t mid;
+
+	while (low < high)
+	{
+		mid = low + (high - low) / 2;
+
+		if (line->transitions[mid] < sample)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	return low;
+}
+
+/****************************************************************************
+* digital_store_init
+*
+* Inputs:
+* - nPorts: number of digital ports (max. DIGITAL_MAX_PORTS)
+* - capacity: initial size in samples, the store grows as needed
+****************************************************************************/
+PICO_STATUS digital_store_init(DIGITAL_STORE* store, int16_t nPorts, uint64_t capacity)
+{
+	int16_t port;
+
+	memset(store, 0, sizeof(DIGITAL_STORE));
+
+	if (nPorts <= 0 || nPorts > DIGITAL_MAX_PORTS)
+		return PICO_INVALID_PARAMETER;
+
+	store->nPorts = nPorts;
+	store->capacity = capacity ? capacity : 1024;
+
+	for (port = 0; port < nPorts; port++)
+	{
+		store->ports[port] = (uint8_t*)malloc((size_t)store->capacity);
+
+		if (store->ports[port] == NULL)
+		{
+			digital_store_free(store);
+			return PICO_MEMORY;
+		}
+	}
+	return PICO_OK;
+}
+
+/****************************************************************************
+* digital_store_free
+****************************************************************************/
+void digital_store_free(DIGITAL_STORE* store)
+{
+	int16_t i;
+
+	for (i = 0; i < DIGITAL_MAX_PORTS; i++)
+	{
+		free(store->ports[i]);
+	}
+
+	for (i = 0; i < DIGITAL_MAX_LINES; i++)
+	{
+		free(store->lines[i].transitions);
+	}
+	memset(store, 0, sizeof(DIGITAL_STORE));
+}
+
+/****************************************************************************
+* digital_store_reset
+*
+* Discards all samples and transitions, keeping the memory
+****************************************************************************/
+void digital_store_reset(DIGITAL_STORE* store)
+{
+	int16_t line;
+
+	store->nSamples = 0;
+
+	for (line = 0; line < DIGITAL_MAX_LINES; line++)
+	{
+		store->lines[line].count = 0;
+		store->lines[line].initialLevel = 0;
+	}
+}
+
+/****************************************************************************
+* digital_store_append
+*
+* Packs the next samples of each port and indexes their transitions
+* Inputs:
+* - portBuffers: one driver buffer per port (the lower 8 bits hold the
+*   port data), NULL for a port that is off
+* - nSamples
+****************************************************************************/
+PICO_STATUS digital_store_append(DIGITAL_STORE* store, int16_t** portBuffers, uint32_t nSamples)
+{
+	PICO_STATUS status;
+	uint64_t first = store->nSamples;
+	uint64_t capacity;
+	uint64_t i;
+	uint8_t* data;
+	int16_t port;
+	int16_t bit;
+
+	if (nSamples == 0)
+		return PICO_OK;
+
+	if (first + nSamples > store->capacity)
+	{
+		capacity = store->capacity;
+		while (capacity < first + nSamples)
+			capacity *= 2;
+
+		for (port = 0; port < store->nPorts; port++)
+		{
+			data = (uint8_t*)realloc(store->ports[port], (size_t)capacity);
+
+			if (data == NULL)
+				return PICO_MEMORY;
+
+			store->ports[port] = data;
+		}
+		store->capacity = capacity;
+	}
+
+	for (port = 0; port < store->nPorts; port++)
+	{
+		data = store->ports[port] + first;
+
+		for (i = 0; i < nSamples; i++)
+		{
+			data[i] = portBuffers[port] ? (uint8_t)(portBuffers[port][i] & 0xff) : 0;
+		}
+
+		if (first == 0)
+		{
+			for (bit = 0; bit < DIGITAL_LINES_PER_PORT; bit++)
+			{
+				store->lines[port * DIGITAL_LINES_PER_PORT + bit].initialLevel = (data[0] >> bit) & 1;
+			}
+		}
+
+		if ((status = indexPort(store, port, first ? first : 1, first + nSamples)) != PICO_OK)
+			return status;
+	}
+
+	store->nSamples += nSamples;
+	return PICO_OK;
+}
+
+/****************************************************************************
+* digital_store_value
+*
+* Returns all lines of one sample, line 0 in bit 0 (port 1 in bits 8 - 15)
+****************************************************************************/
+uint32_t digital_store_value(DIGITAL_STORE* store, uint64_t sample)
+{
+	uint32_t value = 0;
+	int16_t port;
+
+	for (port = 0; port < store->nPorts; port++)
+	{
+		value |= (uint32_t)store->ports[port][sample] << (port * DIGITAL_LINES_PER_PORT);
+	}
+	return value;
+}
+
+/****************************************************************************
+* digital_line_level
+****************************************************************************/
+int16_t digital_line_level(DIGITAL_STORE* store, int16_t line, uint64_t sample)
+{
+	return (store->ports[line / DIGITAL_LINES_PER_PORT][sample] >> (line % DIGITAL_LINES_PER_PORT)) & 1;
+}
+
+/****************************************************************************
+* digital_find_edge
+*
+* Finds the first edge of a line at or after fromSample
+* Outputs:
+* - edgeSample: first sample with the new level
+* Returns:
+* - PICO_OK, or PICO_NOT_FOUND if there is no such edge
+****************************************************************************/
+PICO_STATUS digital_find_edge(DIGITAL_STORE* store, int16_t line, uint64_t fromSample, DIGITAL_EDGE edge, uint64_t* edgeSample)
+{
+	DIGITAL_TRANSITIONS* transitions;
+	uint64_t k;
+
+	if (line < 0 || line >= store->nPorts * DIGITAL_LINES_PER_PORT)
+		return PICO_INVALID_PARAMETER;
+
+	transitions = &store->lines[line];
+
+	// Rising and falling edges alternate, so at most two are checked
+	for (k = findTransition(transitions, fromSample); k < transitions->count; k++)
+	{
+		if (edge == DIGITAL_EDGE_EITHER || (edge == DIGITAL_EDGE_RISING) == (levelAfter(transitions, k) == 1))
+		{
+			*edgeSample = transitions->transitions[k];
+			return PICO_OK;
+		}
+	}
+	return PICO_NOT_FOUND;
+}
+
+/****************************************************************************
+* digital_line_timing
+*
+* Counts the edges and measures the pulse widths of one line
+****************************************************************************/
+PICO_STATUS digital_line_timing(DIGITAL_STORE* store, int16_t line, DIGITAL_TIMING* timing)
+{
+	DIGITAL_TRANSITIONS* transitions;
+	uint64_t width;
+	uint64_t start = 0;
+	uint64_t end;
+	uint64_t k;
+	int16_t level;
+
+	memset(timing, 0, sizeof(DIGITAL_TIMING));
+
+	if (line < 0 || line >= store->nPorts * DIGITAL_LINES_PER_PORT)
+		return PICO_INVALID_PARAMETER;
+
+	transitions = &store->lines[line];
+	level = transitions->initialLevel;
+
+	// Segment k runs from transition k - 1 to transition k
+	for (k = 0; k <= transitions->count; k++)
+	{
+		end = (k < transitions->count) ? transitions->transitions[k] : store->nSamples;
+		width = end - start;
+
+		if (level)
+			timing->highSamples += width;
+
+		// The first and last segments are not complete pulses
+		if (k > 0 && k < transitions->count)
+		{
+			if (level)
+			{
+				if (timing->highPulses == 0 || width < timing->minHigh)
+					timing->minHigh = width;
+				if (width > timing->maxHigh)
+					timing->maxHigh = width;
+				timing->highPulses++;
+			}
+			else
+			{
+				if (timing->lowPulses == 0 || width < timing->minLow)
+					timing->minLow = width;
+				if (width > timing->maxLow)
+					timing->maxLow = width;
+				timing->lowPulses++;
+			}
+		}
+
+		if (k < transitions->count)
+		{
+			if (levelAfter(transitions, k))
+				timing->risingEdges++;
+			else
+				timing->fallingEdges++;
+
+			level = !level;
+		}
+		start = end;
+	}
+	return PICO_OK;
+}
@@ -0,0 +1,80 @@
+/****************************************************************************
+ *
+ * Filename:    PicoDigital.h
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This header defines a packed store for MSO digital ports. Each port
+ * sample is kept as one byte (8 lines per byte) instead of an int16_t,
+ * and each line has an index of the samples where it changes level, so
+ * edge searches and pulse timing work on transitions instead of samples.
+ *
+ ****************************************************************************/
+#ifndef __PICODIGITAL_H__
+#define __PICODIGITAL_H__
+
+#include <stdint.h>
+
+/* PicoStatus.h of the driver being built, from its include directory (AM_CPPFLAGS on Linux) */
+#ifndef PICO_OK
+#include "PicoStatus.h"
+#endif
+
+#define DIGITAL_MAX_PORTS		4
+#define DIGITAL_LINES_PER_PORT	8
+#define DIGITAL_MAX_LINES		(DIGITAL_MAX_PORTS * DIGITAL_LINES_PER_PORT)
+
+typedef enum enDigitalEdge
+{
+	DIGITAL_EDGE_RISING,
+	DIGITAL_EDGE_FALLING,
+	DIGITAL_EDGE_EITHER
+}DIGITAL_EDGE;
+
+// Samples at which a line changes level. Sample transitions[k] is the
+// first sample with the new level.
+typedef struct tDigitalTransitions
+{
+	uint64_t*	transitions;
+	uint64_t	count;
+	uint64_t	capacity;
+	uint8_t		initialLevel;	// Level of sample 0
+}DIGITAL_TRANSITIONS;
+
+typedef struct tDigitalStore
+{
+	int16_t				nPorts;
+	uint64_t			nSamples;
+	uint64_t			capacity;
+	uint8_t*			ports[DIGITAL_MAX_PORTS];	// Bit n is line (port * 8 + n)
+	DIGITAL_TRANSITIONS	lines[DIGITAL_MAX_LINES];
+}DIGITAL_STORE;
+
+// Pulse timing of one line in samples. Only complete pulses are measured.
+typedef struct tDigitalTiming
+{
+	uint64_t	risingEdges;
+	uint64_t	fallingEdges;
+	uint64_t	highPulses;
+	uint64_t	minHigh;
+	uint64_t	maxHigh;
+	uint64_t	lowPulses;
+	uint64_t	minLow;
+	uint64_t	maxLow;
+	uint64_t	highSamples;	// Samples at high level, for the duty cycle
+}DIGITAL_TIMING;
+
+// Function prototypes
+PICO_STATUS digital_store_init(DIGITAL_STORE* store, int16_t nPorts, uint64_t capacity);
+void digital_store_free(DIGITAL_STORE* store);
+void digital_store_reset(DIGITAL_STORE* store);
+
+PICO_STATUS digital_store_append(DIGITAL_STORE* store, int16_t** portBuffers, uint32_t nSamples);
+
+uint32_t digital_store_value(DIGITAL_STORE* store, uint64_t sample);
+int16_t digital_line_level(DIGITAL_STORE* store, int16_t line, uint64_t sample);
+
+PICO_STATUS digital_find_edge(DIGITAL_STORE* store, int16_t line, uint64_t fromSample, DIGITAL_EDGE edge, uint64_t* edgeSample);
+PICO_STATUS digital_line_timing(DIGITAL_STORE* store, int16_t line, DIGITAL_TIMING* timing);
+
+#endif
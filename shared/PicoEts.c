@@ -0,0 +1,349 @@
+/****************************************************************************
+ *
+ * Filename:    PicoEts.c
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This file defines an Equivalent Time Sampling (ETS) reconstructor.
+ * Samples are sorted by time stamp with a radix sort, samples with equal
+ * time stamps are averaged, and the result is linearly interpolated onto
+ * a uniform time grid. All work buffers are allocated once, so repeated
+ * RunBlock cycles can be merged without further allocation.
+ *
+ ****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "./PicoEts.h"
+
+#define ETS_RADIX_BITS	8
+#define ETS_RADIX_SIZE	(1 << ETS_RADIX_BITS)
+
+/****************************************************************************
+* radixSort
+*
+* Sorts order[] by keys[] (least significant digit first). Only the
+* digits needed for maxKey are sorted. The sort is stable.
+****************************************************************************/
+static void radixSort(ETS_RECONSTRUCTOR* ets, uint64_t n, uint64_t maxKey)
+{
+	uint64_t count[ETS_RADIX_SIZE];
+	uint64_t* keys = ets->keys;
+	uint64_t* keysOut = ets->keysTemp;
+	uint32_t* order = ets->order;
+	uint32_t* orderOut = ets->orderTemp;
+	uint64_t* keysSwap;
+	uint32_t* orderSwap;
+	uint64_t i;
+	uint64_t total;
+	uint64_t digitCount;
+	uint32_t shift;
+	uint32_t digit;
+
+	for (shift = 0; shift < 64 && (maxKey >> shift) != 0; shift += ETS_RADIX_BITS)
+	{
+		memset(count, 0, sizeof(count));
+
+		for (i = 0; i < n; i++)
+		{
+			count[(keys[i] >> shift) & (ETS_RADIX_SIZE - 1)]++;
+		}
+
+		total = 0;
+		for (digit = 0; digit < ETS_RADIX_SIZE; digit++)
+		{
+			digitCount = count[digit];
+			count[digit] = total;
+			total += digitCount;
+		}
+
+		for (i = 0; i < n; i++)
+		{
+			digit = (keys[i] >> shift) & (ETS_RADIX_SIZE - 1);
+			keysOut[count[digit]] = keys[i];
+			orderOut[count[digit]] = order[i];
+			count[digit]++;
+		}
+
+		keysSwap = keys; keys = keysOut; keysOut = keysSwap;
+		orderSwap = order; order = orderOut; orderOut = orderSwap;
+	}
+
+	// Keep the sorted data in ets->keys and ets->order
+	if (keys != ets->keys)
+	{
+		memcpy(ets->keys, keys, (size_t)n * sizeof(uint64_t));
+		memcpy(ets->order, order, (size_t)n * sizeof(uint32_t));
+	}
+}
+
+/****************************************************************************
+* ets_init
+*
+* Allocates the sample store and work buffers
+* Inputs:
+* - nChannels (max. ETS_MAX_CHANNELS)
+* - capacity: samples kept (for example blocks x samples per block)
+* - interval: output interval in the units of the etsTime buffer
+*   (femtoseconds for ps5000a)
+* Returns:
+* - PICO_OK, PICO_INVALID_PARAMETER or PICO_MEMORY
+****************************************************************************/
+PICO_STATUS ets_init(ETS_RECONSTRUCTOR* ets, int16_t nChannels, uint64_t capacity, int64_t interval)
+{
+	int16_t ch;
+
+	memset(ets, 0, sizeof(ETS_RECONSTRUCTOR));
+
+	if (nChannels <= 0 || nChannels > ETS_MAX_CHANNELS || capacity == 0 || capacity > UINT32_MAX || interval <= 0)
+		return PICO_INVALID_PARAMETER;
+
+	ets->nChannels = nChannels;
+	ets->capacity = capacity;
+	ets->interval = interval;
+
+	ets->times = (int64_t*)malloc((size_t)capacity * sizeof(int64_t));
+	ets->keys = (uint64_t*)malloc((size_t)capacity * sizeof(uint64_t));
+	ets->keysTemp = (uint64_t*)malloc((size_t)capacity * sizeof(uint64_t));
+	ets->order = (uint32_t*)malloc((size_t)capacity * sizeof(uint32_t));
+	ets->orderTemp = (uint32_t*)malloc((size_t)capacity * sizeof(uint32_t));
+
+	if (ets->times == NULL || ets->keys == NULL || ets->keysTemp == NULL || ets->order == NULL || ets->orderTemp == NULL)
+	{
+		ets_free(ets);
+		return PICO_MEMORY;
+	}
+
+	for (ch = 0; ch < nChannels; ch++)
+	{
+		ets->values[ch] = (int16_t*)calloc((size_t)capacity, sizeof(int16_t));
+		ets->merged[ch] = (int16_t*)calloc((size_t)capacity, sizeof(int16_t));
+
+		if (ets->values[ch] == NULL || ets->merged[ch] == NULL)
+		{
+			ets_free(ets);
+			return PICO_MEMORY;
+		}
+	}
+	return PICO_OK;
+}
+
+/****************************************************************************
+* ets_free
+****************************************************************************/
+void ets_free(ETS_RECONSTRUCTOR* ets)
+{
+	int16_t ch;
+
+	free(ets->times);
+	free(ets->keys);
+	free(ets->keysTemp);
+	free(ets->order);
+	free(ets->orderTemp);
+
+	for (ch = 0; ch < ETS_MAX_CHANNELS; ch++)
+	{
+		free(ets->values[ch]);
+		free(ets->merged[ch]);
+	}
+	memset(ets, 0, sizeof(ETS_RECONSTRUCTOR));
+}
+
+/****************************************************************************
+* ets_reset
+*
+* Discards all stored samples
+****************************************************************************/
+void ets_reset(ETS_RECONSTRUCTOR* ets)
+{
+	ets->count = 0;
+}
+
+/****************************************************************************
+* ets_add_block
+*
+* Adds one ETS block capture. The oldest samples are discarded when the
+* store is full, so a live display shows the most recent captures.
+* Inputs:
+* - times: etsTime buffer
+* - channelBuffers: one buffer per channel, NULL for disabled channels
+* - nSamples
+****************************************************************************/
+PICO_STATUS ets_add_block(ETS_RECONSTRUCTOR* ets, const int64_t* times, int16_t** channelBuffers, uint32_t nSamples)
+{
+	uint64_t discard;
+	uint64_t first = 0;
+	uint64_t n = nSamples;
+	int16_t ch;
+
+	if (ets->capacity == 0 || times == NULL)
+		return PICO_INVALID_PARAMETER;
+
+	// Keep only the newest samples of a block bigger than the store
+	if (n > ets->capacity)
+	{
+		first = n - ets->capacity;
+		n = ets->capacity;
+	}
+
+	if (ets->count + n > ets->capacity)
+	{
+		discard = ets->count + n - ets->capacity;
+		ets->count -= discard;
+
+		memmove(ets->times, ets->times + discard, (size_t)ets->count * sizeof(int64_t));
+		for (ch = 0; ch < ets->nChannels; ch++)
+		{
+			memmove(ets->values[ch], ets->values[ch] + discard, (size_t)ets->count * sizeof(int16_t));
+		}
+	}
+
+	memcpy(ets->times + ets->count, times + first, (size_t)n * sizeof(int64_t));
+	for (ch = 0; ch < ets->nChannels; ch++)
+	{
+		if (channelBuffers[ch] != NULL)
+			memcpy(ets->values[ch] + ets->count, channelBuffers[ch] + first, (size_t)n * sizeof(int16_t));
+		else
+			memset(ets->values[ch] + ets->count, 0, (size_t)n * sizeof(int16_t));
+	}
+
+	ets->count += n;
+	return PICO_OK;
+}
+
+/****************************************************************************
+* ets_output_size
+*
+* Returns the number of output points spanning the stored samples
+****************************************************************************/
+uint64_t ets_output_size(ETS_RECONSTRUCTOR* ets)
+{
+	int64_t minTime;
+	int64_t maxTime;
+	uint64_t i;
+
+	if (ets->count == 0)
+		return 0;
+
+	minTime = maxTime = ets->times[0];
+	for (i = 1; i < ets->count; i++)
+	{
+		if (ets->times[i] < minTime)
+			minTime = ets->times[i];
+		if (ets->times[i] > maxTime)
+			maxTime = ets->times[i];
+	}
+	return (uint64_t)((maxTime - minTime) / ets->interval) + 1;
+}
+
+/****************************************************************************
+* ets_reconstruct
+*
+* Sorts and merges the stored samples, then resamples them at the output
+* interval by linear interpolation
+* Inputs:
+* - nOutput: size of each output buffer (see ets_output_size)
+* - outputs: one buffer per channel, NULL to skip a channel
+* Outputs:
+* - startTime: time stamp of the first output point
+* Returns:
+* - PICO_OK, or PICO_INVALID_PARAMETER if no samples are stored
+****************************************************************************/
+PICO_STATUS ets_reconstruct(ETS_RECONSTRUCTOR* ets, int64_t* startTime, uint64_t nOutput, int16_t** outputs)
+{
+	int64_t minTime;
+	uint64_t maxKey = 0;
+	uint64_t nMerged = 0;
+	uint64_t i;
+	uint64_t j;
+	uint64_t k;
+	uint64_t p = 0;
+	uint64_t t;
+	uint64_t* mergedTimes;
+	int32_t sum[ETS_MAX_CHANNELS];
+	double frac;
+	double value;
+	int16_t ch;
+
+	if (ets->count == 0)
+		return PICO_INVALID_PARAMETER;
+
+	// Time stamps relative to the earliest sample give unsigned sort keys
+	minTime = ets->times[0];
+	for (i = 1; i < ets->count; i++)
+	{
+		if (ets->times[i] < minTime)
+			minTime = ets->times[i];
+	}
+
+	for (i = 0; i < ets->count; i++)
+	{
+		ets->keys[i] = (uint64_t)(ets->times[i] - minTime);
+		ets->order[i] = (uint32_t)i;
+		if (ets->keys[i] > maxKey)
+			maxKey = ets->keys[i];
+	}
+
+	radixSort(ets, ets->count, maxKey);
+
+	// Average samples with equal time stamps (keysTemp is free after the sort)
+	mergedTimes = ets->keysTemp;
+
+	for (i = 0; i < ets->count; i = j)
+	{
+		for (ch = 0; ch < ets->nChannels; ch++)
+		{
+			sum[ch] = 0;
+		}
+
+		for (j = i; j < ets->count && ets->keys[j] == ets->keys[i]; j++)
+		{
+			for (ch = 0; ch < ets->nChannels; ch++)
+			{
+				sum[ch] += ets->values[ch][ets->order[j]];
+			}
+		}
+
+		mergedTimes[nMerged] = ets->keys[i];
+		for (ch = 0; ch < ets->nChannels; ch++)
+		{
+			ets->merged[ch][nMerged] = (int16_t)(sum[ch] / (int32_t)(j - i));
+		}
+		nMerged++;
+	}
+
+	// Resample onto the uniform grid
+	for (k = 0; k < nOutput; k++)
+	{
+		t = k * (uint64_t)ets->interval;
+
+		while (p + 2 < nMerged && mergedTimes[p + 1] <= t)
+			p++;
+
+		if (nMerged == 1 || t <= mergedTimes[p])
+			frac = 0;
+		else if (t >= mergedTimes[p + 1])
+			frac = 1;
+		else
+			frac = (double)(t - mergedTimes[p]) / (double)(mergedTimes[p + 1] - mergedTimes[p]);
+
+		for (ch = 0; ch < ets->nChannels; ch++)
+		{
+			if (outputs[ch] == NULL)
+				continue;
+
+			if (nMerged == 1)
+			{
+				outputs[ch][k] = ets->merged[ch][0];
+			}
+			else
+			{
+				value = ets->merged[ch][p] + frac * (ets->merged[ch][p + 1] - ets->merged[ch][p]);
+				outputs[ch][k] = (int16_t)(value < 0 ? value - 0.5 : value + 0.5);
+			}
+		}
+	}
+
+	*startTime = minTime;
+	return PICO_OK;
+}
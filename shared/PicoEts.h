@@ -0,0 +1,51 @@
+/****************************************************************************
+ *
+ * Filename:    PicoEts.h
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This header defines an Equivalent Time Sampling (ETS) reconstructor.
+ * Repeated ETS block captures are merged by their etsTime stamps and
+ * resampled to one uniformly spaced high-rate waveform.
+ *
+ ****************************************************************************/
+#ifndef __PICOETS_H__
+#define __PICOETS_H__
+
+#include <stdint.h>
+
+/* PicoStatus.h of the driver being built, from its include directory (AM_CPPFLAGS on Linux) */
+#ifndef PICO_OK
+#include "PicoStatus.h"
+#endif
+
+#define ETS_MAX_CHANNELS	8
+
+typedef struct tEtsReconstructor
+{
+	int16_t		nChannels;
+	uint64_t	capacity;		// Samples kept, the oldest are discarded first
+	uint64_t	count;
+	int64_t		interval;		// Output interval, in the units of the time stamps
+	int64_t*	times;
+	int16_t*	values[ETS_MAX_CHANNELS];
+	// Work buffers for ets_reconstruct, allocated once in ets_init
+	uint64_t*	keys;
+	uint32_t*	order;
+	uint32_t*	orderTemp;
+	uint64_t*	keysTemp;
+	int16_t*	merged[ETS_MAX_CHANNELS];
+}ETS_RECONSTRUCTOR;
+
+// Function prototypes
+PICO_STATUS ets_init(ETS_RECONSTRUCTOR* ets, int16_t nChannels, uint64_t capacity, int64_t interval);
+void ets_free(ETS_RECONSTRUCTOR* ets);
+void ets_reset(ETS_RECONSTRUCTOR* ets);
+
+PICO_STATUS ets_add_block(ETS_RECONSTRUCTOR* ets, const int64_t* times, int16_t** channelBuffers, uint32_t nSamples);
+
+uint64_t ets_output_size(ETS_RECONSTRUCTOR* ets);
+
+PICO_STATUS ets_reconstruct(ETS_RECONSTRUCTOR* ets, int64_t* startTime, uint64_t nOutput, int16_t** outputs);
+
+#endif
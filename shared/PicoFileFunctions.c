@@ -178,18 +178,18 @@ int16_t* overflow)
                     {
                         fprintf(fp,
                             "%+5d %+3.3e ",
-                            maxBuffers[capture][j][i],
+                            pico_buffer_value(maxBuffers[capture][j], multiBufferSizes.dataType, i),
                             //(double)adc_to_mv((maxBuffers)[capture][j][i], unit->channelSettings[PICO_CHANNEL_A + j].range, unit->maxADCValue)
-                            adc_to_scaled_value((maxBuffers)[capture][j][i], enabledChannelsScaling[PICO_CHANNEL_A + j], unit->maxADCValue)
+                            adc_to_scaled_value(pico_buffer_value(maxBuffers[capture][j], multiBufferSizes.dataType, i), enabledChannelsScaling[PICO_CHANNEL_A + j], unit->maxADCValue)
                         );
 
                         if (multiBufferSizes.minBufferSize != 0)
                         {
                             fprintf(fp,
                                 "%+5d %+3.3e ",
-                                minBuffers[capture][j][i],
+                                pico_buffer_value(minBuffers[capture][j], multiBufferSizes.dataType, i),
                                 //(double)adc_to_mv((minBuffers)[capture][j][i], unit->channelSettings[PICO_CHANNEL_A + j].range, unit->maxADCValue)
-                                adc_to_scaled_value((minBuffers)[capture][j][i], enabledChannelsScaling[PICO_CHANNEL_A + j], unit->maxADCValue)
+                                adc_to_scaled_value(pico_buffer_value(minBuffers[capture][j], multiBufferSizes.dataType, i), enabledChannelsScaling[PICO_CHANNEL_A + j], unit->maxADCValue)
                             );
                         }
                     }
@@ -279,18 +279,18 @@ void WriteArrayToFileGeneric(GENERICUNIT* unit,
                     {
                         fprintf(fp,
                             "%+5d %+3.3e ",
-                            (maxBuffers)[j][i],              
+                            pico_buffer_value(maxBuffers[j], multiBufferSizes.dataType, i),
                             //(double)adc_to_mv(maxBuffers[j][i], unit->channelSettings[PICO_CHANNEL_A + j].range, unit->maxADCValue)
-                            adc_to_scaled_value(maxBuffers[j][i], enabledChannelsScaling[PICO_CHANNEL_A + j], unit->maxADCValue)
+                            adc_to_scaled_value(pico_buffer_value(maxBuffers[j], multiBufferSizes.dataType, i), enabledChannelsScaling[PICO_CHANNEL_A + j], unit->maxADCValue)
                         );
 
                         if (multiBufferSizes.minBufferSize != 0)
                         {
                             fprintf(fp,
                                 "%+5d %+3.3e ",
-                                minBuffers[j][i],
+                                pico_buffer_value(minBuffers[j], multiBufferSizes.dataType, i),
                                 //(double)adc_to_mv(minBuffers[j][i], unit->channelSettings[PICO_CHANNEL_A + j].range, unit->maxADCValue)
-                                adc_to_scaled_value(minBuffers[j][i], enabledChannelsScaling[PICO_CHANNEL_A + j], unit->maxADCValue)
+                                adc_to_scaled_value(pico_buffer_value(minBuffers[j], multiBufferSizes.dataType, i), enabledChannelsScaling[PICO_CHANNEL_A + j], unit->maxADCValue)
                             );
                         }
                     }
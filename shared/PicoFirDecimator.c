@@ -0,0 +1,427 @@
+/****************************************************************************
+ *
+ * Filename:    PicoFirDecimator.c
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This file defines an anti-aliased software downsampler for streaming
+ * buffers (see PicoFirDecimator.h). The dot product uses four partial
+ * sums over contiguous floats, so the compiler can vectorise it without
+ * reordering a single float sum.
+ *
+ ****************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "./PicoFirDecimator.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/****************************************************************************
+* dotProduct
+****************************************************************************/
+static float dotProduct(const float* coefficients, const float* data, uint32_t nTaps)
+{
+	float sum0 = 0.0f;
+	float sum1 = 0.0f;
+	float sum2 = 0.0f;
+	float sum3 = 0.0f;
+	uint32_t n4 = nTaps & ~3u;
+	uint32_t i;
+
+	for (i = 0; i < n4; i += 4)
+	{
+		sum0 += coefficients[i] * data[i];
+		sum1 += coefficients[i + 1] * data[i + 1];
+		sum2 += coefficients[i + 2] * data[i + 2];
+		sum3 += coefficients[i + 3] * data[i + 3];
+	}
+
+	for (; i < nTaps; i++)
+	{
+		sum0 += coefficients[i] * data[i];
+	}
+
+	return (sum0 + sum1) + (sum2 + sum3);
+}
+
+/****************************************************************************
+* toInt16
+*
+* Rounds and saturates a filter output
+****************************************************************************/
+static int16_t toInt16(float value)
+{
+	value += (value >= 0.0f) ? 0.5f : -0.5f;
+
+	if (value >= 32767.0f)
+		return INT16_MAX;
+	if (value <= -32768.0f)
+		return INT16_MIN;
+
+	return (int16_t)value;
+}
+
+/****************************************************************************
+* filterWork
+*
+* Computes the outputs for nSamples new inputs already converted into the
+* work buffer, then keeps the last nTaps - 1 inputs as history
+****************************************************************************/
+static uint32_t filterWork(FIR_DECIMATOR* decimator, uint32_t nSamples, int16_t* output)
+{
+	uint32_t history = decimator->nTaps - 1;
+	uint32_t nOutputs = 0;
+	uint32_t i;
+
+	// The output at new input i uses work[i] to work[i + nTaps - 1]
+	for (i = decimator->phase; i < nSamples; i += decimator->factor)
+	{
+		output[nOutputs++] = toInt16(dotProduct(decimator->coefficients, decimator->work + i, decimator->nTaps));
+	}
+
+	decimator->phase = i - nSamples;
+	memmove(decimator->work, decimator->work + nSamples, history * sizeof(float));
+	return nOutputs;
+}
+
+/****************************************************************************
+* fir_design_lowpass
+*
+* Blackman windowed-sinc low-pass filter with unity gain at DC
+* Inputs:
+* - nTaps: filter length (odd for a whole-sample delay)
+* - cutoff: -6 dB frequency as a fraction of the input sample rate (0 - 0.5)
+****************************************************************************/
+PICO_STATUS fir_design_lowpass(float* coefficients, uint32_t nTaps, double cutoff)
+{
+	double centre = (nTaps - 1) / 2.0;
+	double x;
+	double window;
+	double sum = 0.0;
+	uint32_t i;
+
+	if (nTaps == 0 || cutoff <= 0.0 || cutoff > 0.5)
+		return PICO_INVALID_PARAMETER;
+
+	for (i = 0; i < nTaps; i++)
+	{
+		x = i - centre;
+		window = (nTaps == 1) ? 1.0 :
+			0.42 - 0.5 * cos(2.0 * M_PI * i / (nTaps - 1)) + 0.08 * cos(4.0 * M_PI * i / (nTaps - 1));
+		coefficients[i] = (float)(window * ((x == 0.0) ? 2.0 * cutoff : sin(2.0 * M_PI * cutoff * x) / (M_PI * x)));
+		sum += coefficients[i];
+	}
+
+	for (i = 0; i < nTaps; i++)
+	{
+		coefficients[i] = (float)(coefficients[i] / sum);
+	}
+	return PICO_OK;
+}
+
+/****************************************************************************
+* fir_decimator_init
+*
+* Inputs:
+* - factor: keep one output for every factor inputs
+* - coefficients: nTaps filter coefficients, or NULL to design a
+*   low-pass filter of FIR_TAPS_PER_FACTOR * factor + 1 taps
+* - maxChunk: inputs converted at once (longer buffers are split)
+****************************************************************************/
+PICO_STATUS fir_decimator_init(FIR_DECIMATOR* decimator, uint32_t factor, const float* coefficients, uint32_t nTaps, uint32_t maxChunk)
+{
+	PICO_STATUS status;
+	uint32_t i;
+
+	memset(decimator, 0, sizeof(FIR_DECIMATOR));
+
+	if (factor == 0 || maxChunk == 0)
+		return PICO_INVALID_PARAMETER;
+
+	if (coefficients == NULL)
+		nTaps = FIR_TAPS_PER_FACTOR * factor + 1;
+
+	if (nTaps == 0)
+		return PICO_INVALID_PARAMETER;
+
+	decimator->factor = factor;
+	decimator->nTaps = nTaps;
+	decimator->maxChunk = maxChunk;
+	decimator->coefficients = (float*)malloc(nTaps * sizeof(float));
+	decimator->work = (float*)calloc((size_t)nTaps - 1 + maxChunk, sizeof(float));
+
+	if (decimator->coefficients == NULL || decimator->work == NULL)
+	{
+		fir_decimator_free(decimator);
+		return PICO_MEMORY;
+	}
+
+	if (coefficients == NULL)
+	{
+		if ((status = fir_design_lowpass(decimator->coefficients, nTaps, FIR_PASSBAND * 0.5 / factor)) != PICO_OK)
+		{
+			fir_decimator_free(decimator);
+			return status;
+		}
+	}
+	else
+	{
+		memcpy(decimator->coefficients, coefficients, nTaps * sizeof(float));
+	}
+
+	// Reverse the taps, so output = sum of coefficients[k] * work[i + k]
+	for (i = 0; i < nTaps / 2; i++)
+	{
+		float temp = decimator->coefficients[i];
+		decimator->coefficients[i] = decimator->coefficients[nTaps - 1 - i];
+		decimator->coefficients[nTaps - 1 - i] = temp;
+	}
+
+	return PICO_OK;
+}
+
+/****************************************************************************
+* fir_decimator_free
+****************************************************************************/
+void fir_decimator_free(FIR_DECIMATOR* decimator)
+{
+	free(decimator->coefficients);
+	free(decimator->work);
+	decimator->coefficients = NULL;
+	decimator->work = NULL;
+}
+
+/****************************************************************************
+* fir_decimator_reset
+*
+* Clears the history, e.g. after a gap in the stream
+****************************************************************************/
+void fir_decimator_reset(FIR_DECIMATOR* decimator)
+{
+	memset(decimator->work, 0, (decimator->nTaps - 1) * sizeof(float));
+	decimator->phase = 0;
+}
+
+/****************************************************************************
+* fir_decimator_process
+*
+* Filters a buffer of 16-bit ADC counts
+* Outputs:
+* - output: room for nSamples / factor + 1 values
+* Returns:
+* - number of values written to output
+****************************************************************************/
+uint32_t fir_decimator_process(FIR_DECIMATOR* decimator, const int16_t* input, uint32_t nSamples, int16_t* output)
+{
+	float* work = decimator->work + decimator->nTaps - 1;
+	uint32_t nOutputs = 0;
+	uint32_t n;
+	uint32_t i;
+
+	while (nSamples > 0)
+	{
+		n = (nSamples < decimator->maxChunk) ? nSamples : decimator->maxChunk;
+
+		for (i = 0; i < n; i++)
+		{
+			work[i] = (float)input[i];
+		}
+
+		nOutputs += filterWork(decimator, n, output + nOutputs);
+		input += n;
+		nSamples -= n;
+	}
+	return nOutputs;
+}
+
+/****************************************************************************
+* fir_decimator_process_int8
+*
+* Filters a buffer of 8-bit ADC counts (PICO_INT8_T), scaled by 256
+****************************************************************************/
+uint32_t fir_decimator_process_int8(FIR_DECIMATOR* decimator, const int8_t* input, uint32_t nSamples, int16_t* output)
+{
+	float* work = decimator->work + decimator->nTaps - 1;
+	uint32_t nOutputs = 0;
+	uint32_t n;
+	uint32_t i;
+
+	while (nSamples > 0)
+	{
+		n = (nSamples < decimator->maxChunk) ? nSamples : decimator->maxChunk;
+
+		for (i = 0; i < n; i++)
+		{
+			work[i] = (float)(input[i] * 256);
+		}
+
+		nOutputs += filterWork(decimator, n, output + nOutputs);
+		input += n;
+		nSamples -= n;
+	}
+	return nOutputs;
+}
+
+/****************************************************************************
+* fir_cascade_init
+*
+* Splits factor into stages of at most FIR_MAX_STAGE_FACTOR where it can
+* (a prime factor above that becomes one stage) and designs their filters
+* Inputs:
+* - factor: overall decimation, 1 to pass the input through
+* - maxChunk: inputs passed to the first stage at once
+****************************************************************************/
+PICO_STATUS fir_cascade_init(FIR_CASCADE* cascade, uint32_t factor, uint32_t maxChunk)
+{
+	PICO_STATUS status;
+	uint32_t remaining = factor;
+	uint32_t stageFactor;
+
+	memset(cascade, 0, sizeof(FIR_CASCADE));
+
+	if (factor == 0 || maxChunk == 0)
+		return PICO_INVALID_PARAMETER;
+
+	cascade->factor = factor;
+	cascade->maxChunk = maxChunk;
+
+	while (remaining > 1)
+	{
+		if (cascade->nStages == FIR_MAX_STAGES)
+		{
+			fir_cascade_free(cascade);
+			return PICO_INVALID_PARAMETER;
+		}
+
+		for (stageFactor = FIR_MAX_STAGE_FACTOR; stageFactor > 1 && remaining % stageFactor != 0; stageFactor--);
+
+		if (stageFactor == 1)
+			stageFactor = remaining;
+
+		// Each stage only sees the output of the one before
+		status = fir_decimator_init(&cascade->stages[cascade->nStages], stageFactor, NULL, 0,
+			(cascade->nStages == 0) ? maxChunk : maxChunk / (factor / remaining) + 1);
+		if (status != PICO_OK)
+		{
+			fir_cascade_free(cascade);
+			return status;
+		}
+
+		cascade->nStages++;
+		remaining /= stageFactor;
+	}
+
+	cascade->scratch[0] = (int16_t*)malloc(((size_t)maxChunk + 1) * sizeof(int16_t));
+	cascade->scratch[1] = (int16_t*)malloc(((size_t)maxChunk + 1) * sizeof(int16_t));
+
+	if (cascade->scratch[0] == NULL || cascade->scratch[1] == NULL)
+	{
+		fir_cascade_free(cascade);
+		return PICO_MEMORY;
+	}
+	return PICO_OK;
+}
+
+/****************************************************************************
+* fir_cascade_free
+****************************************************************************/
+void fir_cascade_free(FIR_CASCADE* cascade)
+{
+	int16_t s;
+
+	for (s = 0; s < FIR_MAX_STAGES; s++)
+	{
+		fir_decimator_free(&cascade->stages[s]);
+	}
+
+	free(cascade->scratch[0]);
+	free(cascade->scratch[1]);
+	cascade->scratch[0] = NULL;
+	cascade->scratch[1] = NULL;
+}
+
+/****************************************************************************
+* runStages
+*
+* Passes the output of the first stage through the rest of the cascade
+****************************************************************************/
+static uint32_t runStages(FIR_CASCADE* cascade, uint32_t n, int16_t* output)
+{
+	int16_t* in = cascade->scratch[0];
+	int16_t s;
+
+	for (s = 1; s < cascade->nStages; s++)
+	{
+		int16_t* out = (s == cascade->nStages - 1) ? output : cascade->scratch[s & 1];
+
+		n = fir_decimator_process(&cascade->stages[s], in, n, out);
+		in = out;
+	}
+
+	if (cascade->nStages == 1)
+		memcpy(output, in, n * sizeof(int16_t));
+
+	return n;
+}
+
+/****************************************************************************
+* fir_cascade_process
+*
+* Outputs:
+* - output: room for nSamples / factor + 1 values
+* Returns:
+* - number of values written to output
+****************************************************************************/
+uint32_t fir_cascade_process(FIR_CASCADE* cascade, const int16_t* input, uint32_t nSamples, int16_t* output)
+{
+	uint32_t nOutputs = 0;
+	uint32_t n;
+
+	if (cascade->nStages == 0)
+	{
+		memcpy(output, input, nSamples * sizeof(int16_t));
+		return nSamples;
+	}
+
+	while (nSamples > 0)
+	{
+		n = (nSamples < cascade->maxChunk) ? nSamples : cascade->maxChunk;
+		nOutputs += runStages(cascade, fir_decimator_process(&cascade->stages[0], input, n, cascade->scratch[0]), output + nOutputs);
+		input += n;
+		nSamples -= n;
+	}
+	return nOutputs;
+}
+
+/****************************************************************************
+* fir_cascade_process_int8
+*
+* As fir_cascade_process for 8-bit ADC counts (PICO_INT8_T)
+****************************************************************************/
+uint32_t fir_cascade_process_int8(FIR_CASCADE* cascade, const int8_t* input, uint32_t nSamples, int16_t* output)
+{
+	uint32_t nOutputs = 0;
+	uint32_t n;
+	uint32_t i;
+
+	if (cascade->nStages == 0)
+	{
+		for (i = 0; i < nSamples; i++)
+		{
+			output[i] = (int16_t)(input[i] * 256);
+		}
+		return nSamples;
+	}
+
+	while (nSamples > 0)
+	{
+		n = (nSamples < cascade->maxChunk) ? nSamples : cascade->maxChunk;
+		nOutputs += runStages(cascade, fir_decimator_process_int8(&cascade->stages[0], input, n, cascade->scratch[0]), output + nOutputs);
+		input += n;
+		nSamples -= n;
+	}
+	return nOutputs;
+}
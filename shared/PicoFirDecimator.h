@@ -0,0 +1,69 @@
+/****************************************************************************
+ *
+ * Filename:    PicoFirDecimator.h
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This header defines an anti-aliased software downsampler for streaming
+ * buffers. Each stage is a low-pass FIR filter that only computes the
+ * outputs it keeps (the polyphase form of a decimator), so a stage with
+ * factor M costs nTaps multiply-adds per output rather than per input.
+ * The last nTaps - 1 inputs are kept between calls, so buffers can be
+ * passed in any sizes and the output is the same as for one long buffer.
+ * Large factors are split into a cascade of stages with short filters.
+ *
+ * Samples are accumulated as floats. 8-bit data is scaled by 256 like
+ * 16-bit data, and the output is rounded and saturated to int16_t.
+ *
+ ****************************************************************************/
+#ifndef __PICOFIRDECIMATOR_H__
+#define __PICOFIRDECIMATOR_H__
+
+#include <stdint.h>
+
+/* PicoStatus.h of the driver being built, from its include directory (AM_CPPFLAGS on Linux) */
+#ifndef PICO_OK
+#include "PicoStatus.h"
+#endif
+
+#define FIR_MAX_STAGES			8
+#define FIR_MAX_STAGE_FACTOR	8		// Larger factors are split into cascaded stages where possible
+#define FIR_TAPS_PER_FACTOR		8		// Designed filters have FIR_TAPS_PER_FACTOR * factor + 1 taps
+#define FIR_PASSBAND			0.8		// Designed cutoff as a fraction of the output Nyquist frequency
+
+typedef struct tFirDecimator
+{
+	uint32_t	factor;
+	uint32_t	nTaps;
+	float*		coefficients;	// Time reversed, so each output is a forward dot product
+	uint32_t	maxChunk;		// Inputs converted at once
+	float*		work;			// nTaps - 1 inputs of history, then up to maxChunk new inputs
+	uint32_t	phase;			// Inputs to skip before the next output
+}FIR_DECIMATOR;
+
+typedef struct tFirCascade
+{
+	uint32_t		factor;		// Product of the stage factors
+	int16_t			nStages;
+	FIR_DECIMATOR	stages[FIR_MAX_STAGES];
+	uint32_t		maxChunk;
+	int16_t*		scratch[2];	// Outputs of the intermediate stages
+}FIR_CASCADE;
+
+// Function prototypes
+PICO_STATUS fir_design_lowpass(float* coefficients, uint32_t nTaps, double cutoff);
+
+PICO_STATUS fir_decimator_init(FIR_DECIMATOR* decimator, uint32_t factor, const float* coefficients, uint32_t nTaps, uint32_t maxChunk);
+void fir_decimator_free(FIR_DECIMATOR* decimator);
+void fir_decimator_reset(FIR_DECIMATOR* decimator);
+
+uint32_t fir_decimator_process(FIR_DECIMATOR* decimator, const int16_t* input, uint32_t nSamples, int16_t* output);
+uint32_t fir_decimator_process_int8(FIR_DECIMATOR* decimator, const int8_t* input, uint32_t nSamples, int16_t* output);
+
+PICO_STATUS fir_cascade_init(FIR_CASCADE* cascade, uint32_t factor, uint32_t maxChunk);
+void fir_cascade_free(FIR_CASCADE* cascade);
+
+uint32_t fir_cascade_process(FIR_CASCADE* cascade, const int16_t* input, uint32_t nSamples, int16_t* output);
+uint32_t fir_cascade_process_int8(FIR_CASCADE* cascade, const int8_t* input, uint32_t nSamples, int16_t* output);
+
+#endif
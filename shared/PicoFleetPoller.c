@@ -0,0 +1,550 @@
+/****************************************************************************
+ *
+ * Filename:    PicoFleetPoller.c
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This file defines a poller for a fleet of networked loggers and the
+ * UDP responder that emulates them (see PicoFleetPoller.h).
+ *
+ ****************************************************************************/
+#ifdef _WIN32
+#include <winsock2.h>	// Before anything includes windows.h
+#include <ws2tcpip.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "ws2_32.lib")
+#endif
+#define closeSocket(s)	closesocket((SOCKET)(s))
+#else
+#define _POSIX_C_SOURCE 200112L	// nanosleep
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <time.h>
+#define closeSocket(s)	close((int)(s))
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include "./PicoFleetPoller.h"
+#include "./PicoLoggerRing.h"
+
+#define REQUEST_BYTES	12
+#define RESPONSE_BYTES	(12 + 4 * FLEET_MAX_CHANNELS)
+
+/****************************************************************************
+* Packet helpers, network byte order
+****************************************************************************/
+static void put32(uint8_t* out, uint32_t value)
+{
+	out[0] = (uint8_t)(value >> 24);
+	out[1] = (uint8_t)(value >> 16);
+	out[2] = (uint8_t)(value >> 8);
+	out[3] = (uint8_t)value;
+}
+
+static void put16(uint8_t* out, uint16_t value)
+{
+	out[0] = (uint8_t)(value >> 8);
+	out[1] = (uint8_t)value;
+}
+
+static uint32_t get32(const uint8_t* in)
+{
+	return ((uint32_t)in[0] << 24) | ((uint32_t)in[1] << 16) | ((uint32_t)in[2] << 8) | in[3];
+}
+
+static uint16_t get16(const uint8_t* in)
+{
+	return (uint16_t)((in[0] << 8) | in[1]);
+}
+
+/****************************************************************************
+* openSocket
+*
+* Opens a UDP socket, bound to port if it is not 0
+****************************************************************************/
+static intptr_t openSocket(uint16_t port)
+{
+	struct sockaddr_in local;
+	intptr_t s;
+
+#ifdef _WIN32
+	WSADATA wsaData;
+
+	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+		return -1;
+
+	s = (intptr_t)socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+	if ((SOCKET)s == INVALID_SOCKET)
+	{
+		WSACleanup();
+		return -1;
+	}
+#else
+	s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+	if (s < 0)
+		return -1;
+#endif
+
+	if (port)
+	{
+		memset(&local, 0, sizeof(local));
+		local.sin_family = AF_INET;
+		local.sin_addr.s_addr = htonl(INADDR_ANY);
+		local.sin_port = htons(port);
+
+		if (bind((int)s, (struct sockaddr*)&local, sizeof(local)) != 0)
+		{
+			closeSocket(s);
+#ifdef _WIN32
+			WSACleanup();
+#endif
+			return -1;
+		}
+	}
+
+	return s;
+}
+
+/****************************************************************************
+* waitReadable
+*
+* Waits up to timeoutMs for a packet
+* Returns:
+* - 1 if a packet is waiting, 0 if not
+****************************************************************************/
+static int16_t waitReadable(intptr_t s, int64_t timeoutMs)
+{
+	struct timeval timeout;
+	fd_set readSet;
+
+	if (timeoutMs < 0)
+		timeoutMs = 0;
+
+	FD_ZERO(&readSet);
+	FD_SET(s, &readSet);
+	timeout.tv_sec = (long)(timeoutMs / 1000);
+	timeout.tv_usec = (long)(timeoutMs % 1000) * 1000;
+
+	return select((int)s + 1, &readSet, NULL, NULL, &timeout) > 0;
+}
+
+/****************************************************************************
+* sleepMs
+****************************************************************************/
+static void sleepMs(int64_t ms)
+{
+#ifndef _WIN32
+	struct timespec delay;
+#endif
+
+	if (ms <= 0)
+		return;
+
+#ifdef _WIN32
+	Sleep((DWORD)ms);
+#else
+	delay.tv_sec = (time_t)(ms / 1000);
+	delay.tv_nsec = (long)(ms % 1000) * 1000000;
+	nanosleep(&delay, NULL);
+#endif
+}
+
+/****************************************************************************
+* fleet_init
+*
+* Inputs:
+* - read: reads a channel of a driver unit, NULL if all units are emulated
+****************************************************************************/
+void fleet_init(FLEET* fleet, FLEET_READ read)
+{
+	memset(fleet, 0, sizeof(FLEET));
+	fleet->socket = -1;
+	fleet->read = read;
+	fleet->startMs = logger_time_ms();
+}
+
+/****************************************************************************
+* addUnit
+****************************************************************************/
+static FLEET_UNIT* addUnit(FLEET* fleet, const char* name, int16_t nChannels, const int16_t* channels,
+	const double* scale, uint32_t cadenceMs)
+{
+	FLEET_UNIT* unit;
+	int16_t c;
+
+	if (fleet->nUnits == FLEET_MAX_UNITS || nChannels < 1 || nChannels > FLEET_MAX_CHANNELS)
+		return NULL;
+
+	// Channel numbers index the fresh mask of the unit
+	for (c = 0; c < nChannels; c++)
+	{
+		if (channels[c] < 1 || channels[c] > FLEET_MAX_CHANNELS)
+			return NULL;
+	}
+
+	unit = &fleet->units[fleet->nUnits++];
+	memset(unit, 0, sizeof(FLEET_UNIT));
+	strncpy(unit->name, name, sizeof(unit->name) - 1);
+	unit->nChannels = nChannels;
+
+	for (c = 0; c < nChannels; c++)
+	{
+		unit->channels[c] = channels[c];
+		unit->scale[c] = scale[c];
+	}
+
+	unit->cadenceMs = cadenceMs ? cadenceMs : 1000;
+
+	// The first read waits for a full cycle, so every channel has converted
+	unit->nextMs = logger_time_ms() + unit->cadenceMs;
+	unit->status = PICO_NO_SAMPLES_AVAILABLE;
+	return unit;
+}
+
+/****************************************************************************
+* fleet_add_unit
+*
+* Adds a unit opened through the driver
+* Inputs:
+* - channels: channel numbers to read, from 1
+* - scale: units per count of each channel
+* - cadenceMs: time the unit takes to convert all its enabled channels
+****************************************************************************/
+PICO_STATUS fleet_add_unit(FLEET* fleet, const char* name, int16_t handle, int16_t nChannels, const int16_t* channels,
+	const double* scale, uint32_t cadenceMs)
+{
+	FLEET_UNIT* unit;
+
+	if (handle <= 0 || fleet->read == NULL)
+		return PICO_INVALID_PARAMETER;
+
+	unit = addUnit(fleet, name, nChannels, channels, scale, cadenceMs);
+
+	if (unit == NULL)
+		return PICO_INVALID_PARAMETER;
+
+	unit->handle = handle;
+	return PICO_OK;
+}
+
+/****************************************************************************
+* fleet_add_emulated_unit
+*
+* Adds a unit emulated by a responder at host:port
+****************************************************************************/
+PICO_STATUS fleet_add_emulated_unit(FLEET* fleet, const char* host, uint16_t port, int16_t emulatedId,
+	int16_t nChannels, const int16_t* channels, const double* scale, uint32_t cadenceMs)
+{
+	struct sockaddr_in address;
+	FLEET_UNIT* unit;
+	char name[32];
+
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+
+	if (inet_pton(AF_INET, host, &address.sin_addr) != 1)
+		return PICO_INVALID_PARAMETER;
+
+	if (fleet->socket == -1 && (fleet->socket = openSocket(0)) == -1)
+		return PICO_NOT_FOUND;
+
+	snprintf(name, sizeof(name), "%s:%u#%d", host, port, emulatedId);
+	unit = addUnit(fleet, name, nChannels, channels, scale, cadenceMs);
+
+	if (unit == NULL)
+		return PICO_INVALID_PARAMETER;
+
+	unit->emulatedId = emulatedId;
+	memcpy(unit->address, &address, sizeof(address));
+	return PICO_OK;
+}
+
+/****************************************************************************
+* sendRequest
+****************************************************************************/
+static void sendRequest(FLEET* fleet, FLEET_UNIT* unit, int64_t now)
+{
+	uint8_t packet[REQUEST_BYTES];
+	uint16_t mask = 0;
+	int16_t c;
+
+	for (c = 0; c < unit->nChannels; c++)
+	{
+		mask |= (uint16_t)(1 << (unit->channels[c] - 1));
+	}
+
+	unit->sequence++;
+	put32(packet, FLEET_REQUEST_MAGIC);
+	put32(packet + 4, unit->sequence);
+	put16(packet + 8, (uint16_t)unit->emulatedId);
+	put16(packet + 10, mask);
+
+	sendto((int)fleet->socket, (const char*)packet, REQUEST_BYTES, 0, (const struct sockaddr*)unit->address, sizeof(struct sockaddr_in));
+	unit->sentMs = now;
+	unit->inFlight = 1;
+}
+
+/****************************************************************************
+* receiveResponses
+*
+* Takes every reply waiting, waiting up to timeoutMs for the first
+****************************************************************************/
+static void receiveResponses(FLEET* fleet, int64_t timeoutMs)
+{
+	uint8_t packet[RESPONSE_BYTES];
+	FLEET_UNIT* unit;
+	int64_t latency;
+	int32_t n;
+	int16_t u;
+	int16_t c;
+
+	while (waitReadable(fleet->socket, timeoutMs))
+	{
+		timeoutMs = 0;
+		n = (int32_t)recvfrom((int)fleet->socket, (char*)packet, RESPONSE_BYTES, 0, NULL, NULL);
+
+		if (n != RESPONSE_BYTES || get32(packet) != FLEET_RESPONSE_MAGIC)
+			continue;
+
+		for (u = 0; u < fleet->nUnits; u++)
+		{
+			unit = &fleet->units[u];
+
+			// Only the reply to the latest request counts, a late one for a timed out request is dropped
+			if (unit->handle == 0 && unit->inFlight && unit->emulatedId == (int16_t)get16(packet + 8) && unit->sequence == get32(packet + 4))
+			{
+				latency = logger_time_ms() - unit->sentMs;
+				unit->latencySumMs += latency;
+				unit->latencyMaxMs = latency > unit->latencyMaxMs ? latency : unit->latencyMaxMs;
+				unit->freshMask = get16(packet + 10);
+
+				for (c = 0; c < unit->nChannels; c++)
+				{
+					unit->raw[c] = (int32_t)get32(packet + 12 + 4 * (unit->channels[c] - 1));
+				}
+
+				unit->status = unit->freshMask ? PICO_OK : PICO_NO_SAMPLES_AVAILABLE;
+				unit->inFlight = 0;
+				unit->updated = 1;
+				unit->reads++;
+				break;
+			}
+		}
+	}
+}
+
+/****************************************************************************
+* fleet_poll
+*
+* Reads every unit that is due, then waits for the emulated units' replies
+* until the next unit is due or maxWaitMs has passed
+* Returns:
+* - the number of units updated, see FLEET_UNIT.updated and values
+****************************************************************************/
+int16_t fleet_poll(FLEET* fleet, uint32_t maxWaitMs)
+{
+	FLEET_UNIT* unit;
+	int64_t now = logger_time_ms();
+	int64_t wakeMs = now + maxWaitMs;
+	int16_t nInFlight = 0;
+	int16_t nUpdated = 0;
+	int16_t u;
+	int16_t c;
+	PICO_STATUS status;
+
+	for (u = 0; u < fleet->nUnits; u++)
+	{
+		unit = &fleet->units[u];
+		unit->updated = 0;
+
+		if (unit->inFlight && now - unit->sentMs >= FLEET_TIMEOUT_MS)
+		{
+			unit->inFlight = 0;
+			unit->timeouts++;
+			unit->status = PICO_NO_SAMPLES_AVAILABLE;
+		}
+
+		if (!unit->inFlight && now >= unit->nextMs)
+		{
+			// Keep to the unit's cadence, but do not try to catch up after a stall
+			unit->nextMs += unit->cadenceMs;
+
+			if (unit->nextMs <= now)
+				unit->nextMs = now + unit->cadenceMs;
+
+			if (unit->handle == 0)
+			{
+				sendRequest(fleet, unit, now);
+			}
+			else
+			{
+				unit->freshMask = 0;
+				unit->status = PICO_OK;
+
+				for (c = 0; c < unit->nChannels; c++)
+				{
+					status = fleet->read(unit->handle, unit->channels[c], &unit->raw[c]);
+
+					if (status == PICO_OK)
+						unit->freshMask |= (uint16_t)(1 << (unit->channels[c] - 1));
+					else if (unit->status == PICO_OK)
+						unit->status = status;
+				}
+
+				unit->updated = 1;
+				unit->reads++;
+			}
+		}
+
+		nInFlight += unit->inFlight;
+
+		if (unit->inFlight)
+			wakeMs = unit->sentMs + FLEET_TIMEOUT_MS < wakeMs ? unit->sentMs + FLEET_TIMEOUT_MS : wakeMs;
+		else
+			wakeMs = unit->nextMs < wakeMs ? unit->nextMs : wakeMs;
+	}
+
+	if (nInFlight)
+		receiveResponses(fleet, wakeMs - logger_time_ms());
+	else
+		sleepMs(wakeMs - logger_time_ms());
+
+	// Scale everything read in this poll in one pass
+	for (u = 0; u < fleet->nUnits; u++)
+	{
+		unit = &fleet->units[u];
+
+		if (unit->updated)
+		{
+			for (c = 0; c < unit->nChannels; c++)
+			{
+				unit->values[c] = unit->raw[c] * unit->scale[c];
+			}
+			nUpdated++;
+		}
+	}
+
+	return nUpdated;
+}
+
+/****************************************************************************
+* fleet_close
+*
+* Closes the responder socket. Driver units are closed by the caller.
+****************************************************************************/
+void fleet_close(FLEET* fleet)
+{
+	if (fleet->socket != -1)
+	{
+		closeSocket(fleet->socket);
+#ifdef _WIN32
+		WSACleanup();
+#endif
+	}
+
+	fleet->socket = -1;
+	fleet->nUnits = 0;
+}
+
+/****************************************************************************
+* fleet_responder_run
+*
+* Emulates nUnits units on a UDP port until stop returns non-zero. Each
+* unit converts one channel every conversionMs in turn, like a PT-104,
+* and replies at once with its latest values in milli-degrees C of a
+* PT100 that drifts up and down by half a degree over a few minutes.
+****************************************************************************/
+PICO_STATUS fleet_responder_run(uint16_t port, int16_t nUnits, uint32_t conversionMs, FLEET_STOP stop)
+{
+	uint8_t request[REQUEST_BYTES];
+	uint8_t response[RESPONSE_BYTES];
+	uint32_t lastConversion[FLEET_MAX_UNITS];
+	struct sockaddr_in from;
+	socklen_t fromLength;
+	intptr_t s;
+	int64_t startMs = logger_time_ms();
+	int64_t reportMs = startMs + 1000;
+	int64_t now;
+	uint64_t requests = 0;
+	uint64_t lastRequests = 0;
+	uint32_t conversion;
+	int32_t drift;
+	uint16_t unit;
+	uint16_t mask;
+	int32_t n;
+	int16_t c;
+
+	if (nUnits < 1 || nUnits > FLEET_MAX_UNITS || conversionMs == 0)
+		return PICO_INVALID_PARAMETER;
+
+	s = openSocket(port);
+
+	if (s == -1)
+		return PICO_NOT_FOUND;
+
+	memset(lastConversion, 0, sizeof(lastConversion));
+	printf("Emulating %d unit(s) on UDP port %u. Press any key to stop.\n\n", nUnits, port);
+
+	while (!stop())
+	{
+		if (waitReadable(s, 100))
+		{
+			fromLength = sizeof(from);
+			n = (int32_t)recvfrom((int)s, (char*)request, REQUEST_BYTES, 0, (struct sockaddr*)&from, &fromLength);
+			unit = get16(request + 8);
+
+			if (n == REQUEST_BYTES && get32(request) == FLEET_REQUEST_MAGIC && unit < nUnits)
+			{
+				now = logger_time_ms();
+				mask = get16(request + 10);
+
+				// Channels are converted in turn, so a channel is new once a full cycle has passed
+				conversion = (uint32_t)((now - startMs) / conversionMs);
+
+				put32(response, FLEET_RESPONSE_MAGIC);
+				memcpy(response + 4, request + 4, 4);
+				put16(response + 8, unit);
+				put16(response + 10, conversion >= lastConversion[unit] + FLEET_MAX_CHANNELS ? mask : 0);
+
+				drift = (int32_t)(((now - startMs) / 100 + 200 * unit) % 2000);
+				drift = drift < 1000 ? drift - 500 : 1500 - drift;
+
+				for (c = 0; c < FLEET_MAX_CHANNELS; c++)
+				{
+					put32(response + 12 + 4 * c, (uint32_t)(20000 + 1000 * unit + 100 * c + drift));
+				}
+
+				if (conversion >= lastConversion[unit] + FLEET_MAX_CHANNELS)
+					lastConversion[unit] = conversion;
+
+				sendto((int)s, (const char*)response, RESPONSE_BYTES, 0, (struct sockaddr*)&from, fromLength);
+				requests++;
+			}
+		}
+
+		now = logger_time_ms();
+
+		if (now >= reportMs)
+		{
+			printf("\r%llu requests, %llu per second   ", (unsigned long long)requests, (unsigned long long)(requests - lastRequests));
+			fflush(stdout);
+			lastRequests = requests;
+			reportMs = now + 1000;
+		}
+	}
+
+	printf("\n");
+	closeSocket(s);
+#ifdef _WIN32
+	WSACleanup();
+#endif
+	return PICO_OK;
+}
@@ -0,0 +1,94 @@
+/****************************************************************************
+ *
+ * Filename:    PicoFleetPoller.h
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This header defines a poller for a fleet of slow networked loggers
+ * (USB PT-104, PLCM3). Each unit is read once per conversion cycle from
+ * its own schedule, so no unit waits on another, and the readings of
+ * every unit updated in a poll are scaled together afterwards.
+ *
+ * Units are either opened through the driver, which keeps converting on
+ * its own so reading the latest values does not block, or emulated by
+ * the UDP responder for throughput and latency testing. Requests to the
+ * emulated units are all sent before any reply is waited for, so one
+ * round trip is in flight to every unit at once.
+ *
+ * Responder protocol (UDP, network byte order):
+ * Request:  uint32_t FLEET_REQUEST_MAGIC, uint32_t sequence,
+ *           uint16_t unit, uint16_t channel mask (bit 0 = channel 1)
+ * Response: uint32_t FLEET_RESPONSE_MAGIC, uint32_t sequence,
+ *           uint16_t unit, uint16_t channel mask of new conversions,
+ *           int32_t value of each of FLEET_MAX_CHANNELS channels
+ *
+ ****************************************************************************/
+#ifndef __PICOFLEETPOLLER_H__
+#define __PICOFLEETPOLLER_H__
+
+#include <stdint.h>
+
+/* PicoStatus.h of the driver being built, from its include directory (AM_CPPFLAGS on Linux) */
+#ifndef PICO_OK
+#include "PicoStatus.h"
+#endif
+
+#define FLEET_MAX_UNITS			64
+#define FLEET_MAX_CHANNELS		4
+#define FLEET_RESPONDER_PORT	6554
+#define FLEET_TIMEOUT_MS		1000	// Emulated units not replying in this time are polled again
+#define FLEET_REQUEST_MAGIC		0x50543151	// "PT1Q"
+#define FLEET_RESPONSE_MAGIC	0x50543152	// "PT1R"
+
+// Reads the latest value of one channel of a driver unit without blocking
+typedef PICO_STATUS(*FLEET_READ)(int16_t handle, int16_t channel, int32_t* value);
+
+// Returns non-zero to stop the responder
+typedef int32_t(*FLEET_STOP)(void);
+
+typedef struct tFleetUnit
+{
+	char		name[32];
+	int16_t		handle;							// Driver handle, 0 for an emulated unit
+	int16_t		emulatedId;						// Unit number at the responder
+	uint8_t		address[16];					// Responder address (struct sockaddr_in)
+	int16_t		nChannels;
+	int16_t		channels[FLEET_MAX_CHANNELS];	// Channel numbers, from 1
+	double		scale[FLEET_MAX_CHANNELS];		// Units per count of each channel
+	uint32_t	cadenceMs;						// Time to convert every enabled channel once
+	int64_t		nextMs;							// Next read
+	int32_t		raw[FLEET_MAX_CHANNELS];
+	double		values[FLEET_MAX_CHANNELS];		// Scaled, valid when updated is set
+	uint16_t	freshMask;						// Channels converted since the last read
+	int16_t		updated;						// Read in the last fleet_poll
+	PICO_STATUS	status;
+	uint32_t	sequence;
+	int64_t		sentMs;
+	int16_t		inFlight;
+	uint64_t	reads;
+	uint64_t	timeouts;
+	int64_t		latencySumMs;
+	int64_t		latencyMaxMs;
+}FLEET_UNIT;
+
+typedef struct tFleet
+{
+	FLEET_UNIT	units[FLEET_MAX_UNITS];
+	int16_t		nUnits;
+	intptr_t	socket;			// For emulated units, -1 if not open
+	FLEET_READ	read;			// For driver units
+	int64_t		startMs;
+}FLEET;
+
+// Function prototypes
+void fleet_init(FLEET* fleet, FLEET_READ read);
+PICO_STATUS fleet_add_unit(FLEET* fleet, const char* name, int16_t handle, int16_t nChannels, const int16_t* channels,
+	const double* scale, uint32_t cadenceMs);
+PICO_STATUS fleet_add_emulated_unit(FLEET* fleet, const char* host, uint16_t port, int16_t emulatedId,
+	int16_t nChannels, const int16_t* channels, const double* scale, uint32_t cadenceMs);
+int16_t fleet_poll(FLEET* fleet, uint32_t maxWaitMs);
+void fleet_close(FLEET* fleet);
+
+PICO_STATUS fleet_responder_run(uint16_t port, int16_t nUnits, uint32_t conversionMs, FLEET_STOP stop);
+
+#endif
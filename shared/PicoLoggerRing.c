@@ -0,0 +1,235 @@
+/****************************************************************************
+ *
+ * Filename:    PicoLoggerRing.c
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This file defines a time-aligned ring for data loggers with several
+ * units (see PicoLoggerRing.h).
+ *
+ ****************************************************************************/
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200112L	// clock_gettime
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "./PicoLoggerRing.h"
+
+/* Headers for Windows */
+#ifdef _WIN32
+#define ringLock(r)		EnterCriticalSection(&(r)->lock)
+#define ringUnlock(r)	LeaveCriticalSection(&(r)->lock)
+#else
+#include <time.h>
+#define ringLock(r)		pthread_mutex_lock(&(r)->lock)
+#define ringUnlock(r)	pthread_mutex_unlock(&(r)->lock)
+#endif
+
+/****************************************************************************
+* clearRow
+****************************************************************************/
+static void clearRow(LOGGER_RING* ring, uint32_t row, int64_t slot)
+{
+	float* values = ring->values + (size_t)row * ring->nColumns;
+	uint32_t c;
+
+	for (c = 0; c < ring->nColumns; c++)
+	{
+		values[c] = NAN;
+	}
+
+	memset(ring->flags + (size_t)row * ring->nColumns, 0, ring->nColumns);
+	ring->slots[row] = slot;
+}
+
+/****************************************************************************
+* logger_ring_init
+*
+* Inputs:
+* - nColumns: values per row (units x channels)
+* - capacity: rows kept, rounded up to a power of 2
+* - intervalMs: time slot of each row
+* Returns:
+* - 1 on success, 0 on failure
+****************************************************************************/
+int16_t logger_ring_init(LOGGER_RING* ring, uint32_t nColumns, uint32_t capacity, uint32_t intervalMs)
+{
+	uint32_t row;
+
+	memset(ring, 0, sizeof(LOGGER_RING));
+
+	if (nColumns == 0 || capacity == 0 || intervalMs == 0)
+		return 0;
+
+	ring->nColumns = nColumns;
+	ring->intervalMs = intervalMs;
+
+	for (ring->capacity = 1; ring->capacity < capacity; ring->capacity <<= 1);
+
+	ring->slots = (int64_t*)malloc(ring->capacity * sizeof(int64_t));
+	ring->values = (float*)malloc((size_t)ring->capacity * nColumns * sizeof(float));
+	ring->flags = (uint8_t*)malloc((size_t)ring->capacity * nColumns);
+
+	if (ring->slots == NULL || ring->values == NULL || ring->flags == NULL)
+	{
+		free(ring->slots);
+		free(ring->values);
+		free(ring->flags);
+		memset(ring, 0, sizeof(LOGGER_RING));
+		return 0;
+	}
+
+	for (row = 0; row < ring->capacity; row++)
+	{
+		clearRow(ring, row, -1);
+	}
+
+#ifdef _WIN32
+	InitializeCriticalSection(&ring->lock);
+#else
+	pthread_mutex_init(&ring->lock, NULL);
+#endif
+	return 1;
+}
+
+/****************************************************************************
+* logger_ring_free
+****************************************************************************/
+void logger_ring_free(LOGGER_RING* ring)
+{
+	if (ring->slots == NULL)
+		return;
+
+#ifdef _WIN32
+	DeleteCriticalSection(&ring->lock);
+#else
+	pthread_mutex_destroy(&ring->lock);
+#endif
+	free(ring->slots);
+	free(ring->values);
+	free(ring->flags);
+	ring->slots = NULL;
+	ring->values = NULL;
+	ring->flags = NULL;
+}
+
+/****************************************************************************
+* logger_ring_put
+*
+* Stores a reading in the row for its time. Call from the poll thread.
+* Inputs:
+* - timeMs: time of the reading on the logger_time_ms clock
+* - column: unit * channels per unit + channel
+* - flags: LOGGER_FLAG_OVERFLOW or 0
+****************************************************************************/
+void logger_ring_put(LOGGER_RING* ring, int64_t timeMs, uint32_t column, float value, uint8_t flags)
+{
+	int64_t slot = (timeMs + ring->intervalMs / 2) / ring->intervalMs;
+	uint32_t row;
+	uint8_t* flag;
+
+	if (column >= ring->nColumns)
+		return;
+
+	ringLock(ring);
+
+	if (!ring->started)
+	{
+		ring->started = 1;
+		ring->firstSlot = slot;
+		ring->endSlot = slot;
+	}
+
+	if (slot < ring->firstSlot)
+	{
+		ring->lateValues++;
+		ringUnlock(ring);
+		return;
+	}
+
+	// Make room by dropping the oldest rows if the reader has fallen behind
+	while (slot >= ring->firstSlot + ring->capacity)
+	{
+		row = (uint32_t)(ring->firstSlot & (ring->capacity - 1));
+
+		if (ring->slots[row] == ring->firstSlot)
+		{
+			ring->rowsLost++;
+			clearRow(ring, row, -1);
+		}
+		ring->firstSlot++;
+	}
+
+	row = (uint32_t)(slot & (ring->capacity - 1));
+
+	if (ring->slots[row] != slot)
+		clearRow(ring, row, slot);
+
+	flag = ring->flags + (size_t)row * ring->nColumns + column;
+	*flag = (*flag & LOGGER_FLAG_VALID ? LOGGER_FLAG_REPLACED : 0) | LOGGER_FLAG_VALID | flags;
+	ring->values[(size_t)row * ring->nColumns + column] = value;
+
+	if (slot >= ring->endSlot)
+		ring->endSlot = slot + 1;
+
+	ringUnlock(ring);
+}
+
+/****************************************************************************
+* logger_ring_read
+*
+* Takes the oldest row with any readings out of the ring
+* Inputs:
+* - settleRows: newest rows to leave, so late units can still fill them
+*   (0 to drain the ring)
+* Outputs:
+* - timeMs: time of the row's slot
+* - values, flags: nColumns each
+* Returns:
+* - 1 if a row was read, 0 if none is ready
+****************************************************************************/
+int16_t logger_ring_read(LOGGER_RING* ring, int64_t* timeMs, float* values, uint8_t* flags, uint32_t settleRows)
+{
+	uint32_t row;
+	int16_t found = 0;
+
+	ringLock(ring);
+
+	while (!found && ring->started && ring->firstSlot + settleRows < ring->endSlot)
+	{
+		row = (uint32_t)(ring->firstSlot & (ring->capacity - 1));
+
+		if (ring->slots[row] == ring->firstSlot)
+		{
+			*timeMs = ring->firstSlot * ring->intervalMs;
+			memcpy(values, ring->values + (size_t)row * ring->nColumns, ring->nColumns * sizeof(float));
+			memcpy(flags, ring->flags + (size_t)row * ring->nColumns, ring->nColumns);
+			clearRow(ring, row, -1);
+			found = 1;
+		}
+		ring->firstSlot++;
+	}
+
+	ringUnlock(ring);
+	return found;
+}
+
+/****************************************************************************
+* logger_time_ms
+*
+* Monotonic host time in milliseconds, used to align units started at
+* different times
+****************************************************************************/
+int64_t logger_time_ms(void)
+{
+#ifdef _WIN32
+	return (int64_t)GetTickCount64();
+#else
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+#endif
+}
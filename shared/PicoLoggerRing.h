@@ -0,0 +1,64 @@
+/****************************************************************************
+ *
+ * Filename:    PicoLoggerRing.h
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This header defines a time-aligned ring for data loggers with several
+ * units. Each row is one time slot of intervalMs, with one column per
+ * unit channel. A poll thread puts readings into the row for their time,
+ * and a reader takes rows out in time order once they are old enough
+ * for every unit to have reported. Columns with no reading for a slot
+ * are NaN.
+ *
+ * The functions return 1 on success and 0 on failure (like the logger
+ * drivers) so the ring does not depend on PicoStatus.h.
+ *
+ ****************************************************************************/
+#ifndef __PICOLOGGERRING_H__
+#define __PICOLOGGERRING_H__
+
+#include <stdint.h>
+
+/* Headers for Windows */
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+// Flags per value
+#define LOGGER_FLAG_VALID		0x01	// A reading arrived for this slot
+#define LOGGER_FLAG_OVERFLOW	0x02	// The driver reported an overflow or over-range
+#define LOGGER_FLAG_REPLACED	0x04	// More than one reading arrived for this slot, the last is kept
+
+typedef struct tLoggerRing
+{
+	uint32_t	nColumns;
+	uint32_t	capacity;		// Rows, a power of 2
+	uint32_t	intervalMs;		// Time slot of each row
+	int16_t		started;
+	int64_t		firstSlot;		// Oldest row not read yet
+	int64_t		endSlot;		// Newest row written + 1
+	int64_t*	slots;			// Slot held by each row, -1 if empty
+	float*		values;			// capacity * nColumns
+	uint8_t*	flags;			// capacity * nColumns, LOGGER_FLAG_*
+	uint64_t	rowsLost;		// Rows overwritten before they were read
+	uint64_t	lateValues;		// Readings for rows already read
+#ifdef _WIN32
+	CRITICAL_SECTION	lock;
+#else
+	pthread_mutex_t		lock;
+#endif
+}LOGGER_RING;
+
+// Function prototypes
+int16_t logger_ring_init(LOGGER_RING* ring, uint32_t nColumns, uint32_t capacity, uint32_t intervalMs);
+void logger_ring_free(LOGGER_RING* ring);
+
+void logger_ring_put(LOGGER_RING* ring, int64_t timeMs, uint32_t column, float value, uint8_t flags);
+int16_t logger_ring_read(LOGGER_RING* ring, int64_t* timeMs, float* values, uint8_t* flags, uint32_t settleRows);
+
+int64_t logger_time_ms(void);
+
+#endif
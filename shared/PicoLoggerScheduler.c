@@ -0,0 +1,451 @@
+/****************************************************************************
+ *
+ * Filename:    PicoLoggerScheduler.c
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This file defines a multi-rate scheduler for data loggers of several
+ * families (see PicoLoggerScheduler.h).
+ *
+ ****************************************************************************/
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200112L	// nanosleep
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "./PicoLoggerScheduler.h"
+#include "./PicoLoggerRing.h"
+
+/* Headers for Windows */
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#define CATCH_UP_POLLS	8	// Reads a poll may make while a buffering device returns full reads
+
+/****************************************************************************
+* pollPeriodMs
+****************************************************************************/
+static int64_t pollPeriodMs(const LOGGER_SCHED_ENTRY* entry)
+{
+	return entry->adapter.pollMs ? entry->adapter.pollMs : entry->adapter.periodMs;
+}
+
+/****************************************************************************
+* sleepMs
+****************************************************************************/
+static void sleepMs(int64_t ms)
+{
+#ifdef _WIN32
+	Sleep((DWORD)ms);
+#else
+	struct timespec wait;
+
+	wait.tv_sec = (time_t)(ms / 1000);
+	wait.tv_nsec = (long)(ms % 1000) * 1000000;
+	nanosleep(&wait, NULL);
+#endif
+}
+
+/****************************************************************************
+* wheelInsert
+****************************************************************************/
+static void wheelInsert(LOGGER_SCHEDULER* sched, LOGGER_SCHED_ENTRY* entry)
+{
+	uint32_t slot = (uint32_t)((entry->dueMs / LOGGER_SCHED_TICK_MS) & (LOGGER_SCHED_WHEEL_SLOTS - 1));
+
+	entry->next = sched->wheel[slot];
+	sched->wheel[slot] = entry;
+}
+
+/****************************************************************************
+* readRows
+*
+* Polls a device and passes its rows to the sink
+****************************************************************************/
+static void readRows(LOGGER_SCHEDULER* sched, LOGGER_SCHED_ENTRY* entry, int64_t nowMs)
+{
+	LOGGER_ADAPTER* adapter = &entry->adapter;
+	int32_t nRows;
+	int32_t reads = 0;
+	int32_t r;
+	int64_t newestMs;
+	int64_t behindMs;
+	int64_t timeMs;
+
+	do
+	{
+		nRows = adapter->poll(adapter->context, entry->values, adapter->maxRows);
+
+		if (nRows < 0)
+		{
+			entry->errors++;
+			return;
+		}
+
+		if (nRows == 0)
+			return;
+
+		if (adapter->pollMs == 0)
+		{
+			// One reading per poll, stamped with the time the poll was due
+			timeMs = entry->dueMs;
+		}
+		else
+		{
+			// Rows were taken on the device clock, keep the newest within a poll of the host clock
+			newestMs = entry->anchorMs + (int64_t)(entry->rows + nRows - 1) * adapter->periodMs + entry->offsetMs;
+			behindMs = nowMs - (int64_t)(adapter->pollMs + adapter->periodMs) - newestMs;
+
+			if (newestMs > nowMs)
+			{
+				entry->offsetMs -= newestMs - nowMs;
+			}
+			else if (behindMs > 0)
+			{
+				entry->offsetMs += (behindMs >> LOGGER_SCHED_SLEW_SHIFT) + 1;
+			}
+
+			timeMs = entry->anchorMs + (int64_t)entry->rows * adapter->periodMs + entry->offsetMs;
+		}
+
+		for (r = 0; r < nRows; r++)
+		{
+			// Never go back past a row already passed on
+			if (timeMs < entry->lastMs)
+				timeMs = entry->lastMs;
+
+			sched->sink(sched->sinkContext, entry->index, adapter->name, timeMs,
+				entry->values + (size_t)r * adapter->nColumns, adapter->nColumns);
+			entry->lastMs = timeMs;
+			timeMs += adapter->periodMs;
+		}
+
+		entry->rows += nRows;
+		sched->rows += nRows;
+	} while (adapter->pollMs != 0 && (uint32_t)nRows == adapter->maxRows && ++reads < CATCH_UP_POLLS);
+}
+
+/****************************************************************************
+* dispatch
+*
+* Runs a due entry and works out when it is next due
+****************************************************************************/
+static void dispatch(LOGGER_SCHEDULER* sched, LOGGER_SCHED_ENTRY* entry, int64_t nowMs)
+{
+	int64_t periodMs = pollPeriodMs(entry);
+	int64_t skipped;
+
+	if (nowMs - entry->dueMs > entry->lateMaxMs)
+	{
+		entry->lateMaxMs = nowMs - entry->dueMs;
+	}
+
+	readRows(sched, entry, nowMs);
+
+	// Due times are counted from the anchor so late polls do not drift
+	entry->polls++;
+	entry->dueMs = entry->anchorMs + (int64_t)entry->polls * periodMs;
+
+	if (entry->dueMs <= nowMs)
+	{
+		skipped = (nowMs - entry->dueMs) / periodMs + 1;
+		entry->missedPolls += skipped;
+		entry->polls += skipped;
+		entry->dueMs += skipped * periodMs;
+	}
+}
+
+/****************************************************************************
+* logger_sched_init
+*
+* Inputs:
+* - sink: called with every row read
+* - sinkContext: passed to the sink, a FILE* for logger_sched_csv_sink
+****************************************************************************/
+void logger_sched_init(LOGGER_SCHEDULER* sched, LOGGER_SCHED_SINK sink, void* sinkContext)
+{
+	memset(sched, 0, sizeof(LOGGER_SCHEDULER));
+	sched->sink = sink;
+	sched->sinkContext = sinkContext;
+}
+
+/****************************************************************************
+* logger_sched_add
+*
+* Adds a device before the scheduler is started
+* Returns:
+* - 1 on success, 0 if the adapter is not valid or there is no room
+****************************************************************************/
+int16_t logger_sched_add(LOGGER_SCHEDULER* sched, const LOGGER_ADAPTER* adapter)
+{
+	LOGGER_SCHED_ENTRY* entry;
+
+	if (sched->nEntries >= LOGGER_SCHED_MAX_ADAPTERS || adapter->poll == NULL || adapter->nColumns == 0 ||
+		adapter->periodMs == 0 || (adapter->pollMs != 0 && adapter->maxRows == 0))
+		return 0;
+
+	entry = &sched->entries[sched->nEntries];
+	memset(entry, 0, sizeof(LOGGER_SCHED_ENTRY));
+	entry->adapter = *adapter;
+	entry->adapter.name[sizeof(entry->adapter.name) - 1] = '\0';
+
+	if (entry->adapter.pollMs == 0)
+	{
+		entry->adapter.maxRows = 1;
+	}
+
+	entry->values = (float*)malloc((size_t)entry->adapter.maxRows * entry->adapter.nColumns * sizeof(float));
+
+	if (entry->values == NULL)
+		return 0;
+
+	entry->index = sched->nEntries++;
+	return 1;
+}
+
+/****************************************************************************
+* logger_sched_start
+*
+* Starts every device and puts it on the wheel. A device that does not
+* start is left out.
+* Returns:
+* - 1 if every device started, 0 otherwise
+****************************************************************************/
+int16_t logger_sched_start(LOGGER_SCHEDULER* sched)
+{
+	LOGGER_SCHED_ENTRY* entry;
+	int16_t allStarted = 1;
+	int64_t nowMs;
+	int16_t e;
+
+	sched->startMs = logger_time_ms();
+	sched->tick = 0;
+	memset(sched->wheel, 0, sizeof(sched->wheel));
+
+	for (e = 0; e < sched->nEntries; e++)
+	{
+		entry = &sched->entries[e];
+
+		if (entry->adapter.start != NULL && !entry->adapter.start(entry->adapter.context))
+		{
+			allStarted = 0;
+			continue;
+		}
+
+		entry->running = 1;
+		nowMs = logger_time_ms() - sched->startMs;
+
+		if (entry->adapter.pollMs == 0)
+		{
+			// Readings of devices with the same period share time stamps
+			entry->anchorMs = (nowMs + entry->adapter.periodMs - 1) / entry->adapter.periodMs * entry->adapter.periodMs;
+			entry->dueMs = entry->anchorMs;
+		}
+		else
+		{
+			// The device has been sampling since it started
+			entry->anchorMs = nowMs;
+			entry->dueMs = nowMs + entry->adapter.pollMs;
+		}
+
+		entry->lastMs = entry->anchorMs;
+		wheelInsert(sched, entry);
+	}
+
+	return allStarted;
+}
+
+/****************************************************************************
+* logger_sched_run_once
+*
+* Polls every device that is due
+* Returns:
+* - milliseconds until the next device is due, at most
+*   LOGGER_SCHED_MAX_WAIT_MS
+****************************************************************************/
+int64_t logger_sched_run_once(LOGGER_SCHEDULER* sched)
+{
+	LOGGER_SCHED_ENTRY* entry;
+	LOGGER_SCHED_ENTRY* next;
+	LOGGER_SCHED_ENTRY* due;
+	int64_t nowMs = logger_time_ms() - sched->startMs;
+	int64_t nowTick = nowMs / LOGGER_SCHED_TICK_MS;
+	int64_t waitMs = LOGGER_SCHED_MAX_WAIT_MS;
+	uint32_t slot;
+	int16_t e;
+
+	sched->wakeups++;
+
+	// Run each slot passed since the last call; the current tick is run again next time
+	for (; sched->tick <= nowTick; sched->tick++)
+	{
+		slot = (uint32_t)(sched->tick & (LOGGER_SCHED_WHEEL_SLOTS - 1));
+		entry = sched->wheel[slot];
+		sched->wheel[slot] = NULL;
+		due = NULL;
+
+		// Entries a whole turn or more away stay in the slot
+		for (; entry != NULL; entry = next)
+		{
+			next = entry->next;
+
+			if (entry->dueMs <= nowMs)
+			{
+				entry->next = due;
+				due = entry;
+			}
+			else
+			{
+				entry->next = sched->wheel[slot];
+				sched->wheel[slot] = entry;
+			}
+		}
+
+		for (entry = due; entry != NULL; entry = next)
+		{
+			next = entry->next;
+			dispatch(sched, entry, nowMs);
+			wheelInsert(sched, entry);
+		}
+	}
+
+	sched->tick = nowTick;
+
+	for (e = 0; e < sched->nEntries; e++)
+	{
+		if (sched->entries[e].running && sched->entries[e].dueMs - nowMs < waitMs)
+		{
+			waitMs = sched->entries[e].dueMs - nowMs;
+		}
+	}
+
+	return waitMs > 0 ? waitMs : 0;
+}
+
+/****************************************************************************
+* logger_sched_run
+*
+* Runs the scheduler until stop returns non-zero, sleeping until each
+* device is due
+****************************************************************************/
+void logger_sched_run(LOGGER_SCHEDULER* sched, LOGGER_SCHED_STOP stop)
+{
+	int64_t waitMs;
+
+	while (!stop())
+	{
+		waitMs = logger_sched_run_once(sched);
+
+		if (waitMs > 0)
+		{
+			sleepMs(waitMs);
+		}
+	}
+}
+
+/****************************************************************************
+* logger_sched_stop
+*
+* Stops every device. The adapters stay added, so the scheduler can be
+* started again.
+****************************************************************************/
+void logger_sched_stop(LOGGER_SCHEDULER* sched)
+{
+	LOGGER_SCHED_ENTRY* entry;
+	int16_t e;
+
+	for (e = 0; e < sched->nEntries; e++)
+	{
+		entry = &sched->entries[e];
+
+		if (entry->running && entry->adapter.stop != NULL)
+		{
+			entry->adapter.stop(entry->adapter.context);
+		}
+
+		entry->running = 0;
+	}
+}
+
+/****************************************************************************
+* logger_sched_free
+*
+* Stops every device and frees the row buffers
+****************************************************************************/
+void logger_sched_free(LOGGER_SCHEDULER* sched)
+{
+	int16_t e;
+
+	logger_sched_stop(sched);
+
+	for (e = 0; e < sched->nEntries; e++)
+	{
+		free(sched->entries[e].values);
+		sched->entries[e].values = NULL;
+	}
+
+	sched->nEntries = 0;
+}
+
+/****************************************************************************
+* logger_sched_print_stats
+****************************************************************************/
+void logger_sched_print_stats(LOGGER_SCHEDULER* sched)
+{
+	LOGGER_SCHED_ENTRY* entry;
+	int64_t elapsedMs = logger_time_ms() - sched->startMs;
+	int16_t e;
+
+	printf("%llu rows in %.1f s, %llu wakeups\n", (unsigned long long)sched->rows, elapsedMs / 1000.0,
+		(unsigned long long)sched->wakeups);
+
+	for (e = 0; e < sched->nEntries; e++)
+	{
+		entry = &sched->entries[e];
+		printf("%-16s every %5u ms: %llu rows, %llu missed polls, %llu errors, latest poll %lld ms late",
+			entry->adapter.name, entry->adapter.periodMs, (unsigned long long)entry->rows,
+			(unsigned long long)entry->missedPolls, (unsigned long long)entry->errors, (long long)entry->lateMaxMs);
+
+		if (entry->adapter.pollMs != 0)
+		{
+			printf(", clock corrected by %lld ms", (long long)entry->offsetMs);
+		}
+
+		printf("\n");
+	}
+}
+
+/****************************************************************************
+* logger_sched_csv_sink
+*
+* Writes each row to the FILE* passed as the sink context as the time in
+* seconds, the adapter name and the values. NaN values are left empty.
+****************************************************************************/
+void logger_sched_csv_sink(void* sinkContext, int16_t adapter, const char* name, int64_t timeMs,
+	const float* values, uint32_t nColumns)
+{
+	FILE* fp = (FILE*)sinkContext;
+	uint32_t c;
+
+	(void)adapter;
+	fprintf(fp, "%.3f, %s", timeMs / 1000.0, name);
+
+	for (c = 0; c < nColumns; c++)
+	{
+		if (isnan(values[c]))
+		{
+			fprintf(fp, ",");
+		}
+		else
+		{
+			fprintf(fp, ", %g", values[c]);
+		}
+	}
+
+	fprintf(fp, "\n");
+}
@@ -0,0 +1,118 @@
+/****************************************************************************
+ *
+ * Filename:    PicoLoggerScheduler.h
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This header defines a scheduler that logs several data loggers of
+ * different families (TC-08, PT-104, PL1000, HRDL, DrDAQ) from one loop
+ * in one thread. Each device is hosted by an adapter giving its natural
+ * sample period and a poll function; the scheduler keeps the adapters on
+ * a timer wheel and sleeps until the next one is due, so no thread spins
+ * or waits on a device that is still converting.
+ *
+ * Every row is stamped on one time base, logger_time_ms (PicoLoggerRing) from when
+ * the scheduler started:
+ *
+ * - Adapters reading one value per poll (pollMs 0) are stamped with the
+ *   time the poll was due. Due times are counted from the start, not from
+ *   the last poll, so late polls do not add up to drift, and polls that
+ *   are missed altogether are skipped and counted.
+ * - Adapters reading rows the device has buffered (pollMs > 0) are
+ *   stamped from the row count and the sample period on the device clock.
+ *   The device clock is pulled back onto the host clock whenever its
+ *   newest row would be in the future or falls behind by more than a
+ *   poll, so rows from every adapter stay comparable over long runs.
+ *
+ * The functions return 1 on success and 0 on failure (like the logger
+ * drivers) so the scheduler does not depend on PicoStatus.h.
+ *
+ ****************************************************************************/
+#ifndef __PICOLOGGERSCHEDULER_H__
+#define __PICOLOGGERSCHEDULER_H__
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define LOGGER_SCHED_MAX_ADAPTERS	16
+#define LOGGER_SCHED_WHEEL_SLOTS	256		// A power of 2
+#define LOGGER_SCHED_TICK_MS		10		// Time of each wheel slot
+#define LOGGER_SCHED_MAX_WAIT_MS	100		// Longest sleep, so a stop request is seen promptly
+#define LOGGER_SCHED_SLEW_SHIFT		3		// A device clock falling behind is pulled in by 1/8 of the error a poll
+
+// Sets the device running, returns 1 on success
+typedef int16_t(*LOGGER_ADAPTER_START)(void* context);
+
+// Reads up to maxRows rows of nColumns values, row by row. Returns the
+// rows read, 0 if none are ready, or -1 on an error.
+typedef int32_t(*LOGGER_ADAPTER_POLL)(void* context, float* values, uint32_t maxRows);
+
+// Stops the device
+typedef void(*LOGGER_ADAPTER_STOP)(void* context);
+
+// Called with each row in the order the rows are read
+typedef void(*LOGGER_SCHED_SINK)(void* sinkContext, int16_t adapter, const char* name, int64_t timeMs,
+	const float* values, uint32_t nColumns);
+
+// Returns non-zero to stop logger_sched_run
+typedef int32_t(*LOGGER_SCHED_STOP)(void);
+
+typedef struct tLoggerAdapter
+{
+	char					name[32];
+	void*					context;
+	uint32_t				nColumns;
+	uint32_t				periodMs;		// Natural sample period of the device
+	uint32_t				pollMs;			// Time between polls of a buffering device, 0 to read one row every periodMs
+	uint32_t				maxRows;		// Most rows a poll can return, 1 if pollMs is 0
+	LOGGER_ADAPTER_START	start;			// May be NULL
+	LOGGER_ADAPTER_POLL		poll;
+	LOGGER_ADAPTER_STOP		stop;			// May be NULL
+}LOGGER_ADAPTER;
+
+typedef struct tLoggerSchedEntry
+{
+	LOGGER_ADAPTER				adapter;
+	int16_t						index;
+	int16_t						running;
+	int64_t						anchorMs;		// Time of the first row
+	uint64_t					polls;			// Polls since the anchor, the next is due at anchorMs + polls * poll period
+	int64_t						dueMs;
+	uint64_t					rows;			// Rows read since the anchor
+	int64_t						offsetMs;		// Drift correction of a buffering device's clock
+	int64_t						lastMs;			// Time of the newest row
+	float*						values;			// maxRows * nColumns
+	uint64_t					missedPolls;
+	uint64_t					errors;
+	int64_t						lateMaxMs;		// Latest a poll ran after it was due
+	struct tLoggerSchedEntry*	next;			// Next entry in the same wheel slot
+}LOGGER_SCHED_ENTRY;
+
+typedef struct tLoggerScheduler
+{
+	LOGGER_SCHED_ENTRY	entries[LOGGER_SCHED_MAX_ADAPTERS];
+	int16_t				nEntries;
+	LOGGER_SCHED_ENTRY*	wheel[LOGGER_SCHED_WHEEL_SLOTS];
+	int64_t				tick;			// Next wheel tick to run
+	int64_t				startMs;
+	LOGGER_SCHED_SINK	sink;
+	void*				sinkContext;
+	uint64_t			wakeups;
+	uint64_t			rows;
+}LOGGER_SCHEDULER;
+
+// Function prototypes
+void logger_sched_init(LOGGER_SCHEDULER* sched, LOGGER_SCHED_SINK sink, void* sinkContext);
+int16_t logger_sched_add(LOGGER_SCHEDULER* sched, const LOGGER_ADAPTER* adapter);
+
+int16_t logger_sched_start(LOGGER_SCHEDULER* sched);
+int64_t logger_sched_run_once(LOGGER_SCHEDULER* sched);
+void logger_sched_run(LOGGER_SCHEDULER* sched, LOGGER_SCHED_STOP stop);
+void logger_sched_stop(LOGGER_SCHEDULER* sched);
+void logger_sched_free(LOGGER_SCHEDULER* sched);
+
+void logger_sched_print_stats(LOGGER_SCHEDULER* sched);
+void logger_sched_csv_sink(void* sinkContext, int16_t adapter, const char* name, int64_t timeMs,
+	const float* values, uint32_t nColumns);
+
+#endif
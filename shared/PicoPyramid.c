@@ -0,0 +1,398 @@
+/****************************************************************************
+ *
+ * Filename:    PicoPyramid.c
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This file defines a min/max decimation pyramid for large captures.
+ * The pyramid is built incrementally as buffers are written and is
+ * saved next to the capture. A query for W pixels reads O(W log N)
+ * pyramid entries and none of the raw samples.
+ *
+ ****************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "./PicoPyramid.h"
+
+/* Headers for Windows */
+#ifdef _WIN32
+#else
+#include <stdlib.h>
+#endif
+
+/****************************************************************************
+* mergeEntry
+****************************************************************************/
+static void mergeEntry(PYRAMID_ENTRY* entry, PYRAMID_ENTRY value)
+{
+	if (value.min < entry->min)
+		entry->min = value.min;
+	if (value.max > entry->max)
+		entry->max = value.max;
+}
+
+/****************************************************************************
+* addEntry
+*
+* Appends an entry to one level, growing the level as needed
+****************************************************************************/
+static PICO_STATUS addEntry(PYRAMID_LEVEL* level, PYRAMID_ENTRY entry)
+{
+	PYRAMID_ENTRY* entries;
+	uint64_t capacity;
+
+	if (level->count == level->capacity)
+	{
+		capacity = level->capacity ? level->capacity * 2 : 1024;
+		entries = (PYRAMID_ENTRY*)realloc(level->entries, (size_t)capacity * sizeof(PYRAMID_ENTRY));
+
+		if (entries == NULL)
+			return PICO_MEMORY;
+
+		level->entries = entries;
+		level->capacity = capacity;
+	}
+
+	level->entries[level->count++] = entry;
+	return PICO_OK;
+}
+
+/****************************************************************************
+* pushBlock
+*
+* Adds a completed level 0 block and carries each completed pair of
+* entries up to the next level
+****************************************************************************/
+static PICO_STATUS pushBlock(PICO_PYRAMID* pyramid, PYRAMID_ENTRY entry)
+{
+	PICO_STATUS status;
+	PYRAMID_LEVEL* level;
+	int16_t l;
+
+	for (l = 0; l < PYRAMID_MAX_LEVELS; l++)
+	{
+		level = &pyramid->level[l];
+
+		if ((status = addEntry(level, entry)) != PICO_OK)
+			return status;
+
+		if (l + 1 > pyramid->nLevels)
+			pyramid->nLevels = l + 1;
+
+		if (level->count & 1)
+			break;
+
+		entry = level->entries[level->count - 2];
+		mergeEntry(&entry, level->entries[level->count - 1]);
+	}
+	return PICO_OK;
+}
+
+/****************************************************************************
+* pyramid_init
+****************************************************************************/
+void pyramid_init(PICO_PYRAMID* pyramid, int16_t channel)
+{
+	memset(pyramid, 0, sizeof(PICO_PYRAMID));
+	pyramid->channel = channel;
+	pyramid->baseShift = PYRAMID_BASE_SHIFT;
+}
+
+/****************************************************************************
+* pyramid_init_aggregated
+*
+* For a pyramid fed with the min/max values of PICO_RATIO_MODE_AGGREGATE
+* data. Sample numbers in pyramid_query stay in raw samples.
+* Inputs:
+* - ratioShift: the downSampleRatio is 2^ratioShift
+****************************************************************************/
+void pyramid_init_aggregated(PICO_PYRAMID* pyramid, int16_t channel, uint32_t ratioShift)
+{
+	pyramid_init(pyramid, channel);
+	pyramid->inputShift = ratioShift;
+
+	if (pyramid->baseShift < ratioShift)
+		pyramid->baseShift = ratioShift;
+}
+
+/****************************************************************************
+* pyramid_free
+****************************************************************************/
+void pyramid_free(PICO_PYRAMID* pyramid)
+{
+	int16_t l;
+
+	for (l = 0; l < PYRAMID_MAX_LEVELS; l++)
+	{
+		free(pyramid->level[l].entries);
+	}
+	memset(pyramid, 0, sizeof(PICO_PYRAMID));
+}
+
+/****************************************************************************
+* pyramid_append
+*
+* Adds the next samples of a channel to the pyramid
+* Inputs:
+* - maxBuffer: samples, or max values for aggregated data
+* - minBuffer: min values for aggregated data, or NULL
+* - dataType: PICO_INT8_T or PICO_INT16_T (see pico_buffer_value)
+* - nSamples: number of values (aggregated values after pyramid_init_aggregated)
+****************************************************************************/
+PICO_STATUS pyramid_append(PICO_PYRAMID* pyramid, const int16_t* maxBuffer, const int16_t* minBuffer,
+	PICO_DATA_TYPE dataType, uint64_t nSamples)
+{
+	PICO_STATUS status;
+	PYRAMID_ENTRY value;
+	uint64_t blockSize = 1ull << (pyramid->baseShift - pyramid->inputShift);	// Values per level 0 block
+	uint64_t i;
+
+	if (pyramid->finished || maxBuffer == NULL)
+		return PICO_INVALID_PARAMETER;
+
+	for (i = 0; i < nSamples; i++)
+	{
+		value.max = pico_buffer_value(maxBuffer, dataType, i);
+		value.min = minBuffer ? pico_buffer_value(minBuffer, dataType, i) : value.max;
+
+		if (pyramid->partialCount == 0)
+			pyramid->partial = value;
+		else
+			mergeEntry(&pyramid->partial, value);
+
+		if (++pyramid->partialCount == blockSize)
+		{
+			if ((status = pushBlock(pyramid, pyramid->partial)) != PICO_OK)
+				return status;
+
+			pyramid->partialCount = 0;
+		}
+	}
+
+	pyramid->nSamples += nSamples << pyramid->inputShift;
+	return PICO_OK;
+}
+
+/****************************************************************************
+* pyramid_finish
+*
+* Adds the last partly filled blocks, so every level covers all samples.
+* No more samples can be appended afterwards.
+****************************************************************************/
+PICO_STATUS pyramid_finish(PICO_PYRAMID* pyramid)
+{
+	PICO_STATUS status;
+	PYRAMID_LEVEL* level;
+	PYRAMID_ENTRY entry;
+	int16_t l;
+
+	if (pyramid->finished)
+		return PICO_OK;
+
+	if (pyramid->partialCount != 0)
+	{
+		if ((status = pushBlock(pyramid, pyramid->partial)) != PICO_OK)
+			return status;
+
+		pyramid->partialCount = 0;
+	}
+
+	// Each level needs ceil(count / 2) entries of the level below. An entry
+	// added here may complete a pair, which is merged before it is carried up.
+	for (l = 0; l + 1 < PYRAMID_MAX_LEVELS && pyramid->level[l].count > 1; l++)
+	{
+		level = &pyramid->level[l];
+
+		if (pyramid->level[l + 1].count < (level->count + 1) / 2)
+		{
+			entry = level->entries[level->count - 1];
+
+			if ((level->count & 1) == 0)
+				mergeEntry(&entry, level->entries[level->count - 2]);
+
+			if ((status = addEntry(&pyramid->level[l + 1], entry)) != PICO_OK)
+				return status;
+		}
+	}
+
+	pyramid->nLevels = l + 1;
+	pyramid->finished = TRUE;
+	return PICO_OK;
+}
+
+/****************************************************************************
+* pyramid_query
+*
+* Returns the min and max value per pixel for samples [startSample, endSample)
+* Pixel edges are rounded out to level 0 blocks. Pixels with no data
+* return min = INT16_MAX and max = INT16_MIN.
+* Inputs:
+* - width: number of pixels (size of minValues and maxValues)
+****************************************************************************/
+PICO_STATUS pyramid_query(PICO_PYRAMID* pyramid, uint64_t startSample, uint64_t endSample,
+	uint32_t width, int16_t* minValues, int16_t* maxValues)
+{
+	PYRAMID_ENTRY result;
+	PYRAMID_ENTRY empty = { INT16_MAX, INT16_MIN };
+	uint64_t blockSize = 1ull << pyramid->baseShift;
+	uint64_t span;
+	uint64_t first;
+	uint64_t last;
+	uint64_t s;
+	uint64_t e;
+	uint32_t pixel;
+	int16_t l;
+
+	if (width == 0 || endSample <= startSample)
+		return PICO_INVALID_PARAMETER;
+
+	span = endSample - startSample;
+
+	for (pixel = 0; pixel < width; pixel++)
+	{
+		first = startSample + span * pixel / width;
+		last = startSample + span * (pixel + 1) / width;
+		if (last == first)
+			last = first + 1;
+
+		// Range of level 0 blocks, split into whole blocks of each level
+		s = first >> pyramid->baseShift;
+		e = (last + blockSize - 1) >> pyramid->baseShift;
+		if (e > pyramid->level[0].count)
+			e = pyramid->level[0].count;
+
+		result = empty;
+
+		for (l = 0; l < pyramid->nLevels && s < e; l++)
+		{
+			if (s & 1)
+				mergeEntry(&result, pyramid->level[l].entries[s++]);
+			if (e & 1)
+				mergeEntry(&result, pyramid->level[l].entries[--e]);
+
+			s >>= 1;
+			e >>= 1;
+		}
+
+		minValues[pixel] = result.min;
+		maxValues[pixel] = result.max;
+	}
+	return PICO_OK;
+}
+
+/****************************************************************************
+* pyramid_write_file
+*
+* Saves one pyramid per channel next to a capture
+****************************************************************************/
+PICO_STATUS pyramid_write_file(const char* fileName, PICO_PYRAMID* pyramids, int16_t nPyramids)
+{
+	FILE* fp = NULL;
+	uint32_t header[3] = { PYRAMID_MAGIC, PYRAMID_VERSION, (uint32_t)nPyramids };
+	int16_t p;
+	int16_t l;
+
+	fopen_s(&fp, fileName, "wb");
+	if (fp == NULL)
+		return PICO_NOT_FOUND;
+
+	fwrite(header, sizeof(header), 1, fp);
+
+	for (p = 0; p < nPyramids; p++)
+	{
+		fwrite(&pyramids[p].channel, sizeof(int16_t), 1, fp);
+		fwrite(&pyramids[p].nLevels, sizeof(int16_t), 1, fp);
+		fwrite(&pyramids[p].baseShift, sizeof(uint32_t), 1, fp);
+		fwrite(&pyramids[p].nSamples, sizeof(uint64_t), 1, fp);
+
+		for (l = 0; l < pyramids[p].nLevels; l++)
+		{
+			fwrite(&pyramids[p].level[l].count, sizeof(uint64_t), 1, fp);
+		}
+
+		for (l = 0; l < pyramids[p].nLevels; l++)
+		{
+			fwrite(pyramids[p].level[l].entries, sizeof(PYRAMID_ENTRY), (size_t)pyramids[p].level[l].count, fp);
+		}
+	}
+
+	fclose(fp);
+	return PICO_OK;
+}
+
+/****************************************************************************
+* pyramid_read_file
+*
+* Loads the pyramids saved by pyramid_write_file. Free each one with
+* pyramid_free.
+****************************************************************************/
+PICO_STATUS pyramid_read_file(const char* fileName, PICO_PYRAMID* pyramids, int16_t maxPyramids, int16_t* nPyramids)
+{
+	FILE* fp = NULL;
+	PICO_STATUS status = PICO_OK;
+	uint32_t header[3];
+	PICO_PYRAMID* pyramid;
+	int16_t p;
+	int16_t l;
+
+	*nPyramids = 0;
+
+	fopen_s(&fp, fileName, "rb");
+	if (fp == NULL)
+		return PICO_NOT_FOUND;
+
+	if (fread(header, sizeof(header), 1, fp) != 1 || header[0] != PYRAMID_MAGIC ||
+		header[1] != PYRAMID_VERSION || header[2] > (uint32_t)maxPyramids)
+	{
+		fclose(fp);
+		return PICO_INVALID_PARAMETER;
+	}
+
+	for (p = 0; p < (int16_t)header[2] && status == PICO_OK; p++)
+	{
+		pyramid = &pyramids[p];
+		pyramid_init(pyramid, 0);
+		(*nPyramids)++;
+
+		if (fread(&pyramid->channel, sizeof(int16_t), 1, fp) != 1 ||
+			fread(&pyramid->nLevels, sizeof(int16_t), 1, fp) != 1 ||
+			fread(&pyramid->baseShift, sizeof(uint32_t), 1, fp) != 1 ||
+			fread(&pyramid->nSamples, sizeof(uint64_t), 1, fp) != 1 ||
+			pyramid->nLevels < 0 || pyramid->nLevels > PYRAMID_MAX_LEVELS)
+		{
+			status = PICO_INVALID_PARAMETER;
+			break;
+		}
+
+		for (l = 0; l < pyramid->nLevels; l++)
+		{
+			if (fread(&pyramid->level[l].count, sizeof(uint64_t), 1, fp) != 1)
+				status = PICO_INVALID_PARAMETER;
+		}
+
+		for (l = 0; l < pyramid->nLevels && status == PICO_OK; l++)
+		{
+			pyramid->level[l].capacity = pyramid->level[l].count;
+			pyramid->level[l].entries = (PYRAMID_ENTRY*)malloc((size_t)pyramid->level[l].count * sizeof(PYRAMID_ENTRY));
+
+			if (pyramid->level[l].entries == NULL)
+				status = PICO_MEMORY;
+			else if (fread(pyramid->level[l].entries, sizeof(PYRAMID_ENTRY), (size_t)pyramid->level[l].count, fp) != pyramid->level[l].count)
+				status = PICO_INVALID_PARAMETER;
+		}
+
+		pyramid->finished = TRUE;
+	}
+
+	fclose(fp);
+
+	if (status != PICO_OK)
+	{
+		for (p = 0; p < *nPyramids; p++)
+		{
+			pyramid_free(&pyramids[p]);
+		}
+		*nPyramids = 0;
+	}
+	return status;
+}
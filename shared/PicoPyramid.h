@@ -0,0 +1,65 @@
+/****************************************************************************
+ *
+ * Filename:    PicoPyramid.h
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This header defines a min/max decimation pyramid for large captures.
+ * Level k holds the min and max of each block of 2^(baseShift + k)
+ * samples (like PICO_RATIO_MODE_AGGREGATE), so an overview of any time
+ * range can be drawn without reading the raw samples.
+ *
+ ****************************************************************************/
+#ifndef __PICOPYRAMID_H__
+#define __PICOPYRAMID_H__
+
+#include "./PicoBuffers.h"
+
+#define PYRAMID_MAGIC		0x52595050	// "PPYR"
+#define PYRAMID_VERSION		1
+// Samples per level 0 block = 2^PYRAMID_BASE_SHIFT
+#define PYRAMID_BASE_SHIFT	4
+#define PYRAMID_MAX_LEVELS	48
+
+typedef struct tPyramidEntry
+{
+	int16_t		min;
+	int16_t		max;
+}PYRAMID_ENTRY;
+
+typedef struct tPyramidLevel
+{
+	PYRAMID_ENTRY*	entries;
+	uint64_t		count;
+	uint64_t		capacity;
+}PYRAMID_LEVEL;
+
+typedef struct tPicoPyramid
+{
+	int16_t			channel;
+	uint32_t		baseShift;
+	uint32_t		inputShift;		// Each appended value covers 2^inputShift samples (aggregated input)
+	uint64_t		nSamples;
+	int16_t			nLevels;
+	int16_t			finished;
+	PYRAMID_ENTRY	partial;		// Level 0 block being filled
+	uint64_t		partialCount;
+	PYRAMID_LEVEL	level[PYRAMID_MAX_LEVELS];
+}PICO_PYRAMID;
+
+// Function prototypes
+void pyramid_init(PICO_PYRAMID* pyramid, int16_t channel);
+void pyramid_init_aggregated(PICO_PYRAMID* pyramid, int16_t channel, uint32_t ratioShift);
+void pyramid_free(PICO_PYRAMID* pyramid);
+
+PICO_STATUS pyramid_append(PICO_PYRAMID* pyramid, const int16_t* maxBuffer, const int16_t* minBuffer,
+	PICO_DATA_TYPE dataType, uint64_t nSamples);
+PICO_STATUS pyramid_finish(PICO_PYRAMID* pyramid);
+
+PICO_STATUS pyramid_query(PICO_PYRAMID* pyramid, uint64_t startSample, uint64_t endSample,
+	uint32_t width, int16_t* minValues, int16_t* maxValues);
+
+PICO_STATUS pyramid_write_file(const char* fileName, PICO_PYRAMID* pyramids, int16_t nPyramids);
+PICO_STATUS pyramid_read_file(const char* fileName, PICO_PYRAMID* pyramids, int16_t maxPyramids, int16_t* nPyramids);
+
+#endif
@@ -0,0 +1,466 @@
+/****************************************************************************
+ *
+ * Filename:    PicoSerialDecode.c
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This file defines UART, SPI and I2C decoders for MSO digital data.
+ * UART start bits are found with the transition index and the bits are
+ * read at their centres. SPI and I2C step through the clock and data
+ * transitions in time order and read the other line at each edge.
+ *
+ ****************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include "./PicoSerialDecode.h"
+
+/****************************************************************************
+* addFrame
+****************************************************************************/
+static PICO_STATUS addFrame(SERIAL_DECODER* decoder, SERIAL_FRAME_TYPE type, uint32_t value, uint32_t value2,
+	uint64_t startSample, uint64_t endSample, uint16_t flags)
+{
+	SERIAL_FRAME* frames;
+	SERIAL_FRAME* frame;
+	uint64_t capacity;
+
+	if (decoder->nFrames == decoder->capacity)
+	{
+		capacity = decoder->capacity ? decoder->capacity * 2 : 256;
+		frames = (SERIAL_FRAME*)realloc(decoder->frames, (size_t)capacity * sizeof(SERIAL_FRAME));
+
+		if (frames == NULL)
+			return PICO_MEMORY;
+
+		decoder->frames = frames;
+		decoder->capacity = capacity;
+	}
+
+	frame = &decoder->frames[decoder->nFrames++];
+	frame->type = type;
+	frame->value = value;
+	frame->value2 = value2;
+	frame->startSample = startSample;
+	frame->endSample = endSample;
+	frame->flags = flags;
+	return PICO_OK;
+}
+
+/****************************************************************************
+* validLine
+****************************************************************************/
+static int16_t validLine(int16_t line)
+{
+	return line >= 0 && line < DIGITAL_MAX_LINES;
+}
+
+/****************************************************************************
+* storeLine
+*
+* The line is in one of the ports the store holds. Optional lines (SPI CS
+* and MISO) that are not set pass.
+****************************************************************************/
+static int16_t storeLine(DIGITAL_STORE* store, int16_t line, int16_t optional)
+{
+	if (optional && !validLine(line))
+		return 1;
+
+	return line >= 0 && line < store->nPorts * DIGITAL_LINES_PER_PORT;
+}
+
+/****************************************************************************
+* decoderLinesInStore
+****************************************************************************/
+static int16_t decoderLinesInStore(SERIAL_DECODER* decoder, DIGITAL_STORE* store)
+{
+	switch (decoder->protocol)
+	{
+		case SERIAL_UART:
+			return storeLine(store, decoder->uart.line, 0);
+
+		case SERIAL_SPI:
+			return storeLine(store, decoder->spi.clockLine, 0) && storeLine(store, decoder->spi.mosiLine, 0) &&
+				storeLine(store, decoder->spi.misoLine, 1) && storeLine(store, decoder->spi.csLine, 1);
+
+		case SERIAL_I2C:
+			return storeLine(store, decoder->i2c.sclLine, 0) && storeLine(store, decoder->i2c.sdaLine, 0);
+
+		default:
+			return 0;
+	}
+}
+
+/****************************************************************************
+* initDecoder
+****************************************************************************/
+static void initDecoder(SERIAL_DECODER* decoder, SERIAL_PROTOCOL protocol)
+{
+	memset(decoder, 0, sizeof(SERIAL_DECODER));
+	decoder->protocol = protocol;
+}
+
+/****************************************************************************
+* bitSample
+*
+* Sample at a position (in bits) after a UART start edge
+****************************************************************************/
+static uint64_t bitSample(uint64_t start, double samplesPerBit, double bits)
+{
+	return start + (uint64_t)(samplesPerBit * bits + 0.5);
+}
+
+/****************************************************************************
+* decodeUart
+****************************************************************************/
+static PICO_STATUS decodeUart(SERIAL_DECODER* decoder, DIGITAL_STORE* store)
+{
+	UART_SETTINGS* uart = &decoder->uart;
+	PICO_STATUS status;
+	DIGITAL_EDGE startEdge = uart->inverted ? DIGITAL_EDGE_RISING : DIGITAL_EDGE_FALLING;
+	int16_t frameBits = 1 + uart->dataBits + (uart->parity != SERIAL_PARITY_NONE) + uart->stopBits;
+	int16_t ones;
+	int16_t bit;
+	int16_t k;
+	uint64_t start;
+	uint64_t lastCentre;
+	uint32_t value;
+	uint16_t flags;
+
+	while (digital_find_edge(store, uart->line, decoder->searchFrom, startEdge, &start) == PICO_OK)
+	{
+		// Wait for the rest of the frame to arrive
+		lastCentre = bitSample(start, uart->samplesPerBit, frameBits - 0.5);
+
+		if (lastCentre >= store->nSamples)
+		{
+			decoder->searchFrom = start;
+			return PICO_OK;
+		}
+
+		// A glitch is not a start bit
+		if ((digital_line_level(store, uart->line, bitSample(start, uart->samplesPerBit, 0.5)) ^ uart->inverted) != 0)
+		{
+			decoder->searchFrom = start + 1;
+			continue;
+		}
+
+		value = 0;
+		ones = 0;
+		flags = 0;
+
+		for (k = 0; k < uart->dataBits; k++)
+		{
+			bit = digital_line_level(store, uart->line, bitSample(start, uart->samplesPerBit, 1.5 + k)) ^ uart->inverted;
+			value |= (uint32_t)bit << k;
+			ones += bit;
+		}
+
+		if (uart->parity != SERIAL_PARITY_NONE)
+		{
+			ones += digital_line_level(store, uart->line, bitSample(start, uart->samplesPerBit, 1.5 + k)) ^ uart->inverted;
+
+			if ((ones & 1) != (uart->parity == SERIAL_PARITY_ODD))
+				flags |= SERIAL_FLAG_PARITY_ERROR;
+			k++;
+		}
+
+		for (; k < frameBits - 1; k++)
+		{
+			if ((digital_line_level(store, uart->line, bitSample(start, uart->samplesPerBit, 1.5 + k)) ^ uart->inverted) == 0)
+				flags |= SERIAL_FLAG_FRAMING_ERROR;
+		}
+
+		if ((status = addFrame(decoder, SERIAL_FRAME_DATA, value, 0, start, bitSample(start, uart->samplesPerBit, frameBits), flags)) != PICO_OK)
+			return status;
+
+		// The next start bit follows the middle of the last stop bit
+		decoder->searchFrom = lastCentre;
+	}
+
+	decoder->searchFrom = store->nSamples;
+	return PICO_OK;
+}
+
+/****************************************************************************
+* decodeSpi
+****************************************************************************/
+static PICO_STATUS decodeSpi(SERIAL_DECODER* decoder, DIGITAL_STORE* store)
+{
+	SPI_SETTINGS* spi = &decoder->spi;
+	PICO_STATUS status;
+	DIGITAL_TRANSITIONS* clock = &store->lines[spi->clockLine];
+	DIGITAL_TRANSITIONS* cs = validLine(spi->csLine) ? &store->lines[spi->csLine] : NULL;
+	int16_t samplingLevel = (spi->cpol == spi->cpha);	// Clock level after the sampling edge
+	uint64_t t;
+	uint32_t mosi;
+	uint32_t miso;
+
+	for (; decoder->nextClock < clock->count; decoder->nextClock++)
+	{
+		t = clock->transitions[decoder->nextClock];
+
+		// Any change of chip select starts a new word
+		if (cs != NULL)
+		{
+			while (decoder->nextData < cs->count && cs->transitions[decoder->nextData] <= t)
+			{
+				decoder->nextData++;
+				decoder->bitCount = 0;
+			}
+
+			if (digital_line_level(store, spi->csLine, t))
+				continue;
+		}
+
+		if (digital_line_level(store, spi->clockLine, t) != samplingLevel)
+			continue;
+
+		mosi = digital_line_level(store, spi->mosiLine, t);
+		miso = validLine(spi->misoLine) ? digital_line_level(store, spi->misoLine, t) : 0;
+
+		if (decoder->bitCount == 0)
+		{
+			decoder->frameStart = t;
+			decoder->shiftIn = 0;
+			decoder->shiftIn2 = 0;
+		}
+
+		if (spi->lsbFirst)
+		{
+			decoder->shiftIn |= mosi << decoder->bitCount;
+			decoder->shiftIn2 |= miso << decoder->bitCount;
+		}
+		else
+		{
+			decoder->shiftIn = (decoder->shiftIn << 1) | mosi;
+			decoder->shiftIn2 = (decoder->shiftIn2 << 1) | miso;
+		}
+
+		if (++decoder->bitCount == spi->bitsPerWord)
+		{
+			if ((status = addFrame(decoder, SERIAL_FRAME_DATA, decoder->shiftIn, decoder->shiftIn2, decoder->frameStart, t, 0)) != PICO_OK)
+				return status;
+
+			decoder->bitCount = 0;
+		}
+	}
+	return PICO_OK;
+}
+
+/****************************************************************************
+* decodeI2c
+****************************************************************************/
+static PICO_STATUS decodeI2c(SERIAL_DECODER* decoder, DIGITAL_STORE* store)
+{
+	I2C_SETTINGS* i2c = &decoder->i2c;
+	PICO_STATUS status = PICO_OK;
+	DIGITAL_TRANSITIONS* scl = &store->lines[i2c->sclLine];
+	DIGITAL_TRANSITIONS* sda = &store->lines[i2c->sdaLine];
+	uint64_t tClock;
+	uint64_t tData;
+	uint32_t bit;
+
+	while (status == PICO_OK && (decoder->nextClock < scl->count || decoder->nextData < sda->count))
+	{
+		tClock = decoder->nextClock < scl->count ? scl->transitions[decoder->nextClock] : UINT64_MAX;
+		tData = decoder->nextData < sda->count ? sda->transitions[decoder->nextData] : UINT64_MAX;
+
+		if (tData < tClock)
+		{
+			decoder->nextData++;
+
+			// SDA changing while SCL is high is a start or stop condition
+			if (!digital_line_level(store, i2c->sclLine, tData))
+				continue;
+
+			if (digital_line_level(store, i2c->sdaLine, tData) == 0)
+			{
+				status = addFrame(decoder, SERIAL_FRAME_START, 0, 0, tData, tData, 0);
+				decoder->inTransfer = 1;
+				decoder->firstByte = 1;
+			}
+			else
+			{
+				status = addFrame(decoder, SERIAL_FRAME_STOP, 0, 0, tData, tData, 0);
+				decoder->inTransfer = 0;
+			}
+			decoder->bitCount = 0;
+			decoder->shiftIn = 0;
+			continue;
+		}
+
+		// A data change on the same sample as the clock is not a start or stop
+		if (tData == tClock)
+			decoder->nextData++;
+
+		decoder->nextClock++;
+
+		// Data is read on the rising edge of SCL
+		if (!decoder->inTransfer || !digital_line_level(store, i2c->sclLine, tClock))
+			continue;
+
+		bit = digital_line_level(store, i2c->sdaLine, tClock);
+
+		if (decoder->bitCount == 0)
+			decoder->frameStart = tClock;
+
+		if (decoder->bitCount < 8)
+		{
+			decoder->shiftIn = (decoder->shiftIn << 1) | bit;
+			decoder->bitCount++;
+			continue;
+		}
+
+		// Ninth bit is the acknowledge (low)
+		if (decoder->firstByte)
+		{
+			status = addFrame(decoder, SERIAL_FRAME_ADDRESS, decoder->shiftIn >> 1, 0, decoder->frameStart, tClock,
+				(uint16_t)((bit ? SERIAL_FLAG_NACK : 0) | ((decoder->shiftIn & 1) ? SERIAL_FLAG_READ : 0)));
+		}
+		else
+		{
+			status = addFrame(decoder, SERIAL_FRAME_DATA, decoder->shiftIn, 0, decoder->frameStart, tClock,
+				(uint16_t)(bit ? SERIAL_FLAG_NACK : 0));
+		}
+
+		decoder->firstByte = 0;
+		decoder->bitCount = 0;
+		decoder->shiftIn = 0;
+	}
+	return status;
+}
+
+/****************************************************************************
+* serial_decoder_init_uart
+****************************************************************************/
+PICO_STATUS serial_decoder_init_uart(SERIAL_DECODER* decoder, const UART_SETTINGS* settings)
+{
+	initDecoder(decoder, SERIAL_UART);
+
+	if (!validLine(settings->line) || settings->samplesPerBit < 2.0 || settings->dataBits < 5 || settings->dataBits > 9 ||
+		settings->stopBits < 1 || settings->stopBits > 2)
+		return PICO_INVALID_PARAMETER;
+
+	decoder->uart = *settings;
+	return PICO_OK;
+}
+
+/****************************************************************************
+* serial_decoder_init_spi
+****************************************************************************/
+PICO_STATUS serial_decoder_init_spi(SERIAL_DECODER* decoder, const SPI_SETTINGS* settings)
+{
+	initDecoder(decoder, SERIAL_SPI);
+
+	if (!validLine(settings->clockLine) || !validLine(settings->mosiLine) || settings->bitsPerWord < 1 || settings->bitsPerWord > 32)
+		return PICO_INVALID_PARAMETER;
+
+	decoder->spi = *settings;
+	return PICO_OK;
+}
+
+/****************************************************************************
+* serial_decoder_init_i2c
+****************************************************************************/
+PICO_STATUS serial_decoder_init_i2c(SERIAL_DECODER* decoder, const I2C_SETTINGS* settings)
+{
+	initDecoder(decoder, SERIAL_I2C);
+
+	if (!validLine(settings->sclLine) || !validLine(settings->sdaLine) || settings->sclLine == settings->sdaLine)
+		return PICO_INVALID_PARAMETER;
+
+	decoder->i2c = *settings;
+	return PICO_OK;
+}
+
+/****************************************************************************
+* serial_decoder_free
+****************************************************************************/
+void serial_decoder_free(SERIAL_DECODER* decoder)
+{
+	free(decoder->frames);
+	decoder->frames = NULL;
+	decoder->nFrames = 0;
+	decoder->capacity = 0;
+}
+
+/****************************************************************************
+* serial_decode
+*
+* Decodes the samples appended to the store since the last call. The
+* new frames are added to decoder->frames.
+* Returns:
+* - PICO_INVALID_PARAMETER if a line of the decoder is in a port the
+*   store does not hold
+****************************************************************************/
+PICO_STATUS serial_decode(SERIAL_DECODER* decoder, DIGITAL_STORE* store)
+{
+	if (!decoderLinesInStore(decoder, store))
+		return PICO_INVALID_PARAMETER;
+
+	switch (decoder->protocol)
+	{
+		case SERIAL_UART:
+			return decodeUart(decoder, store);
+
+		case SERIAL_SPI:
+			return decodeSpi(decoder, store);
+
+		case SERIAL_I2C:
+			return decodeI2c(decoder, store);
+
+		default:
+			return PICO_INVALID_PARAMETER;
+	}
+}
+
+/****************************************************************************
+* serial_write_frames
+*
+* Writes the decoded frames as text and removes them from the decoder
+* Inputs:
+* - fp: output file (or stdout)
+* - timeInterval: sample interval in seconds
+****************************************************************************/
+void serial_write_frames(SERIAL_DECODER* decoder, FILE* fp, double timeInterval)
+{
+	const char* protocols[] = { "UART", "SPI", "I2C" };
+	SERIAL_FRAME* frame;
+	uint64_t i;
+
+	for (i = 0; i < decoder->nFrames; i++)
+	{
+		frame = &decoder->frames[i];
+
+		fprintf(fp, "%14.9f s  %-4s ", frame->startSample * timeInterval, protocols[decoder->protocol]);
+
+		switch (frame->type)
+		{
+			case SERIAL_FRAME_START:
+				fprintf(fp, "Start");
+				break;
+
+			case SERIAL_FRAME_STOP:
+				fprintf(fp, "Stop");
+				break;
+
+			case SERIAL_FRAME_ADDRESS:
+				fprintf(fp, "Address 0x%02X %s", frame->value, (frame->flags & SERIAL_FLAG_READ) ? "Read" : "Write");
+				break;
+
+			default:
+				fprintf(fp, "Data 0x%02X", frame->value);
+
+				if (decoder->protocol == SERIAL_SPI && validLine(decoder->spi.misoLine))
+					fprintf(fp, " MISO 0x%02X", frame->value2);
+				break;
+		}
+
+		fprintf(fp, "%s%s%s\n",
+			(frame->flags & SERIAL_FLAG_PARITY_ERROR) ? " Parity error" : "",
+			(frame->flags & SERIAL_FLAG_FRAMING_ERROR) ? " Framing error" : "",
+			(frame->flags & SERIAL_FLAG_NACK) ? " NACK" : "");
+	}
+
+	decoder->nFrames = 0;
+}
@@ -0,0 +1,120 @@
+/****************************************************************************
+ *
+ * Filename:    PicoSerialDecode.h
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This header defines UART, SPI and I2C decoders for MSO digital data.
+ * The decoders read the transition index of a DIGITAL_STORE, so they
+ * step from edge to edge instead of testing every sample. Each call to
+ * serial_decode continues from where the previous call stopped, so the
+ * decoders can run on each streaming chunk as it is appended.
+ *
+ ****************************************************************************/
+#ifndef __PICOSERIALDECODE_H__
+#define __PICOSERIALDECODE_H__
+
+#include <stdio.h>
+#include "./PicoDigital.h"
+
+#define SERIAL_NO_LINE	-1
+
+// Frame flags
+#define SERIAL_FLAG_PARITY_ERROR	0x0001	// UART
+#define SERIAL_FLAG_FRAMING_ERROR	0x0002	// UART stop bit low
+#define SERIAL_FLAG_NACK			0x0004	// I2C no acknowledge
+#define SERIAL_FLAG_READ			0x0008	// I2C read address
+
+typedef enum enSerialProtocol
+{
+	SERIAL_UART,
+	SERIAL_SPI,
+	SERIAL_I2C
+}SERIAL_PROTOCOL;
+
+typedef enum enSerialParity
+{
+	SERIAL_PARITY_NONE,
+	SERIAL_PARITY_EVEN,
+	SERIAL_PARITY_ODD
+}SERIAL_PARITY;
+
+typedef enum enSerialFrameType
+{
+	SERIAL_FRAME_DATA,			// UART character, SPI word or I2C data byte
+	SERIAL_FRAME_START,			// I2C start or repeated start
+	SERIAL_FRAME_ADDRESS,		// I2C 7-bit address
+	SERIAL_FRAME_STOP			// I2C stop
+}SERIAL_FRAME_TYPE;
+
+typedef struct tSerialFrame
+{
+	SERIAL_FRAME_TYPE	type;
+	uint32_t			value;			// UART / I2C data, SPI MOSI
+	uint32_t			value2;			// SPI MISO
+	uint64_t			startSample;
+	uint64_t			endSample;
+	uint16_t			flags;
+}SERIAL_FRAME;
+
+typedef struct tUartSettings
+{
+	int16_t			line;
+	double			samplesPerBit;	// Sample rate / baud rate
+	int16_t			dataBits;		// 5 to 9
+	SERIAL_PARITY	parity;
+	int16_t			stopBits;
+	int16_t			inverted;		// Idle low
+}UART_SETTINGS;
+
+typedef struct tSpiSettings
+{
+	int16_t		clockLine;
+	int16_t		mosiLine;
+	int16_t		misoLine;		// SERIAL_NO_LINE if not used
+	int16_t		csLine;			// Active low, SERIAL_NO_LINE if not used
+	int16_t		cpol;
+	int16_t		cpha;
+	int16_t		bitsPerWord;	// 1 to 32
+	int16_t		lsbFirst;
+}SPI_SETTINGS;
+
+typedef struct tI2cSettings
+{
+	int16_t		sclLine;
+	int16_t		sdaLine;
+}I2C_SETTINGS;
+
+typedef struct tSerialDecoder
+{
+	SERIAL_PROTOCOL	protocol;
+	UART_SETTINGS	uart;
+	SPI_SETTINGS	spi;
+	I2C_SETTINGS	i2c;
+	// Decoder state
+	uint64_t		searchFrom;		// UART: first sample to search for a start bit
+	uint64_t		nextClock;		// SPI / I2C: next SCL or SPI clock transition
+	uint64_t		nextData;		// SPI: next CS transition, I2C: next SDA transition
+	int16_t			bitCount;
+	uint32_t		shiftIn;
+	uint32_t		shiftIn2;
+	uint64_t		frameStart;
+	int16_t			inTransfer;		// I2C: between start and stop
+	int16_t			firstByte;		// I2C: next byte is an address
+	// Decoded frames, see serial_write_frames
+	SERIAL_FRAME*	frames;
+	uint64_t		nFrames;
+	uint64_t		capacity;
+}SERIAL_DECODER;
+
+// Function prototypes
+PICO_STATUS serial_decoder_init_uart(SERIAL_DECODER* decoder, const UART_SETTINGS* settings);
+PICO_STATUS serial_decoder_init_spi(SERIAL_DECODER* decoder, const SPI_SETTINGS* settings);
+PICO_STATUS serial_decoder_init_i2c(SERIAL_DECODER* decoder, const I2C_SETTINGS* settings);
+void serial_decoder_free(SERIAL_DECODER* decoder);
+
+PICO_STATUS serial_decode(SERIAL_DECODER* decoder, DIGITAL_STORE* store);
+
+void serial_write_frames(SERIAL_DECODER* decoder, FILE* fp, double timeInterval);
+
+#endif
@@ -0,0 +1,220 @@
+/****************************************************************************
+ *
+ * Filename:    PicoSlidingWindow.c
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This file defines a constant-time sliding window for data loggers (see
+ * PicoSlidingWindow.h).
+ *
+ ****************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "./PicoSlidingWindow.h"
+
+/****************************************************************************
+* dequeBack
+****************************************************************************/
+static uint64_t dequeBack(const SLIDING_WINDOW* window, const WINDOW_DEQUE* deque)
+{
+	return deque->index[(deque->head + deque->size - 1) % window->capacity];
+}
+
+/****************************************************************************
+* dequeFront
+****************************************************************************/
+static uint64_t dequeFront(const WINDOW_DEQUE* deque)
+{
+	return deque->index[deque->head];
+}
+
+/****************************************************************************
+* dequePush
+*
+* Adds the newest sample, first removing the samples at the back it
+* makes irrelevant: for the minimum deque those not below it, for the
+* maximum deque those not above it
+****************************************************************************/
+static void dequePush(SLIDING_WINDOW* window, WINDOW_DEQUE* deque, uint64_t sample, float value, int16_t isMaximum)
+{
+	float back;
+
+	while (deque->size > 0)
+	{
+		back = window->values[dequeBack(window, deque) % window->capacity];
+
+		if (isMaximum ? back > value : back < value)
+			break;
+
+		deque->size--;
+	}
+
+	deque->index[(deque->head + deque->size) % window->capacity] = sample;
+	deque->size++;
+}
+
+/****************************************************************************
+* dequeExpire
+*
+* Removes the front sample if it has left the window
+****************************************************************************/
+static void dequeExpire(SLIDING_WINDOW* window, WINDOW_DEQUE* deque, uint64_t oldest)
+{
+	if (deque->size > 0 && dequeFront(deque) < oldest)
+	{
+		deque->head = (deque->head + 1) % window->capacity;
+		deque->size--;
+	}
+}
+
+/****************************************************************************
+* window_init
+*
+* Inputs:
+* - capacity: window length in samples
+* Returns:
+* - 1 on success, 0 on failure
+****************************************************************************/
+int16_t window_init(SLIDING_WINDOW* window, uint32_t capacity)
+{
+	memset(window, 0, sizeof(SLIDING_WINDOW));
+
+	if (capacity == 0)
+		return 0;
+
+	window->capacity = capacity;
+	window->values = (float*)malloc(capacity * sizeof(float));
+	window->minimum.index = (uint64_t*)malloc(capacity * sizeof(uint64_t));
+	window->maximum.index = (uint64_t*)malloc(capacity * sizeof(uint64_t));
+
+	if (window->values == NULL || window->minimum.index == NULL || window->maximum.index == NULL)
+	{
+		window_free(window);
+		return 0;
+	}
+
+	return 1;
+}
+
+/****************************************************************************
+* window_free
+****************************************************************************/
+void window_free(SLIDING_WINDOW* window)
+{
+	free(window->values);
+	free(window->minimum.index);
+	free(window->maximum.index);
+	memset(window, 0, sizeof(SLIDING_WINDOW));
+}
+
+/****************************************************************************
+* window_reset
+*
+* Empties the window
+****************************************************************************/
+void window_reset(SLIDING_WINDOW* window)
+{
+	window->count = 0;
+	window->sum = 0;
+	window->sumSquares = 0;
+	window->minimum.head = window->minimum.size = 0;
+	window->maximum.head = window->maximum.size = 0;
+}
+
+/****************************************************************************
+* window_push
+*
+* Adds a sample, dropping the oldest once the window is full
+****************************************************************************/
+void window_push(SLIDING_WINDOW* window, float value)
+{
+	uint64_t sample = window->count;
+	uint32_t slot = (uint32_t)(sample % window->capacity);
+	float oldest;
+	uint32_t i;
+
+	if (sample >= window->capacity)
+	{
+		oldest = window->values[slot];
+		window->sum -= oldest;
+		window->sumSquares -= (double)oldest * oldest;
+
+		dequeExpire(window, &window->minimum, sample - window->capacity + 1);
+		dequeExpire(window, &window->maximum, sample - window->capacity + 1);
+	}
+
+	window->values[slot] = value;
+	window->sum += value;
+	window->sumSquares += (double)value * value;
+	window->count++;
+
+	dequePush(window, &window->minimum, sample, value, 0);
+	dequePush(window, &window->maximum, sample, value, 1);
+
+	// Once in a while, add the window up again
+	if (window->count % ((uint64_t)window->capacity * WINDOW_RESUM_PERIODS) == 0)
+	{
+		window->sum = 0;
+		window->sumSquares = 0;
+
+		for (i = 0; i < window->capacity; i++)
+		{
+			window->sum += window->values[i];
+			window->sumSquares += (double)window->values[i] * window->values[i];
+		}
+	}
+}
+
+/****************************************************************************
+* window_length
+*
+* Returns:
+* - the samples in the window, less than the capacity until it fills
+****************************************************************************/
+uint32_t window_length(const SLIDING_WINDOW* window)
+{
+	return window->count < window->capacity ? (uint32_t)window->count : window->capacity;
+}
+
+/****************************************************************************
+* window_min
+****************************************************************************/
+float window_min(const SLIDING_WINDOW* window)
+{
+	if (window->minimum.size == 0)
+		return NAN;
+
+	return window->values[dequeFront(&window->minimum) % window->capacity];
+}
+
+/****************************************************************************
+* window_max
+****************************************************************************/
+float window_max(const SLIDING_WINDOW* window)
+{
+	if (window->maximum.size == 0)
+		return NAN;
+
+	return window->values[dequeFront(&window->maximum) % window->capacity];
+}
+
+/****************************************************************************
+* window_mean
+****************************************************************************/
+double window_mean(const SLIDING_WINDOW* window)
+{
+	uint32_t length = window_length(window);
+
+	return length ? window->sum / length : NAN;
+}
+
+/****************************************************************************
+* window_rms
+****************************************************************************/
+double window_rms(const SLIDING_WINDOW* window)
+{
+	uint32_t length = window_length(window);
+
+	return length ? sqrt((window->sumSquares > 0 ? window->sumSquares : 0) / length) : NAN;
+}
@@ -0,0 +1,58 @@
+/****************************************************************************
+ *
+ * Filename:    PicoSlidingWindow.h
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This header defines a sliding window over the last N samples of one
+ * channel for data loggers. Each new sample updates the mean, minimum,
+ * maximum and RMS of the window in constant time: the sum and sum of
+ * squares are updated with the sample entering and the sample leaving,
+ * and the minimum and maximum come from monotonic deques, so the window
+ * is never scanned again. Logging only the samples that arrived since
+ * the last read then gives the same figures as reading the whole window
+ * each time.
+ *
+ * The functions return 1 on success and 0 on failure (like the logger
+ * drivers) so the window does not depend on PicoStatus.h.
+ *
+ ****************************************************************************/
+#ifndef __PICOSLIDINGWINDOW_H__
+#define __PICOSLIDINGWINDOW_H__
+
+#include <stdint.h>
+
+#define WINDOW_RESUM_PERIODS	64	// The sums are recomputed every this many window lengths to stop rounding errors building up
+
+typedef struct tWindowDeque
+{
+	uint64_t*	index;		// Sample numbers, capacity entries
+	uint32_t	head;
+	uint32_t	size;
+}WINDOW_DEQUE;
+
+typedef struct tSlidingWindow
+{
+	uint32_t		capacity;	// Window length in samples
+	float*			values;		// The last capacity samples, by sample number % capacity
+	uint64_t		count;		// Samples pushed
+	double			sum;
+	double			sumSquares;
+	WINDOW_DEQUE	minimum;	// Rising values, the front is the minimum
+	WINDOW_DEQUE	maximum;	// Falling values, the front is the maximum
+}SLIDING_WINDOW;
+
+// Function prototypes
+int16_t window_init(SLIDING_WINDOW* window, uint32_t capacity);
+void window_free(SLIDING_WINDOW* window);
+void window_reset(SLIDING_WINDOW* window);
+
+void window_push(SLIDING_WINDOW* window, float value);
+
+uint32_t window_length(const SLIDING_WINDOW* window);
+float window_min(const SLIDING_WINDOW* window);
+float window_max(const SLIDING_WINDOW* window);
+double window_mean(const SLIDING_WINDOW* window);
+double window_rms(const SLIDING_WINDOW* window);
+
+#endif
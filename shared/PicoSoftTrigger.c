@@ -0,0 +1,450 @@
+/****************************************************************************
+ *
+ * Filename:    PicoSoftTrigger.c
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This file defines a software trigger for continuous streams.
+ * The source channel is tested a block of samples at a time with a
+ * branch-free compare loop, so most blocks are passed over without
+ * looking at individual samples.
+ *
+ ****************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include "./PicoSoftTrigger.h"
+
+/****************************************************************************
+* findInRange
+*
+* Returns the offset of the first sample in [low, high], or n if none
+****************************************************************************/
+static uint32_t findInRange(const int16_t* data, uint32_t n, int32_t low, int32_t high)
+{
+	uint32_t i = 0;
+	uint32_t j;
+	int32_t hit;
+
+	for (; i + SOFT_TRIGGER_SCAN_BLOCK <= n; i += SOFT_TRIGGER_SCAN_BLOCK)
+	{
+		hit = 0;
+		for (j = 0; j < SOFT_TRIGGER_SCAN_BLOCK; j++)
+		{
+			hit |= (data[i + j] >= low) & (data[i + j] <= high);
+		}
+
+		if (hit)
+			break;
+	}
+
+	for (; i < n; i++)
+	{
+		if (data[i] >= low && data[i] <= high)
+			return i;
+	}
+	return n;
+}
+
+/****************************************************************************
+* findOutOfRange
+*
+* Returns the offset of the first sample outside [low, high], or n if none
+****************************************************************************/
+static uint32_t findOutOfRange(const int16_t* data, uint32_t n, int32_t low, int32_t high)
+{
+	uint32_t i = 0;
+	uint32_t j;
+	int32_t hit;
+
+	for (; i + SOFT_TRIGGER_SCAN_BLOCK <= n; i += SOFT_TRIGGER_SCAN_BLOCK)
+	{
+		hit = 0;
+		for (j = 0; j < SOFT_TRIGGER_SCAN_BLOCK; j++)
+		{
+			hit |= (data[i + j] < low) | (data[i + j] > high);
+		}
+
+		if (hit)
+			break;
+	}
+
+	for (; i < n; i++)
+	{
+		if (data[i] < low || data[i] > high)
+			return i;
+	}
+	return n;
+}
+
+/****************************************************************************
+* getRanges
+*
+* The source enters state 1 on a sample in [enterLow, enterHigh] and
+* returns to state 0 on a sample outside [stayLow, stayHigh]
+****************************************************************************/
+static void getRanges(SOFT_TRIGGER_SETTINGS* settings, int32_t* enterLow, int32_t* enterHigh, int32_t* stayLow, int32_t* stayHigh)
+{
+	int32_t upper = settings->thresholdUpper;
+	int32_t lower = settings->thresholdLower;
+	int32_t hysteresis = settings->hysteresis;
+
+	switch (settings->type)
+	{
+		case SOFT_TRIGGER_FALLING:
+			// Falls through the threshold, re-arms above threshold + hysteresis
+			*enterLow = upper + hysteresis;
+			*enterHigh = INT32_MAX;
+			*stayLow = upper + 1;
+			*stayHigh = INT32_MAX;
+			break;
+
+		case SOFT_TRIGGER_ENTER:
+		case SOFT_TRIGGER_EXIT:
+		case SOFT_TRIGGER_ENTER_OR_EXIT:
+			*enterLow = lower + hysteresis;
+			*enterHigh = upper - hysteresis;
+			*stayLow = lower;
+			*stayHigh = upper;
+			break;
+
+		default:
+			// Rises through the threshold, re-arms below threshold - hysteresis
+			*enterLow = upper;
+			*enterHigh = INT32_MAX;
+			*stayLow = upper - hysteresis + 1;
+			*stayHigh = INT32_MAX;
+			break;
+	}
+}
+
+/****************************************************************************
+* pulseQualifies
+****************************************************************************/
+static int16_t pulseQualifies(SOFT_TRIGGER* trigger, uint64_t width)
+{
+	SOFT_TRIGGER_SETTINGS* settings = &trigger->settings;
+
+	if (settings->pwqType == SOFT_PWQ_NONE)
+		return 1;
+
+	if (!trigger->haveCrossing)
+		return 0;
+
+	switch (settings->pwqType)
+	{
+		case SOFT_PWQ_LESS_THAN:
+			return width < settings->pwqLower;
+
+		case SOFT_PWQ_GREATER_THAN:
+			return width > settings->pwqLower;
+
+		case SOFT_PWQ_IN_RANGE:
+			return width >= settings->pwqLower && width <= settings->pwqUpper;
+
+		case SOFT_PWQ_OUT_OF_RANGE:
+			return width < settings->pwqLower || width > settings->pwqUpper;
+
+		default:
+			return 1;
+	}
+}
+
+/****************************************************************************
+* crossing
+*
+* Called at every change of state of the source
+****************************************************************************/
+static void crossing(SOFT_TRIGGER* trigger, uint64_t sample)
+{
+	SOFT_TRIGGER_SETTINGS* settings = &trigger->settings;
+	int16_t rising = trigger->state;
+	uint64_t width = trigger->haveCrossing ? sample - trigger->lastCrossing : 0;
+	int16_t wanted;
+	uint32_t k;
+
+	switch (settings->type)
+	{
+		case SOFT_TRIGGER_RISING:
+		case SOFT_TRIGGER_ENTER:
+			wanted = rising;
+			break;
+
+		case SOFT_TRIGGER_FALLING:
+		case SOFT_TRIGGER_EXIT:
+			wanted = !rising;
+			break;
+
+		default:
+			wanted = 1;
+			break;
+	}
+
+	if (wanted && pulseQualifies(trigger, width)
+		&& !(trigger->haveTrigger && sample - trigger->lastTrigger < settings->holdoff))
+	{
+		if (trigger->nPending == SOFT_TRIGGER_MAX_PENDING)
+		{
+			trigger->nMissed++;
+		}
+		else
+		{
+			k = (trigger->pendingHead + trigger->nPending++) % SOFT_TRIGGER_MAX_PENDING;
+			trigger->pending[k] = sample;
+			trigger->pendingRising[k] = rising;
+			trigger->pendingWidth[k] = width;
+			trigger->lastTrigger = sample;
+			trigger->haveTrigger = 1;
+		}
+	}
+
+	trigger->lastCrossing = sample;
+	trigger->haveCrossing = 1;
+}
+
+/****************************************************************************
+* emitEvent
+*
+* Cuts the record of the oldest pending trigger from the history ring
+****************************************************************************/
+static void emitEvent(SOFT_TRIGGER* trigger)
+{
+	SOFT_TRIGGER_EVENT* event = &trigger->event;
+	uint64_t triggerSample = trigger->pending[trigger->pendingHead];
+	uint64_t last = triggerSample + trigger->settings.postTrigger;
+	uint64_t ringLength = trigger->ringMask + 1;
+	uint64_t index;
+	uint64_t first;
+	uint32_t part;
+	int16_t ch;
+
+	if (last > trigger->nSamples)
+		last = trigger->nSamples;
+
+	event->preSamples = (triggerSample < trigger->settings.preTrigger) ? (uint32_t)triggerSample : trigger->settings.preTrigger;
+	first = triggerSample - event->preSamples;
+
+	event->eventNumber = trigger->nEvents++;
+	event->triggerSample = triggerSample;
+	event->firstSample = first;
+	event->nSamples = (uint32_t)(last - first);
+	event->rising = trigger->pendingRising[trigger->pendingHead];
+	event->pulseWidth = trigger->pendingWidth[trigger->pendingHead];
+
+	// The record may wrap around the end of the ring
+	index = first & trigger->ringMask;
+	part = (index + event->nSamples > ringLength) ? (uint32_t)(ringLength - index) : event->nSamples;
+
+	for (ch = 0; ch < trigger->nChannels; ch++)
+	{
+		memcpy(event->data[ch], trigger->ring[ch] + index, part * sizeof(int16_t));
+		memcpy(event->data[ch] + part, trigger->ring[ch], (event->nSamples - part) * sizeof(int16_t));
+	}
+
+	trigger->pendingHead = (trigger->pendingHead + 1) % SOFT_TRIGGER_MAX_PENDING;
+	trigger->nPending--;
+
+	trigger->callback(event, trigger->parameter);
+}
+
+/****************************************************************************
+* scan
+*
+* Looks for crossings in samples [from, trigger->nSamples) of the ring
+****************************************************************************/
+static void scan(SOFT_TRIGGER* trigger, uint64_t from)
+{
+	int16_t* source = trigger->ring[trigger->settings.source];
+	uint64_t ringLength = trigger->ringMask + 1;
+	uint64_t index;
+	uint32_t length;
+	uint32_t offset;
+	int32_t enterLow, enterHigh, stayLow, stayHigh;
+
+	getRanges(&trigger->settings, &enterLow, &enterHigh, &stayLow, &stayHigh);
+
+	while (from < trigger->nSamples)
+	{
+		index = from & trigger->ringMask;
+		length = (uint32_t)(trigger->nSamples - from);
+
+		if (index + length > ringLength)
+			length = (uint32_t)(ringLength - index);
+
+		if (trigger->state)
+			offset = findOutOfRange(source + index, length, stayLow, stayHigh);
+		else
+			offset = findInRange(source + index, length, enterLow, enterHigh);
+
+		from += offset;
+
+		if (offset < length)
+		{
+			trigger->state = !trigger->state;
+			crossing(trigger, from);
+			from++;
+		}
+	}
+}
+
+/****************************************************************************
+* processChunk
+*
+* Appends up to maxChunk samples (16 or 8-bit), then scans them
+****************************************************************************/
+static void processChunk(SOFT_TRIGGER* trigger, void** buffers, int16_t bytesPerSample, uint32_t offset, uint32_t nSamples)
+{
+	uint64_t start = trigger->nSamples;
+	uint64_t index;
+	uint32_t i;
+	int16_t ch;
+	int16_t* ring;
+	int32_t enterLow, enterHigh, stayLow, stayHigh;
+
+	for (ch = 0; ch < trigger->nChannels; ch++)
+	{
+		ring = trigger->ring[ch];
+
+		for (i = 0, index = start & trigger->ringMask; i < nSamples; i++, index = (index + 1) & trigger->ringMask)
+		{
+			ring[index] = (bytesPerSample == 1) ? (int16_t)(((int8_t*)buffers[ch])[offset + i] * 256)
+				: ((int16_t*)buffers[ch])[offset + i];
+		}
+	}
+
+	trigger->nSamples += nSamples;
+
+	if (start == 0)
+	{
+		// The first sample sets the initial state
+		getRanges(&trigger->settings, &enterLow, &enterHigh, &stayLow, &stayHigh);
+		trigger->state = trigger->ring[trigger->settings.source][0] >= enterLow && trigger->ring[trigger->settings.source][0] <= enterHigh;
+		start = 1;
+	}
+
+	scan(trigger, start);
+
+	while (trigger->nPending > 0 && trigger->pending[trigger->pendingHead] + trigger->settings.postTrigger <= trigger->nSamples)
+	{
+		emitEvent(trigger);
+	}
+}
+
+/****************************************************************************
+* soft_trigger_init
+*
+* Inputs:
+* - settings: source channel, thresholds, pulse width qualifier and the
+*   length of the records
+* - nChannels: number of buffers passed to soft_trigger_process
+* - maxChunk: longest block expected per call (longer blocks are split)
+* - callback: called with each completed event. The event data is only
+*   valid during the call.
+****************************************************************************/
+PICO_STATUS soft_trigger_init(SOFT_TRIGGER* trigger, const SOFT_TRIGGER_SETTINGS* settings, int16_t nChannels, uint32_t maxChunk,
+	SOFT_TRIGGER_CALLBACK callback, void* parameter)
+{
+	uint64_t ringLength = 1;
+	int16_t ch;
+
+	memset(trigger, 0, sizeof(SOFT_TRIGGER));
+
+	if (nChannels <= 0 || nChannels > SOFT_TRIGGER_MAX_CHANNELS || settings->source < 0 || settings->source >= nChannels
+		|| maxChunk == 0 || callback == NULL)
+	{
+		return PICO_INVALID_PARAMETER;
+	}
+
+	trigger->settings = *settings;
+	trigger->nChannels = nChannels;
+	trigger->maxChunk = maxChunk;
+	trigger->callback = callback;
+	trigger->parameter = parameter;
+	trigger->event.nChannels = nChannels;
+
+	// Room for a whole record plus the block being appended
+	while (ringLength < (uint64_t)settings->preTrigger + settings->postTrigger + maxChunk + 1)
+	{
+		ringLength <<= 1;
+	}
+	trigger->ringMask = ringLength - 1;
+
+	for (ch = 0; ch < nChannels; ch++)
+	{
+		trigger->ring[ch] = (int16_t*)malloc((size_t)ringLength * sizeof(int16_t));
+		trigger->event.data[ch] = (int16_t*)malloc(((size_t)settings->preTrigger + settings->postTrigger + 1) * sizeof(int16_t));
+
+		if (trigger->ring[ch] == NULL || trigger->event.data[ch] == NULL)
+		{
+			soft_trigger_free(trigger);
+			return PICO_MEMORY;
+		}
+	}
+	return PICO_OK;
+}
+
+/****************************************************************************
+* soft_trigger_free
+****************************************************************************/
+void soft_trigger_free(SOFT_TRIGGER* trigger)
+{
+	int16_t ch;
+
+	for (ch = 0; ch < SOFT_TRIGGER_MAX_CHANNELS; ch++)
+	{
+		free(trigger->ring[ch]);
+		free(trigger->event.data[ch]);
+		trigger->ring[ch] = NULL;
+		trigger->event.data[ch] = NULL;
+	}
+}
+
+/****************************************************************************
+* soft_trigger_process
+*
+* Adds the next samples of each channel (ADC counts) and calls the
+* callback for every event whose post-trigger samples are complete
+****************************************************************************/
+PICO_STATUS soft_trigger_process(SOFT_TRIGGER* trigger, int16_t** buffers, uint32_t nSamples)
+{
+	uint32_t done;
+	uint32_t n;
+
+	for (done = 0; done < nSamples; done += n)
+	{
+		n = (nSamples - done > trigger->maxChunk) ? trigger->maxChunk : nSamples - done;
+		processChunk(trigger, (void**)buffers, sizeof(int16_t), done, n);
+	}
+	return PICO_OK;
+}
+
+/****************************************************************************
+* soft_trigger_process_int8
+*
+* As soft_trigger_process for 8-bit data (PICO_INT8_T), scaled by 256
+****************************************************************************/
+PICO_STATUS soft_trigger_process_int8(SOFT_TRIGGER* trigger, int8_t** buffers, uint32_t nSamples)
+{
+	uint32_t done;
+	uint32_t n;
+
+	for (done = 0; done < nSamples; done += n)
+	{
+		n = (nSamples - done > trigger->maxChunk) ? trigger->maxChunk : nSamples - done;
+		processChunk(trigger, (void**)buffers, sizeof(int8_t), done, n);
+	}
+	return PICO_OK;
+}
+
+/****************************************************************************
+* soft_trigger_flush
+*
+* Emits the pending events at the end of a stream with the post-trigger
+* samples received so far
+****************************************************************************/
+void soft_trigger_flush(SOFT_TRIGGER* trigger)
+{
+	while (trigger->nPending > 0)
+	{
+		emitEvent(trigger);
+	}
+}
@@ -0,0 +1,118 @@
+/****************************************************************************
+ *
+ * Filename:    PicoSoftTrigger.h
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This header defines a software trigger for continuous streams.
+ * The last samples of every channel are kept in a history ring and the
+ * source channel is scanned for edges or window entry/exit with
+ * hysteresis and an optional pulse width qualifier. Each trigger cuts
+ * its own pre- and post-trigger record from the ring, so the trigger
+ * re-arms immediately and can fire any number of times during a stream.
+ *
+ ****************************************************************************/
+#ifndef __PICOSOFTTRIGGER_H__
+#define __PICOSOFTTRIGGER_H__
+
+#include <stdint.h>
+
+/* PicoStatus.h of the driver being built, from its include directory (AM_CPPFLAGS on Linux) */
+#ifndef PICO_OK
+#include "PicoStatus.h"
+#endif
+
+#define SOFT_TRIGGER_MAX_CHANNELS	8
+#define SOFT_TRIGGER_MAX_PENDING	256		// Events waiting for their post-trigger samples
+#define SOFT_TRIGGER_SCAN_BLOCK		64		// Samples tested together when looking for a crossing
+
+typedef enum enSoftTriggerType
+{
+	SOFT_TRIGGER_RISING,
+	SOFT_TRIGGER_FALLING,
+	SOFT_TRIGGER_RISING_OR_FALLING,
+	SOFT_TRIGGER_ENTER,				// Window entry
+	SOFT_TRIGGER_EXIT,				// Window exit
+	SOFT_TRIGGER_ENTER_OR_EXIT
+}SOFT_TRIGGER_TYPE;
+
+// Like PICO_PULSE_WIDTH_TYPE. The pulse is the one that ends at the
+// trigger edge, e.g. the high pulse before a falling edge.
+typedef enum enSoftPwqType
+{
+	SOFT_PWQ_NONE,
+	SOFT_PWQ_LESS_THAN,
+	SOFT_PWQ_GREATER_THAN,
+	SOFT_PWQ_IN_RANGE,
+	SOFT_PWQ_OUT_OF_RANGE
+}SOFT_PWQ_TYPE;
+
+typedef struct tSoftTriggerSettings
+{
+	int16_t				source;			// Index into the buffers passed to soft_trigger_process
+	SOFT_TRIGGER_TYPE	type;
+	int16_t				thresholdUpper;	// ADC counts, the edge threshold or the top of the window
+	int16_t				thresholdLower;	// ADC counts, the bottom of the window
+	uint16_t			hysteresis;		// ADC counts
+	SOFT_PWQ_TYPE		pwqType;
+	uint64_t			pwqLower;		// Samples
+	uint64_t			pwqUpper;		// Samples
+	uint32_t			preTrigger;		// Samples before the trigger in each event
+	uint32_t			postTrigger;	// Samples from the trigger on in each event
+	uint64_t			holdoff;		// Minimum samples between triggers, 0 for none
+}SOFT_TRIGGER_SETTINGS;
+
+typedef struct tSoftTriggerEvent
+{
+	uint32_t	eventNumber;
+	uint64_t	triggerSample;	// Sample number in the stream
+	uint64_t	firstSample;	// Sample number of data[channel][0]
+	uint32_t	preSamples;		// Fewer than preTrigger near the start of the stream
+	uint32_t	nSamples;		// Fewer than preTrigger + postTrigger at the end of the stream
+	int16_t		rising;			// 1 for a rising edge or window entry
+	uint64_t	pulseWidth;		// Samples since the previous crossing, 0 if there was none
+	int16_t		nChannels;
+	int16_t*	data[SOFT_TRIGGER_MAX_CHANNELS];
+}SOFT_TRIGGER_EVENT;
+
+typedef void (*SOFT_TRIGGER_CALLBACK)(SOFT_TRIGGER_EVENT* event, void* parameter);
+
+typedef struct tSoftTrigger
+{
+	SOFT_TRIGGER_SETTINGS	settings;
+	SOFT_TRIGGER_CALLBACK	callback;
+	void*					parameter;
+	int16_t					nChannels;
+	uint32_t				maxChunk;		// Longest block appended at once
+	// History ring, one per channel
+	int16_t*				ring[SOFT_TRIGGER_MAX_CHANNELS];
+	uint64_t				ringMask;		// Ring length - 1 (a power of 2)
+	uint64_t				nSamples;		// Samples appended since soft_trigger_init
+	// Trigger state
+	int16_t					state;			// 1 above the threshold / inside the window
+	uint64_t				lastCrossing;
+	int16_t					haveCrossing;
+	uint64_t				lastTrigger;
+	int16_t					haveTrigger;
+	uint64_t				pending[SOFT_TRIGGER_MAX_PENDING];	// Trigger samples in order
+	int16_t					pendingRising[SOFT_TRIGGER_MAX_PENDING];
+	uint64_t				pendingWidth[SOFT_TRIGGER_MAX_PENDING];
+	uint32_t				pendingHead;
+	uint32_t				nPending;
+	// Event output
+	SOFT_TRIGGER_EVENT		event;
+	uint32_t				nEvents;
+	uint32_t				nMissed;		// Triggers dropped because too many were pending
+}SOFT_TRIGGER;
+
+// Function prototypes
+PICO_STATUS soft_trigger_init(SOFT_TRIGGER* trigger, const SOFT_TRIGGER_SETTINGS* settings, int16_t nChannels, uint32_t maxChunk,
+	SOFT_TRIGGER_CALLBACK callback, void* parameter);
+void soft_trigger_free(SOFT_TRIGGER* trigger);
+
+PICO_STATUS soft_trigger_process(SOFT_TRIGGER* trigger, int16_t** buffers, uint32_t nSamples);
+PICO_STATUS soft_trigger_process_int8(SOFT_TRIGGER* trigger, int8_t** buffers, uint32_t nSamples);
+
+void soft_trigger_flush(SOFT_TRIGGER* trigger);
+
+#endif
@@ -0,0 +1,222 @@
+/****************************************************************************
+ *
+ * Filename:    PicoStatistics.c
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This file defines incremental per-channel statistics for streaming.
+ * The reduction loop has no branches or stores to memory other than its
+ * accumulators, so the compiler can vectorise it. The histogram is
+ * counted in a separate pass.
+ *
+ ****************************************************************************/
+#include <string.h>
+#include <math.h>
+#include "./PicoStatistics.h"
+
+typedef struct tStatisticsBlock
+{
+	uint64_t	count;
+	int32_t		origin;			// First value of the buffer, sum and sumSquares are taken about it
+	int64_t		sum;
+	int64_t		sumSquares;
+	int32_t		min;
+	int32_t		max;
+	uint64_t	overrange;
+	uint64_t	histogram[STATISTICS_HISTOGRAM_BINS];
+}STATISTICS_BLOCK;
+
+/****************************************************************************
+* resetSummary
+****************************************************************************/
+static void resetSummary(STATISTICS_SUMMARY* summary)
+{
+	memset(summary, 0, sizeof(STATISTICS_SUMMARY));
+	summary->min = INT16_MAX;
+	summary->max = INT16_MIN;
+}
+
+/****************************************************************************
+* mergeBlock
+*
+* Adds the reduction of one buffer to a summary (Chan et al. parallel
+* form of Welford's algorithm). The block sums are taken about its first
+* value, so the block M2 does not lose precision to cancellation when the
+* signal has a large offset.
+****************************************************************************/
+static void mergeBlock(STATISTICS_SUMMARY* summary, const STATISTICS_BLOCK* block)
+{
+	double centredMean = (double)block->sum / block->count;
+	double blockMean = block->origin + centredMean;
+	double blockM2 = (double)block->sumSquares - (double)block->sum * centredMean;
+	double delta = blockMean - summary->mean;
+	uint64_t count = summary->count + block->count;
+	int16_t bin;
+
+	summary->mean += delta * block->count / count;
+	summary->m2 += blockM2 + delta * delta * ((double)summary->count * block->count / count);
+	summary->count = count;
+	summary->sumSquares += (double)block->sumSquares + 2.0 * block->origin * (double)block->sum + (double)block->origin * block->origin * block->count;
+	summary->overrange += block->overrange;
+
+	if (block->min < summary->min)
+		summary->min = (int16_t)block->min;
+	if (block->max > summary->max)
+		summary->max = (int16_t)block->max;
+
+	for (bin = 0; bin < STATISTICS_HISTOGRAM_BINS; bin++)
+	{
+		summary->histogram[bin] += block->histogram[bin];
+	}
+}
+
+/****************************************************************************
+* stats_init
+****************************************************************************/
+void stats_init(CHANNEL_STATISTICS* stats, int16_t channel, int16_t overrangeLimit)
+{
+	stats->channel = channel;
+	stats->overrangeLimit = overrangeLimit;
+	resetSummary(&stats->window);
+	resetSummary(&stats->lifetime);
+}
+
+/****************************************************************************
+* stats_reset_window
+****************************************************************************/
+void stats_reset_window(CHANNEL_STATISTICS* stats)
+{
+	resetSummary(&stats->window);
+}
+
+/****************************************************************************
+* stats_update
+*
+* Adds a buffer of 16-bit ADC counts to the window and lifetime statistics
+****************************************************************************/
+void stats_update(CHANNEL_STATISTICS* stats, const int16_t* buffer, uint64_t nSamples)
+{
+	STATISTICS_BLOCK block;
+	int32_t limit = stats->overrangeLimit;
+	int32_t value;
+	int32_t centred;
+	uint64_t i;
+
+	if (nSamples == 0)
+		return;
+
+	memset(&block, 0, sizeof(STATISTICS_BLOCK));
+	block.count = nSamples;
+	block.min = INT16_MAX;
+	block.max = INT16_MIN;
+	block.origin = buffer[0];
+
+	for (i = 0; i < nSamples; i++)
+	{
+		value = buffer[i];
+		centred = value - block.origin;
+		block.sum += centred;
+		block.sumSquares += (int64_t)centred * centred;
+		block.min = value < block.min ? value : block.min;
+		block.max = value > block.max ? value : block.max;
+		block.overrange += (value >= limit) | (value <= -limit);
+	}
+
+	for (i = 0; i < nSamples; i++)
+	{
+		block.histogram[((uint16_t)buffer[i] ^ 0x8000) >> STATISTICS_HISTOGRAM_SHIFT]++;
+	}
+
+	mergeBlock(&stats->window, &block);
+	mergeBlock(&stats->lifetime, &block);
+}
+
+/****************************************************************************
+* stats_update_int8
+*
+* Adds a buffer of 8-bit ADC counts (PICO_INT8_T). The values are scaled
+* by 256 like 16-bit data, so the results compare directly.
+****************************************************************************/
+void stats_update_int8(CHANNEL_STATISTICS* stats, const int8_t* buffer, uint64_t nSamples)
+{
+	STATISTICS_BLOCK block;
+	int32_t limit = stats->overrangeLimit;
+	int32_t value;
+	int32_t centred;
+	uint64_t i;
+
+	if (nSamples == 0)
+		return;
+
+	memset(&block, 0, sizeof(STATISTICS_BLOCK));
+	block.count = nSamples;
+	block.min = INT16_MAX;
+	block.max = INT16_MIN;
+	block.origin = buffer[0] * 256;
+
+	for (i = 0; i < nSamples; i++)
+	{
+		value = buffer[i] * 256;
+		centred = value - block.origin;
+		block.sum += centred;
+		block.sumSquares += (int64_t)centred * centred;
+		block.min = value < block.min ? value : block.min;
+		block.max = value > block.max ? value : block.max;
+		block.overrange += (value >= limit) | (value <= -limit);
+	}
+
+	for (i = 0; i < nSamples; i++)
+	{
+		block.histogram[(uint8_t)buffer[i] ^ 0x80]++;
+	}
+
+	mergeBlock(&stats->window, &block);
+	mergeBlock(&stats->lifetime, &block);
+}
+
+/****************************************************************************
+* stats_variance
+*
+* Sample variance in ADC counts squared
+****************************************************************************/
+double stats_variance(const STATISTICS_SUMMARY* summary)
+{
+	return summary->count > 1 ? summary->m2 / (summary->count - 1) : 0.0;
+}
+
+/****************************************************************************
+* stats_std_dev
+****************************************************************************/
+double stats_std_dev(const STATISTICS_SUMMARY* summary)
+{
+	return sqrt(stats_variance(summary));
+}
+
+/****************************************************************************
+* stats_rms
+****************************************************************************/
+double stats_rms(const STATISTICS_SUMMARY* summary)
+{
+	return summary->count > 0 ? sqrt(summary->sumSquares / summary->count) : 0.0;
+}
+
+/****************************************************************************
+* stats_print
+*
+* Writes one line of statistics in ADC counts
+* Inputs:
+* - summary: &stats->window or &stats->lifetime
+* - label: printed before the channel letter
+****************************************************************************/
+void stats_print(FILE* fp, const CHANNEL_STATISTICS* stats, const STATISTICS_SUMMARY* summary, const char* label)
+{
+	if (summary->count == 0)
+	{
+		fprintf(fp, "%s Ch%c: no data\n", label, 'A' + stats->channel);
+		return;
+	}
+
+	fprintf(fp, "%s Ch%c: n %llu min %d max %d mean %.2f rms %.2f std dev %.2f over-range %llu\n",
+		label, 'A' + stats->channel, (unsigned long long)summary->count, summary->min, summary->max,
+		summary->mean, stats_rms(summary), stats_std_dev(summary), (unsigned long long)summary->overrange);
+}
@@ -0,0 +1,55 @@
+/****************************************************************************
+ *
+ * Filename:    PicoStatistics.h
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This header defines incremental per-channel statistics for streaming.
+ * Each buffer is reduced once (min, max, sum, sum of squares, over-range
+ * count and histogram) and merged into a window summary and a lifetime
+ * summary with Welford's parallel update, so no raw data has to be kept.
+ *
+ ****************************************************************************/
+#ifndef __PICOSTATISTICS_H__
+#define __PICOSTATISTICS_H__
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define STATISTICS_HISTOGRAM_BINS	256
+#define STATISTICS_HISTOGRAM_SHIFT	8	// 16-bit ADC count >> shift (after offset) gives the bin
+
+typedef struct tStatisticsSummary
+{
+	uint64_t	count;
+	int16_t		min;
+	int16_t		max;
+	double		mean;
+	double		m2;				// Sum of squared differences from the mean (Welford)
+	double		sumSquares;		// For the RMS
+	uint64_t	overrange;		// Samples at or beyond +/- overrangeLimit
+	uint64_t	histogram[STATISTICS_HISTOGRAM_BINS];	// Bin 0 is -32768, bin 128 is 0
+}STATISTICS_SUMMARY;
+
+typedef struct tChannelStatistics
+{
+	int16_t				channel;
+	int16_t				overrangeLimit;	// Usually the maximum ADC value
+	STATISTICS_SUMMARY	window;			// Since stats_reset_window
+	STATISTICS_SUMMARY	lifetime;
+}CHANNEL_STATISTICS;
+
+// Function prototypes
+void stats_init(CHANNEL_STATISTICS* stats, int16_t channel, int16_t overrangeLimit);
+void stats_reset_window(CHANNEL_STATISTICS* stats);
+
+void stats_update(CHANNEL_STATISTICS* stats, const int16_t* buffer, uint64_t nSamples);
+void stats_update_int8(CHANNEL_STATISTICS* stats, const int8_t* buffer, uint64_t nSamples);
+
+double stats_variance(const STATISTICS_SUMMARY* summary);
+double stats_std_dev(const STATISTICS_SUMMARY* summary);
+double stats_rms(const STATISTICS_SUMMARY* summary);
+
+void stats_print(FILE* fp, const CHANNEL_STATISTICS* stats, const STATISTICS_SUMMARY* summary, const char* label);
+
+#endif
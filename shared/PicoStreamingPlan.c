@@ -0,0 +1,190 @@
+/****************************************************************************
+ *
+ * Filename:    PicoStreamingPlan.c
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This file defines a planner for the fastest sustainable streaming
+ * settings. Channel and resolution limits come from the timebase
+ * solver, so planning needs no driver calls.
+ *
+ ****************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "./PicoStreamingPlan.h"
+
+/****************************************************************************
+* countChannels
+****************************************************************************/
+static int16_t countChannels(uint32_t channelFlags)
+{
+	int16_t count = 0;
+
+	while (channelFlags)
+	{
+		channelFlags &= channelFlags - 1;
+		count++;
+	}
+	return count;
+}
+
+/****************************************************************************
+* planResolution
+*
+* Finds the fastest sustainable settings for one resolution
+* Outputs:
+* - plan (timebase, interval, downsampling and transfer rate only)
+****************************************************************************/
+static PICO_STATUS planResolution(TIMEBASE_SOLVER* solver,
+	const PLAN_RESOLUTION* resolution,
+	const STREAMING_PLAN_REQUEST* request,
+	STREAMING_PLAN* plan)
+{
+	PICO_STATUS status;
+	uint32_t minTimebase;
+	double minInterval;
+	double bandwidthInterval;
+	int16_t nChannels = countChannels(request->channelFlags);
+
+	if (!timebase_solver_ready(solver, resolution->resolution))
+		return PICO_INVALID_PARAMETER;
+
+	status = timebase_solver_fastest(solver, resolution->resolution, request->channelFlags, 0, &minTimebase, &minInterval);
+	if (status != PICO_OK)
+		return status;
+
+	// Shortest interval the USB link can sustain for raw data
+	bandwidthInterval = (double)nChannels * resolution->bytesPerSample / request->bandwidth;
+
+	plan->resolution = resolution->resolution;
+	plan->bits = resolution->bits;
+	plan->aggregate = 0;
+	plan->downSampleRatio = 1;
+
+	if (minInterval >= bandwidthInterval)
+	{
+		// The ADC is the limit - stream raw at the fastest timebase
+		plan->timebase = minTimebase;
+		plan->sampleInterval = minInterval;
+	}
+	else if (request->allowAggregation)
+	{
+		// Sample at the fastest timebase, the driver returns a min and max value per ratio samples
+		plan->timebase = minTimebase;
+		plan->sampleInterval = minInterval;
+		plan->aggregate = 1;
+		plan->downSampleRatio = (uint64_t)ceil(2 * bandwidthInterval / minInterval - TIMEBASE_TOLERANCE);
+	}
+	else
+	{
+		// Slow down to the bandwidth limit
+		status = timebase_solver_nearest(solver, resolution->resolution, request->channelFlags,
+			bandwidthInterval, 0, &plan->timebase, &plan->sampleInterval);
+		if (status != PICO_OK)
+			return status;
+	}
+
+	plan->transferRate = (double)nChannels * resolution->bytesPerSample * (plan->aggregate ? 2 : 1) /
+		(plan->sampleInterval * (double)plan->downSampleRatio);
+
+	return PICO_OK;
+}
+
+/****************************************************************************
+* streaming_plan_create
+*
+* Picks the resolution with the highest sustained output rate (after any
+* aggregation) that meets the minimum resolution. For equal rates the
+* higher resolution wins.
+* Inputs:
+* - solver: calibrated timebase solver
+* - resolutions: resolutions offered by the device
+* - request: channels, minimum resolution, duration and bandwidth
+* Outputs:
+* - plan
+* Returns:
+* - PICO_OK, or the status from the last resolution tried
+****************************************************************************/
+PICO_STATUS streaming_plan_create(TIMEBASE_SOLVER* solver,
+	const PLAN_RESOLUTION* resolutions,
+	int16_t nResolutions,
+	const STREAMING_PLAN_REQUEST* request,
+	STREAMING_PLAN* plan)
+{
+	PICO_STATUS status = PICO_INVALID_PARAMETER;
+	STREAMING_PLAN candidate;
+	double outputInterval;
+	double candidateInterval;
+	int16_t i;
+
+	memset(plan, 0, sizeof(STREAMING_PLAN));
+
+	if (request->channelFlags == 0 || request->bandwidth <= 0 || request->duration <= 0)
+		return PICO_INVALID_PARAMETER;
+
+	for (i = 0; i < nResolutions; i++)
+	{
+		if (resolutions[i].bits < request->minBits)
+			continue;
+
+		memset(&candidate, 0, sizeof(STREAMING_PLAN));
+		status = planResolution(solver, &resolutions[i], request, &candidate);
+
+		if (status != PICO_OK)
+			continue;
+
+		// Compare the interval of the data returned, which for aggregation is
+		// the sample interval times the ratio, not the ADC sample interval
+		candidateInterval = candidate.sampleInterval * (double)candidate.downSampleRatio;
+		outputInterval = plan->sampleInterval * (double)plan->downSampleRatio;
+
+		if (!plan->valid ||
+			candidateInterval < outputInterval * (1 - TIMEBASE_TOLERANCE) ||
+			(candidateInterval <= outputInterval * (1 + TIMEBASE_TOLERANCE) && candidate.bits > plan->bits))
+		{
+			*plan = candidate;
+			plan->valid = 1;
+		}
+	}
+
+	if (!plan->valid)
+		return status;
+
+	// Size the buffer sets to fill every PLAN_BUFFER_SECONDS
+	outputInterval = plan->sampleInterval * (double)plan->downSampleRatio;
+	plan->samplesPerBuffer = (uint64_t)(PLAN_BUFFER_SECONDS / outputInterval);
+
+	if (plan->samplesPerBuffer < PLAN_MIN_BUFFER_SIZE)
+		plan->samplesPerBuffer = PLAN_MIN_BUFFER_SIZE;
+	if (plan->samplesPerBuffer > PLAN_MAX_BUFFER_SIZE)
+		plan->samplesPerBuffer = PLAN_MAX_BUFFER_SIZE;
+
+	plan->totalSamples = (uint64_t)ceil(request->duration / plan->sampleInterval);
+	plan->numberOfBuffers = (uint64_t)ceil(request->duration / (outputInterval * (double)plan->samplesPerBuffer));
+
+	if (plan->numberOfBuffers < 2)
+		plan->numberOfBuffers = 2;	// streamDataHandler needs 2 or more buffer sets
+
+	return PICO_OK;
+}
+
+/****************************************************************************
+* streaming_plan_print
+****************************************************************************/
+void streaming_plan_print(const STREAMING_PLAN* plan)
+{
+	if (!plan->valid)
+	{
+		printf("Streaming plan: none\n");
+		return;
+	}
+
+	printf("Streaming plan:\n");
+	printf(" Resolution:         %d bits\n", plan->bits);
+	printf(" Timebase:           %lu (%le seconds)\n", (unsigned long)plan->timebase, plan->sampleInterval);
+	printf(" Downsampling:       %s, ratio %llu\n", plan->aggregate ? "Aggregate" : "Raw", (unsigned long long)plan->downSampleRatio);
+	printf(" Buffer sets:        %llu x %llu samples\n", (unsigned long long)plan->numberOfBuffers, (unsigned long long)plan->samplesPerBuffer);
+	printf(" Samples per channel: %llu\n", (unsigned long long)plan->totalSamples);
+	printf(" USB transfer rate:  %.1f MB/s\n", plan->transferRate / 1e6);
+}
@@ -0,0 +1,63 @@
+/****************************************************************************
+ *
+ * Filename:    PicoStreamingPlan.h
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This header defines a planner that picks the resolution, timebase,
+ * downsampling and buffer sizes giving the highest sustained streaming
+ * rate for a set of channels within the USB bandwidth.
+ *
+ ****************************************************************************/
+#ifndef __PICOSTREAMINGPLAN_H__
+#define __PICOSTREAMINGPLAN_H__
+
+#include "./PicoTimebase.h"
+
+// Each buffer set is sized to fill in about this time (seconds)
+#define PLAN_BUFFER_SECONDS		0.1
+#define PLAN_MIN_BUFFER_SIZE	1024
+#define PLAN_MAX_BUFFER_SIZE	(16 * 1024 * 1024)
+
+// Resolutions offered by a device, in order of preference for equal rates
+typedef struct tPlanResolution
+{
+	int32_t		resolution;		// API resolution enum value
+	int16_t		bits;
+	int16_t		bytesPerSample;	// Size of one sample transferred to the host
+}PLAN_RESOLUTION;
+
+typedef struct tStreamingPlanRequest
+{
+	uint32_t	channelFlags;		// Required channels (bit 0 = channel A)
+	int16_t		minBits;			// Minimum resolution in bits
+	double		duration;			// Target capture duration in seconds
+	double		bandwidth;			// Sustained USB bandwidth in bytes per second
+	int16_t		allowAggregation;	// Sample faster and aggregate in the driver if bandwidth limited
+}STREAMING_PLAN_REQUEST;
+
+typedef struct tStreamingPlan
+{
+	int16_t		valid;
+	int32_t		resolution;
+	int16_t		bits;
+	uint32_t	timebase;
+	double		sampleInterval;		// ADC sample interval in seconds
+	int16_t		aggregate;			// 1 = PICO_RATIO_MODE_AGGREGATE, 0 = PICO_RATIO_MODE_RAW
+	uint64_t	downSampleRatio;
+	uint64_t	samplesPerBuffer;	// Per channel, after downsampling
+	uint64_t	numberOfBuffers;	// Buffer sets needed for the target duration
+	uint64_t	totalSamples;		// ADC samples per channel over the target duration
+	double		transferRate;		// Bytes per second over USB
+}STREAMING_PLAN;
+
+// Function prototypes
+PICO_STATUS streaming_plan_create(TIMEBASE_SOLVER* solver,
+	const PLAN_RESOLUTION* resolutions,
+	int16_t nResolutions,
+	const STREAMING_PLAN_REQUEST* request,
+	STREAMING_PLAN* plan);
+
+void streaming_plan_print(const STREAMING_PLAN* plan);
+
+#endif
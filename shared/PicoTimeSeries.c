@@ -0,0 +1,852 @@
+/****************************************************************************
+ *
+ * Filename:    PicoTimeSeries.c
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This file defines an append-only time-series store for data loggers
+ * (see PicoTimeSeries.h).
+ *
+ ****************************************************************************/
+#ifndef _WIN32
+#define _FILE_OFFSET_BITS 64		// fseeko and ftello beyond 2 GB
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "./PicoTimeSeries.h"
+
+#ifdef _WIN32
+#define tsSeek(fp, offset)	_fseeki64(fp, offset, SEEK_SET)
+#define tsSeekEnd(fp)		_fseeki64(fp, 0, SEEK_END)
+#define tsTell(fp)			_ftelli64(fp)
+#else
+#define tsSeek(fp, offset)	fseeko(fp, (off_t)(offset), SEEK_SET)
+#define tsSeekEnd(fp)		fseeko(fp, 0, SEEK_END)
+#define tsTell(fp)			((int64_t)ftello(fp))
+#endif
+
+static const char* levelExtensions[TS_LEVELS] = { ".tsr", ".tsm", ".tsh", ".tsd" };
+
+/****************************************************************************
+* Compression helpers
+*
+* Integers are written 7 bits a byte, low bits first, with signed values
+* zigzag encoded so small negative deltas stay short
+****************************************************************************/
+static uint32_t putVarint(uint8_t* out, uint64_t value)
+{
+	uint32_t n = 0;
+
+	while (value >= 0x80)
+	{
+		out[n++] = (uint8_t)(value | 0x80);
+		value >>= 7;
+	}
+	out[n++] = (uint8_t)value;
+	return n;
+}
+
+static uint32_t getVarint(const uint8_t* in, uint32_t available, uint64_t* value)
+{
+	uint32_t n = 0;
+	uint32_t shift = 0;
+
+	*value = 0;
+
+	while (n < available && shift < 64)
+	{
+		*value |= (uint64_t)(in[n] & 0x7F) << shift;
+
+		if ((in[n++] & 0x80) == 0)
+			return n;
+
+		shift += 7;
+	}
+	return 0;
+}
+
+static uint64_t zigzag(int64_t value)
+{
+	return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value)
+{
+	return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+/****************************************************************************
+* putXor
+*
+* Writes the XOR of a value with the previous one as a control byte
+* (trailing zero bytes in the high nibble, bytes kept in the low nibble)
+* and the bytes kept. An unchanged value takes one byte.
+****************************************************************************/
+static uint32_t putXor(uint8_t* out, uint32_t bits)
+{
+	uint32_t trailing = 0;
+	uint32_t kept = 4;
+	uint32_t n = 1;
+
+	if (bits == 0)
+	{
+		out[0] = 0;
+		return 1;
+	}
+
+	while ((bits & 0xFF) == 0)
+	{
+		bits >>= 8;
+		trailing++;
+		kept--;
+	}
+
+	while (kept > 1 && (bits >> (8 * (kept - 1))) == 0)
+		kept--;
+
+	out[0] = (uint8_t)((trailing << 4) | kept);
+
+	while (kept--)
+	{
+		out[n++] = (uint8_t)bits;
+		bits >>= 8;
+	}
+	return n;
+}
+
+static uint32_t getXor(const uint8_t* in, uint32_t available, uint32_t* bits)
+{
+	uint32_t trailing;
+	uint32_t kept;
+	uint32_t i;
+
+	if (available == 0)
+		return 0;
+
+	trailing = in[0] >> 4;
+	kept = in[0] & 0x0F;
+
+	if (trailing + kept > 4 || kept + 1 > available)
+		return 0;
+
+	*bits = 0;
+
+	for (i = 0; i < kept; i++)
+	{
+		*bits |= (uint32_t)in[1 + i] << (8 * (i + trailing));
+	}
+	return kept + 1;
+}
+
+static uint32_t floatBits(float value)
+{
+	uint32_t bits;
+
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+static float bitsFloat(uint32_t bits)
+{
+	float value;
+
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+/****************************************************************************
+* encodedBytes
+*
+* Largest payload of a block of TS_BLOCK_ROWS rows: a varint timestamp
+* delta of up to 10 bytes and up to 5 bytes of each value a row, and the
+* column offsets
+****************************************************************************/
+static size_t encodedBytes(uint32_t nColumns)
+{
+	return (size_t)TS_BLOCK_ROWS * (10 + 5 * nColumns) + 4 * nColumns;
+}
+
+/****************************************************************************
+* validBlock
+*
+* Checks a block header read from the raw file, so its payload fits the
+* decode buffer and the column offsets follow the timestamps
+****************************************************************************/
+static int16_t validBlock(const TS_STORE* store, const TS_BLOCK_HEADER* header)
+{
+	return header->magic == TS_BLOCK_MAGIC &&
+		header->nRows > 0 && header->nRows <= TS_BLOCK_ROWS &&
+		header->payloadBytes <= encodedBytes(store->nColumns) &&
+		header->payloadBytes >= store->nColumns * sizeof(uint32_t) &&
+		header->timeBytes <= header->payloadBytes - store->nColumns * sizeof(uint32_t);
+}
+
+/****************************************************************************
+* periodStart
+*
+* Start of the rollup period holding timeMs, rounding down for negative times
+****************************************************************************/
+static int64_t periodStart(int64_t timeMs, int64_t periodMs)
+{
+	int64_t start = (timeMs / periodMs) * periodMs;
+
+	return start > timeMs ? start - periodMs : start;
+}
+
+/****************************************************************************
+* openFile
+*
+* Opens one file of a store for update, creating it with its header if it
+* does not exist
+* Returns:
+* - the file, NULL if it cannot be opened or belongs to a different store
+****************************************************************************/
+static FILE* openFile(TS_STORE* store, TS_LEVEL level, int64_t* dataBytes)
+{
+	TS_FILE_HEADER header;
+	char fileName[TS_MAX_NAME + 8];
+	FILE* fp = NULL;
+
+	snprintf(fileName, sizeof(fileName), "%s%s", store->name, levelExtensions[level]);
+
+	fp = fopen(fileName, "r+b");
+
+	if (fp != NULL)
+	{
+		if (fread(&header, sizeof(header), 1, fp) != 1 || header.magic != TS_MAGIC || header.version != TS_VERSION ||
+			header.nColumns != store->nColumns || header.level != (uint32_t)level)
+		{
+			fclose(fp);
+			return NULL;
+		}
+
+		tsSeekEnd(fp);
+		*dataBytes = tsTell(fp) - (int64_t)sizeof(header);
+		return fp;
+	}
+
+	fp = fopen(fileName, "w+b");
+
+	if (fp == NULL)
+		return NULL;
+
+	memset(&header, 0, sizeof(header));
+	header.magic = TS_MAGIC;
+	header.version = TS_VERSION;
+	header.nColumns = store->nColumns;
+	header.level = level;
+	header.periodMs = ts_level_period_ms(level);
+
+	if (fwrite(&header, sizeof(header), 1, fp) != 1)
+	{
+		fclose(fp);
+		return NULL;
+	}
+
+	*dataBytes = 0;
+	return fp;
+}
+
+/****************************************************************************
+* resetRollup
+****************************************************************************/
+static void resetRollup(TS_STORE* store, TS_ROLLUP* rollup, int64_t startMs)
+{
+	uint32_t c;
+
+	rollup->startMs = startMs;
+
+	for (c = 0; c < store->nColumns; c++)
+	{
+		rollup->min[c] = INFINITY;
+		rollup->max[c] = -INFINITY;
+		rollup->sum[c] = 0.0;
+		rollup->count[c] = 0;
+	}
+}
+
+/****************************************************************************
+* writeRollup
+*
+* Appends the open period of a rollup level to its file
+****************************************************************************/
+static int16_t writeRollup(TS_STORE* store, TS_ROLLUP* rollup)
+{
+	size_t recordSize = TS_RECORD_SIZE(store->nColumns);
+	float* fields = (float*)(rollup->record + sizeof(int64_t));
+	uint32_t c;
+
+	memcpy(rollup->record, &rollup->startMs, sizeof(int64_t));
+
+	for (c = 0; c < store->nColumns; c++)
+	{
+		fields[4 * c] = rollup->count[c] ? rollup->min[c] : NAN;
+		fields[4 * c + 1] = rollup->count[c] ? rollup->max[c] : NAN;
+		fields[4 * c + 2] = rollup->count[c] ? (float)(rollup->sum[c] / rollup->count[c]) : NAN;
+		memcpy(&fields[4 * c + 3], &rollup->count[c], sizeof(uint32_t));
+	}
+
+	if (tsSeek(rollup->fp, (int64_t)sizeof(TS_FILE_HEADER) + (int64_t)(rollup->nRecords * recordSize)) != 0 ||
+		fwrite(rollup->record, recordSize, 1, rollup->fp) != 1)
+		return 0;
+
+	rollup->nRecords++;
+	return 1;
+}
+
+/****************************************************************************
+* writeBlock
+*
+* Compresses the rows waiting in the store into one block of the raw file
+****************************************************************************/
+static int16_t writeBlock(TS_STORE* store)
+{
+	TS_BLOCK_HEADER header;
+	uint8_t* out = store->encoded;
+	uint8_t* offsets;
+	uint32_t n = 0;
+	uint32_t row;
+	uint32_t c;
+	uint32_t bits;
+	uint32_t previousBits;
+	int64_t delta;
+	int64_t previousDelta = 0;
+
+	if (store->nRows == 0)
+		return 1;
+
+	// Timestamps: the first is in the header, then the first delta and deltas of deltas
+	for (row = 1; row < store->nRows; row++)
+	{
+		delta = store->times[row] - store->times[row - 1];
+		n += putVarint(out + n, zigzag(delta - previousDelta));
+		previousDelta = delta;
+	}
+
+	memset(&header, 0, sizeof(header));
+	header.magic = TS_BLOCK_MAGIC;
+	header.nRows = store->nRows;
+	header.timeBytes = n;
+	header.firstMs = store->times[0];
+	header.lastMs = store->times[store->nRows - 1];
+
+	offsets = out + n;
+	n += store->nColumns * sizeof(uint32_t);
+
+	// Values column by column: the first as it is, then the XOR with the one before
+	for (c = 0; c < store->nColumns; c++)
+	{
+		memcpy(offsets + c * sizeof(uint32_t), &n, sizeof(uint32_t));
+		previousBits = floatBits(store->values[c]);
+		memcpy(out + n, &previousBits, sizeof(uint32_t));
+		n += sizeof(uint32_t);
+
+		for (row = 1; row < store->nRows; row++)
+		{
+			bits = floatBits(store->values[(size_t)row * store->nColumns + c]);
+			n += putXor(out + n, bits ^ previousBits);
+			previousBits = bits;
+		}
+	}
+
+	header.payloadBytes = n;
+
+	if (tsSeek(store->raw, store->rawEnd) != 0 ||
+		fwrite(&header, sizeof(header), 1, store->raw) != 1 ||
+		fwrite(out, n, 1, store->raw) != 1)
+		return 0;
+
+	store->rawEnd += sizeof(header) + n;
+	store->bytesWritten += sizeof(header) + n;
+	store->nRows = 0;
+	return 1;
+}
+
+/****************************************************************************
+* ts_store_open
+*
+* Opens a store, creating its files if they do not exist
+* Inputs:
+* - name: path of the store without an extension
+* - nColumns: values per row, must match an existing store
+* Returns:
+* - 1 on success, 0 on failure
+****************************************************************************/
+int16_t ts_store_open(TS_STORE* store, const char* name, uint32_t nColumns)
+{
+	TS_BLOCK_HEADER header;
+	TS_ROLLUP* rollup;
+	int64_t dataBytes = 0;
+	int64_t fileEnd;
+	int16_t level;
+
+	memset(store, 0, sizeof(TS_STORE));
+
+	if (nColumns == 0 || strlen(name) >= TS_MAX_NAME)
+		return 0;
+
+	strcpy(store->name, name);
+	store->nColumns = nColumns;
+	store->lastMs = INT64_MIN;
+
+	store->times = (int64_t*)malloc(TS_BLOCK_ROWS * sizeof(int64_t));
+	store->values = (float*)malloc((size_t)TS_BLOCK_ROWS * nColumns * sizeof(float));
+	store->encoded = (uint8_t*)malloc(encodedBytes(nColumns));
+	store->raw = openFile(store, TS_LEVEL_RAW, &dataBytes);
+
+	if (store->times == NULL || store->values == NULL || store->encoded == NULL || store->raw == NULL)
+	{
+		ts_store_close(store);
+		return 0;
+	}
+
+	// Find the end of the last complete block, so a block cut short by a
+	// crash is overwritten, and the newest time so appends stay in order
+	store->rawEnd = sizeof(TS_FILE_HEADER);
+	fileEnd = store->rawEnd + dataBytes;
+	tsSeek(store->raw, store->rawEnd);
+
+	while (fread(&header, sizeof(header), 1, store->raw) == 1 && validBlock(store, &header) &&
+		store->rawEnd + (int64_t)sizeof(header) + header.payloadBytes <= fileEnd)
+	{
+		store->rawEnd += sizeof(header) + header.payloadBytes;
+		store->lastMs = header.lastMs;
+		tsSeek(store->raw, store->rawEnd);
+	}
+
+	for (level = TS_LEVEL_MINUTE; level < TS_LEVELS; level++)
+	{
+		rollup = &store->rollups[level];
+		rollup->periodMs = ts_level_period_ms((TS_LEVEL)level);
+		rollup->min = (float*)malloc(nColumns * sizeof(float));
+		rollup->max = (float*)malloc(nColumns * sizeof(float));
+		rollup->sum = (double*)malloc(nColumns * sizeof(double));
+		rollup->count = (uint32_t*)malloc(nColumns * sizeof(uint32_t));
+		rollup->record = (uint8_t*)malloc(TS_RECORD_SIZE(nColumns));
+		rollup->fp = openFile(store, (TS_LEVEL)level, &dataBytes);
+
+		if (rollup->min == NULL || rollup->max == NULL || rollup->sum == NULL || rollup->count == NULL ||
+			rollup->record == NULL || rollup->fp == NULL)
+		{
+			ts_store_close(store);
+			return 0;
+		}
+
+		rollup->nRecords = (uint64_t)dataBytes / TS_RECORD_SIZE(nColumns);	// Drops a record cut short
+		rollup->startMs = -1;
+	}
+
+	return 1;
+}
+
+/****************************************************************************
+* ts_store_append
+*
+* Appends one row
+* Inputs:
+* - timeMs: time of the row, not before the previous row
+* - values: nColumns values, NaN for missing readings
+* Returns:
+* - 1 on success, 0 on failure
+****************************************************************************/
+int16_t ts_store_append(TS_STORE* store, int64_t timeMs, const float* values)
+{
+	TS_ROLLUP* rollup;
+	int64_t startMs;
+	int16_t level;
+	uint32_t c;
+
+	if (timeMs < store->lastMs)
+		return 0;
+
+	store->times[store->nRows] = timeMs;
+	memcpy(store->values + (size_t)store->nRows * store->nColumns, values, store->nColumns * sizeof(float));
+	store->nRows++;
+	store->lastMs = timeMs;
+	store->rowsAppended++;
+
+	if (store->nRows == TS_BLOCK_ROWS && !writeBlock(store))
+	{
+		// Drop the block, the rows of the next append must fit the buffers
+		store->nRows = 0;
+		return 0;
+	}
+
+	for (level = TS_LEVEL_MINUTE; level < TS_LEVELS; level++)
+	{
+		rollup = &store->rollups[level];
+		startMs = periodStart(timeMs, rollup->periodMs);
+
+		if (rollup->startMs != startMs)
+		{
+			if (rollup->startMs != -1 && !writeRollup(store, rollup))
+				return 0;
+
+			resetRollup(store, rollup, startMs);
+		}
+
+		for (c = 0; c < store->nColumns; c++)
+		{
+			if (!isnan(values[c]))
+			{
+				rollup->min[c] = values[c] < rollup->min[c] ? values[c] : rollup->min[c];
+				rollup->max[c] = values[c] > rollup->max[c] ? values[c] : rollup->max[c];
+				rollup->sum[c] += values[c];
+				rollup->count[c]++;
+			}
+		}
+	}
+
+	return 1;
+}
+
+/****************************************************************************
+* ts_store_flush
+*
+* Writes the rows waiting for a full block and flushes the files. Rollup
+* periods still open stay in memory until they end or the store is closed.
+****************************************************************************/
+int16_t ts_store_flush(TS_STORE* store)
+{
+	int16_t ok = writeBlock(store);
+	int16_t level;
+
+	ok &= (fflush(store->raw) == 0);
+
+	for (level = TS_LEVEL_MINUTE; level < TS_LEVELS; level++)
+	{
+		ok &= (fflush(store->rollups[level].fp) == 0);
+	}
+
+	return ok;
+}
+
+/****************************************************************************
+* ts_store_close
+*
+* Writes any rows waiting and the open rollup periods, then closes the files
+****************************************************************************/
+void ts_store_close(TS_STORE* store)
+{
+	TS_ROLLUP* rollup;
+	int16_t level;
+
+	if (store->raw != NULL)
+	{
+		writeBlock(store);
+		fclose(store->raw);
+	}
+
+	for (level = TS_LEVEL_MINUTE; level < TS_LEVELS; level++)
+	{
+		rollup = &store->rollups[level];
+
+		if (rollup->fp != NULL)
+		{
+			if (rollup->startMs != -1)
+				writeRollup(store, rollup);
+
+			fclose(rollup->fp);
+		}
+
+		free(rollup->min);
+		free(rollup->max);
+		free(rollup->sum);
+		free(rollup->count);
+		free(rollup->record);
+	}
+
+	free(store->times);
+	free(store->values);
+	free(store->encoded);
+	memset(store, 0, sizeof(TS_STORE));
+}
+
+/****************************************************************************
+* ts_level_period_ms
+****************************************************************************/
+int64_t ts_level_period_ms(TS_LEVEL level)
+{
+	switch (level)
+	{
+		case TS_LEVEL_MINUTE:
+			return 60000;
+
+		case TS_LEVEL_HOUR:
+			return 3600000;
+
+		case TS_LEVEL_DAY:
+			return 86400000;
+
+		default:
+			return 0;
+	}
+}
+
+/****************************************************************************
+* ts_store_pick_level
+*
+* Picks the finest level that covers a time range in no more than
+* maxPoints points
+* Inputs:
+* - rowIntervalMs: interval rows are appended at
+****************************************************************************/
+TS_LEVEL ts_store_pick_level(int64_t startMs, int64_t endMs, uint32_t maxPoints, int64_t rowIntervalMs)
+{
+	int64_t span = endMs - startMs;
+	int16_t level;
+
+	if (rowIntervalMs > 0 && span / rowIntervalMs < (int64_t)maxPoints)
+		return TS_LEVEL_RAW;
+
+	for (level = TS_LEVEL_MINUTE; level < TS_LEVEL_DAY; level++)
+	{
+		if (span / ts_level_period_ms((TS_LEVEL)level) < (int64_t)maxPoints)
+			break;
+	}
+
+	return (TS_LEVEL)level;
+}
+
+/****************************************************************************
+* addPoint
+*
+* Adds a point to a query's results, merging it with the last point if
+* they are the same rollup period (written in two parts across a reopen)
+* Returns:
+* - 0 if the results are full
+****************************************************************************/
+static int16_t addPoint(TS_POINT* points, int32_t* nPoints, uint32_t maxPoints, const TS_POINT* point, int16_t merge)
+{
+	TS_POINT* last = *nPoints ? &points[*nPoints - 1] : NULL;
+	uint32_t count;
+
+	if (merge && last != NULL && last->timeMs == point->timeMs)
+	{
+		if (point->count)
+		{
+			count = last->count + point->count;
+			last->mean = last->count ? (float)(((double)last->mean * last->count + (double)point->mean * point->count) / count) : point->mean;
+			last->min = (last->count && last->min < point->min) ? last->min : point->min;
+			last->max = (last->count && last->max > point->max) ? last->max : point->max;
+			last->count = count;
+		}
+		return 1;
+	}
+
+	if ((uint32_t)*nPoints == maxPoints)
+		return 0;
+
+	points[(*nPoints)++] = *point;
+	return 1;
+}
+
+/****************************************************************************
+* queryRaw
+****************************************************************************/
+static int32_t queryRaw(TS_STORE* store, uint32_t column, int64_t startMs, int64_t endMs, TS_POINT* points, uint32_t maxPoints)
+{
+	TS_BLOCK_HEADER header;
+	TS_POINT point;
+	uint8_t* payload = NULL;
+	uint64_t value;
+	int64_t offset = sizeof(TS_FILE_HEADER);
+	int64_t timeMs;
+	int64_t delta;
+	uint32_t bits;
+	uint32_t xorBits;
+	uint32_t pos;
+	uint32_t valuePos;
+	uint32_t n;
+	uint32_t row;
+	int32_t nPoints = 0;
+	int16_t full = 0;
+
+	memset(&point, 0, sizeof(point));
+	point.count = 1;
+
+	while (!full && offset < store->rawEnd)
+	{
+		if (tsSeek(store->raw, offset) != 0 || fread(&header, sizeof(header), 1, store->raw) != 1 ||
+			!validBlock(store, &header))
+			break;
+
+		offset += sizeof(header) + header.payloadBytes;
+
+		if (header.firstMs > endMs)
+			break;
+
+		if (header.lastMs < startMs)
+			continue;	// Skip the block without reading it
+
+		if (payload == NULL)
+			payload = (uint8_t*)malloc(encodedBytes(store->nColumns));
+
+		if (payload == NULL || fread(payload, header.payloadBytes, 1, store->raw) != 1)
+			break;
+
+		// Decode the timestamps and the one column asked for side by side
+		memcpy(&valuePos, payload + header.timeBytes + column * sizeof(uint32_t), sizeof(uint32_t));
+
+		if (valuePos > header.payloadBytes - sizeof(uint32_t))
+			break;
+
+		memcpy(&bits, payload + valuePos, sizeof(uint32_t));
+		valuePos += sizeof(uint32_t);
+		timeMs = header.firstMs;
+		delta = 0;
+		pos = 0;
+
+		for (row = 0; row < header.nRows && !full; row++)
+		{
+			if (row > 0)
+			{
+				n = getVarint(payload + pos, header.timeBytes - pos, &value);
+
+				if (n == 0)
+					break;
+
+				pos += n;
+				delta += unzigzag(value);
+				timeMs += delta;
+
+				n = getXor(payload + valuePos, header.payloadBytes - valuePos, &xorBits);
+
+				if (n == 0)
+					break;
+
+				valuePos += n;
+				bits ^= xorBits;
+			}
+
+			if (timeMs >= startMs && timeMs <= endMs)
+			{
+				point.timeMs = timeMs;
+				point.min = point.max = point.mean = bitsFloat(bits);
+				full = !addPoint(points, &nPoints, maxPoints, &point, 0);
+			}
+		}
+	}
+
+	free(payload);
+
+	// Rows waiting for a full block
+	for (row = 0; row < store->nRows && !full; row++)
+	{
+		if (store->times[row] >= startMs && store->times[row] <= endMs)
+		{
+			point.timeMs = store->times[row];
+			point.min = point.max = point.mean = store->values[(size_t)row * store->nColumns + column];
+			full = !addPoint(points, &nPoints, maxPoints, &point, 0);
+		}
+	}
+
+	return nPoints;
+}
+
+/****************************************************************************
+* queryRollup
+*
+* Binary searches the rollup file for the first period in the range, then
+* reads the records up to the end of the range
+****************************************************************************/
+static int32_t queryRollup(TS_STORE* store, TS_ROLLUP* rollup, uint32_t column, int64_t startMs, int64_t endMs,
+	TS_POINT* points, uint32_t maxPoints)
+{
+	TS_POINT point;
+	size_t recordSize = TS_RECORD_SIZE(store->nColumns);
+	float fields[4];
+	uint64_t low = 0;
+	uint64_t high = rollup->nRecords;
+	uint64_t middle;
+	uint64_t record;
+	int64_t recordMs;
+	int32_t nPoints = 0;
+	int16_t full = 0;
+
+	startMs = periodStart(startMs, rollup->periodMs);
+
+	while (low < high)
+	{
+		middle = (low + high) / 2;
+
+		if (tsSeek(rollup->fp, (int64_t)sizeof(TS_FILE_HEADER) + (int64_t)(middle * recordSize)) != 0 ||
+			fread(&recordMs, sizeof(int64_t), 1, rollup->fp) != 1)
+			return -1;
+
+		if (recordMs < startMs)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	for (record = low; record < rollup->nRecords && !full; record++)
+	{
+		if (tsSeek(rollup->fp, (int64_t)sizeof(TS_FILE_HEADER) + (int64_t)(record * recordSize)) != 0 ||
+			fread(rollup->record, recordSize, 1, rollup->fp) != 1)
+			return -1;
+
+		memcpy(&point.timeMs, rollup->record, sizeof(int64_t));
+
+		if (point.timeMs > endMs)
+			break;
+
+		memcpy(fields, rollup->record + sizeof(int64_t) + column * sizeof(fields), sizeof(fields));
+		point.min = fields[0];
+		point.max = fields[1];
+		point.mean = fields[2];
+		memcpy(&point.count, &fields[3], sizeof(uint32_t));
+		full = !addPoint(points, &nPoints, maxPoints, &point, 1);
+	}
+
+	// The period still open
+	if (!full && rollup->startMs != -1 && rollup->startMs >= startMs && rollup->startMs <= endMs)
+	{
+		point.timeMs = rollup->startMs;
+		point.count = rollup->count[column];
+		point.min = point.count ? rollup->min[column] : NAN;
+		point.max = point.count ? rollup->max[column] : NAN;
+		point.mean = point.count ? (float)(rollup->sum[column] / point.count) : NAN;
+		addPoint(points, &nPoints, maxPoints, &point, 1);
+	}
+
+	return nPoints;
+}
+
+/****************************************************************************
+* ts_store_query
+*
+* Reads one column over a time range, including rows and rollup periods
+* not yet written to the files
+* Inputs:
+* - level: TS_LEVEL_RAW for the rows, or a rollup level
+* - startMs, endMs: the range, inclusive. Rollup periods are included if
+*   they start in the range or hold startMs.
+* - maxPoints: size of points
+* Outputs:
+* - points: in time order
+* Returns:
+* - the number of points, -1 on failure
+****************************************************************************/
+int32_t ts_store_query(TS_STORE* store, TS_LEVEL level, uint32_t column, int64_t startMs, int64_t endMs,
+	TS_POINT* points, uint32_t maxPoints)
+{
+	if (column >= store->nColumns || level >= TS_LEVELS || maxPoints == 0)
+		return -1;
+
+	if (level == TS_LEVEL_RAW)
+	{
+		if (fflush(store->raw) != 0)
+			return -1;
+
+		return queryRaw(store, column, startMs, endMs, points, maxPoints);
+	}
+
+	if (fflush(store->rollups[level].fp) != 0)
+		return -1;
+
+	return queryRollup(store, &store->rollups[level], column, startMs, endMs, points, maxPoints);
+}
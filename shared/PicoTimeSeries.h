@@ -0,0 +1,132 @@
+/****************************************************************************
+ *
+ * Filename:    PicoTimeSeries.h
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This header defines an append-only time-series store for data loggers.
+ * Each store has nColumns float values per row and holds four files:
+ *
+ * <name>.tsr	Raw rows in compressed blocks. Timestamps are stored as
+ *				deltas of deltas and each column as the XOR of each value
+ *				with the previous one, column by column, so readings at a
+ *				steady interval that change slowly take a few bytes a row.
+ * <name>.tsm	Minute rollups: min, max, mean and count of each column
+ * <name>.tsh	Hour rollups
+ * <name>.tsd	Day rollups
+ *
+ * Rollups are built as rows arrive and are fixed-size records, so a range
+ * query on a rollup level is a binary search and reads only the records
+ * in the range. ts_store_pick_level picks the coarsest level still giving
+ * the points a dashboard needs. Timestamps are in milliseconds and must
+ * not go backwards. NaN values (missing readings) are kept in the raw
+ * rows and left out of the rollups.
+ *
+ * Opening an existing store appends to it. A rollup period still open
+ * when a store is closed is written as it stands, and queries merge it
+ * with the rest of the period if more rows arrive after reopening.
+ *
+ * The functions return 1 on success and 0 on failure (like the logger
+ * drivers) so the store does not depend on PicoStatus.h.
+ *
+ ****************************************************************************/
+#ifndef __PICOTIMESERIES_H__
+#define __PICOTIMESERIES_H__
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define TS_MAGIC			0x53545050	// "PPTS"
+#define TS_BLOCK_MAGIC		0x4B4C4254	// "TBLK"
+#define TS_VERSION			1
+#define TS_BLOCK_ROWS		1024		// Rows per compressed block
+#define TS_MAX_NAME			260
+
+typedef enum enTsLevel
+{
+	TS_LEVEL_RAW,
+	TS_LEVEL_MINUTE,
+	TS_LEVEL_HOUR,
+	TS_LEVEL_DAY,
+	TS_LEVELS
+}TS_LEVEL;
+
+// Header at the start of every file of a store
+typedef struct tTsFileHeader
+{
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	nColumns;
+	uint32_t	level;			// TS_LEVEL
+	int64_t		periodMs;		// Rollup period, 0 for raw rows
+}TS_FILE_HEADER;
+
+// Each rollup record is the int64_t start of the period then, for each
+// column, float min, max and mean and uint32_t count
+#define TS_RECORD_SIZE(nColumns)	(sizeof(int64_t) + (nColumns) * 4 * sizeof(float))
+
+// Header of each raw block, followed by the compressed timestamps, then
+// nColumns uint32_t offsets of the column streams from the start of the
+// payload and the column streams
+typedef struct tTsBlockHeader
+{
+	uint32_t	magic;
+	uint32_t	nRows;
+	uint32_t	payloadBytes;
+	uint32_t	timeBytes;
+	int64_t		firstMs;
+	int64_t		lastMs;
+}TS_BLOCK_HEADER;
+
+// One point returned by a query. For raw rows min, max and mean are the value.
+typedef struct tTsPoint
+{
+	int64_t		timeMs;			// Row time or start of the rollup period
+	float		min;
+	float		max;
+	float		mean;
+	uint32_t	count;			// Readings in the point, 0 if none
+}TS_POINT;
+
+typedef struct tTsRollup
+{
+	FILE*		fp;
+	int64_t		periodMs;
+	int64_t		startMs;		// Start of the open period, -1 if none
+	float*		min;
+	float*		max;
+	double*		sum;
+	uint32_t*	count;
+	uint64_t	nRecords;		// Records in the file
+	uint8_t*	record;			// Record being written or read
+}TS_ROLLUP;
+
+typedef struct tTsStore
+{
+	char		name[TS_MAX_NAME];
+	uint32_t	nColumns;
+	FILE*		raw;
+	int64_t		rawEnd;			// End of the last complete block in the raw file
+	int64_t		lastMs;			// Newest row appended, INT64_MIN if none
+	uint32_t	nRows;			// Rows in the block being built
+	int64_t*	times;			// TS_BLOCK_ROWS
+	float*		values;			// TS_BLOCK_ROWS * nColumns, row by row
+	uint8_t*	encoded;		// Compressed block being written
+	TS_ROLLUP	rollups[TS_LEVELS];	// rollups[TS_LEVEL_RAW] is not used
+	uint64_t	rowsAppended;
+	uint64_t	bytesWritten;	// Raw block bytes written since opening
+}TS_STORE;
+
+// Function prototypes
+int16_t ts_store_open(TS_STORE* store, const char* name, uint32_t nColumns);
+int16_t ts_store_append(TS_STORE* store, int64_t timeMs, const float* values);
+int16_t ts_store_flush(TS_STORE* store);
+void ts_store_close(TS_STORE* store);
+
+int64_t ts_level_period_ms(TS_LEVEL level);
+TS_LEVEL ts_store_pick_level(int64_t startMs, int64_t endMs, uint32_t maxPoints, int64_t rowIntervalMs);
+
+int32_t ts_store_query(TS_STORE* store, TS_LEVEL level, uint32_t column, int64_t startMs, int64_t endMs,
+	TS_POINT* points, uint32_t maxPoints);
+
+#endif
@@ -0,0 +1,346 @@
+/****************************************************************************
+ *
+ * Filename:    PicoTimebase.c
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This file defines a cached timebase solver for PicoScope data.
+ * The series libraries fill the solver once per session (see
+ * calibrateTimebaseSolver) and then answer timebase requests from memory.
+ *
+ ****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "./PicoTimebase.h"
+
+/****************************************************************************
+* countChannelFlags
+*
+* Returns the number of channels set in a channel flags value
+****************************************************************************/
+static int16_t countChannelFlags(uint32_t channelFlags)
+{
+	int16_t count = 0;
+
+	while (channelFlags)
+	{
+		channelFlags &= channelFlags - 1;
+		count++;
+	}
+	return count;
+}
+
+/****************************************************************************
+* getEntry
+*
+* Returns the cache entry for a resolution and channel flags combination,
+* or NULL if the combination is outside the solver
+****************************************************************************/
+static TIMEBASE_ENTRY* getEntry(TIMEBASE_SOLVER* solver, int32_t resolution, uint32_t channelFlags)
+{
+	if (solver->entries == NULL || resolution < 0 || resolution >= TIMEBASE_MAX_RESOLUTIONS)
+		return NULL;
+
+	if (channelFlags == 0 || channelFlags >= (1u << solver->channelCount))
+		return NULL;
+
+	return &solver->entries[((uint32_t)resolution << solver->channelCount) + channelFlags];
+}
+
+/****************************************************************************
+* timebase_solver_init
+*
+* Allocates the cache for every resolution and channel flags combination.
+* Every entry starts as PICO_INVALID_PARAMETER until calibrated.
+* Inputs:
+* - solver
+* - channelCount (analogue channels, max. TIMEBASE_MAX_CHANNELS)
+* Returns:
+* - PICO_OK, PICO_INVALID_PARAMETER or PICO_MEMORY
+****************************************************************************/
+PICO_STATUS timebase_solver_init(TIMEBASE_SOLVER* solver, int16_t channelCount)
+{
+	uint32_t nEntries;
+	uint32_t i;
+
+	memset(solver, 0, sizeof(TIMEBASE_SOLVER));
+
+	if (channelCount <= 0 || channelCount > TIMEBASE_MAX_CHANNELS)
+		return PICO_INVALID_PARAMETER;
+
+	nEntries = (uint32_t)TIMEBASE_MAX_RESOLUTIONS << channelCount;
+	solver->entries = (TIMEBASE_ENTRY*)calloc(nEntries, sizeof(TIMEBASE_ENTRY));
+
+	if (solver->entries == NULL)
+		return PICO_MEMORY;
+
+	for (i = 0; i < nEntries; i++)
+	{
+		solver->entries[i].status = PICO_INVALID_PARAMETER;
+	}
+
+	solver->channelCount = channelCount;
+	return PICO_OK;
+}
+
+/****************************************************************************
+* timebase_solver_free
+****************************************************************************/
+void timebase_solver_free(TIMEBASE_SOLVER* solver)
+{
+	free(solver->entries);
+	memset(solver, 0, sizeof(TIMEBASE_SOLVER));
+}
+
+/****************************************************************************
+* timebase_solver_set_model
+*
+* Sets the timebase formula for one resolution
+****************************************************************************/
+void timebase_solver_set_model(TIMEBASE_SOLVER* solver, int32_t resolution, TIMEBASE_MODEL model)
+{
+	if (resolution >= 0 && resolution < TIMEBASE_MAX_RESOLUTIONS)
+		solver->model[resolution] = model;
+}
+
+/****************************************************************************
+* timebase_solver_set_memory
+*
+* Sets the total capture memory (in samples) for one resolution.
+* Leave at 0 if unknown - sample count checks are then skipped.
+****************************************************************************/
+void timebase_solver_set_memory(TIMEBASE_SOLVER* solver, int32_t resolution, uint64_t maxSamples)
+{
+	if (resolution >= 0 && resolution < TIMEBASE_MAX_RESOLUTIONS)
+		solver->maxMemory[resolution] = maxSamples;
+}
+
+/****************************************************************************
+* timebase_solver_set_entry
+*
+* Stores the driver result of GetMinimumTimebaseStateless for one
+* resolution and channel flags combination
+****************************************************************************/
+void timebase_solver_set_entry(TIMEBASE_SOLVER* solver, int32_t resolution, uint32_t channelFlags,
+	PICO_STATUS status, uint32_t minTimebase, double minInterval)
+{
+	TIMEBASE_ENTRY* entry = getEntry(solver, resolution, channelFlags);
+
+	if (entry == NULL)
+		return;
+
+	entry->status = status;
+	entry->minTimebase = minTimebase;
+	entry->minInterval = minInterval;
+}
+
+/****************************************************************************
+* timebase_solver_ready
+*
+* Returns 1 if the solver can answer requests for this resolution
+* without calling the driver
+****************************************************************************/
+int16_t timebase_solver_ready(TIMEBASE_SOLVER* solver, int32_t resolution)
+{
+	if (!solver->calibrated || resolution < 0 || resolution >= TIMEBASE_MAX_RESOLUTIONS)
+		return 0;
+
+	return solver->model[resolution].valid;
+}
+
+/****************************************************************************
+* timebase_solver_validate
+*
+* Compares the model interval for a timebase against the interval
+* returned by the driver. The model for the resolution is invalidated
+* on mismatch, so callers fall back to driver calls.
+* Returns:
+* - 1 if the model agrees with the driver, else 0
+****************************************************************************/
+int16_t timebase_solver_validate(TIMEBASE_SOLVER* solver, int32_t resolution, uint32_t timebase, double driverInterval)
+{
+	TIMEBASE_MODEL* model;
+	double modelInterval;
+
+	if (resolution < 0 || resolution >= TIMEBASE_MAX_RESOLUTIONS)
+		return 0;
+
+	model = &solver->model[resolution];
+	if (!model->valid)
+		return 0;
+
+	modelInterval = timebase_to_interval(model, timebase);
+
+	if (fabs(modelInterval - driverInterval) > driverInterval * TIMEBASE_TOLERANCE)
+	{
+		printf("Timebase solver: timebase %lu model %le s, driver %le s - using driver calls\n",
+			(unsigned long)timebase, modelInterval, driverInterval);
+		model->valid = 0;
+		return 0;
+	}
+	return 1;
+}
+
+/****************************************************************************
+* timebase_to_interval
+*
+* Returns the sample interval (seconds) of a timebase
+****************************************************************************/
+double timebase_to_interval(const TIMEBASE_MODEL* model, uint32_t timebase)
+{
+	if (timebase < model->nExponential)
+		return model->baseInterval * (double)(1ull << timebase);
+
+	return (double)((int64_t)timebase - (int64_t)model->linearOffset) * model->linearStep;
+}
+
+/****************************************************************************
+* interval_to_timebase
+*
+* Returns the timebase nearest to the requested interval
+* Inputs:
+* - roundFaster: 1 = interval at or below the request, 0 = at or above
+****************************************************************************/
+uint32_t interval_to_timebase(const TIMEBASE_MODEL* model, double interval, int16_t roundFaster)
+{
+	uint32_t timebase;
+	double estimate;
+
+	if (interval <= 0)
+		return 0;
+
+	// Find the fastest timebase that is not slower than the request
+	if (interval < timebase_to_interval(model, model->nExponential))
+	{
+		estimate = floor(log2(interval / model->baseInterval) + TIMEBASE_TOLERANCE);
+		timebase = estimate < 0 ? 0 : (uint32_t)estimate;
+		if (timebase >= model->nExponential && model->nExponential > 0)
+			timebase = model->nExponential - 1;
+	}
+	else
+	{
+		estimate = floor(interval / model->linearStep + TIMEBASE_TOLERANCE) + model->linearOffset;
+		timebase = estimate > UINT32_MAX ? UINT32_MAX : (uint32_t)estimate;
+	}
+
+	if (!roundFaster && timebase < UINT32_MAX &&
+		timebase_to_interval(model, timebase) < interval * (1 - TIMEBASE_TOLERANCE))
+	{
+		timebase++;
+	}
+	return timebase;
+}
+
+/****************************************************************************
+* timebase_solver_nearest
+*
+* In memory equivalent of NearestSampleIntervalStateless
+* Outputs:
+* - timebase, interval (seconds)
+* Returns:
+* - PICO_OK or the driver status stored for the channel combination
+****************************************************************************/
+PICO_STATUS timebase_solver_nearest(TIMEBASE_SOLVER* solver, int32_t resolution, uint32_t channelFlags,
+	double requestedInterval, int16_t roundFaster, uint32_t* timebase, double* interval)
+{
+	TIMEBASE_ENTRY* entry;
+	uint32_t tb;
+
+	if (!timebase_solver_ready(solver, resolution))
+		return PICO_INVALID_PARAMETER;
+
+	entry = getEntry(solver, resolution, channelFlags);
+	if (entry == NULL)
+		return PICO_INVALID_PARAMETER;
+
+	if (entry->status != PICO_OK)
+		return entry->status;
+
+	tb = interval_to_timebase(&solver->model[resolution], requestedInterval, roundFaster);
+	if (tb < entry->minTimebase)
+		tb = entry->minTimebase;
+
+	*timebase = tb;
+	*interval = timebase_to_interval(&solver->model[resolution], tb);
+	return PICO_OK;
+}
+
+/****************************************************************************
+* timebase_solver_fastest
+*
+* Returns the shortest timebase for a channel combination when at least
+* minSamples per channel must fit in capture memory
+****************************************************************************/
+PICO_STATUS timebase_solver_fastest(TIMEBASE_SOLVER* solver, int32_t resolution, uint32_t channelFlags,
+	uint64_t minSamples, uint32_t* timebase, double* interval)
+{
+	TIMEBASE_ENTRY* entry;
+
+	if (!solver->calibrated)
+		return PICO_INVALID_PARAMETER;
+
+	entry = getEntry(solver, resolution, channelFlags);
+	if (entry == NULL)
+		return PICO_INVALID_PARAMETER;
+
+	if (entry->status != PICO_OK)
+		return entry->status;
+
+	// Capture memory is shared between the enabled channels
+	if (solver->maxMemory[resolution] != 0 &&
+		minSamples > solver->maxMemory[resolution] / (uint64_t)countChannelFlags(channelFlags))
+	{
+		return PICO_TOO_MANY_SAMPLES;
+	}
+
+	*timebase = entry->minTimebase;
+	*interval = entry->minInterval;
+	return PICO_OK;
+}
+
+/****************************************************************************
+* timebase_solver_fastest_for_count
+*
+* Searches every combination of nChannels channels for the shortest
+* timebase. Ties are resolved in favour of the lowest channels.
+* Outputs:
+* - channelFlags, timebase, interval (seconds)
+****************************************************************************/
+PICO_STATUS timebase_solver_fastest_for_count(TIMEBASE_SOLVER* solver, int32_t resolution, int16_t nChannels,
+	uint64_t minSamples, uint32_t* channelFlags, uint32_t* timebase, double* interval)
+{
+	PICO_STATUS status = PICO_INVALID_NUMBER_CHANNELS_FOR_RESOLUTION;
+	PICO_STATUS entryStatus;
+	uint32_t flags;
+	uint32_t tb;
+	double ti;
+
+	if (!solver->calibrated || nChannels <= 0 || nChannels > solver->channelCount)
+		return PICO_INVALID_PARAMETER;
+
+	for (flags = 1; flags < (1u << solver->channelCount); flags++)
+	{
+		if (countChannelFlags(flags) != nChannels)
+			continue;
+
+		entryStatus = timebase_solver_fastest(solver, resolution, flags, minSamples, &tb, &ti);
+
+		if (entryStatus == PICO_OK)
+		{
+			if (status != PICO_OK || tb < *timebase)
+			{
+				*channelFlags = flags;
+				*timebase = tb;
+				*interval = ti;
+			}
+			status = PICO_OK;
+		}
+		else if (status != PICO_OK && entryStatus == PICO_TOO_MANY_SAMPLES)
+		{
+			status = PICO_TOO_MANY_SAMPLES;
+		}
+	}
+	return status;
+}
@@ -0,0 +1,82 @@
+/****************************************************************************
+ *
+ * Filename:    PicoTimebase.h
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This header defines a cached timebase solver for PicoScope data.
+ * The solver holds the timebase <-> sample interval mapping and the
+ * shortest timebase for each resolution and channel flag combination,
+ * so timebase selection can be answered without driver calls.
+ *
+ ****************************************************************************/
+#ifndef __PICOTIMEBASE_H__
+#define __PICOTIMEBASE_H__
+
+#include <stdint.h>
+
+/* PicoStatus.h of the driver being built, from its include directory (AM_CPPFLAGS on Linux) */
+#ifndef PICO_OK
+#include "PicoStatus.h"
+#endif
+
+// Resolution enum values of all APIs are below this value (PICO_DR_10BIT = 10)
+#define TIMEBASE_MAX_RESOLUTIONS	16
+// Analogue channels only - one flag bit per channel (PICO_CHANNEL_A_FLAGS = 1)
+#define TIMEBASE_MAX_CHANNELS		8
+// Relative tolerance used when comparing solver intervals against the driver
+#define TIMEBASE_TOLERANCE			1e-6
+
+// Timebase to sample interval formula as given in the Programmer's Guides:
+// timebase < nExponential  : interval = baseInterval * 2^timebase
+// timebase >= nExponential : interval = (timebase - linearOffset) * linearStep
+typedef struct tTimebaseModel
+{
+	int16_t		valid;
+	uint32_t	nExponential;
+	double		baseInterval;	// In seconds
+	uint32_t	linearOffset;
+	double		linearStep;		// In seconds
+}TIMEBASE_MODEL;
+
+typedef struct tTimebaseEntry
+{
+	PICO_STATUS	status;			// Driver status for this combination (PICO_OK if valid)
+	uint32_t	minTimebase;
+	double		minInterval;	// In seconds
+}TIMEBASE_ENTRY;
+
+typedef struct tTimebaseSolver
+{
+	int16_t			calibrated;
+	int16_t			channelCount;
+	uint64_t		maxMemory[TIMEBASE_MAX_RESOLUTIONS];	// Total samples, 0 if unknown
+	TIMEBASE_MODEL	model[TIMEBASE_MAX_RESOLUTIONS];
+	TIMEBASE_ENTRY*	entries;								// [resolution][channelFlags]
+}TIMEBASE_SOLVER;
+
+// Function prototypes
+PICO_STATUS timebase_solver_init(TIMEBASE_SOLVER* solver, int16_t channelCount);
+void timebase_solver_free(TIMEBASE_SOLVER* solver);
+
+void timebase_solver_set_model(TIMEBASE_SOLVER* solver, int32_t resolution, TIMEBASE_MODEL model);
+void timebase_solver_set_memory(TIMEBASE_SOLVER* solver, int32_t resolution, uint64_t maxSamples);
+void timebase_solver_set_entry(TIMEBASE_SOLVER* solver, int32_t resolution, uint32_t channelFlags,
+	PICO_STATUS status, uint32_t minTimebase, double minInterval);
+
+int16_t timebase_solver_ready(TIMEBASE_SOLVER* solver, int32_t resolution);
+int16_t timebase_solver_validate(TIMEBASE_SOLVER* solver, int32_t resolution, uint32_t timebase, double driverInterval);
+
+double timebase_to_interval(const TIMEBASE_MODEL* model, uint32_t timebase);
+uint32_t interval_to_timebase(const TIMEBASE_MODEL* model, double interval, int16_t roundFaster);
+
+PICO_STATUS timebase_solver_nearest(TIMEBASE_SOLVER* solver, int32_t resolution, uint32_t channelFlags,
+	double requestedInterval, int16_t roundFaster, uint32_t* timebase, double* interval);
+
+PICO_STATUS timebase_solver_fastest(TIMEBASE_SOLVER* solver, int32_t resolution, uint32_t channelFlags,
+	uint64_t minSamples, uint32_t* timebase, double* interval);
+
+PICO_STATUS timebase_solver_fastest_for_count(TIMEBASE_SOLVER* solver, int32_t resolution, int16_t nChannels,
+	uint64_t minSamples, uint32_t* channelFlags, uint32_t* timebase, double* interval);
+
+#endif
@@ -0,0 +1,465 @@
+/****************************************************************************
+ *
+ * Filename:    PicoTriggerCorrelator.c
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This file defines a correlator for the trigger time stamps of several
+ * scopes in rapid block mode (see PicoTriggerCorrelator.h).
+ *
+ ****************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "./PicoTriggerCorrelator.h"
+
+#ifndef PICO_DEVICE_TIME_STAMP_RESET
+#define PICO_DEVICE_TIME_STAMP_RESET	0x01000000UL
+#endif
+
+typedef struct tCorrelatorEntry
+{
+	double		timeNs;		// Reference time
+	int16_t		device;
+	int32_t		segment;
+}CORRELATOR_ENTRY;
+
+/****************************************************************************
+* compareEntries
+****************************************************************************/
+static int compareEntries(const void* a, const void* b)
+{
+	double timeA = ((const CORRELATOR_ENTRY*)a)->timeNs;
+	double timeB = ((const CORRELATOR_ENTRY*)b)->timeNs;
+
+	return (timeA > timeB) - (timeA < timeB);
+}
+
+/****************************************************************************
+* validTimes
+*
+* Copies the segments of a device with a valid time stamp, in order
+*
+* Returns:
+* - the number of segments copied
+****************************************************************************/
+static uint32_t validTimes(const CORRELATOR_DEVICE* device, double* times, int32_t* segments)
+{
+	uint32_t i;
+	uint32_t n = 0;
+
+	for (i = 0; i < device->nSegments; i++)
+	{
+		if (!isnan(device->localNs[i]))
+		{
+			times[n] = device->localNs[i];
+			segments[n++] = (int32_t)i;
+		}
+	}
+	return n;
+}
+
+/****************************************************************************
+* matchTimes
+*
+* Pairs each device time with the reference time it lands on under the
+* clock model, both lists being in time order
+*
+* Outputs:
+* - match: the reference index for each device time, -1 if none (may be NULL)
+* - sumSquares: of the differences of the pairs
+* Returns:
+* - the number of pairs
+****************************************************************************/
+static uint32_t matchTimes(const double* reference, uint32_t nReference, const double* local, uint32_t nLocal,
+	double rate, double offsetNs, double toleranceNs, int32_t* match, double* sumSquares)
+{
+	uint32_t i = 0;
+	uint32_t k;
+	uint32_t pairs = 0;
+	double predicted;
+
+	*sumSquares = 0;
+
+	for (k = 0; k < nLocal; k++)
+	{
+		predicted = offsetNs + rate * local[k];
+
+		while (i < nReference && reference[i] < predicted - toleranceNs)
+			i++;
+
+		if (i < nReference && fabs(reference[i] - predicted) <= toleranceNs)
+		{
+			*sumSquares += (reference[i] - predicted) * (reference[i] - predicted);
+
+			if (match)
+				match[k] = (int32_t)i;
+
+			pairs++;
+			i++;
+		}
+		else if (match)
+		{
+			match[k] = -1;
+		}
+	}
+	return pairs;
+}
+
+/****************************************************************************
+* alignDevice
+*
+* Finds the offset of a device clock for this run and adds its matched
+* triggers to the drift fit
+****************************************************************************/
+static void alignDevice(CORRELATOR_DEVICE* device, const double* reference, uint32_t nReference,
+	const double* local, uint32_t nLocal, int32_t* match, double toleranceNs)
+{
+	uint32_t a;
+	uint32_t b;
+	uint32_t k;
+	uint32_t pairs;
+	uint32_t bestPairs = 0;
+	double offsetNs;
+	double bestOffsetNs = 0;
+	double sumSquares;
+	double bestSumSquares = 0;
+	double meanX = 0;
+	double meanY = 0;
+	double sxx = 0;
+	double sxy = 0;
+	double x;
+	double y;
+
+	device->aligned = 0;
+
+	// Try the first few segments of each against each other as the first common trigger
+	for (a = 0; a < nReference && a < TRIGGER_CORRELATOR_ANCHORS; a++)
+	{
+		for (b = 0; b < nLocal && b < TRIGGER_CORRELATOR_ANCHORS; b++)
+		{
+			offsetNs = reference[a] - device->rate * local[b];
+			pairs = matchTimes(reference, nReference, local, nLocal, device->rate, offsetNs, toleranceNs, NULL, &sumSquares);
+
+			if (pairs > bestPairs || (pairs == bestPairs && pairs > 0 && sumSquares < bestSumSquares))
+			{
+				bestPairs = pairs;
+				bestOffsetNs = offsetNs;
+				bestSumSquares = sumSquares;
+			}
+		}
+	}
+
+	if (bestPairs == 0)
+		return;
+
+	pairs = matchTimes(reference, nReference, local, nLocal, device->rate, bestOffsetNs, toleranceNs, match, &sumSquares);
+
+	// Sums of this run about its own means, as the offset is new each run
+	for (k = 0; k < nLocal; k++)
+	{
+		if (match[k] >= 0)
+		{
+			meanX += local[k];
+			meanY += reference[match[k]];
+		}
+	}
+
+	meanX /= pairs;
+	meanY /= pairs;
+
+	for (k = 0; k < nLocal; k++)
+	{
+		if (match[k] >= 0)
+		{
+			x = local[k] - meanX;
+			y = reference[match[k]] - meanY;
+			sxx += x * x;
+			sxy += x * y;
+		}
+	}
+
+	device->pairs += pairs;
+	device->sxx += sxx;
+	device->sxy += sxy;
+
+	if (device->pairs >= TRIGGER_CORRELATOR_MIN_PAIRS && device->sxx > 0)
+		device->rate = device->sxy / device->sxx;
+
+	device->offsetNs = meanY - device->rate * meanX;
+	device->aligned = 1;
+
+	matchTimes(reference, nReference, local, nLocal, device->rate, device->offsetNs, toleranceNs, NULL, &sumSquares);
+	device->residualRmsNs = sqrt(sumSquares / pairs);
+}
+
+/****************************************************************************
+* trigger_correlator_init
+*
+* Inputs:
+* - nDevices: devices to correlate, device 0 is the reference
+* - toleranceNs: furthest apart two time stamps of one trigger can be
+****************************************************************************/
+PICO_STATUS trigger_correlator_init(TRIGGER_CORRELATOR* correlator, int16_t nDevices, double toleranceNs)
+{
+	int16_t device;
+
+	memset(correlator, 0, sizeof(TRIGGER_CORRELATOR));
+
+	if (nDevices < 1 || nDevices > TRIGGER_CORRELATOR_MAX_DEVICES || toleranceNs <= 0)
+		return PICO_INVALID_PARAMETER;
+
+	correlator->nDevices = nDevices;
+	correlator->toleranceNs = toleranceNs;
+
+	for (device = 0; device < nDevices; device++)
+		correlator->devices[device].rate = 1.0;
+
+	return PICO_OK;
+}
+
+/****************************************************************************
+* trigger_correlator_free
+****************************************************************************/
+void trigger_correlator_free(TRIGGER_CORRELATOR* correlator)
+{
+	int16_t device;
+
+	for (device = 0; device < TRIGGER_CORRELATOR_MAX_DEVICES; device++)
+		free(correlator->devices[device].localNs);
+
+	free(correlator->events);
+	memset(correlator, 0, sizeof(TRIGGER_CORRELATOR));
+}
+
+/****************************************************************************
+* trigger_correlator_add
+*
+* Adds the time stamps of one run of a device, as read with
+* GetTriggerInfoBulk. The counter of the segment flagged with
+* PICO_DEVICE_TIME_STAMP_RESET starts the run; segments after a later
+* reset cannot be placed and are left out.
+*
+* Inputs:
+* - timeIntervalNs: time of one counter tick (the sample interval)
+* - timeStampCounters, statuses: per segment
+****************************************************************************/
+PICO_STATUS trigger_correlator_add(TRIGGER_CORRELATOR* correlator, int16_t device, double timeIntervalNs,
+	const uint64_t* timeStampCounters, const PICO_STATUS* statuses, uint32_t nSegments)
+{
+	CORRELATOR_DEVICE* dev;
+	double* localNs;
+	uint64_t base = 0;
+	int16_t started = 0;
+	int16_t restarted = 0;
+	uint32_t i;
+
+	if (device < 0 || device >= correlator->nDevices || timeIntervalNs <= 0)
+		return PICO_INVALID_PARAMETER;
+
+	dev = &correlator->devices[device];
+
+	if (nSegments > dev->capacity)
+	{
+		localNs = (double*)realloc(dev->localNs, nSegments * sizeof(double));
+
+		if (localNs == NULL)
+			return PICO_MEMORY;
+
+		dev->localNs = localNs;
+		dev->capacity = nSegments;
+	}
+
+	for (i = 0; i < nSegments; i++)
+	{
+		if (started && (statuses[i] & PICO_DEVICE_TIME_STAMP_RESET))
+			restarted = 1;
+
+		if (restarted || (statuses[i] & ~PICO_DEVICE_TIME_STAMP_RESET) != PICO_OK)
+		{
+			dev->localNs[i] = NAN;
+			continue;
+		}
+
+		if (!started)
+		{
+			base = timeStampCounters[i];
+			started = 1;
+		}
+
+		dev->localNs[i] = (double)(int64_t)(timeStampCounters[i] - base) * timeIntervalNs;
+	}
+
+	dev->timeIntervalNs = timeIntervalNs;
+	dev->nSegments = nSegments;
+	return PICO_OK;
+}
+
+/****************************************************************************
+* trigger_correlator_correlate
+*
+* Matches the segments added for this run and starts the next run
+*
+* Outputs:
+* - events: the correlated events of the run in time order, valid until
+*   the next call
+****************************************************************************/
+PICO_STATUS trigger_correlator_correlate(TRIGGER_CORRELATOR* correlator, const CORRELATED_EVENT** events, uint32_t* nEvents)
+{
+	CORRELATOR_DEVICE* reference = &correlator->devices[0];
+	CORRELATOR_ENTRY* entries;
+	CORRELATED_EVENT* event = NULL;
+	CORRELATED_EVENT* grown;
+	double* referenceTimes;
+	double* times;
+	int32_t* referenceSegments;
+	int32_t* segments;
+	int32_t* match;
+	uint32_t maxSegments = 0;
+	uint32_t nReference;
+	uint32_t nTimes;
+	uint32_t nEntries = 0;
+	uint32_t i;
+	int16_t device;
+	PICO_STATUS status = PICO_OK;
+
+	for (device = 0; device < correlator->nDevices; device++)
+	{
+		if (correlator->devices[device].nSegments > maxSegments)
+			maxSegments = correlator->devices[device].nSegments;
+	}
+
+	entries = (CORRELATOR_ENTRY*)malloc((maxSegments * correlator->nDevices + 1) * sizeof(CORRELATOR_ENTRY));
+	referenceTimes = (double*)malloc((maxSegments + 1) * sizeof(double));
+	times = (double*)malloc((maxSegments + 1) * sizeof(double));
+	referenceSegments = (int32_t*)malloc((maxSegments + 1) * sizeof(int32_t));
+	segments = (int32_t*)malloc((maxSegments + 1) * sizeof(int32_t));
+	match = (int32_t*)malloc((maxSegments + 1) * sizeof(int32_t));
+
+	// Every segment of every device may be a separate event
+	if (maxSegments * correlator->nDevices > correlator->eventCapacity)
+	{
+		grown = (CORRELATED_EVENT*)realloc(correlator->events, maxSegments * correlator->nDevices * sizeof(CORRELATED_EVENT));
+
+		if (grown != NULL)
+		{
+			correlator->events = grown;
+			correlator->eventCapacity = maxSegments * correlator->nDevices;
+		}
+	}
+
+	if (entries == NULL || referenceTimes == NULL || times == NULL || referenceSegments == NULL || segments == NULL ||
+		match == NULL || maxSegments * correlator->nDevices > correlator->eventCapacity)
+	{
+		status = PICO_MEMORY;
+	}
+	else
+	{
+		// The reference clock is the time base of the run
+		nReference = validTimes(reference, referenceTimes, referenceSegments);
+		reference->aligned = nReference > 0;
+
+		for (i = 0; i < nReference; i++)
+		{
+			entries[nEntries].timeNs = referenceTimes[i];
+			entries[nEntries].device = 0;
+			entries[nEntries++].segment = referenceSegments[i];
+		}
+
+		for (device = 1; device < correlator->nDevices; device++)
+		{
+			CORRELATOR_DEVICE* dev = &correlator->devices[device];
+
+			nTimes = validTimes(dev, times, segments);
+			alignDevice(dev, referenceTimes, nReference, times, nTimes, match, correlator->toleranceNs);
+
+			if (!dev->aligned)
+				continue;
+
+			for (i = 0; i < nTimes; i++)
+			{
+				entries[nEntries].timeNs = dev->offsetNs + dev->rate * times[i];
+				entries[nEntries].device = device;
+				entries[nEntries++].segment = segments[i];
+			}
+		}
+
+		// Time stamps of one trigger are within the tolerance and from different devices
+		qsort(entries, nEntries, sizeof(CORRELATOR_ENTRY), compareEntries);
+		correlator->nEvents = 0;
+
+		for (i = 0; i < nEntries; i++)
+		{
+			if (event == NULL || entries[i].timeNs - event->timeNs > correlator->toleranceNs ||
+				event->segment[entries[i].device] >= 0)
+			{
+				event = &correlator->events[correlator->nEvents++];
+				memset(event->segment, -1, sizeof(event->segment));
+				event->globalIndex = correlator->nextIndex++;
+				event->run = correlator->run;
+				event->timeNs = entries[i].timeNs;
+			}
+
+			event->segment[entries[i].device] = entries[i].segment;
+
+			if (entries[i].device == 0)
+				event->timeNs = entries[i].timeNs;
+		}
+
+		for (i = 0; i < correlator->nEvents; i++)
+		{
+			for (device = 0; device < correlator->nDevices; device++)
+			{
+				if (correlator->events[i].segment[device] < 0)
+					correlator->devices[device].missed++;
+			}
+		}
+
+		*events = correlator->events;
+		*nEvents = correlator->nEvents;
+	}
+
+	for (device = 0; device < correlator->nDevices; device++)
+		correlator->devices[device].nSegments = 0;
+
+	correlator->run++;
+
+	free(entries);
+	free(referenceTimes);
+	free(times);
+	free(referenceSegments);
+	free(segments);
+	free(match);
+	return status;
+}
+
+/****************************************************************************
+* trigger_correlator_print
+****************************************************************************/
+void trigger_correlator_print(FILE* fp, const TRIGGER_CORRELATOR* correlator)
+{
+	const CORRELATOR_DEVICE* dev;
+	int16_t device;
+
+	for (device = 0; device < correlator->nDevices; device++)
+	{
+		dev = &correlator->devices[device];
+
+		if (device == 0)
+		{
+			fprintf(fp, "Device 0: reference, missed %llu\n", (unsigned long long)dev->missed);
+		}
+		else if (!dev->aligned)
+		{
+			fprintf(fp, "Device %d: not lined up in the last run, %llu matched, missed %llu\n", device,
+				(unsigned long long)dev->pairs, (unsigned long long)dev->missed);
+		}
+		else
+		{
+			// The rate is reference time per device time, so a device clock running fast has a rate below 1
+			fprintf(fp, "Device %d: %llu matched, clock %+.3f ppm, offset %.1f ns, residual %.1f ns rms, missed %llu\n", device,
+				(unsigned long long)dev->pairs, (1.0 / dev->rate - 1.0) * 1e6, dev->offsetNs, dev->residualRmsNs,
+				(unsigned long long)dev->missed);
+		}
+	}
+}
@@ -0,0 +1,88 @@
+/****************************************************************************
+ *
+ * Filename:    PicoTriggerCorrelator.h
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This header defines a correlator for the trigger time stamps of several
+ * scopes capturing the same triggers in rapid block mode. After each run
+ * the time stamp counters of every segment of every device are added and
+ * the correlator matches them up, so the captures of one trigger event
+ * can be joined across scopes without looking at the sample data.
+ *
+ * Device 0 is the reference. The time stamp counters restart with every
+ * run, so each device has a clock offset per run, found by trying the
+ * first few segments of the device against the first few of the
+ * reference and keeping the pairing that lines up the most triggers. The
+ * drift of each device clock against the reference is fitted by least
+ * squares over the matched triggers of all runs so far, so it improves
+ * run by run and no run has to be kept.
+ *
+ * Every trigger seen by any device becomes one correlated event with a
+ * global index that carries on from run to run, and the segment each
+ * device captured it in (-1 if the device missed it).
+ *
+ ****************************************************************************/
+#ifndef __PICOTRIGGERCORRELATOR_H__
+#define __PICOTRIGGERCORRELATOR_H__
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* PicoStatus.h of the driver being built, from its include directory (AM_CPPFLAGS on Linux) */
+#ifndef PICO_OK
+#include "PicoStatus.h"
+#endif
+
+#define TRIGGER_CORRELATOR_MAX_DEVICES	8
+#define TRIGGER_CORRELATOR_ANCHORS		4	// Leading segments of each device tried as the first common trigger
+#define TRIGGER_CORRELATOR_MIN_PAIRS	3	// Matched triggers needed before the drift is fitted
+
+typedef struct tCorrelatorDevice
+{
+	double		timeIntervalNs;		// Time of one time stamp counter tick
+	uint32_t	nSegments;			// Segments added for this run
+	uint32_t	capacity;
+	double*		localNs;			// Time of each segment from the first, NAN if the segment has no valid time stamp
+	// Clock model, reference time = offsetNs + rate * local time
+	double		rate;				// Fitted over all runs
+	double		offsetNs;			// For the last run
+	int16_t		aligned;			// The last run could be lined up with the reference
+	uint64_t	pairs;				// Triggers matched with the reference over all runs
+	double		sxx;				// Sums over the matched triggers, each run about its own means
+	double		sxy;
+	double		residualRmsNs;		// Of the matched triggers of the last run
+	uint64_t	missed;				// Events this device did not capture
+}CORRELATOR_DEVICE;
+
+typedef struct tCorrelatedEvent
+{
+	uint64_t	globalIndex;
+	uint32_t	run;
+	double		timeNs;				// Reference time from the first reference segment of the run
+	int32_t		segment[TRIGGER_CORRELATOR_MAX_DEVICES];	// -1 if the device missed the trigger
+}CORRELATED_EVENT;
+
+typedef struct tTriggerCorrelator
+{
+	int16_t				nDevices;
+	double				toleranceNs;	// Furthest apart two time stamps of one trigger can be
+	CORRELATOR_DEVICE	devices[TRIGGER_CORRELATOR_MAX_DEVICES];
+	uint32_t			run;
+	uint64_t			nextIndex;
+	CORRELATED_EVENT*	events;			// Events of the last run
+	uint32_t			nEvents;
+	uint32_t			eventCapacity;
+}TRIGGER_CORRELATOR;
+
+// Function prototypes
+PICO_STATUS trigger_correlator_init(TRIGGER_CORRELATOR* correlator, int16_t nDevices, double toleranceNs);
+void trigger_correlator_free(TRIGGER_CORRELATOR* correlator);
+
+PICO_STATUS trigger_correlator_add(TRIGGER_CORRELATOR* correlator, int16_t device, double timeIntervalNs,
+	const uint64_t* timeStampCounters, const PICO_STATUS* statuses, uint32_t nSegments);
+PICO_STATUS trigger_correlator_correlate(TRIGGER_CORRELATOR* correlator, const CORRELATED_EVENT** events, uint32_t* nEvents);
+
+void trigger_correlator_print(FILE* fp, const TRIGGER_CORRELATOR* correlator);
+
+#endif
@@ -0,0 +1,183 @@
+/****************************************************************************
+ *
+ * Filename:    PicoTriggerHistory.c
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This file defines a host-side pre-trigger history for triggered
+ * streaming (see PicoTriggerHistory.h).
+ *
+ ****************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include "./PicoTriggerHistory.h"
+
+/****************************************************************************
+* trigger_history_init
+*
+* Inputs:
+* - nChannels: number of enabled channels
+* - sampleBytes: 1 or 2 (see pico_sample_size)
+* - bufferSize: samples per buffer passed to the driver
+* - historySamples: pre-trigger samples to keep
+* - postSamples: samples to keep from the trigger on
+****************************************************************************/
+PICO_STATUS trigger_history_init(TRIGGER_HISTORY* history, int16_t nChannels, uint32_t sampleBytes, uint64_t bufferSize,
+	uint64_t historySamples, uint64_t postSamples)
+{
+	int16_t ch;
+
+	memset(history, 0, sizeof(TRIGGER_HISTORY));
+
+	if (nChannels <= 0 || nChannels > TRIGGER_HISTORY_MAX_CHANNELS || (sampleBytes != 1 && sampleBytes != 2) || bufferSize == 0)
+		return PICO_INVALID_PARAMETER;
+
+	history->nChannels = nChannels;
+	history->sampleBytes = sampleBytes;
+	history->bufferSize = bufferSize;
+	history->historySamples = historySamples;
+	history->postSamples = postSamples;
+
+	// The trigger can be anywhere in its buffer, so keep one extra slot
+	history->nSlots = (historySamples + bufferSize - 1) / bufferSize + 1;
+	history->nPostBuffers = (postSamples + bufferSize - 1) / bufferSize;
+
+	for (ch = 0; ch < nChannels; ch++)
+	{
+		history->records[ch] = (uint8_t*)malloc((size_t)((history->nSlots + history->nPostBuffers) * bufferSize * sampleBytes));
+
+		if (history->records[ch] == NULL)
+		{
+			trigger_history_free(history);
+			return PICO_MEMORY;
+		}
+	}
+	return PICO_OK;
+}
+
+/****************************************************************************
+* trigger_history_free
+****************************************************************************/
+void trigger_history_free(TRIGGER_HISTORY* history)
+{
+	int16_t ch;
+
+	for (ch = 0; ch < TRIGGER_HISTORY_MAX_CHANNELS; ch++)
+	{
+		free(history->records[ch]);
+		history->records[ch] = NULL;
+	}
+}
+
+/****************************************************************************
+* trigger_history_buffer
+*
+* Returns the buffer to pass to the driver next for one channel
+****************************************************************************/
+void* trigger_history_buffer(TRIGGER_HISTORY* history, int16_t channel)
+{
+	uint64_t buffer = history->triggered ? history->nSlots + history->postBuffer : history->slot;
+
+	return history->records[channel] + buffer * history->bufferSize * history->sampleBytes;
+}
+
+/****************************************************************************
+* trigger_history_buffer_full
+*
+* Called when the driver has filled the buffers from trigger_history_buffer
+* Inputs:
+* - triggered: the trigger occurred in this buffer
+* - triggerAt: index of the trigger in this buffer
+* Returns:
+* - 1 when the record is complete, 0 if more buffers are needed
+****************************************************************************/
+int16_t trigger_history_buffer_full(TRIGGER_HISTORY* history, int16_t triggered, uint64_t triggerAt)
+{
+	uint64_t ringSamples = history->nSlots * history->bufferSize;
+
+	if (history->triggered)
+	{
+		history->postBuffer++;
+	}
+	else if (triggered)
+	{
+		// In time order the trigger slot is the last of the ring, so the
+		// post-trigger buffers continue straight on from it
+		history->triggered = 1;
+		history->triggerSlot = history->slot;
+		history->triggerIndex = ringSamples - history->bufferSize + triggerAt;
+	}
+	else
+	{
+		history->slot = (history->slot + 1) % history->nSlots;
+
+		if (history->slotsFilled < history->nSlots - 1)
+			history->slotsFilled++;
+	}
+
+	return history->triggered
+		&& ringSamples + history->postBuffer * history->bufferSize >= history->triggerIndex + history->postSamples;
+}
+
+/****************************************************************************
+* trigger_history_record
+*
+* Finds the pre- and post-trigger samples kept, the same for every
+* channel. Read them with trigger_history_value.
+* Outputs:
+* - triggerIndex: trigger position in the record
+* Returns:
+* - number of samples in the record, 0 if there was no trigger
+****************************************************************************/
+uint64_t trigger_history_record(TRIGGER_HISTORY* history, uint64_t* triggerIndex)
+{
+	uint64_t first;
+	uint64_t end;
+
+	*triggerIndex = 0;
+
+	if (!history->triggered)
+		return 0;
+
+	// Slots not written before the trigger are skipped
+	first = (history->nSlots - 1 - history->slotsFilled) * history->bufferSize;
+
+	if (history->triggerIndex > history->historySamples && history->triggerIndex - history->historySamples > first)
+		first = history->triggerIndex - history->historySamples;
+
+	end = (history->nSlots + history->postBuffer) * history->bufferSize;
+
+	if (end > history->triggerIndex + history->postSamples)
+		end = history->triggerIndex + history->postSamples;
+
+	history->recordStart = first;
+	*triggerIndex = history->triggerIndex - first;
+	return end - first;
+}
+
+/****************************************************************************
+* trigger_history_value
+*
+* Returns a sample of the record found by trigger_history_record. 8-bit
+* samples are scaled by 256 like 16-bit data, as pico_buffer_value does.
+* Inputs:
+* - index: position in the record
+****************************************************************************/
+int16_t trigger_history_value(TRIGGER_HISTORY* history, int16_t channel, uint64_t index)
+{
+	uint64_t position = history->recordStart + index;
+	uint64_t ringSamples = history->nSlots * history->bufferSize;
+	uint64_t slot;
+
+	// Ring positions start from the slot after the trigger slot, the post-trigger buffers follow the ring
+	if (position < ringSamples)
+	{
+		slot = (history->triggerSlot + 1 + position / history->bufferSize) % history->nSlots;
+		position = slot * history->bufferSize + position % history->bufferSize;
+	}
+
+	if (history->sampleBytes == 1)
+		return (int16_t)(((int8_t*)history->records[channel])[position] * 256);
+
+	return ((int16_t*)history->records[channel])[position];
+}
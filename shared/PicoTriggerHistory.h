@@ -0,0 +1,60 @@
+/****************************************************************************
+ *
+ * Filename:    PicoTriggerHistory.h
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This header defines a host-side pre-trigger history for triggered
+ * streaming. Each channel has one record of (nSlots + nPostBuffers)
+ * driver buffers. Before the trigger the driver writes into the first
+ * nSlots buffers in turn, so they hold the most recent history. When
+ * the buffer holding the trigger is complete the post-trigger buffers
+ * that follow the ring are passed to the driver. Nothing is moved while
+ * streaming: the ring is read in time order from the slot after the
+ * trigger slot once the record is complete.
+ *
+ ****************************************************************************/
+#ifndef __PICOTRIGGERHISTORY_H__
+#define __PICOTRIGGERHISTORY_H__
+
+#include <stdint.h>
+
+/* PicoStatus.h of the driver being built, from its include directory (AM_CPPFLAGS on Linux) */
+#ifndef PICO_OK
+#include "PicoStatus.h"
+#endif
+
+#define TRIGGER_HISTORY_MAX_CHANNELS	8
+
+typedef struct tTriggerHistory
+{
+	int16_t		nChannels;
+	uint32_t	sampleBytes;		// 1 for PICO_INT8_T, 2 for PICO_INT16_T
+	uint64_t	bufferSize;			// Samples per driver buffer
+	uint64_t	historySamples;		// Pre-trigger samples wanted
+	uint64_t	postSamples;		// Post-trigger samples wanted
+	uint64_t	nSlots;				// History ring length in buffers (including the trigger buffer)
+	uint64_t	nPostBuffers;
+	uint8_t*	records[TRIGGER_HISTORY_MAX_CHANNELS];
+	// State
+	uint64_t	slot;				// Ring slot the driver is writing, before the trigger
+	uint64_t	slotsFilled;		// Complete history slots, at most nSlots - 1 are kept
+	int16_t		triggered;
+	uint64_t	triggerSlot;		// Ring slot holding the trigger
+	uint64_t	triggerIndex;		// Trigger position with the ring in time order
+	uint64_t	postBuffer;			// Next post-trigger buffer
+	uint64_t	recordStart;		// First sample of the record with the ring in time order
+}TRIGGER_HISTORY;
+
+// Function prototypes
+PICO_STATUS trigger_history_init(TRIGGER_HISTORY* history, int16_t nChannels, uint32_t sampleBytes, uint64_t bufferSize,
+	uint64_t historySamples, uint64_t postSamples);
+void trigger_history_free(TRIGGER_HISTORY* history);
+
+void* trigger_history_buffer(TRIGGER_HISTORY* history, int16_t channel);
+int16_t trigger_history_buffer_full(TRIGGER_HISTORY* history, int16_t triggered, uint64_t triggerAt);
+
+uint64_t trigger_history_record(TRIGGER_HISTORY* history, uint64_t* triggerIndex);
+int16_t trigger_history_value(TRIGGER_HISTORY* history, int16_t channel, uint64_t index);
+
+#endif
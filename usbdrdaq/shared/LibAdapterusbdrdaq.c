@@ -0,0 +1,50 @@
+/****************************************************************************
+ *
+ * Filename:    LibAdapterusbdrdaq.c
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This file defines the logger scheduler adapter of the USB DrDAQ (see
+ * LibAdapterusbdrdaq.h).
+ *
+ ****************************************************************************/
+#include <math.h>
+#include "./LibAdapterusbdrdaq.h"
+
+/****************************************************************************
+* usbDrDaqAdapterPoll
+*
+* Reads one row of every channel, in mV if scaleToMv is set. A channel
+* that overflowed reads as NAN.
+****************************************************************************/
+int32_t usbDrDaqAdapterPoll(void* context, float* values, uint32_t maxRows)
+{
+	USB_DRDAQ_ADAPTER* adapter = (USB_DRDAQ_ADAPTER*) context;
+	float value;
+	uint16_t overflow;
+	int32_t c;
+
+	(void) maxRows;	// One row a poll
+
+	for (c = 1; c <= USB_DRDAQ_MAX_CHANNELS; c++)
+	{
+		value = 0;
+		adapter->status = UsbDrDaqGetSingleF(adapter->handle, (USB_DRDAQ_INPUTS) c, &value, &overflow);
+
+		if (adapter->status != PICO_OK)
+		{
+			return -1;
+		}
+
+		if (overflow)
+		{
+			values[c - 1] = NAN;
+		}
+		else
+		{
+			values[c - 1] = adapter->scaleToMv ? (value / adapter->maxAdc) * 2500 : value;
+		}
+	}
+
+	return 1;
+}
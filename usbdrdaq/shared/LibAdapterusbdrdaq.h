@@ -0,0 +1,42 @@
+/****************************************************************************
+ *
+ * Filename:    LibAdapterusbdrdaq.h
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This header defines the logger scheduler adapter (see
+ * PicoLoggerScheduler.h) of the USB DrDAQ. Each poll takes an individual
+ * reading of every channel.
+ *
+ * The names are prefixed with the family, so one program can register
+ * adapters of several logger families with the same scheduler.
+ *
+ ****************************************************************************/
+#ifndef __LIBADAPTERUSBDRDAQ_H__
+#define __LIBADAPTERUSBDRDAQ_H__
+
+#include <stdint.h>
+
+#ifdef WIN32
+#include <windows.h>
+#include "usbDrDaqApi.h"
+#else
+#include <libusbdrdaq/usbDrDaqApi.h>
+#ifndef PICO_STATUS
+#include <libusbdrdaq/PicoStatus.h>
+#endif
+#endif
+
+/* A unit hosted by the logger scheduler */
+typedef struct tUsbDrDaqAdapter
+{
+	int16_t		handle;
+	int16_t		scaleToMv;
+	uint16_t	maxAdc;
+	PICO_STATUS	status;			// Status of the last driver call
+}USB_DRDAQ_ADAPTER;
+
+// Function prototypes
+int32_t usbDrDaqAdapterPoll(void* context, float* values, uint32_t maxRows);
+
+#endif
@@ -11,7 +11,9 @@
  *    Collect a block of samples when a trigger event occurs
  *    Use windowing to collect a sequence of overlapped blocks
  *    Write a continuous stream of data to a file
+ *    Count pulses and sample digital inputs in the background while streaming
  *    Take individual readings
+ *    Log through the multi-rate logger scheduler
  *		 Set the signal generator
  *		 Set digital outputs
  *		 Get states of digital inputs
@@ -51,6 +53,7 @@
  ******************************************************************************/
 
 #include <stdio.h>
+#include <math.h>
 
 // Define bool type
 typedef enum enBOOL
@@ -62,6 +65,8 @@ typedef enum enBOOL
 /* Headers for Windows */
 #include "windows.h"
 #include <conio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "usbDrDaqApi.h"
 
@@ -76,6 +81,7 @@ typedef enum enBOOL
 #include <sys/types.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <pthread.h>
 
 #include <libusbdrdaq/usbDrDaqApi.h>
 #ifndef PICO_STATUS
@@ -143,6 +149,75 @@ return (fp>0)?0:-1;
 #define TRUE		1
 #define FALSE		0
 
+#include "../../shared/PicoLoggerRing.h"
+#include "../../shared/PicoLoggerScheduler.h"
+#include "../shared/LibAdapterusbdrdaq.h"
+
+#define SCHED_INTERVAL_MS	100		// Time between readings of all channels when hosted by the logger scheduler
+
+#define COUNTER_PERIOD_MS	10		// Time between reads of the pulse counters and digital inputs
+#define COUNTER_RATE_MS		1000	// Time over which the pulse rates are worked out
+#define COUNTER_RING_EVENTS	4096	// Events kept until the main thread reads them, a power of 2
+#define COUNTER_PULSE_GPIOS	2		// GPIO 1 and 2 count pulses
+#define COUNTER_INPUT_GPIOS	2		// GPIO 3 and 4 are sampled as digital inputs
+
+typedef enum enCounterEventType
+{
+	COUNTER_EVENT_PULSES,			// Pulses counted in one period
+	COUNTER_EVENT_RISING,			// A digital input went high
+	COUNTER_EVENT_FALLING			// A digital input went low
+}COUNTER_EVENT_TYPE;
+
+/* One event in the counter engine ring, 8 bytes */
+typedef struct tCounterEvent
+{
+	uint32_t	timeMs;				// Time of the read that saw the event, from when the engine started
+	uint8_t		type;				// COUNTER_EVENT_TYPE
+	uint8_t		gpio;				// USB_DRDAQ_GPIO
+	uint16_t	count;				// Pulses, for COUNTER_EVENT_PULSES
+}COUNTER_EVENT;
+
+/* Background engine reading the pulse counters and digital inputs */
+typedef struct tCounterEngine
+{
+	int64_t				startMs;
+	int16_t				lastCount[COUNTER_PULSE_GPIOS];
+	int16_t				lastInputs;						// Bit per input GPIO
+	uint64_t			totals[COUNTER_PULSE_GPIOS];
+	uint64_t			rateTotals[COUNTER_PULSE_GPIOS];	// Totals at the start of the rate period
+	int64_t				rateStartMs;
+	double				rateHz[COUNTER_PULSE_GPIOS];
+	COUNTER_EVENT		events[COUNTER_RING_EVENTS];
+	uint32_t			head;							// Next event to write
+	uint32_t			tail;							// Next event to read
+	uint64_t			dropped;						// Events lost because the ring was full
+	uint64_t			reads;
+	uint64_t			lateReads;						// Reads that missed their time
+	PICO_STATUS			status;
+	volatile int16_t	stop;
+#ifdef WIN32
+	CRITICAL_SECTION	lock;							// Guards the event ring and the counts
+	CRITICAL_SECTION	driverLock;						// Guards the UsbDrDaq calls made while the thread runs
+	HANDLE				thread;
+#else
+	pthread_mutex_t		lock;							// Guards the event ring and the counts
+	pthread_mutex_t		driverLock;						// Guards the UsbDrDaq calls made while the thread runs
+	pthread_t			thread;
+#endif
+}COUNTER_ENGINE;
+
+#ifdef WIN32
+#define counterLock(e)		EnterCriticalSection(&(e)->lock)
+#define counterUnlock(e)	LeaveCriticalSection(&(e)->lock)
+#define driverLock(e)		EnterCriticalSection(&(e)->driverLock)
+#define driverUnlock(e)		LeaveCriticalSection(&(e)->driverLock)
+#else
+#define counterLock(e)		pthread_mutex_lock(&(e)->lock)
+#define counterUnlock(e)	pthread_mutex_unlock(&(e)->lock)
+#define driverLock(e)		pthread_mutex_lock(&(e)->driverLock)
+#define driverUnlock(e)		pthread_mutex_unlock(&(e)->driverLock)
+#endif
+
 int32_t				scale_to_mv;
 uint16_t			max_adc_value;
 int16_t				g_handle;
@@ -495,12 +570,273 @@ void collect_windowed_blocks (void)
 	_getch();
 }
 
+/****************************************************************************
+*
+* counter_put
+*  Adds an event to the counter engine ring. Called with the lock held.
+*
+****************************************************************************/
+void counter_put (COUNTER_ENGINE * engine, uint32_t timeMs, COUNTER_EVENT_TYPE type, USB_DRDAQ_GPIO gpio, uint16_t count)
+{
+	COUNTER_EVENT * event;
+
+	if (engine->head - engine->tail >= COUNTER_RING_EVENTS)
+	{
+		engine->dropped++;
+		return;
+	}
+
+	event = &engine->events[engine->head & (COUNTER_RING_EVENTS - 1)];
+	event->timeMs = timeMs;
+	event->type = (uint8_t) type;
+	event->gpio = (uint8_t) gpio;
+	event->count = count;
+	engine->head++;
+}
+
+/****************************************************************************
+*
+* counter_thread
+*  Reads the pulse counters and digital inputs every COUNTER_PERIOD_MS.
+*  Each read is timed from the start rather than from the last read, so
+*  the reads do not drift however long each one takes.
+*
+****************************************************************************/
+#ifdef WIN32
+DWORD WINAPI counter_thread (LPVOID parameter)
+#else
+void * counter_thread (void * parameter)
+#endif
+{
+	COUNTER_ENGINE *	engine = (COUNTER_ENGINE *) parameter;
+	int64_t				nextRead = engine->startMs;
+	int64_t				nowMs;
+	int64_t				delay;
+	int16_t				count[COUNTER_PULSE_GPIOS];
+	int16_t				inputs;
+	int16_t				value;
+	uint16_t			pulses;
+	int32_t				i;
+
+	while (!engine->stop)
+	{
+		// The driver is shared with the main thread, so the calls are made under the driver lock.
+		// They are made outside the event lock, so counter_read is not held up by the driver.
+		driverLock(engine);
+
+		for (i = 0; i < COUNTER_PULSE_GPIOS && engine->status == PICO_OK; i++)
+		{
+			engine->status = UsbDrDaqGetPulseCount(g_handle, (USB_DRDAQ_GPIO) (USB_DRDAQ_GPIO_1 + i), &count[i]);
+		}
+
+		for (i = 0, inputs = 0; i < COUNTER_INPUT_GPIOS && engine->status == PICO_OK; i++)
+		{
+			engine->status = UsbDrDaqGetInput(g_handle, (USB_DRDAQ_GPIO) (USB_DRDAQ_GPIO_3 + i), 0, &value);	// Not using pull-up resistor
+			inputs |= (value ? 1 : 0) << i;
+		}
+
+		driverUnlock(engine);
+
+		if (engine->status != PICO_OK)
+		{
+			break;
+		}
+
+		nowMs = logger_time_ms() - engine->startMs;
+		counterLock(engine);
+
+		// The counters run on from UsbDrDaqStartPulseCount, so the pulses in a period are the difference
+		for (i = 0; i < COUNTER_PULSE_GPIOS; i++)
+		{
+			pulses = (uint16_t) (count[i] - engine->lastCount[i]);
+			engine->lastCount[i] = count[i];
+
+			if (pulses)
+			{
+				engine->totals[i] += pulses;
+				counter_put(engine, (uint32_t) nowMs, COUNTER_EVENT_PULSES, (USB_DRDAQ_GPIO) (USB_DRDAQ_GPIO_1 + i), pulses);
+			}
+		}
+
+		for (i = 0; i < COUNTER_INPUT_GPIOS; i++)
+		{
+			if ((inputs ^ engine->lastInputs) & (1 << i))
+			{
+				counter_put(engine, (uint32_t) nowMs, (inputs & (1 << i)) ? COUNTER_EVENT_RISING : COUNTER_EVENT_FALLING,
+					(USB_DRDAQ_GPIO) (USB_DRDAQ_GPIO_3 + i), 0);
+			}
+		}
+
+		engine->lastInputs = inputs;
+
+		if (nowMs - engine->rateStartMs >= COUNTER_RATE_MS)
+		{
+			for (i = 0; i < COUNTER_PULSE_GPIOS; i++)
+			{
+				engine->rateHz[i] = (engine->totals[i] - engine->rateTotals[i]) * 1000.0 / (double) (nowMs - engine->rateStartMs);
+				engine->rateTotals[i] = engine->totals[i];
+			}
+
+			engine->rateStartMs = nowMs;
+		}
+
+		engine->reads++;
+		counterUnlock(engine);
+
+		// Sleep to the next period rather than for a fixed time
+		nextRead += COUNTER_PERIOD_MS;
+		delay = nextRead - logger_time_ms();
+
+		if (delay > 0)
+		{
+			Sleep((uint32_t) delay);
+		}
+		else
+		{
+			engine->lateReads++;
+			nextRead = logger_time_ms();
+		}
+	}
+
+	return 0;
+}
+
+/****************************************************************************
+*
+* counter_start
+*  Starts counting rising edges on GPIO 1 and 2 and the thread reading
+*  them and the inputs on GPIO 3 and 4
+*
+****************************************************************************/
+int16_t counter_start (COUNTER_ENGINE * engine)
+{
+	int16_t	value;
+	int32_t	i;
+
+	memset(engine, 0, sizeof(COUNTER_ENGINE));
+	engine->status = PICO_OK;
+
+	for (i = 0; i < COUNTER_PULSE_GPIOS && engine->status == PICO_OK; i++)
+	{
+		engine->status = UsbDrDaqStartPulseCount(g_handle, (USB_DRDAQ_GPIO) (USB_DRDAQ_GPIO_1 + i), 0);
+
+		if (engine->status == PICO_OK)
+		{
+			engine->status = UsbDrDaqGetPulseCount(g_handle, (USB_DRDAQ_GPIO) (USB_DRDAQ_GPIO_1 + i), &engine->lastCount[i]);
+		}
+	}
+
+	for (i = 0; i < COUNTER_INPUT_GPIOS && engine->status == PICO_OK; i++)
+	{
+		engine->status = UsbDrDaqGetInput(g_handle, (USB_DRDAQ_GPIO) (USB_DRDAQ_GPIO_3 + i), 0, &value);
+		engine->lastInputs |= (value ? 1 : 0) << i;
+	}
+
+	if (engine->status != PICO_OK)
+	{
+		printf("counter_start: Status = 0x%X\n", engine->status);
+		return FALSE;
+	}
+
+	engine->startMs = logger_time_ms();
+
+#ifdef WIN32
+	InitializeCriticalSection(&engine->lock);
+	InitializeCriticalSection(&engine->driverLock);
+	engine->thread = CreateThread(NULL, 0, counter_thread, engine, 0, NULL);
+
+	if (engine->thread == NULL)
+	{
+		DeleteCriticalSection(&engine->lock);
+		DeleteCriticalSection(&engine->driverLock);
+		return FALSE;
+	}
+#else
+	pthread_mutex_init(&engine->lock, NULL);
+	pthread_mutex_init(&engine->driverLock, NULL);
+
+	if (pthread_create(&engine->thread, NULL, counter_thread, engine) != 0)
+	{
+		pthread_mutex_destroy(&engine->lock);
+		pthread_mutex_destroy(&engine->driverLock);
+		return FALSE;
+	}
+#endif
+
+	return TRUE;
+}
+
+/****************************************************************************
+*
+* counter_stop
+*  Stops the thread. The events left in the ring can still be read.
+*
+****************************************************************************/
+void counter_stop (COUNTER_ENGINE * engine)
+{
+	engine->stop = TRUE;
+
+#ifdef WIN32
+	WaitForSingleObject(engine->thread, INFINITE);
+	CloseHandle(engine->thread);
+#else
+	pthread_join(engine->thread, NULL);
+#endif
+
+	// Reset digital output status
+	d1State = d2State = d3State = d4State = 0;
+}
+
+/****************************************************************************
+*
+* counter_free
+*  Releases the locks once the last events have been read
+*
+****************************************************************************/
+void counter_free (COUNTER_ENGINE * engine)
+{
+#ifdef WIN32
+	DeleteCriticalSection(&engine->lock);
+	DeleteCriticalSection(&engine->driverLock);
+#else
+	pthread_mutex_destroy(&engine->lock);
+	pthread_mutex_destroy(&engine->driverLock);
+#endif
+}
+
+/****************************************************************************
+*
+* counter_read
+*  Takes the oldest event out of the ring, returns FALSE if there is none
+*
+****************************************************************************/
+int16_t counter_read (COUNTER_ENGINE * engine, COUNTER_EVENT * event)
+{
+	int16_t found = FALSE;
+
+	counterLock(engine);
+
+	if (engine->tail != engine->head)
+	{
+		*event = engine->events[engine->tail & (COUNTER_RING_EVENTS - 1)];
+		engine->tail++;
+		found = TRUE;
+	}
+
+	counterUnlock(engine);
+	return found;
+}
+
 /****************************************************************************
 *
 * collect_streaming
 * 
 * This function demonstrates how to use streaming.
 *
+* The pulse counters and digital inputs can be read at the same time by
+* the counter engine, which runs in its own thread so neither waits for
+* the other. Its events are written to usb_dr_daq_counters.txt.
+*
 ****************************************************************************/
 
 void collect_streaming (void)
@@ -518,9 +854,33 @@ void collect_streaming (void)
 	uint32_t	triggerIndex = 0;
 	int16_t		nLines = 0;
 	FILE *		fp;
+	FILE *		fpCounters = NULL;
+	COUNTER_ENGINE *	engine = NULL;
+	COUNTER_EVENT		event;
+	static const char *	eventNames[] = {"pulses", "rising", "falling"};
 
 	printf ("Collect streaming (channel %d)...\n", channel);
 	printf ("Data is written to disk file (usb_dr_daq_streaming.txt)\n");
+	printf ("Count pulses on GPIO 1 and 2 and sample GPIO 3 and 4 at the same time (Y/N)?\n");
+
+	if (toupper(_getch()) == 'Y')
+	{
+		engine = (COUNTER_ENGINE *) calloc(1, sizeof(COUNTER_ENGINE));
+		fopen_s(&fpCounters, "usb_dr_daq_counters.txt", "w");
+
+		if (engine == NULL || fpCounters == NULL)
+		{
+			printf ("Unable to set up the counter engine\n");
+			free(engine);
+			engine = NULL;
+		}
+		else
+		{
+			printf ("Counter events are written to disk file (usb_dr_daq_counters.txt)\n");
+			fprintf(fpCounters, "Time (ms)\tGPIO\tEvent\tCount\n");
+		}
+	}
+
 	printf ("Press a key to start\n");
 	_getch();
 
@@ -544,12 +904,45 @@ void collect_streaming (void)
 	printf("\nPress any key to stop\n\n");
 	fopen_s(&fp, "usb_dr_daq_streaming.txt", "w");
 
+	if (engine != NULL && !counter_start(engine))
+	{
+		free(engine);
+		engine = NULL;
+	}
+
 	while (!_kbhit())
 	{
 		nSamplesCollected = nSamplesPerChannel;
-		status = UsbDrDaqGetValuesF(g_handle, samples, &nSamplesCollected, &overflow, &triggerIndex);
 
-		printf("%d values per channel\n", nSamplesCollected);
+		if (engine != NULL)
+		{
+			driverLock(engine);
+			status = UsbDrDaqGetValuesF(g_handle, samples, &nSamplesCollected, &overflow, &triggerIndex);
+			driverUnlock(engine);
+		}
+		else
+		{
+			status = UsbDrDaqGetValuesF(g_handle, samples, &nSamplesCollected, &overflow, &triggerIndex);
+		}
+
+		if (engine != NULL)
+		{
+			while (counter_read(engine, &event))
+			{
+				fprintf(fpCounters, "%u\t%d\t%s\t%u\n", event.timeMs, event.gpio, eventNames[event.type], event.count);
+			}
+
+			counterLock(engine);
+			printf("%d values per channel, GPIO 1: %.1f Hz (%llu), GPIO 2: %.1f Hz (%llu), GPIO 3 and 4: %d%d\n",
+				nSamplesCollected, engine->rateHz[0], (unsigned long long) engine->totals[0],
+				engine->rateHz[1], (unsigned long long) engine->totals[1],
+				engine->lastInputs & 1, (engine->lastInputs >> 1) & 1);
+			counterUnlock(engine);
+		}
+		else
+		{
+			printf("%d values per channel\n", nSamplesCollected);
+		}
 
 		if (nLines == 20)
 		{
@@ -576,7 +969,40 @@ void collect_streaming (void)
 	}
 	
 	fclose(fp);
-	status = UsbDrDaqStop(g_handle);
+
+	if (engine != NULL)
+	{
+		driverLock(engine);
+		status = UsbDrDaqStop(g_handle);
+		driverUnlock(engine);
+
+		counter_stop(engine);
+
+		while (counter_read(engine, &event))
+		{
+			fprintf(fpCounters, "%u\t%d\t%s\t%u\n", event.timeMs, event.gpio, eventNames[event.type], event.count);
+		}
+
+		if (engine->status != PICO_OK)
+		{
+			printf("\nCounter engine stopped: Status = 0x%X\n", engine->status);
+		}
+
+		printf("\nPulses: GPIO 1 %llu, GPIO 2 %llu. %llu reads, %llu late, %llu events dropped\n",
+			(unsigned long long) engine->totals[0], (unsigned long long) engine->totals[1],
+			(unsigned long long) engine->reads, (unsigned long long) engine->lateReads, (unsigned long long) engine->dropped);
+		counter_free(engine);
+		free(engine);
+	}
+	else
+	{
+		status = UsbDrDaqStop(g_handle);
+	}
+
+	if (fpCounters != NULL)
+	{
+		fclose(fpCounters);
+	}
 
 	_getch();
 }
@@ -628,6 +1054,78 @@ void collect_individual (void)
 	_getch ();
 }
 
+/****************************************************************************
+*
+* scheduled_logging
+*  Logs every channel through the logger scheduler, which can host units
+*  of the other logger families alongside it in the same loop. Rows are
+*  written to drdaq_scheduled.csv.
+*
+****************************************************************************/
+void scheduled_logging (void)
+{
+	LOGGER_SCHEDULER *	sched;
+	LOGGER_ADAPTER		adapter;
+	USB_DRDAQ_ADAPTER	context;
+	FILE *				fp = NULL;
+	int32_t				c;
+
+	printf ("Scheduled logging...\n");
+	printf ("Data is written to disk file (drdaq_scheduled.csv)\n");
+	printf ("Press a key to start\n");
+	_getch();
+
+	memset(&context, 0, sizeof(USB_DRDAQ_ADAPTER));
+	context.handle = g_handle;
+	context.scaleToMv = (int16_t) scale_to_mv;
+	context.maxAdc = max_adc_value;
+
+	memset(&adapter, 0, sizeof(LOGGER_ADAPTER));
+	strcpy(adapter.name, "DrDAQ");
+	adapter.context = &context;
+	adapter.nColumns = USB_DRDAQ_MAX_CHANNELS;
+	adapter.periodMs = SCHED_INTERVAL_MS;
+	adapter.poll = usbDrDaqAdapterPoll;
+
+	sched = (LOGGER_SCHEDULER *) calloc(1, sizeof(LOGGER_SCHEDULER));
+	fopen_s(&fp, "drdaq_scheduled.csv", "w");
+
+	if (sched == NULL || fp == NULL)
+	{
+		printf ("Unable to set up scheduled logging\n");
+	}
+	else
+	{
+		fprintf(fp, "Time (s), Unit");
+
+		for (c = 1; c <= USB_DRDAQ_MAX_CHANNELS; c++)
+		{
+			fprintf(fp, ", ch%d", c);
+		}
+
+		fprintf(fp, "\n");
+
+		logger_sched_init(sched, logger_sched_csv_sink, fp);
+		logger_sched_add(sched, &adapter);
+		logger_sched_start(sched);
+
+		printf ("Reading every %d ms. Press any key to stop\n", SCHED_INTERVAL_MS);
+		logger_sched_run(sched, _kbhit);
+		_getch();
+		logger_sched_stop(sched);
+		printf ("\n");
+		logger_sched_print_stats(sched);
+		logger_sched_free(sched);
+	}
+
+	if (fp != NULL)
+	{
+		fclose(fp);
+	}
+
+	free(sched);
+}
+
 /****************************************************************************
 *
 * Set/clear digital outputs
@@ -1095,7 +1593,7 @@ void main (void)
 			printf ("S - Streaming\t\t\tE - Pulse counting\n");
 			printf ("C - Select channel\t\tF - Set signal generator\n");
 			printf ("G - Channel scaling\t\tH - Set RGB LED\n");
-			printf ("A - Select mV or ADC counts\n");
+			printf ("A - Select mV or ADC counts\tL - Scheduled logging\n");
 			printf ("I - Individual reading\t\tX - Exit\n");
 			ch = toupper (_getch());
 			printf ("\n");
@@ -1127,6 +1625,10 @@ void main (void)
 				collect_individual ();
 				break;
 
+			case 'L':
+				scheduled_logging ();
+				break;
+
 			case 'D':
 				DigitalInput();
 				break;
@@ -0,0 +1,68 @@
+/****************************************************************************
+ *
+ * Filename:    LibAdapterusbpt104.c
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This file defines the logger scheduler adapter of the USB PT-104 (see
+ * LibAdapterusbpt104.h).
+ *
+ ****************************************************************************/
+#include <math.h>
+#include "./LibAdapterusbpt104.h"
+
+/****************************************************************************
+* pt104AdapterStart
+*
+* Sets the channels of the unit
+****************************************************************************/
+int16_t pt104AdapterStart(void* context)
+{
+	PT104_ADAPTER* adapter = (PT104_ADAPTER*) context;
+	int16_t channel;
+
+	adapter->status = PICO_OK;
+
+	for (channel = 0; channel < PT104_ADAPTER_CHANNELS && adapter->status == PICO_OK; channel++)
+	{
+		adapter->status = UsbPt104SetChannel(adapter->handle, (USBPT104_CHANNELS) (channel + 1),
+			adapter->measurementType[channel], adapter->noWires[channel]);
+	}
+
+	return adapter->status == PICO_OK;
+}
+
+/****************************************************************************
+* pt104AdapterPoll
+*
+* Reads the latest conversion of each enabled channel. A channel with no
+* conversion yet reads as NAN.
+****************************************************************************/
+int32_t pt104AdapterPoll(void* context, float* values, uint32_t maxRows)
+{
+	PT104_ADAPTER* adapter = (PT104_ADAPTER*) context;
+	int32_t value;
+	int16_t c;
+
+	(void) maxRows;	// One row a poll
+
+	for (c = 0; c < adapter->nChannels; c++)
+	{
+		adapter->status = UsbPt104GetValue(adapter->handle, (USBPT104_CHANNELS) adapter->channels[c], &value, 0);
+
+		if (adapter->status == PICO_OK || adapter->status == PICO_WARNING_REPEAT_VALUE)
+		{
+			values[c] = (float) (value * adapter->scale[c]);
+		}
+		else if (adapter->status == PICO_NO_SAMPLES_AVAILABLE)
+		{
+			values[c] = NAN;
+		}
+		else
+		{
+			return -1;
+		}
+	}
+
+	return 1;
+}
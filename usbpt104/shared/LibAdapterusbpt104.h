@@ -0,0 +1,45 @@
+/****************************************************************************
+ *
+ * Filename:    LibAdapterusbpt104.h
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This header defines the logger scheduler adapter (see
+ * PicoLoggerScheduler.h) of the USB PT-104. Each poll reads the latest
+ * conversion of each enabled channel, which does not block.
+ *
+ * The names are prefixed with the family, so one program can register
+ * adapters of several logger families with the same scheduler.
+ *
+ ****************************************************************************/
+#ifndef __LIBADAPTERUSBPT104_H__
+#define __LIBADAPTERUSBPT104_H__
+
+#include <stdint.h>
+
+#ifdef WIN32
+#include <windows.h>
+#include "usbPT104Api.h"
+#else
+#include "libusbpt104/UsbPT104Api.h"
+#endif
+
+#define PT104_ADAPTER_CHANNELS	4
+
+/* A unit hosted by the logger scheduler */
+typedef struct tPt104Adapter
+{
+	int16_t					handle;
+	USBPT104_DATA_TYPES		measurementType[PT104_ADAPTER_CHANNELS];	// Set on every channel, from channel 1
+	int16_t					noWires[PT104_ADAPTER_CHANNELS];
+	int16_t					nChannels;
+	int16_t					channels[PT104_ADAPTER_CHANNELS];			// Enabled channels, from 1
+	double					scale[PT104_ADAPTER_CHANNELS];
+	PICO_STATUS				status;										// Status of the last driver call
+}PT104_ADAPTER;
+
+// Function prototypes
+int16_t pt104AdapterStart(void* context);
+int32_t pt104AdapterPoll(void* context, float* values, uint32_t maxRows);
+
+#endif
@@ -11,6 +11,9 @@
  *    How to set up the channels
  *    How to collect data via both USB and ethernet connections
  *    How to enable ethernet and set the unit's IP address and port
+ *    How to poll a fleet of ethernet units from one loop
+ *    How to emulate units for testing the fleet poller
+ *    How to log through the multi-rate logger scheduler
  *
  *	To build this application:-
  *
@@ -45,6 +48,9 @@
  ******************************************************************************/
 
 #include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
 #ifdef WIN32
 #include <conio.h>
 #include <windows.h>
@@ -119,7 +125,14 @@ return (fp>0)?0:-1;
 #define min(a,b) ((a) < (b) ? a : b)
 #endif
 
+#include "../../shared/PicoFleetPoller.h"
+#include "../../shared/PicoLoggerRing.h"
+#include "../../shared/PicoLoggerScheduler.h"
+#include "../../shared/PicoTimeSeries.h"
+#include "../shared/LibAdapterusbpt104.h"
+
 #define NUM_CHANNELS 4
+#define CONVERSION_MS 720	// Time for the unit to convert one channel
 
 typedef struct 
 {
@@ -215,41 +228,49 @@ int8_t* MeasurementTypeToString(USBPT104_DATA_TYPES measurementType)
 	}
 }
 
-// Convert values to degrees C, Ohms or millivolts
-double ApplyScaling(int32_t value, int16_t channel)
+// Degrees C, Ohms or millivolts per count, 0 if the channel is off
+double ScalingFactor(int16_t channel)
 {
 	switch(channelSettings[channel].measurementType)
 	{
-		case USBPT104_OFF:
-			return 0;
-
 		case USBPT104_PT100:
-			return value / 1000.0;
+			return 1 / 1000.0;
 
 		case USBPT104_PT1000:
-			return value / 1000.0;
+			return 1 / 1000.0;
 
 		case USBPT104_RESISTANCE_TO_375R:
-			return value / 1000000.0;
+			return 1 / 1000000.0;
 
 		case USBPT104_RESISTANCE_TO_10K:
-			return value / 1000.0;
+			return 1 / 1000.0;
 
 		case USBPT104_DIFFERENTIAL_TO_115MV:
-			return value / 1000000.0;
+			return 1 / 1000000.0;
 
 		case USBPT104_DIFFERENTIAL_TO_2500MV:
-			return value / 100000.0;
+			return 1 / 100000.0;
 
 		case USBPT104_SINGLE_ENDED_TO_115MV:
-			return value / 1000000.0;
+			return 1 / 1000000.0;
 
 		case USBPT104_SINGLE_ENDED_TO_2500MV:
-			return value / 100000.0;
+			return 1 / 100000.0;
 
 		default:
-			return -1;
+			return 0;
+	}
+}
+
+// Convert values to degrees C, Ohms or millivolts
+double ApplyScaling(int32_t value, int16_t channel)
+{
+	if (channelSettings[channel].measurementType > USBPT104_SINGLE_ENDED_TO_2500MV)
+	{
+		return -1;
 	}
+
+	return value * ScalingFactor(channel);
 }
 
 void CollectData()
@@ -330,6 +351,404 @@ void CollectData()
 	_getch();
 }
 
+// Logs the unit through the logger scheduler, which can host units of the
+// other logger families alongside it in the same loop
+void ScheduledLogging()
+{
+	LOGGER_SCHEDULER * sched;
+	LOGGER_ADAPTER adapter;
+	PT104_ADAPTER context;
+	FILE * fp = NULL;
+	int16_t channel;
+
+	memset(&context, 0, sizeof(PT104_ADAPTER));
+	context.handle = g_handle;
+
+	for(channel = 0; channel < NUM_CHANNELS; channel++)
+	{
+		context.measurementType[channel] = channelSettings[channel].measurementType;
+		context.noWires[channel] = channelSettings[channel].noWires;
+
+		if(channelSettings[channel].measurementType != USBPT104_OFF)
+		{
+			context.channels[context.nChannels] = channel + 1;
+			context.scale[context.nChannels] = ScalingFactor(channel);
+			context.nChannels++;
+		}
+	}
+
+	if(context.nChannels == 0)
+	{
+		printf("\nNo channels are enabled.\n");
+		return;
+	}
+
+	memset(&adapter, 0, sizeof(LOGGER_ADAPTER));
+	strcpy(adapter.name, "PT-104");
+	adapter.context = &context;
+	adapter.nColumns = context.nChannels;
+	adapter.periodMs = CONVERSION_MS * context.nChannels;	// Each channel is converted in turn
+	adapter.start = pt104AdapterStart;
+	adapter.poll = pt104AdapterPoll;
+
+	sched = (LOGGER_SCHEDULER *) calloc(1, sizeof(LOGGER_SCHEDULER));
+	fopen_s(&fp, "pt104_scheduled.csv", "w");
+
+	if(sched == NULL || fp == NULL)
+	{
+		printf("\nUnable to set up scheduled logging.\n");
+	}
+	else
+	{
+		fprintf(fp, "Time (s), Unit");
+
+		for(channel = 0; channel < context.nChannels; channel++)
+		{
+			fprintf(fp, ", Ch %d", context.channels[channel]);
+		}
+
+		fprintf(fp, "\n");
+
+		logger_sched_init(sched, logger_sched_csv_sink, fp);
+		logger_sched_add(sched, &adapter);
+
+		if(!logger_sched_start(sched))
+		{
+			printf("\n\nSetChannel: Status = 0x%X\n", context.status);
+		}
+		else
+		{
+			printf("\nLogging every %u ms to pt104_scheduled.csv. Press any key to stop.\n", adapter.periodMs);
+			logger_sched_run(sched, _kbhit);
+			_getch();
+			logger_sched_stop(sched);
+			printf("\n");
+			logger_sched_print_stats(sched);
+		}
+
+		logger_sched_free(sched);
+	}
+
+	if(fp != NULL)
+	{
+		fclose(fp);
+	}
+
+	free(sched);
+}
+
+// Reads the latest value of a channel for the fleet poller
+PICO_STATUS FleetRead(int16_t handle, int16_t channel, int32_t * value)
+{
+	return UsbPt104GetValue(handle, (USBPT104_CHANNELS) channel, value, 0);
+}
+
+// Polls every unit listed in pt104_fleet.txt, or units emulated by a responder,
+// from one loop and logs the readings to pt104_fleet.csv
+void FleetPolling()
+{
+	FLEET * fleet;
+	FILE * fp = NULL;
+	int8_t line[40];
+	int8_t IPAddress[20];
+	int16_t channels[NUM_CHANNELS];
+	double scale[NUM_CHANNELS];
+	int16_t nChannels = 0;
+	int16_t channel;
+	int16_t handle;
+	int16_t u;
+	int16_t c;
+	int32_t nEmulated = 0;
+	int64_t reportMs;
+	int64_t latencySumMs;
+	uint64_t reads;
+	uint64_t lastReads = 0;
+	int32_t nPoints;
+	int64_t wallStartMs;
+	float * row = NULL;
+	int16_t storeOpen = FALSE;
+	TS_STORE store;
+	TS_POINT points[10];
+	uint64_t timeouts;
+	FLEET_UNIT * unit;
+
+	fleet = (FLEET *) calloc(1, sizeof(FLEET));
+
+	if (fleet == NULL)
+	{
+		return;
+	}
+
+	printf("\nChannels: ");
+
+	for (channel = 0; channel < NUM_CHANNELS; channel++)
+	{
+		printf("%s%s", channel ? ", " : "", MeasurementTypeToString(channelSettings[channel].measurementType));
+	}
+
+	printf("\nChange channel settings? (Y/N)\n");
+
+	if (toupper(_getch()) == 'Y')
+	{
+		ChannelSetUp();
+	}
+
+	// Every unit uses the same channels, and converts them in turn
+	for (channel = 0; channel < NUM_CHANNELS; channel++)
+	{
+		if (channelSettings[channel].measurementType != USBPT104_OFF)
+		{
+			channels[nChannels] = channel + 1;
+			scale[nChannels++] = ScalingFactor(channel);
+		}
+	}
+
+	if (nChannels == 0)
+	{
+		printf("No channels are enabled.\n");
+		free(fleet);
+		return;
+	}
+
+	fleet_init(fleet, FleetRead);
+
+	printf("\nEnter the number of emulated units (0 to open the units listed in pt104_fleet.txt): ");
+	scanf_s("%d", &nEmulated);
+
+	if (nEmulated > 0)
+	{
+		printf("Enter the IP address of the responder: ");
+		scanf("%19s", IPAddress);
+
+		for (u = 0; u < nEmulated && u < FLEET_MAX_UNITS; u++)
+		{
+			g_status = fleet_add_emulated_unit(fleet, (char *) IPAddress, FLEET_RESPONDER_PORT, u, nChannels, channels, scale, CONVERSION_MS * NUM_CHANNELS);
+
+			if (g_status != PICO_OK)
+			{
+				printf("Unable to reach the responder. Status code: 0x%X\n", g_status);
+				break;
+			}
+		}
+	}
+	else
+	{
+		// One IPAddress:port a line
+		fopen_s(&fp, "pt104_fleet.txt", "r");
+
+		if (fp == NULL)
+		{
+			printf("Unable to open pt104_fleet.txt\n");
+		}
+
+		while (fp != NULL && fleet->nUnits < FLEET_MAX_UNITS && fscanf(fp, "%39s", line) == 1)
+		{
+			printf("Opening %s... ", line);
+			handle = 0;
+			g_status = UsbPt104OpenUnitViaIp(&handle, NULL, line);
+
+			for (channel = 0; channel < NUM_CHANNELS && g_status == PICO_OK; channel++)
+			{
+				g_status = UsbPt104SetChannel(handle, (USBPT104_CHANNELS) (channel + 1), channelSettings[channel].measurementType, channelSettings[channel].noWires);
+			}
+
+			if (g_status == PICO_OK)
+			{
+				g_status = fleet_add_unit(fleet, (char *) line, handle, nChannels, channels, scale, CONVERSION_MS * NUM_CHANNELS);
+			}
+
+			if (g_status == PICO_OK)
+			{
+				printf("OK\n");
+			}
+			else
+			{
+				printf("Status code: 0x%X\n", g_status);
+
+				if (handle > 0)
+				{
+					UsbPt104CloseUnit(handle);
+				}
+			}
+		}
+
+		if (fp != NULL)
+		{
+			fclose(fp);
+		}
+	}
+
+	fp = NULL;
+
+	if (fleet->nUnits > 0)
+	{
+		fopen_s(&fp, "pt104_fleet.csv", "w");
+	}
+
+	if (fp != NULL)
+	{
+		fprintf(fp, "Time (s), Unit");
+
+		for (c = 0; c < nChannels; c++)
+		{
+			fprintf(fp, ", Ch %d", channels[c]);
+		}
+
+		fprintf(fp, "\n");
+
+		/* One column per channel of each unit, so a store is only reused with the same units */
+		row = (float *) malloc(fleet->nUnits * nChannels * sizeof(float));
+		storeOpen = (row != NULL && ts_store_open(&store, "pt104_fleet", fleet->nUnits * nChannels));
+		wallStartMs = (int64_t) time(NULL) * 1000;
+
+		if (!storeOpen)
+		{
+			printf("Cannot open the time-series store pt104_fleet, readings are only written to pt104_fleet.csv\n");
+		}
+		else if (store.lastMs >= wallStartMs)
+		{
+			wallStartMs = store.lastMs + 1;
+		}
+
+		printf("\nPolling %d unit(s), readings are written to pt104_fleet.csv. Press any key to stop.\n\n", fleet->nUnits);
+		reportMs = logger_time_ms() + 1000;
+
+		while (!_kbhit())
+		{
+			if (fleet_poll(fleet, 100) > 0)
+			{
+				for (u = 0; u < fleet->nUnits; u++)
+				{
+					unit = &fleet->units[u];
+
+					if (unit->updated && unit->freshMask)
+					{
+						fprintf(fp, "%.3f, %s", (logger_time_ms() - fleet->startMs) / 1000.0, unit->name);
+
+						for (c = 0; c < unit->nChannels; c++)
+						{
+							// Channels not converted since the last read are left empty
+							if (unit->freshMask & (1 << (unit->channels[c] - 1)))
+							{
+								fprintf(fp, ", %.4f", unit->values[c]);
+							}
+							else
+							{
+								fprintf(fp, ",");
+							}
+						}
+
+						fprintf(fp, "\n");
+					}
+				}
+
+				if (storeOpen)
+				{
+					/* Channels not converted since the last read are missing (NaN) in the store */
+					for (u = 0; u < fleet->nUnits; u++)
+					{
+						unit = &fleet->units[u];
+
+						for (c = 0; c < nChannels; c++)
+						{
+							row[u * nChannels + c] = (unit->updated && (unit->freshMask & (1 << (unit->channels[c] - 1)))) ? (float) unit->values[c] : NAN;
+						}
+					}
+
+					ts_store_append(&store, wallStartMs + logger_time_ms() - fleet->startMs, row);
+				}
+			}
+
+			if (logger_time_ms() >= reportMs)
+			{
+				for (u = 0, reads = 0; u < fleet->nUnits; u++)
+				{
+					reads += fleet->units[u].reads;
+				}
+
+				printf("\r%llu reads, %llu per second   ", (unsigned long long) reads, (unsigned long long) (reads - lastReads));
+				lastReads = reads;
+				reportMs += 1000;
+			}
+		}
+
+		_getch();
+		fclose(fp);
+
+		// Summary, with round-trip latency for emulated units
+		for (u = 0, reads = 0, timeouts = 0, latencySumMs = 0; u < fleet->nUnits; u++)
+		{
+			reads += fleet->units[u].reads;
+			timeouts += fleet->units[u].timeouts;
+			latencySumMs += fleet->units[u].latencySumMs;
+		}
+
+		printf("\n\n%llu reads from %d unit(s) in %.1f s", (unsigned long long) reads, fleet->nUnits, (logger_time_ms() - fleet->startMs) / 1000.0);
+
+		if (nEmulated > 0 && reads > 0)
+		{
+			printf(", mean round trip %.2f ms, %llu timeouts", (double) latencySumMs / reads, (unsigned long long) timeouts);
+		}
+
+		printf("\n");
+
+		if (storeOpen)
+		{
+			if (store.rowsAppended > 0)
+			{
+				/* Summaries come from the rollups, without reading the rows back */
+				nPoints = ts_store_query(&store, TS_LEVEL_MINUTE, 0, store.lastMs - 9 * ts_level_period_ms(TS_LEVEL_MINUTE), store.lastMs, points, 10);
+
+				printf("\nMinute rollups of %s Ch %d:\n", fleet->units[0].name, channels[0]);
+
+				for (u = 0; u < nPoints; u++)
+				{
+					printf("%lld: min %.3f, max %.3f, mean %.3f (%u readings)\n", (long long) points[u].timeMs / 1000,
+						points[u].min, points[u].max, points[u].mean, points[u].count);
+				}
+			}
+
+			ts_store_close(&store);
+		}
+
+		free(row);
+	}
+
+	for (u = 0; u < fleet->nUnits; u++)
+	{
+		if (fleet->units[u].handle > 0)
+		{
+			UsbPt104CloseUnit(fleet->units[u].handle);
+		}
+	}
+
+	fleet_close(fleet);
+	free(fleet);
+}
+
+// Emulates units for testing the fleet poller, with no hardware
+void RunResponder()
+{
+	int32_t nUnits = 0;
+
+	do
+	{
+		printf("Enter the number of units to emulate (1 to %d): ", FLEET_MAX_UNITS);
+		scanf_s("%d", &nUnits);
+	} while (nUnits < 1 || nUnits > FLEET_MAX_UNITS);
+
+	g_status = fleet_responder_run(FLEET_RESPONDER_PORT, (int16_t) nUnits, CONVERSION_MS, _kbhit);
+
+	if (g_status != PICO_OK)
+	{
+		printf("Unable to open UDP port %d. Status code: 0x%X\n", FLEET_RESPONDER_PORT, g_status);
+	}
+	else
+	{
+		_getch();
+	}
+}
+
 void EthernetSettings()
 {
 	int32_t tmp;
@@ -414,6 +833,13 @@ void main()
 
 	printf("USB PT-104 (usbpt104) Driver Example Program\n\n");
 
+	// Set default channel settings
+	for (channel = 0; channel < NUM_CHANNELS; channel++)
+	{
+		channelSettings[channel].measurementType	= USBPT104_PT100;
+		channelSettings[channel].noWires			= 4;
+	}
+
 	printf("Enumerating devices...\n\n");
 
 	// Enumerate all USB and Ethernet devices
@@ -434,7 +860,9 @@ void main()
 		printf("\n\n");
 		printf("Select connection:\n");
 		printf("U:\tUSB\n");
-		printf("E:\tEthernet\n\n");
+		printf("E:\tEthernet\n");
+		printf("F:\tFleet of ethernet units\n");
+		printf("R:\tResponder emulating ethernet units\n\n");
 
 		ch = toupper(_getch());
 
@@ -450,6 +878,14 @@ void main()
 			validSelection = 1;
 			break;
 
+		case 'F':
+			FleetPolling();
+			return;
+
+		case 'R':
+			RunResponder();
+			return;
+
 		default:
 			printf("Invalid input.\n");
 		}
@@ -485,13 +921,6 @@ void main()
 
 	}
 
-	// Set default channel settings
-	for (channel = 0; channel < NUM_CHANNELS; channel++)
-	{
-		channelSettings[channel].measurementType	= USBPT104_PT100;
-		channelSettings[channel].noWires			= 4;
-	}
-
 	// Get unit information
 	for (i = 0; i < 7; i++)
 	{
@@ -518,6 +947,7 @@ void main()
 		printf("S:\tStart Aquisition\n");
 		printf("C:\tChannel Settings\n");
 		printf("E:\tEthernet Settings\n");
+		printf("L:\tScheduled logging\n");
 		printf("X:\tExit\n\n");
 
 		ch = toupper(_getch());
@@ -541,6 +971,10 @@ void main()
 				EthernetSettings();
 				break;
 
+			case 'L':
+				ScheduledLogging();
+				break;
+
 			case 'X':
 				break;
 
@@ -0,0 +1,79 @@
+/****************************************************************************
+ *
+ * Filename:    LibAdapterusbtc08.c
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This file defines the logger scheduler adapter of the USB TC-08 (see
+ * LibAdapterusbtc08.h).
+ *
+ ****************************************************************************/
+#include <math.h>
+#include "./LibAdapterusbtc08.h"
+
+/****************************************************************************
+* tc08AdapterStart
+****************************************************************************/
+int16_t tc08AdapterStart(void* context)
+{
+	TC08_ADAPTER* adapter = (TC08_ADAPTER*) context;
+
+	return (int16_t) (usb_tc08_run(adapter->handle, adapter->intervalMs) > 0);
+}
+
+/****************************************************************************
+* tc08AdapterPoll
+*
+* Reads the conversions since the last poll as rows of CJC and channels 1
+* to 8. Channel 8 is converted last in each cycle, so it is read first and
+* no more readings than it has are taken from the other channels; any
+* reading taken during the poll stays in the driver until the next one.
+****************************************************************************/
+int32_t tc08AdapterPoll(void* context, float* values, uint32_t maxRows)
+{
+	TC08_ADAPTER* adapter = (TC08_ADAPTER*) context;
+	int16_t overflow = 0;
+	int32_t nRows;
+	int32_t n;
+	int32_t row;
+	int16_t channel;
+
+	nRows = usb_tc08_get_temp(adapter->handle, adapter->temp[USBTC08_MAX_CHANNELS], adapter->times, (int32_t) (maxRows < TC08_ADAPTER_ROWS ? maxRows : TC08_ADAPTER_ROWS),
+		&overflow, USBTC08_MAX_CHANNELS, USBTC08_UNITS_CENTIGRADE, 0);
+
+	if (nRows <= 0)
+	{
+		return nRows;
+	}
+
+	for (channel = USBTC08_CHANNEL_CJC; channel < USBTC08_MAX_CHANNELS; channel++)
+	{
+		n = usb_tc08_get_temp(adapter->handle, adapter->temp[channel], adapter->times, nRows,
+			&overflow, channel, USBTC08_UNITS_CENTIGRADE, 0);
+
+		if (n < 0)
+		{
+			return -1;
+		}
+
+		for (row = 0; row < nRows; row++)
+		{
+			values[row * TC08_ADAPTER_CHANNELS + channel] = row < n ? adapter->temp[channel][row] : NAN;
+		}
+	}
+
+	for (row = 0; row < nRows; row++)
+	{
+		values[row * TC08_ADAPTER_CHANNELS + USBTC08_MAX_CHANNELS] = adapter->temp[USBTC08_MAX_CHANNELS][row];
+	}
+
+	return nRows;
+}
+
+/****************************************************************************
+* tc08AdapterStop
+****************************************************************************/
+void tc08AdapterStop(void* context)
+{
+	usb_tc08_stop(((TC08_ADAPTER*) context)->handle);
+}
@@ -0,0 +1,45 @@
+/****************************************************************************
+ *
+ * Filename:    LibAdapterusbtc08.h
+ * Copyright:   Pico Technology Limited 2025
+ * Description:
+ *
+ * This header defines the logger scheduler adapter (see
+ * PicoLoggerScheduler.h) of the USB TC-08. The unit runs in streaming
+ * mode and each poll reads the conversions buffered by the driver as rows
+ * of CJC and channels 1 to 8.
+ *
+ * The names are prefixed with the family, so one program can register
+ * adapters of several logger families with the same scheduler.
+ *
+ ****************************************************************************/
+#ifndef __LIBADAPTERUSBTC08_H__
+#define __LIBADAPTERUSBTC08_H__
+
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include "usbtc08.h"
+#else
+#include <libusbtc08/usbtc08.h>
+#endif
+
+#define TC08_ADAPTER_CHANNELS	(USBTC08_MAX_CHANNELS + 1)	// CJC and 8 thermocouple channels
+#define TC08_ADAPTER_ROWS		16							// Readings per channel taken in one poll
+
+/* A unit hosted by the logger scheduler */
+typedef struct tTc08Adapter
+{
+	int16_t		handle;
+	int32_t		intervalMs;
+	float		temp[TC08_ADAPTER_CHANNELS][TC08_ADAPTER_ROWS];
+	int32_t		times[TC08_ADAPTER_ROWS];
+}TC08_ADAPTER;
+
+// Function prototypes
+int16_t tc08AdapterStart(void* context);
+int32_t tc08AdapterPoll(void* context, float* values, uint32_t maxRows);
+void tc08AdapterStop(void* context);
+
+#endif
@@ -10,6 +10,8 @@
  * Examples:
  *    Collect a single reading from each channel
  *    Collect readings continuously from each channel
+ *    Log all channels of every connected unit into one time-aligned file
+ *    Log through the multi-rate logger scheduler
  *
  * To build this application:-
  *
@@ -43,11 +45,15 @@
  *
  ******************************************************************************/
 #include <stdio.h>
+#include <time.h>
+#include <math.h>
 
 /* Headers for Windows */
 #ifdef _WIN32
 #include "windows.h"
 #include <conio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "usbtc08.h"
 #else
 #include <sys/types.h>
@@ -122,10 +128,438 @@ int32_t fopen_s(FILE ** a, const char * b, const char * c)
 #define min(a,b) ((a) < (b) ? a : b)
 #endif
 
+#include "../../shared/PicoLoggerRing.h"
+#include "../../shared/PicoTimeSeries.h"
+#include "../../shared/PicoLoggerScheduler.h"
+#include "../shared/LibAdapterusbtc08.h"
+
 #define PREF4 __stdcall
 
 #define BUFFER_SIZE 1000	// Buffer size to be used for streaming mode captures
 
+#define MAX_TC08_UNITS		64		// Units opened for multi-unit logging
+#define TC08_CHANNELS		(USBTC08_MAX_CHANNELS + 1)	// CJC and 8 thermocouple channels
+#define RING_ROWS			1024	// Time slots kept in the logger ring
+#define RING_SETTLE_ROWS	2		// Newest slots left for units that report late
+
+/* One opened unit in multi-unit logging */
+typedef struct tTc08Unit
+{
+	int16_t		handle;
+	char		serial[USBTC08_MAX_SERIAL_CHARS];
+	int32_t		intervalMs;		/* usb_tc08_get_minimum_interval_ms for the unit */
+	int64_t		startMs;		/* logger_time_ms when the unit was set running */
+	int16_t		failed;			/* usb_tc08_get_temp returned an error */
+}TC08_UNIT;
+
+/* Multi-unit logging service shared with the poll thread */
+typedef struct tTc08Service
+{
+	TC08_UNIT		units[MAX_TC08_UNITS];
+	int16_t			nUnits;
+	int32_t			intervalMs;		/* Poll period and ring time slot, the shortest unit interval */
+	LOGGER_RING		ring;
+	volatile int16_t	stop;
+#ifdef _WIN32
+	HANDLE			thread;
+#else
+	pthread_t		thread;
+#endif
+}TC08_SERVICE;
+
+/****************************************************************************
+* pollUnits
+*
+* Poll thread of the multi-unit logging service. Once per interval it
+* drains the readings of every channel of every unit into the logger
+* ring, then sleeps until the next interval, so no core spins while the
+* units convert.
+****************************************************************************/
+#ifdef _WIN32
+static DWORD WINAPI pollUnits(LPVOID parameter)
+#else
+static void* pollUnits(void* parameter)
+#endif
+{
+	TC08_SERVICE* service = (TC08_SERVICE*)parameter;
+	TC08_UNIT* unit;
+	float temp_buffer[BUFFER_SIZE];
+	int32_t times_buffer[BUFFER_SIZE];
+	int16_t overflow = 0;
+	int32_t readingsCollected;
+	int64_t nextPoll = logger_time_ms();
+	int64_t delay;
+	int16_t u;
+	int32_t channel;
+	int32_t reading;
+
+	while (!service->stop)
+	{
+		for (u = 0; u < service->nUnits; u++)
+		{
+			unit = &service->units[u];
+
+			for (channel = 0; channel < TC08_CHANNELS && !unit->failed; channel++)
+			{
+				// Missed readings are filled with NaN, so each reading keeps its time slot
+				readingsCollected = usb_tc08_get_temp(unit->handle, temp_buffer, times_buffer, BUFFER_SIZE, &overflow, (int16_t)channel, USBTC08_UNITS_CENTIGRADE, 1);
+
+				if (readingsCollected < 0)
+				{
+					unit->failed = TRUE;	/* e.g. unplugged, reported by the main thread */
+					break;
+				}
+
+				for (reading = 0; reading < readingsCollected; reading++)
+				{
+					logger_ring_put(&service->ring, unit->startMs + times_buffer[reading], u * TC08_CHANNELS + channel,
+						temp_buffer[reading], overflow ? LOGGER_FLAG_OVERFLOW : 0);
+				}
+			}
+		}
+
+		// Timer: sleep to the next interval rather than a fixed time, so polling does not drift
+		nextPoll += service->intervalMs;
+		delay = nextPoll - logger_time_ms();
+
+		if (delay > 0)
+		{
+			Sleep((uint32_t)delay);
+		}
+		else
+		{
+			nextPoll = logger_time_ms();
+		}
+	}
+	return 0;
+}
+
+/****************************************************************************
+* multiUnitLogging
+*
+* Opens every other connected TC-08 alongside firstHandle, runs each at its
+* minimum interval and logs all channels of all units to tc08_multi.csv,
+* one row per time slot, from a single poll thread. The rows are also
+* appended to the time-series store tc08_multi, which keeps minute, hour
+* and day rollups across runs.
+****************************************************************************/
+static void multiUnitLogging(int16_t firstHandle)
+{
+	TC08_SERVICE* service;
+	USBTC08_INFO unitInfo;
+	FILE* fp = NULL;
+	TS_STORE store;
+	TS_POINT points[10];
+	int32_t nPoints;
+	int16_t storeOpen = FALSE;
+	int64_t wallStartMs;
+	float* values;
+	uint8_t* flags;
+	int64_t timeMs;
+	int64_t firstRowMs = -1;
+	uint32_t nColumns;
+	uint32_t column;
+	uint64_t rows = 0;
+	int32_t retVal;
+	int16_t handle = 0;
+	int16_t u;
+	int16_t nFailed = 0;
+	int32_t channel;
+
+	service = (TC08_SERVICE*)calloc(1, sizeof(TC08_SERVICE));
+
+	if (service == NULL)
+	{
+		return;
+	}
+
+	service->units[service->nUnits++].handle = firstHandle;
+
+	/* Open the other units one after another, without blocking on the firmware download */
+	printf("Looking for more USB TC-08 units: ");
+
+	while (service->nUnits < MAX_TC08_UNITS && usb_tc08_open_unit_async() == 1)
+	{
+		while ((retVal = usb_tc08_open_unit_progress(&handle, NULL)) == USBTC08_PROGRESS_PENDING)
+		{
+			printf("|");
+			fflush(stdout);
+			Sleep(200);
+		}
+
+		if (retVal != USBTC08_PROGRESS_COMPLETE || handle <= 0)
+		{
+			break;
+		}
+
+		retVal = usb_tc08_set_channel(handle, 0, 'C');
+
+		for (channel = 1; channel < TC08_CHANNELS; channel++)
+		{
+			retVal &= usb_tc08_set_channel(handle, (int16_t)channel, 'K');
+		}
+
+		if (!retVal)
+		{
+			printf("\nError setting up channels on a unit, it is not used.\n");
+			usb_tc08_close_unit(handle);
+			continue;
+		}
+
+		service->units[service->nUnits++].handle = handle;
+	}
+
+	printf("\n\n%d unit(s):\n", service->nUnits);
+
+	service->intervalMs = INT32_MAX;
+
+	for (u = 0; u < service->nUnits; u++)
+	{
+		unitInfo.size = sizeof(unitInfo);
+		usb_tc08_get_unit_info(service->units[u].handle, &unitInfo);
+		memcpy_s(service->units[u].serial, USBTC08_MAX_SERIAL_CHARS, unitInfo.szSerial, USBTC08_MAX_SERIAL_CHARS);
+
+		service->units[u].intervalMs = usb_tc08_get_minimum_interval_ms(service->units[u].handle);
+		service->intervalMs = min(service->intervalMs, service->units[u].intervalMs);
+		printf("Unit %d: serial %s, interval %d ms\n", u + 1, service->units[u].serial, service->units[u].intervalMs);
+	}
+
+	nColumns = service->nUnits * TC08_CHANNELS;
+	values = (float*)calloc(nColumns, sizeof(float));
+	flags = (uint8_t*)calloc(nColumns, sizeof(uint8_t));
+
+	if (values == NULL || flags == NULL || !logger_ring_init(&service->ring, nColumns, RING_ROWS, service->intervalMs) ||
+		fopen_s(&fp, "tc08_multi.csv", "w") != 0 || fp == NULL)
+	{
+		printf("Error setting up multi-unit logging.\n");
+	}
+	else
+	{
+		fprintf(fp, "Time (ms)");
+
+		for (u = 0; u < service->nUnits; u++)
+		{
+			for (channel = 0; channel < TC08_CHANNELS; channel++)
+			{
+				fprintf(fp, channel ? ", %s Ch%d" : ", %s CJC", service->units[u].serial, channel);
+			}
+		}
+		fprintf(fp, "\n");
+
+		/* The columns of a store are fixed, so it is only reused with the same number of units */
+		storeOpen = ts_store_open(&store, "tc08_multi", nColumns);
+		wallStartMs = (int64_t)time(NULL) * 1000;
+
+		if (!storeOpen)
+		{
+			printf("Cannot open the time-series store tc08_multi, rows are only written to tc08_multi.csv\n");
+		}
+		else if (store.lastMs >= wallStartMs)
+		{
+			wallStartMs = store.lastMs + 1;
+		}
+
+		/* Set every unit running, recording when each started so their readings can be aligned */
+		for (u = 0; u < service->nUnits; u++)
+		{
+			usb_tc08_run(service->units[u].handle, service->units[u].intervalMs);
+			service->units[u].startMs = logger_time_ms();
+		}
+
+#ifdef _WIN32
+		service->thread = CreateThread(NULL, 0, pollUnits, service, 0, NULL);
+		retVal = (service->thread != NULL);
+#else
+		retVal = (pthread_create(&service->thread, NULL, pollUnits, service) == 0);
+#endif
+
+		if (!retVal)
+		{
+			printf("Error starting the poll thread.\n");
+		}
+		else
+		{
+			printf("\nLogging to tc08_multi.csv (* marks an overflow). Press any key to stop.\n\n");
+
+			while (!service->stop)
+			{
+				service->stop = (int16_t)_kbhit();
+
+				if (service->stop)
+				{
+					/* Wait for the last readings of the poll thread before the final drain */
+#ifdef _WIN32
+					WaitForSingleObject(service->thread, INFINITE);
+					CloseHandle(service->thread);
+#else
+					pthread_join(service->thread, NULL);
+#endif
+				}
+				else
+				{
+					Sleep(service->intervalMs);
+				}
+
+				/* Drain the ring, everything once stopping */
+				while (logger_ring_read(&service->ring, &timeMs, values, flags, service->stop ? 0 : RING_SETTLE_ROWS))
+				{
+					if (firstRowMs < 0)
+					{
+						firstRowMs = timeMs;
+					}
+
+					fprintf(fp, "%lld", (long long)(timeMs - firstRowMs));
+
+					for (column = 0; column < nColumns; column++)
+					{
+						fprintf(fp, (flags[column] & LOGGER_FLAG_OVERFLOW) ? ", %.2f*" : ", %.2f", values[column]);
+					}
+					fprintf(fp, "\n");
+					rows++;
+
+					if (storeOpen)
+					{
+						ts_store_append(&store, wallStartMs + timeMs - firstRowMs, values);
+					}
+				}
+
+				for (u = 0; u < service->nUnits; u++)
+				{
+					if (service->units[u].failed == TRUE)
+					{
+						printf("Error while streaming from unit %d (%s), its channels are empty from now on.\n", u + 1, service->units[u].serial);
+						service->units[u].failed = 2;	/* Reported */
+						nFailed++;
+					}
+				}
+
+				printf("\r%llu rows, %d unit(s) logging   ", (unsigned long long)rows, service->nUnits - nFailed);
+				fflush(stdout);
+			}
+
+			printf("\n\n%llu rows written to tc08_multi.csv, %llu rows lost, %llu late readings\n",
+				(unsigned long long)rows, (unsigned long long)service->ring.rowsLost, (unsigned long long)service->ring.lateValues);
+
+			if (storeOpen && rows > 0)
+			{
+				/* Summaries come from the rollups, without reading the rows back */
+				nPoints = ts_store_query(&store, TS_LEVEL_MINUTE, 1, store.lastMs - 9 * ts_level_period_ms(TS_LEVEL_MINUTE), store.lastMs, points, 10);
+
+				printf("\nMinute rollups of %s Ch1:\n", service->units[0].serial);
+
+				for (u = 0; u < nPoints; u++)
+				{
+					printf("%lld: min %.2f, max %.2f, mean %.2f (%u readings)\n", (long long)points[u].timeMs / 1000,
+						points[u].min, points[u].max, points[u].mean, points[u].count);
+				}
+			}
+		}
+
+		if (storeOpen)
+		{
+			ts_store_close(&store);
+		}
+
+		for (u = 0; u < service->nUnits; u++)
+		{
+			usb_tc08_stop(service->units[u].handle);
+		}
+	}
+
+	if (fp != NULL)
+	{
+		fclose(fp);
+	}
+
+	/* Keep the first unit open for the rest of the example */
+	for (u = 1; u < service->nUnits; u++)
+	{
+		usb_tc08_close_unit(service->units[u].handle);
+	}
+
+	logger_ring_free(&service->ring);
+	free(values);
+	free(flags);
+	free(service);
+}
+
+/****************************************************************************
+* scheduledLogging
+*
+* Logs the unit through the logger scheduler, which can host units of the
+* other logger families alongside it in the same loop. Rows are written
+* to tc08_scheduled.csv.
+****************************************************************************/
+static void scheduledLogging(int16_t handle)
+{
+	LOGGER_SCHEDULER * sched;
+	TC08_ADAPTER * context;
+	LOGGER_ADAPTER adapter;
+	FILE * fp = NULL;
+	int16_t channel;
+
+	sched = (LOGGER_SCHEDULER *) calloc(1, sizeof(LOGGER_SCHEDULER));
+	context = (TC08_ADAPTER *) calloc(1, sizeof(TC08_ADAPTER));
+	fopen_s(&fp, "tc08_scheduled.csv", "w");
+
+	if (sched == NULL || context == NULL || fp == NULL)
+	{
+		printf("\nUnable to set up scheduled logging.\n");
+	}
+	else
+	{
+		context->handle = handle;
+		context->intervalMs = usb_tc08_get_minimum_interval_ms(handle);
+
+		memset(&adapter, 0, sizeof(LOGGER_ADAPTER));
+		strcpy(adapter.name, "TC-08");
+		adapter.context = context;
+		adapter.nColumns = TC08_CHANNELS;
+		adapter.periodMs = (uint32_t) context->intervalMs;
+		adapter.pollMs = (uint32_t) context->intervalMs;	/* The unit buffers its readings, read about one a poll */
+		adapter.maxRows = TC08_ADAPTER_ROWS;
+		adapter.start = tc08AdapterStart;
+		adapter.poll = tc08AdapterPoll;
+		adapter.stop = tc08AdapterStop;
+
+		fprintf(fp, "Time (s), Unit, CJC");
+
+		for (channel = (int16_t) USBTC08_CHANNEL_1; channel <= USBTC08_MAX_CHANNELS; channel++)
+		{
+			fprintf(fp, ", Ch%d", channel);
+		}
+
+		fprintf(fp, "\n");
+
+		logger_sched_init(sched, logger_sched_csv_sink, fp);
+		logger_sched_add(sched, &adapter);
+
+		if (!logger_sched_start(sched))
+		{
+			printf("\nError starting the unit.\n");
+		}
+		else
+		{
+			printf("\nLogging every %d ms to tc08_scheduled.csv. Press any key to stop.\n", context->intervalMs);
+			logger_sched_run(sched, _kbhit);
+			_getch();
+			logger_sched_stop(sched);
+			printf("\n");
+			logger_sched_print_stats(sched);
+		}
+
+		logger_sched_free(sched);
+	}
+
+	if (fp != NULL)
+	{
+		fclose(fp);
+	}
+
+	free(context);
+	free(sched);
+}
+
 int32_t main(void)
 {
 	int16_t handle = 0;									/* The handle to a TC-08 returned by usb_tc08_open_unit() or usb_tc08_open_unit_progress() */
@@ -229,6 +663,8 @@ int32_t main(void)
 		printf("------------------------------------------------------------\n\n");
 		printf("S - Single reading on all channels\n");
 		printf("C - Continuous reading on all channels\n");
+		printf("M - Multi-unit logging of every connected unit\n");
+		printf("L - Scheduled logging through the logger scheduler\n");
 		printf("X - Close the USB TC08 and exit \n");
 		
 		while (0 == scanf_s(" %c", &selection, 1))
@@ -291,6 +727,11 @@ int32_t main(void)
 						{
 							// Request temperature data, a negative value indicates an error
 							readingsCollected = usb_tc08_get_temp(handle, temp_buffer[channel], times_buffer, BUFFER_SIZE, &overflows[channel], channel, USBTC08_UNITS_CENTIGRADE, 1);
+
+							if (readingsCollected == 0)
+							{
+								Sleep(minimumIntervalMs / 10);	// Wait for the next conversion rather than spinning
+							}
 						}
 						while(readingsCollected == 0);
 
@@ -326,6 +767,16 @@ int32_t main(void)
 
 				usb_tc08_stop(handle);
 				break;
+
+			case 'M':
+			case 'm': /* Multi-unit logging */
+				multiUnitLogging(handle);
+				break;
+
+			case 'L':
+			case 'l': /* Scheduled logging */
+				scheduledLogging(handle);
+				break;
 		}
 		
 	} while (selection != 'X' && selection != 'x');